@@ -23,10 +23,15 @@
 	#include <netinet/in.h>
 	#include <fcntl.h>
 	#include <pthread.h>
+	#include <sched.h>
 	#include <arpa/inet.h>
 
 	#include <dirent.h>
 
+	#if defined(CONF_PLATFORM_LINUX)
+		#include <sys/inotify.h>
+	#endif
+
 	#if defined(CONF_PLATFORM_MACOSX)
 		#include <Carbon/Carbon.h>
 	#endif
@@ -40,6 +45,7 @@
 	#include <fcntl.h>
 	#include <direct.h>
 	#include <errno.h>
+	#include <sys/stat.h>
 #else
 	#error NOT IMPLEMENTED
 #endif
@@ -60,7 +66,6 @@ static DBG_LOGGER loggers[16];
 static int num_loggers = 0;
 
 static NETSTATS network_stats = {0};
-static MEMSTATS memory_stats = {0};
 
 static NETSOCKET invalid_socket = {NETTYPE_INVALID, -1, -1};
 
@@ -149,13 +154,46 @@ void dbg_logger_file(const char *filename)
 }
 /* */
 
+/* the counters are shared by all threads, they are only ever added to atomically */
+static volatile int memory_counters[NUM_MEMTAGS][3];
+static MEMSTATS memory_stats = {0};
+static MEMSTATS memory_tag_stats[NUM_MEMTAGS];
+
+static const char *memory_tag_names[NUM_MEMTAGS] = {
+	"other",
+	"net",
+	"snapshot",
+	"map",
+	"game",
+	"console",
+};
+
+static void mem_count(int tag, int size, int allocations)
+{
+#if defined(CONF_FAMILY_WINDOWS)
+	InterlockedExchangeAdd((volatile long *)&memory_counters[tag][0], size);
+	InterlockedExchangeAdd((volatile long *)&memory_counters[tag][1], allocations);
+	if(allocations > 0)
+		InterlockedIncrement((volatile long *)&memory_counters[tag][2]);
+#else
+	__sync_fetch_and_add(&memory_counters[tag][0], size);
+	__sync_fetch_and_add(&memory_counters[tag][1], allocations);
+	if(allocations > 0)
+		__sync_fetch_and_add(&memory_counters[tag][2], 1);
+#endif
+}
+
+#if defined(CONF_DEBUG)
+/* padded to a multiple of 16 bytes to keep the blocks aligned like malloc does */
 typedef struct MEMHEADER
 {
 	const char *filename;
-	int line;
-	int size;
 	struct MEMHEADER *prev;
 	struct MEMHEADER *next;
+	int line;
+	int size;
+	int tag;
+	char padding[16 - (3*sizeof(void *) + 3*sizeof(int)) % 16];
 } MEMHEADER;
 
 typedef struct MEMTAIL
@@ -166,31 +204,71 @@ typedef struct MEMTAIL
 static struct MEMHEADER *first = 0;
 static const int MEM_GUARD_VAL = 0xbaadc0de;
 
-void *mem_alloc_debug(const char *filename, int line, unsigned size, unsigned alignment)
+/* the block list can't use a LOCK, lock_create allocates itself */
+static volatile long memory_list_lock = 0;
+
+static void mem_list_lock()
+{
+#if defined(CONF_FAMILY_WINDOWS)
+	while(InterlockedExchange(&memory_list_lock, 1))
+		Sleep(0);
+#else
+	while(__sync_lock_test_and_set(&memory_list_lock, 1))
+		sched_yield();
+#endif
+}
+
+static void mem_list_unlock()
+{
+#if defined(CONF_FAMILY_WINDOWS)
+	InterlockedExchange(&memory_list_lock, 0);
+#else
+	__sync_lock_release(&memory_list_lock);
+#endif
+}
+#else
+/* only what mem_free needs, padded to keep the blocks aligned like malloc does */
+typedef struct MEMHEADER
+{
+	int size;
+	int tag;
+	int padding[2];
+} MEMHEADER;
+#endif
+
+void *mem_alloc_debug(const char *filename, int line, unsigned size, unsigned alignment, int tag)
 {
 	/* TODO: fix alignment */
-	/* TODO: add debugging */
+	MEMHEADER *header;
+#if defined(CONF_DEBUG)
 	MEMTAIL *tail;
-	MEMHEADER *header = (struct MEMHEADER *)malloc(size+sizeof(MEMHEADER)+sizeof(MEMTAIL));
+	header = (struct MEMHEADER *)malloc(size+sizeof(MEMHEADER)+sizeof(MEMTAIL));
+#else
+	header = (struct MEMHEADER *)malloc(size+sizeof(MEMHEADER));
+#endif
 	dbg_assert(header != 0, "mem_alloc failure");
 	if(!header)
 		return NULL;
-	tail = (struct MEMTAIL *)(((char*)(header+1))+size);
+	if(tag < 0 || tag >= NUM_MEMTAGS)
+		tag = MEMTAG_OTHER;
 	header->size = size;
+	header->tag = tag;
+	mem_count(tag, size, 1);
+
+#if defined(CONF_DEBUG)
+	tail = (struct MEMTAIL *)(((char*)(header+1))+size);
 	header->filename = filename;
 	header->line = line;
-
-	memory_stats.allocated += header->size;
-	memory_stats.total_allocations++;
-	memory_stats.active_allocations++;
-
 	tail->guard = MEM_GUARD_VAL;
 
+	mem_list_lock();
 	header->prev = (MEMHEADER *)0;
 	header->next = first;
 	if(first)
 		first->prev = header;
 	first = header;
+	mem_list_unlock();
+#endif
 
 	/*dbg_msg("mem", "++ %p", header+1); */
 	return header+1;
@@ -201,20 +279,23 @@ void mem_free(void *p)
 	if(p)
 	{
 		MEMHEADER *header = (MEMHEADER *)p - 1;
+#if defined(CONF_DEBUG)
 		MEMTAIL *tail = (MEMTAIL *)(((char*)(header+1))+header->size);
 
 		if(tail->guard != MEM_GUARD_VAL)
 			dbg_msg("mem", "!! %p", p);
-		/* dbg_msg("mem", "-- %p", p); */
-		memory_stats.allocated -= header->size;
-		memory_stats.active_allocations--;
 
+		mem_list_lock();
 		if(header->prev)
 			header->prev->next = header->next;
 		else
 			first = header->next;
 		if(header->next)
 			header->next->prev = header->prev;
+		mem_list_unlock();
+#endif
+		/* dbg_msg("mem", "-- %p", p); */
+		mem_count(header->tag, -header->size, -1);
 
 		free(header);
 	}
@@ -223,20 +304,35 @@ void mem_free(void *p)
 void mem_debug_dump(IOHANDLE file)
 {
 	char buf[1024];
-	MEMHEADER *header = first;
+	int i;
 	if(!file)
 		file = io_open("memory.txt", IOFLAG_WRITE);
 
 	if(file)
 	{
-		while(header)
+		for(i = 0; i < NUM_MEMTAGS; i++)
 		{
-			str_format(buf, sizeof(buf), "%s(%d): %d", header->filename, header->line, header->size);
+			const MEMSTATS *stats = mem_stats_tag(i);
+			str_format(buf, sizeof(buf), "%s: %d bytes in %d blocks, %d allocations", memory_tag_names[i],
+				stats->allocated, stats->active_allocations, stats->total_allocations);
 			io_write(file, buf, strlen(buf));
 			io_write_newline(file);
-			header = header->next;
 		}
 
+#if defined(CONF_DEBUG)
+		{
+			MEMHEADER *header;
+			mem_list_lock();
+			for(header = first; header; header = header->next)
+			{
+				str_format(buf, sizeof(buf), "%s(%d): %d %s", header->filename, header->line, header->size, memory_tag_names[header->tag]);
+				io_write(file, buf, strlen(buf));
+				io_write_newline(file);
+			}
+			mem_list_unlock();
+		}
+#endif
+
 		io_close(file);
 	}
 }
@@ -259,19 +355,25 @@ void mem_zero(void *block,unsigned size)
 
 int mem_check_imp()
 {
-	MEMHEADER *header = first;
-	while(header)
+#if defined(CONF_DEBUG)
+	int result = 1;
+	MEMHEADER *header;
+	mem_list_lock();
+	for(header = first; header; header = header->next)
 	{
 		MEMTAIL *tail = (MEMTAIL *)(((char*)(header+1))+header->size);
 		if(tail->guard != MEM_GUARD_VAL)
 		{
 			dbg_msg("mem", "Memory check failed at %s(%d): %d", header->filename, header->line, header->size);
-			return 0;
+			result = 0;
+			break;
 		}
-		header = header->next;
 	}
-
+	mem_list_unlock();
+	return result;
+#else
 	return 1;
+#endif
 }
 
 IOHANDLE io_open(const char *filename, int flags)
@@ -537,7 +639,21 @@ void lock_release(LOCK lock)
 
 
 /* -----  time ----- */
+static int64 virtual_time = -1;
+
 int64 time_get()
+{
+	if(virtual_time >= 0)
+		return virtual_time;
+	return time_get_real();
+}
+
+void time_set_virtual(int64 time)
+{
+	virtual_time = time;
+}
+
+int64 time_get_real()
 {
 #if defined(CONF_FAMILY_UNIX)
 	struct timeval val;
@@ -1484,6 +1600,99 @@ int fs_rename(const char *oldname, const char *newname)
 	return 0;
 }
 
+struct FSWATCHINTERNAL
+{
+#if defined(CONF_PLATFORM_LINUX)
+	int fd;
+	char name[256];
+#else
+	char path[512];
+	time_t mtime;
+#endif
+};
+
+FSWATCH fs_watch_create(const char *filename)
+{
+	FSWATCH watch = (FSWATCH)mem_alloc(sizeof(struct FSWATCHINTERNAL), 1);
+#if defined(CONF_PLATFORM_LINUX)
+	/* watch the directory, editors often replace the file instead of writing it */
+	char dir[512];
+	const char *name = filename;
+	const char *p;
+	for(p = filename; *p; p++)
+		if(*p == '/')
+			name = p+1;
+
+	if(name == filename)
+		str_copy(dir, ".", sizeof(dir));
+	else if(name-filename < (int)sizeof(dir))
+		str_copy(dir, filename, (int)(name-filename)+1); /* keeps the slash */
+	else
+	{
+		mem_free(watch);
+		return 0;
+	}
+	str_copy(watch->name, name, sizeof(watch->name));
+
+	watch->fd = inotify_init();
+	if(watch->fd < 0 || inotify_add_watch(watch->fd, dir, IN_CLOSE_WRITE|IN_MOVED_TO) < 0)
+	{
+		if(watch->fd >= 0)
+			close(watch->fd);
+		mem_free(watch);
+		return 0;
+	}
+	fcntl(watch->fd, F_SETFL, fcntl(watch->fd, F_GETFL) | O_NONBLOCK);
+#else
+	struct stat sb;
+	if(stat(filename, &sb) != 0)
+	{
+		mem_free(watch);
+		return 0;
+	}
+	str_copy(watch->path, filename, sizeof(watch->path));
+	watch->mtime = sb.st_mtime;
+#endif
+	return watch;
+}
+
+int fs_watch_changed(FSWATCH watch)
+{
+#if defined(CONF_PLATFORM_LINUX)
+	char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	int changed = 0;
+	int bytes;
+	while((bytes = read(watch->fd, buffer, sizeof(buffer))) > 0)
+	{
+		int offset = 0;
+		while(offset < bytes)
+		{
+			const struct inotify_event *event = (const struct inotify_event *)(buffer+offset);
+			if(event->len && str_comp(event->name, watch->name) == 0)
+				changed = 1;
+			offset += sizeof(struct inotify_event) + event->len;
+		}
+	}
+	return changed;
+#else
+	struct stat sb;
+	if(stat(watch->path, &sb) != 0 || sb.st_mtime == watch->mtime)
+		return 0;
+	watch->mtime = sb.st_mtime;
+	return 1;
+#endif
+}
+
+void fs_watch_destroy(FSWATCH watch)
+{
+	if(!watch)
+		return;
+#if defined(CONF_PLATFORM_LINUX)
+	close(watch->fd);
+#endif
+	mem_free(watch);
+}
+
 void swap_endian(void *data, unsigned elem_size, unsigned num)
 {
 	char *src = (char*) data;
@@ -1545,6 +1754,42 @@ int net_socket_read_wait(NETSOCKET sock, int time)
 	return 0;
 }
 
+int net_socket_wait(const NETSOCKET *socks, const int *write, int num, int time)
+{
+	struct timeval tv;
+	fd_set readfds;
+	fd_set writefds;
+	int sockid = 0;
+	int i;
+
+	tv.tv_sec = time/1000;
+	tv.tv_usec = 1000*(time%1000);
+
+	FD_ZERO(&readfds);
+	FD_ZERO(&writefds);
+	for(i = 0; i < num; i++)
+	{
+		if(socks[i].ipv4sock >= 0)
+		{
+			FD_SET(socks[i].ipv4sock, &readfds);
+			if(write && write[i])
+				FD_SET(socks[i].ipv4sock, &writefds);
+			if(socks[i].ipv4sock > sockid)
+				sockid = socks[i].ipv4sock;
+		}
+		if(socks[i].ipv6sock >= 0)
+		{
+			FD_SET(socks[i].ipv6sock, &readfds);
+			if(write && write[i])
+				FD_SET(socks[i].ipv6sock, &writefds);
+			if(socks[i].ipv6sock > sockid)
+				sockid = socks[i].ipv6sock;
+		}
+	}
+
+	return select(sockid+1, &readfds, &writefds, NULL, &tv);
+}
+
 int time_timestamp()
 {
 	return time(0);
@@ -1778,9 +2023,33 @@ int mem_comp(const void *a, const void *b, int size)
 
 const MEMSTATS *mem_stats()
 {
+	int i;
+	memory_stats.allocated = 0;
+	memory_stats.active_allocations = 0;
+	memory_stats.total_allocations = 0;
+	for(i = 0; i < NUM_MEMTAGS; i++)
+	{
+		memory_stats.allocated += memory_counters[i][0];
+		memory_stats.active_allocations += memory_counters[i][1];
+		memory_stats.total_allocations += memory_counters[i][2];
+	}
 	return &memory_stats;
 }
 
+const MEMSTATS *mem_stats_tag(int tag)
+{
+	MEMSTATS *stats = &memory_tag_stats[tag];
+	stats->allocated = memory_counters[tag][0];
+	stats->active_allocations = memory_counters[tag][1];
+	stats->total_allocations = memory_counters[tag][2];
+	return stats;
+}
+
+const char *mem_tag_name(int tag)
+{
+	return memory_tag_names[tag];
+}
+
 void net_stats(NETSTATS *stats_inout)
 {
 	*stats_inout = network_stats;
@@ -71,6 +71,18 @@ void dbg_msg(const char *sys, const char *fmt, ...);
 
 /* Group: Memory */
 
+/* subsystems the allocations are counted for */
+enum
+{
+	MEMTAG_OTHER=0,
+	MEMTAG_NET,
+	MEMTAG_SNAPSHOT,
+	MEMTAG_MAP,
+	MEMTAG_GAME,
+	MEMTAG_CONSOLE,
+	NUM_MEMTAGS
+};
+
 /*
 	Function: mem_alloc
 		Allocates memory.
@@ -86,12 +98,28 @@ void dbg_msg(const char *sys, const char *fmt, ...);
 	Remarks:
 		- Passing 0 to size will allocated the smallest amount possible
 		and return a unique pointer.
+		- The function is thread safe. Only the debug version of the
+		library keeps a list of all blocks and guards their ends.
 
 	See Also:
-		<mem_free>
+		<mem_free>, <mem_alloc_tag>
 */
-void *mem_alloc_debug(const char *filename, int line, unsigned size, unsigned alignment);
-#define mem_alloc(s,a) mem_alloc_debug(__FILE__, __LINE__, (s), (a))
+void *mem_alloc_debug(const char *filename, int line, unsigned size, unsigned alignment, int tag);
+#define mem_alloc(s,a) mem_alloc_debug(__FILE__, __LINE__, (s), (a), MEMTAG_OTHER)
+
+/*
+	Function: mem_alloc_tag
+		Allocates memory that is counted for a subsystem.
+
+	Parameters:
+		size - Size of the needed block.
+		alignment - Alignment for the block.
+		tag - One of the MEMTAG_* values.
+
+	See Also:
+		<mem_alloc>, <mem_stats_tag>
+*/
+#define mem_alloc_tag(s,a,t) mem_alloc_debug(__FILE__, __LINE__, (s), (a), (t))
 
 /*
 	Function: mem_free
@@ -173,6 +201,9 @@ int mem_comp(const void *a, const void *b, int size);
 	Function: mem_check
 		Validates the heap
 		Will trigger a assert if memory has failed.
+
+	Remarks:
+		- Does nothing in release version of the library.
 */
 int mem_check_imp();
 #define mem_check() dbg_assert_imp(__FILE__, __LINE__, mem_check_imp(), "Memory check failed")
@@ -459,6 +490,27 @@ typedef long long int64;
 */
 int64 time_get();
 
+/*
+	Function: time_get_real
+		Fetches a sample from the high resolution timer, ignoring
+		<time_set_virtual>.
+
+	Returns:
+		Current value of the timer.
+*/
+int64 time_get_real();
+
+/*
+	Function: time_set_virtual
+		Makes <time_get> return a given value instead of the timer.
+		Used to replay recorded sessions faster than real time.
+
+	Parameters:
+		time - Value <time_get> returns from now on, in <time_freq>
+			units. A negative value switches back to the timer.
+*/
+void time_set_virtual(int64 time);
+
 /*
 	Function: time_freq
 		Returns the frequency of the high resolution timer.
@@ -1135,6 +1187,46 @@ int fs_remove(const char *filename);
 */
 int fs_rename(const char *oldname, const char *newname);
 
+typedef struct FSWATCHINTERNAL *FSWATCH;
+
+/*
+	Function: fs_watch_create
+		Starts watching a file for changes.
+
+	Parameters:
+		filename - The file to watch
+
+	Returns:
+		Returns a handle to the watch on success, 0 on failure.
+
+	Remarks:
+		- Uses inotify on linux, so replacing the file (like most
+		  editors do when saving) is noticed as well. Other platforms
+		  compare the modification time.
+*/
+FSWATCH fs_watch_create(const char *filename);
+
+/*
+	Function: fs_watch_changed
+		Checks if the file was written since the last call, never blocks.
+
+	Parameters:
+		watch - Watch to check
+
+	Returns:
+		Returns 1 if the file changed, 0 otherwise.
+*/
+int fs_watch_changed(FSWATCH watch);
+
+/*
+	Function: fs_watch_destroy
+		Stops watching the file and frees the watch.
+
+	Parameters:
+		watch - Watch to destroy
+*/
+void fs_watch_destroy(FSWATCH watch);
+
 /*
 	Group: Undocumented
 */
@@ -1177,6 +1269,22 @@ int net_would_block();
 
 int net_socket_read_wait(NETSOCKET sock, int time);
 
+/*
+	Function: net_socket_wait
+		Waits until one of the sockets can be read from or, if asked
+		for, written to.
+
+	Parameters:
+		socks - The sockets to wait for.
+		write - Per socket, whether it may become writable as well. Can be 0.
+		num - Number of sockets.
+		time - Time to wait at most in milliseconds.
+
+	Returns:
+		Number of ready sockets, 0 on a timeout. Negative value on failure.
+*/
+int net_socket_wait(const NETSOCKET *socks, const int *write, int num, int time);
+
 void mem_debug_dump(IOHANDLE file);
 
 void swap_endian(void *data, unsigned elem_size, unsigned num);
@@ -1196,8 +1304,31 @@ typedef struct
 	int total_allocations;
 } MEMSTATS;
 
+/*
+	Function: mem_stats
+		Returns the statistics of all allocations.
+
+	Remarks:
+		- The counters are updated without locks, the sum is built
+		on every call and is not thread safe.
+*/
 const MEMSTATS *mem_stats();
 
+/*
+	Function: mem_stats_tag
+		Returns the statistics of the allocations of a subsystem.
+
+	Parameters:
+		tag - One of the MEMTAG_* values.
+*/
+const MEMSTATS *mem_stats_tag(int tag);
+
+/*
+	Function: mem_tag_name
+		Returns the name of a subsystem tag.
+*/
+const char *mem_tag_name(int tag);
+
 typedef struct
 {
 	int sent_packets;
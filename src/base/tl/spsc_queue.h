@@ -0,0 +1,67 @@
+/* File is created for the TW+ mod
+ */
+#ifndef BASE_TL_SPSC_QUEUE_H
+#define BASE_TL_SPSC_QUEUE_H
+
+#include "threading.h"
+
+/*
+	Class: spsc_queue
+		Fixed size queue between exactly one producer and one consumer
+		thread, without locks
+
+	Remarks:
+		- SIZE must be a power of two
+		- push() may only be called by the producer, pop() only by the
+		  consumer. empty() and size() are a snapshot for either side
+*/
+template <class T, unsigned SIZE>
+class spsc_queue
+{
+	T items[SIZE];
+	volatile unsigned read_index;
+	volatile unsigned write_index;
+
+public:
+	spsc_queue()
+	{
+		read_index = 0;
+		write_index = 0;
+	}
+
+	/*
+		Function: push
+			Copies the item into the queue, returns false if it is full
+	*/
+	bool push(const T &item)
+	{
+		unsigned index = write_index;
+		if(index - read_index == SIZE)
+			return false;
+		items[index%SIZE] = item;
+		sync_barrier();
+		write_index = index+1;
+		return true;
+	}
+
+	/*
+		Function: pop
+			Takes the oldest item out of the queue, returns false if it is empty
+	*/
+	bool pop(T *item)
+	{
+		unsigned index = read_index;
+		if(index == write_index)
+			return false;
+		sync_barrier();
+		*item = items[index%SIZE];
+		sync_barrier();
+		read_index = index+1;
+		return true;
+	}
+
+	bool empty() const { return read_index == write_index; }
+	unsigned size() const { return write_index - read_index; }
+};
+
+#endif
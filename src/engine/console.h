@@ -63,6 +63,7 @@ public:
 	typedef void (*FPossibleCallback)(const char *pCmd, void *pUser);
 	typedef void (*FCommandCallback)(IResult *pResult, void *pUserData);
 	typedef void (*FChainCommandCallback)(IResult *pResult, void *pUserData, FCommandCallback pfnCallback, void *pCallbackUserData);
+	typedef void (*FConfigCallback)(int Variable, void *pUserData);
 
 	virtual const CCommandInfo *FirstCommandInfo(int AccessLevel, int Flagmask) const = 0;
 	virtual const CCommandInfo *GetCommandInfo(const char *pName, int FlagMask, bool Temp) = 0;
@@ -74,6 +75,15 @@ public:
 	virtual void DeregisterTemp(const char *pName) = 0;
 	virtual void DeregisterTempAll() = 0;
 	virtual void Chain(const char *pName, FChainCommandCallback pfnChainFunc, void *pUser) = 0;
+
+	/*
+		Function: RegisterConfigCallback
+			Calls the function whenever the config variable (one of the
+			CONFIG_* ids) gets a new value. Code that writes g_Config
+			directly has to call ConfigChanged itself.
+	*/
+	virtual void RegisterConfigCallback(int Variable, FConfigCallback pfnFunc, void *pUserData) = 0;
+	virtual void ConfigChanged(int Variable) = 0;
 	virtual void StoreCommands(bool Store) = 0;
 
 	virtual bool LineIsValid(const char *pStr) = 0;
@@ -26,6 +26,12 @@ public:
 		const char *m_pName;
 		int m_Latency;
 		int m_DDNetVersion;
+		int m_LateInputs;
+		int m_DuplicateInputs;
+		int m_Rtt; // smoothed round trip time of the connection in ms, -1 if unknown
+		int m_RttVar;
+		int m_VitalChunks;
+		int m_Resends; // vital chunks that had to be sent again
 	};
 
 	int Tick() const { return m_CurrentGameTick; }
@@ -38,6 +44,10 @@ public:
 	virtual bool ClientIngame(int ClientID) = 0;
 	virtual int GetClientInfo(int ClientID, CClientInfo *pInfo) = 0;
 	virtual void GetClientAddr(int ClientID, char *pAddrStr, int Size) = 0;
+	// the client's address with the port zeroed, false if the client is not ingame
+	virtual bool GetClientAddr(int ClientID, NETADDR *pAddr) = 0;
+	// the server info has to be rebuilt, e.g. after a team change
+	virtual void ExpireServerInfo() = 0;
 
 	virtual int SendMsg(CMsgPacker *pMsg, int Flags, int ClientID) = 0;
 
@@ -60,6 +70,10 @@ public:
 	virtual void SnapFreeID(int ID) = 0;
 	virtual void *SnapNewItem(int Type, int ID, int Size) = 0;
 
+	// part of the margin beyond the visible area that goes into the
+	// snapshots of the client, below 1 while they are over its budget
+	virtual float SnapRange(int ClientID) = 0;
+
 	virtual void SnapSetStaticsize(int ItemType, int Size) = 0;
 
 	enum
@@ -98,6 +112,9 @@ public:
 	virtual void OnClientDirectInput(int ClientID, void *pInput) = 0;
 	virtual void OnClientPredictedInput(int ClientID, void *pInput) = 0;
 
+	// writes the state of the world that must not change between builds
+	virtual void WriteWorldHash(IOHANDLE File) = 0;
+
 	virtual bool IsClientReady(int ClientID) = 0;
 	virtual bool IsClientPlayer(int ClientID) = 0;
 
@@ -0,0 +1,150 @@
+/* File is created for the TW+ mod
+ */
+
+#include <base/math.h>
+
+#include <engine/message.h>
+#include <engine/shared/protocol.h>
+
+#include "mapdownload.h"
+
+void CMapTransfer::Start(int MapSize, int Window, int64 Now)
+{
+	m_MapSize = MapSize;
+	m_NumChunks = max((MapSize+CHUNK_SIZE-1)/CHUNK_SIZE, 1);
+	m_Acked = 0;
+	m_NextSend = 0;
+	m_HighestSent = -1;
+	m_Window = (float)clamp(Window, 1, (int)MAX_WINDOW);
+	m_SsThresh = (float)MAX_WINDOW;
+	m_Srtt = -1;
+	m_RttVar = 0;
+	m_Backoff = 0;
+	m_StartTime = Now;
+	m_NumSent = 0;
+	m_NumResent = 0;
+}
+
+int64 CMapTransfer::Rto() const
+{
+	int64 Rto = m_Srtt < 0 ? time_freq() : m_Srtt + max(time_freq()/100, 4*m_RttVar);
+	Rto = max(Rto, time_freq()/20) << m_Backoff;
+	return min(Rto, time_freq()*2);
+}
+
+void CMapTransfer::OnRequest(int Chunk, int64 Now)
+{
+	if(!Active() || Chunk <= m_Acked || Chunk > m_HighestSent+1)
+		return;
+
+	// the request came for the chunk before, unless that one was sent twice
+	int Index = (Chunk-1)%MAX_WINDOW;
+	if(!m_aResent[Index])
+	{
+		int64 Rtt = Now - m_aSendTime[Index];
+		if(m_Srtt < 0)
+		{
+			m_Srtt = Rtt;
+			m_RttVar = Rtt/2;
+		}
+		else
+		{
+			m_RttVar = (3*m_RttVar + absolute(m_Srtt - Rtt))/4;
+			m_Srtt = (7*m_Srtt + Rtt)/8;
+		}
+	}
+
+	for(; m_Acked < Chunk; m_Acked++)
+	{
+		if(m_Window < m_SsThresh)
+			m_Window += 1.0f;
+		else
+			m_Window += 1.0f/m_Window;
+	}
+	m_Window = min(m_Window, (float)MAX_WINDOW);
+	m_NextSend = max(m_NextSend, m_Acked);
+	m_Backoff = 0;
+}
+
+int CMapTransfer::NextChunk(int64 Now)
+{
+	if(!Active())
+		return -1;
+
+	// the oldest chunk in flight or one before it got lost, go back to it
+	if(m_NextSend > m_Acked && Now - m_aSendTime[m_Acked%MAX_WINDOW] > Rto())
+	{
+		m_SsThresh = max(m_Window/2, 2.0f);
+		m_Window = m_SsThresh;
+		m_NextSend = m_Acked;
+		if(m_Backoff < 5)
+			m_Backoff++;
+	}
+
+	if(m_NextSend >= m_NumChunks || m_NextSend >= m_Acked + (int)m_Window)
+		return -1;
+	return m_NextSend++;
+}
+
+void CMapTransfer::OnSent(int Chunk, int64 Now)
+{
+	int Index = Chunk%MAX_WINDOW;
+	m_aResent[Index] = Chunk <= m_HighestSent;
+	m_aSendTime[Index] = Now;
+	m_HighestSent = max(m_HighestSent, Chunk);
+	m_NumSent++;
+	if(m_aResent[Index])
+		m_NumResent++;
+}
+
+int CMapTransfer::Speed(int64 Now) const
+{
+	int64 Time = Now - m_StartTime;
+	if(Time <= 0)
+		return 0;
+	return (int)(min((int64)m_Acked*CHUNK_SIZE, (int64)m_MapSize)*time_freq()/Time);
+}
+
+CMapChunks::CMapChunks(const unsigned char *pMap, int MapSize, unsigned Crc)
+{
+	m_pNext = 0;
+	m_NumChunks = max((MapSize+CMapTransfer::CHUNK_SIZE-1)/CMapTransfer::CHUNK_SIZE, 1);
+	m_pOffsets = (int *)mem_alloc_tag((m_NumChunks+1)*sizeof(int), sizeof(int), MEMTAG_MAP);
+
+	// the header ints take at most 6*5 bytes
+	m_pData = (unsigned char *)mem_alloc_tag(m_NumChunks*(CMapTransfer::CHUNK_SIZE+32), 1, MEMTAG_MAP);
+	m_DataSize = 0;
+
+	for(int i = 0; i < m_NumChunks; i++)
+	{
+		int Offset = i*CMapTransfer::CHUNK_SIZE;
+		int ChunkSize = min((int)CMapTransfer::CHUNK_SIZE, MapSize-Offset);
+
+		CMsgPacker Msg(NETMSG_MAP_DATA);
+		Msg.AddInt(i == m_NumChunks-1);
+		Msg.AddInt(Crc);
+		Msg.AddInt(i);
+		Msg.AddInt(ChunkSize);
+		Msg.AddRaw(&pMap[Offset], ChunkSize);
+
+		m_pOffsets[i] = m_DataSize;
+		mem_copy(&m_pData[m_DataSize], Msg.Data(), Msg.Size());
+		m_pData[m_DataSize] = (m_pData[m_DataSize]<<1) | 1; // system message
+		m_DataSize += Msg.Size();
+	}
+	m_pOffsets[m_NumChunks] = m_DataSize;
+}
+
+CMapChunks::~CMapChunks()
+{
+	mem_free(m_pOffsets);
+	mem_free(m_pData);
+}
+
+const unsigned char *CMapChunks::Chunk(int Index, int *pSize) const
+{
+	if(Index < 0 || Index >= m_NumChunks)
+		return 0;
+	*pSize = m_pOffsets[Index+1] - m_pOffsets[Index];
+	return &m_pData[m_pOffsets[Index]];
+}
@@ -0,0 +1,108 @@
+/* File is created for the TW+ mod
+ */
+
+#ifndef ENGINE_SERVER_MAPDOWNLOAD_H
+#define ENGINE_SERVER_MAPDOWNLOAD_H
+
+#include <base/system.h>
+
+/*
+	Keeps track of the map chunks pushed to one client. Clients ask for the
+	chunk after the last one they got in order, so every request acks all
+	chunks before it. Chunks that arrive out of order are thrown away by
+	the client: a lost chunk is sent again together with everything behind
+	it once the oldest chunk in flight was not acked in time.
+	The window grows like tcp's (slow start, then one chunk per window) and
+	is halved on a timeout. The timeout follows the round trip times taken
+	from the requests.
+*/
+class CMapTransfer
+{
+public:
+	enum
+	{
+		CHUNK_SIZE=1024-128,
+		MAX_WINDOW=256,
+	};
+
+	CMapTransfer() : m_NumChunks(0) {}
+
+	void Start(int MapSize, int Window, int64 Now);
+	void Stop() { m_NumChunks = 0; }
+	bool Active() const { return m_NumChunks > 0; }
+
+	/**
+	 * The client asked for the chunk, it has all before it
+	 */
+	void OnRequest(int Chunk, int64 Now);
+
+	/**
+	 * Next chunk to send, -1 while the window is full or everything was
+	 * sent. Rewinds on a timeout
+	 */
+	int NextChunk(int64 Now);
+	void OnSent(int Chunk, int64 Now);
+
+	// statistics
+	int Progress() const { return m_NumChunks ? m_Acked*100/m_NumChunks : 0; }
+	int Speed(int64 Now) const; // acked bytes per second
+	int Window() const { return (int)m_Window; }
+	int Rtt() const { return m_Srtt < 0 ? -1 : (int)(m_Srtt*1000/time_freq()); }
+	int NumSent() const { return m_NumSent; }
+	int NumResent() const { return m_NumResent; }
+	int64 StartTime() const { return m_StartTime; }
+	int MapSize() const { return m_MapSize; }
+
+private:
+	int m_MapSize;
+	int m_NumChunks;
+	int m_Acked; // chunks the client has
+	int m_NextSend;
+	int m_HighestSent;
+
+	float m_Window;
+	float m_SsThresh;
+
+	int64 m_Srtt;
+	int64 m_RttVar;
+	int m_Backoff;
+
+	int64 m_aSendTime[MAX_WINDOW];
+	bool m_aResent[MAX_WINDOW];
+
+	int64 m_StartTime;
+	int m_NumSent;
+	int m_NumResent;
+
+	int64 Rto() const;
+};
+
+/*
+	The map data messages of a map, packed once when it gets loaded. They
+	are ready to be queued as they are (system flag included) and the
+	connections keep vital ones for resends without a copy. A connection
+	may still resend chunks of a replaced map, so the server keeps a
+	replaced buffer until no connection refers to it anymore.
+*/
+class CMapChunks
+{
+public:
+	CMapChunks(const unsigned char *pMap, int MapSize, unsigned Crc);
+	~CMapChunks();
+
+	int NumChunks() const { return m_NumChunks; }
+	const unsigned char *Chunk(int Index, int *pSize) const;
+
+	const unsigned char *Data() const { return m_pData; }
+	int DataSize() const { return m_DataSize; }
+
+	CMapChunks *m_pNext; // replaced buffers
+
+private:
+	int m_NumChunks;
+	int *m_pOffsets; // m_NumChunks+1 offsets into m_pData
+	unsigned char *m_pData;
+	int m_DataSize;
+};
+
+#endif
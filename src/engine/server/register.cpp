@@ -16,6 +16,11 @@ CRegister::CRegister()
 	m_pMasterServer = 0;
 	m_pConsole = 0;
 
+	m_pThread = 0;
+	mem_zero(&m_LastInfo, sizeof(m_LastInfo));
+	m_Stop = false;
+
+	mem_zero(&m_Info, sizeof(m_Info));
 	m_RegisterState = REGISTERSTATE_START;
 	m_RegisterStateStart = 0;
 	m_RegisterFirst = 1;
@@ -25,122 +30,187 @@ CRegister::CRegister()
 	m_RegisterRegisteredServer = -1;
 }
 
-void CRegister::RegisterNewState(int State)
+void CRegister::Init(CNetServer *pNetServer, IEngineMasterServer *pMasterServer, IConsole *pConsole)
 {
-	m_RegisterState = State;
-	m_RegisterStateStart = time_get();
+	m_pNetServer = pNetServer;
+	m_pMasterServer = pMasterServer;
+	m_pConsole = pConsole;
 }
 
-void CRegister::RegisterSendFwcheckresponse(NETADDR *pAddr)
+void CRegister::RegisterUpdate(int Nettype)
 {
-	CNetChunk Packet;
-	Packet.m_ClientID = -1;
-	Packet.m_Address = *pAddr;
-	Packet.m_Flags = NETSENDFLAG_CONNLESS;
-	Packet.m_DataSize = sizeof(SERVERBROWSE_FWRESPONSE);
-	Packet.m_pData = SERVERBROWSE_FWRESPONSE;
-	m_pNetServer->Send(&Packet);
+	// hand over changed settings
+	CInfo Info;
+	Info.m_Enabled = g_Config.m_SvRegister != 0;
+	Info.m_Port = g_Config.m_SvExternalPort ? g_Config.m_SvExternalPort : g_Config.m_SvPort;
+	Info.m_Nettype = Nettype;
+	if(Info.m_Enabled != m_LastInfo.m_Enabled || Info.m_Port != m_LastInfo.m_Port || Info.m_Nettype != m_LastInfo.m_Nettype)
+	{
+		if(!m_pThread && Info.m_Enabled)
+		{
+			// the master list is loaded by now
+			for(int i = 0; i < IMasterServer::MAX_MASTERSERVERS; i++)
+				str_copy(m_aMasterserverInfo[i].m_aHostname, m_pMasterServer->GetName(i), sizeof(m_aMasterserverInfo[i].m_aHostname));
+			m_Stop = false;
+			m_pThread = teethread_create(RegisterThread, this);
+		}
+		if(m_InfoQueue.push(Info))
+			m_LastInfo = Info;
+	}
+
+	if(!m_pThread)
+		return;
+
+	CPacket Packet;
+	while(m_SendQueue.pop(&Packet))
+	{
+		CNetChunk Chunk;
+		Chunk.m_ClientID = -1;
+		Chunk.m_Address = Packet.m_Addr;
+		Chunk.m_Flags = NETSENDFLAG_CONNLESS;
+		Chunk.m_DataSize = Packet.m_DataSize;
+		Chunk.m_pData = Packet.m_aData;
+		m_pNetServer->Send(&Chunk);
+	}
+
+	CLine Line;
+	while(m_LineQueue.pop(&Line))
+		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "register", Line.m_aLine);
 }
 
-void CRegister::RegisterSendHeartbeat(NETADDR Addr)
+int CRegister::RegisterProcessPacket(CNetChunk *pPacket)
 {
-	static unsigned char aData[sizeof(SERVERBROWSE_HEARTBEAT) + 2];
-	unsigned short Port = g_Config.m_SvPort;
-	CNetChunk Packet;
-
-	mem_copy(aData, SERVERBROWSE_HEARTBEAT, sizeof(SERVERBROWSE_HEARTBEAT));
+	if(!m_pThread)
+		return 0;
 
-	Packet.m_ClientID = -1;
-	Packet.m_Address = Addr;
-	Packet.m_Flags = NETSENDFLAG_CONNLESS;
-	Packet.m_DataSize = sizeof(SERVERBROWSE_HEARTBEAT) + 2;
-	Packet.m_pData = &aData;
+	// the thread checks whether it came from a master
+	CPacket Packet;
+	Packet.m_Addr = pPacket->m_Address;
+	Packet.m_Count = 0;
+	Packet.m_DataSize = 0;
+	if(pPacket->m_DataSize == sizeof(SERVERBROWSE_FWCHECK) &&
+		mem_comp(pPacket->m_pData, SERVERBROWSE_FWCHECK, sizeof(SERVERBROWSE_FWCHECK)) == 0)
+		Packet.m_Type = PACKET_FWCHECK;
+	else if(pPacket->m_DataSize == sizeof(SERVERBROWSE_FWOK) &&
+		mem_comp(pPacket->m_pData, SERVERBROWSE_FWOK, sizeof(SERVERBROWSE_FWOK)) == 0)
+		Packet.m_Type = PACKET_FWOK;
+	else if(pPacket->m_DataSize == sizeof(SERVERBROWSE_FWERROR) &&
+		mem_comp(pPacket->m_pData, SERVERBROWSE_FWERROR, sizeof(SERVERBROWSE_FWERROR)) == 0)
+		Packet.m_Type = PACKET_FWERROR;
+	else if(pPacket->m_DataSize == sizeof(SERVERBROWSE_COUNT)+2 &&
+		mem_comp(pPacket->m_pData, SERVERBROWSE_COUNT, sizeof(SERVERBROWSE_COUNT)) == 0)
+	{
+		unsigned char *pData = (unsigned char *)pPacket->m_pData;
+		Packet.m_Type = PACKET_COUNT;
+		Packet.m_Count = (pData[sizeof(SERVERBROWSE_COUNT)]<<8) | pData[sizeof(SERVERBROWSE_COUNT)+1];
+	}
+	else
+		return 0;
 
-	// supply the set port that the master can use if it has problems
-	if(g_Config.m_SvExternalPort)
-		Port = g_Config.m_SvExternalPort;
-	aData[sizeof(SERVERBROWSE_HEARTBEAT)] = Port >> 8;
-	aData[sizeof(SERVERBROWSE_HEARTBEAT)+1] = Port&0xff;
-	m_pNetServer->Send(&Packet);
+	m_RecvQueue.push(Packet);
+	return 1;
 }
 
-void CRegister::RegisterSendCountRequest(NETADDR Addr)
+void CRegister::Shutdown()
 {
-	CNetChunk Packet;
-	Packet.m_ClientID = -1;
-	Packet.m_Address = Addr;
-	Packet.m_Flags = NETSENDFLAG_CONNLESS;
-	Packet.m_DataSize = sizeof(SERVERBROWSE_GETCOUNT);
-	Packet.m_pData = SERVERBROWSE_GETCOUNT;
-	m_pNetServer->Send(&Packet);
+	if(!m_pThread)
+		return;
+
+	m_Stop = true;
+	thread_wait(m_pThread);
+	m_pThread = 0;
 }
 
-void CRegister::RegisterGotCount(CNetChunk *pChunk)
+void CRegister::RegisterThread(void *pUser)
 {
-	unsigned char *pData = (unsigned char *)pChunk->m_pData;
-	int Count = (pData[sizeof(SERVERBROWSE_COUNT)]<<8) | pData[sizeof(SERVERBROWSE_COUNT)+1];
-
-	for(int i = 0; i < IMasterServer::MAX_MASTERSERVERS; i++)
+	CRegister *pThis = (CRegister *)pUser;
+	while(!pThis->m_Stop)
 	{
-		if(net_addr_comp(&m_aMasterserverInfo[i].m_Addr, &pChunk->m_Address) == 0)
-		{
-			m_aMasterserverInfo[i].m_Count = Count;
-			break;
-		}
+		pThis->RegisterRun();
+		thread_sleep(10);
 	}
 }
 
-void CRegister::Init(CNetServer *pNetServer, IEngineMasterServer *pMasterServer, IConsole *pConsole)
+void CRegister::RegisterRun()
 {
-	m_pNetServer = pNetServer;
-	m_pMasterServer = pMasterServer;
-	m_pConsole = pConsole;
+	CInfo Info;
+	while(m_InfoQueue.pop(&Info))
+		m_Info = Info;
+
+	CPacket Packet;
+	while(m_RecvQueue.pop(&Packet))
+		RegisterGotPacket(&Packet);
+
+	if(m_Info.m_Enabled)
+		RegisterUpdateState();
 }
 
-void CRegister::RegisterUpdate(int Nettype)
+void CRegister::RegisterNewState(int State)
 {
-	int64 Now = time_get();
-	int64 Freq = time_freq();
+	m_RegisterState = State;
+	m_RegisterStateStart = time_get();
+}
 
-	if(!g_Config.m_SvRegister)
-		return;
+void CRegister::RegisterSend(NETADDR Addr, const void *pData, int DataSize)
+{
+	CPacket Packet;
+	Packet.m_Addr = Addr;
+	Packet.m_DataSize = DataSize;
+	mem_copy(Packet.m_aData, pData, DataSize);
+	m_SendQueue.push(Packet);
+}
+
+void CRegister::RegisterPrint(const char *pLine)
+{
+	CLine Line;
+	str_copy(Line.m_aLine, pLine, sizeof(Line.m_aLine));
+	m_LineQueue.push(Line);
+}
 
-	m_pMasterServer->Update();
+void CRegister::RegisterSendHeartbeat(NETADDR Addr)
+{
+	unsigned char aData[sizeof(SERVERBROWSE_HEARTBEAT) + 2];
+	mem_copy(aData, SERVERBROWSE_HEARTBEAT, sizeof(SERVERBROWSE_HEARTBEAT));
+
+	// supply the set port that the master can use if it has problems
+	aData[sizeof(SERVERBROWSE_HEARTBEAT)] = m_Info.m_Port >> 8;
+	aData[sizeof(SERVERBROWSE_HEARTBEAT)+1] = m_Info.m_Port&0xff;
+	RegisterSend(Addr, aData, sizeof(aData));
+}
+
+void CRegister::RegisterRefreshAddresses()
+{
+	// blocks this thread only
+	for(int i = 0; i < IMasterServer::MAX_MASTERSERVERS && !m_Stop; i++)
+	{
+		CMasterserverInfo *pInfo = &m_aMasterserverInfo[i];
+		pInfo->m_Valid = 0;
+		pInfo->m_Count = 0;
+		if(!pInfo->m_aHostname[0] || net_host_lookup(pInfo->m_aHostname, &pInfo->m_Addr, m_Info.m_Nettype) != 0)
+			continue;
+
+		pInfo->m_Addr.port = 8300;
+		pInfo->m_Valid = 1;
+		pInfo->m_Count = -1;
+		pInfo->m_LastSend = 0;
+	}
+}
+
+void CRegister::RegisterUpdateState()
+{
+	int64 Now = time_get();
+	int64 Freq = time_freq();
 
 	if(m_RegisterState == REGISTERSTATE_START)
 	{
 		m_RegisterCount = 0;
 		m_RegisterFirst = 1;
-		RegisterNewState(REGISTERSTATE_UPDATE_ADDRS);
-		m_pMasterServer->RefreshAddresses(Nettype);
-		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "register", "refreshing ip addresses");
-	}
-	else if(m_RegisterState == REGISTERSTATE_UPDATE_ADDRS)
-	{
 		m_RegisterRegisteredServer = -1;
+		RegisterPrint("refreshing ip addresses");
+		RegisterRefreshAddresses();
 
-		if(!m_pMasterServer->IsRefreshing())
-		{
-			int i;
-			for(i = 0; i < IMasterServer::MAX_MASTERSERVERS; i++)
-			{
-				if(!m_pMasterServer->IsValid(i))
-				{
-					m_aMasterserverInfo[i].m_Valid = 0;
-					m_aMasterserverInfo[i].m_Count = 0;
-					continue;
-				}
-
-				NETADDR Addr = m_pMasterServer->GetAddr(i);
-				m_aMasterserverInfo[i].m_Addr = Addr;
-				m_aMasterserverInfo[i].m_Valid = 1;
-				m_aMasterserverInfo[i].m_Count = -1;
-				m_aMasterserverInfo[i].m_LastSend = 0;
-			}
-
-			m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "register", "fetching server counts");
-			RegisterNewState(REGISTERSTATE_QUERY_COUNT);
-		}
+		RegisterPrint("fetching server counts");
+		RegisterNewState(REGISTERSTATE_QUERY_COUNT);
 	}
 	else if(m_RegisterState == REGISTERSTATE_QUERY_COUNT)
 	{
@@ -156,7 +226,7 @@ void CRegister::RegisterUpdate(int Nettype)
 				if(m_aMasterserverInfo[i].m_LastSend+Freq < Now)
 				{
 					m_aMasterserverInfo[i].m_LastSend = Now;
-					RegisterSendCountRequest(m_aMasterserverInfo[i].m_Addr);
+					RegisterSend(m_aMasterserverInfo[i].m_Addr, SERVERBROWSE_GETCOUNT, sizeof(SERVERBROWSE_GETCOUNT));
 				}
 			}
 		}
@@ -180,14 +250,14 @@ void CRegister::RegisterUpdate(int Nettype)
 			m_RegisterRegisteredServer = Best;
 			if(m_RegisterRegisteredServer == -1)
 			{
-				m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "register", "WARNING: No master servers. Retrying in 60 seconds");
+				RegisterPrint("WARNING: No master servers. Retrying in 60 seconds");
 				RegisterNewState(REGISTERSTATE_ERROR);
 			}
 			else
 			{
 				char aBuf[256];
-				str_format(aBuf, sizeof(aBuf), "chose '%s' as master, sending heartbeats", m_pMasterServer->GetName(m_RegisterRegisteredServer));
-				m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "register", aBuf);
+				str_format(aBuf, sizeof(aBuf), "chose '%s' as master, sending heartbeats", m_aMasterserverInfo[m_RegisterRegisteredServer].m_aHostname);
+				RegisterPrint(aBuf);
 				m_aMasterserverInfo[m_RegisterRegisteredServer].m_LastSend = 0;
 				RegisterNewState(REGISTERSTATE_HEARTBEAT);
 			}
@@ -204,14 +274,14 @@ void CRegister::RegisterUpdate(int Nettype)
 
 		if(Now > m_RegisterStateStart+Freq*60)
 		{
-			m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "register", "WARNING: Master server is not responding, switching master");
+			RegisterPrint("WARNING: Master server is not responding, switching master");
 			RegisterNewState(REGISTERSTATE_START);
 		}
 	}
 	else if(m_RegisterState == REGISTERSTATE_REGISTERED)
 	{
 		if(m_RegisterFirst)
-			m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "register", "server registered");
+			RegisterPrint("server registered");
 
 		m_RegisterFirst = 0;
 
@@ -235,11 +305,11 @@ void CRegister::RegisterUpdate(int Nettype)
 	}
 }
 
-int CRegister::RegisterProcessPacket(CNetChunk *pPacket)
+void CRegister::RegisterGotPacket(const CPacket *pPacket)
 {
 	// check for masterserver address
 	bool Valid = false;
-	NETADDR Addr1 = pPacket->m_Address;
+	NETADDR Addr1 = pPacket->m_Addr;
 	Addr1.port = 0;
 	for(int i = 0; i < IMasterServer::MAX_MASTERSERVERS; i++)
 	{
@@ -252,38 +322,34 @@ int CRegister::RegisterProcessPacket(CNetChunk *pPacket)
 		}
 	}
 	if(!Valid)
-		return 0;
+		return;
 
-	if(pPacket->m_DataSize == sizeof(SERVERBROWSE_FWCHECK) &&
-		mem_comp(pPacket->m_pData, SERVERBROWSE_FWCHECK, sizeof(SERVERBROWSE_FWCHECK)) == 0)
-	{
-		RegisterSendFwcheckresponse(&pPacket->m_Address);
-		return 1;
-	}
-	else if(pPacket->m_DataSize == sizeof(SERVERBROWSE_FWOK) &&
-		mem_comp(pPacket->m_pData, SERVERBROWSE_FWOK, sizeof(SERVERBROWSE_FWOK)) == 0)
+	if(pPacket->m_Type == PACKET_FWCHECK)
+		RegisterSend(pPacket->m_Addr, SERVERBROWSE_FWRESPONSE, sizeof(SERVERBROWSE_FWRESPONSE));
+	else if(pPacket->m_Type == PACKET_FWOK)
 	{
 		if(m_RegisterFirst)
-			m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "register", "no firewall/nat problems detected");
+			RegisterPrint("no firewall/nat problems detected");
 		RegisterNewState(REGISTERSTATE_REGISTERED);
-		return 1;
 	}
-	else if(pPacket->m_DataSize == sizeof(SERVERBROWSE_FWERROR) &&
-		mem_comp(pPacket->m_pData, SERVERBROWSE_FWERROR, sizeof(SERVERBROWSE_FWERROR)) == 0)
+	else if(pPacket->m_Type == PACKET_FWERROR)
 	{
-		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "register", "ERROR: the master server reports that clients can not connect to this server.");
+		RegisterPrint("ERROR: the master server reports that clients can not connect to this server.");
 		char aBuf[256];
-		str_format(aBuf, sizeof(aBuf), "ERROR: configure your firewall/nat to let through udp on port %d.", g_Config.m_SvPort);
-		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "register", aBuf);
+		str_format(aBuf, sizeof(aBuf), "ERROR: configure your firewall/nat to let through udp on port %d.", m_Info.m_Port);
+		RegisterPrint(aBuf);
 		RegisterNewState(REGISTERSTATE_ERROR);
-		return 1;
 	}
-	else if(pPacket->m_DataSize == sizeof(SERVERBROWSE_COUNT)+2 &&
-		mem_comp(pPacket->m_pData, SERVERBROWSE_COUNT, sizeof(SERVERBROWSE_COUNT)) == 0)
+	else if(pPacket->m_Type == PACKET_COUNT)
 	{
-		RegisterGotCount(pPacket);
-		return 1;
+		// the count answer comes from the master's address, port included
+		for(int i = 0; i < IMasterServer::MAX_MASTERSERVERS; i++)
+		{
+			if(net_addr_comp(&m_aMasterserverInfo[i].m_Addr, &pPacket->m_Addr) == 0)
+			{
+				m_aMasterserverInfo[i].m_Count = pPacket->m_Count;
+				break;
+			}
+		}
 	}
-
-	return 0;
 }
@@ -3,30 +3,83 @@
 #ifndef ENGINE_SERVER_REGISTER_H
 #define ENGINE_SERVER_REGISTER_H
 
+#include <base/tl/spsc_queue.h>
+
+/*
+	The registration runs on its own thread, so master server lookups and
+	timeouts never hold up a tick. The game loop and the thread only talk
+	through queues: the game loop hands over the registration settings and
+	the packets from the masters, the thread hands back the packets to
+	send and the lines to print.
+*/
 class CRegister
 {
 	enum
 	{
 		REGISTERSTATE_START=0,
-		REGISTERSTATE_UPDATE_ADDRS,
 		REGISTERSTATE_QUERY_COUNT,
 		REGISTERSTATE_HEARTBEAT,
 		REGISTERSTATE_REGISTERED,
 		REGISTERSTATE_ERROR
 	};
 
+	enum
+	{
+		PACKET_FWCHECK=0,
+		PACKET_FWOK,
+		PACKET_FWERROR,
+		PACKET_COUNT,
+
+		MAX_PACKET_SIZE=16,
+	};
+
 	struct CMasterserverInfo
 	{
+		char m_aHostname[128];
 		NETADDR m_Addr;
 		int m_Count;
 		int m_Valid;
 		int64 m_LastSend;
 	};
 
+	// what the thread needs to know about the server
+	struct CInfo
+	{
+		bool m_Enabled;
+		int m_Port;
+		int m_Nettype;
+	};
+
+	struct CPacket
+	{
+		NETADDR m_Addr;
+		int m_Type; // received packets only
+		int m_Count;
+		int m_DataSize; // sent packets only
+		unsigned char m_aData[MAX_PACKET_SIZE];
+	};
+
+	struct CLine
+	{
+		char m_aLine[256];
+	};
+
 	class CNetServer *m_pNetServer;
 	class IEngineMasterServer *m_pMasterServer;
 	class IConsole *m_pConsole;
 
+	// game loop side
+	void *m_pThread;
+	CInfo m_LastInfo;
+
+	spsc_queue<CInfo, 4> m_InfoQueue;
+	spsc_queue<CPacket, 16> m_RecvQueue;
+	spsc_queue<CPacket, 16> m_SendQueue;
+	spsc_queue<CLine, 16> m_LineQueue;
+	volatile bool m_Stop;
+
+	// thread side
+	CInfo m_Info;
 	int m_RegisterState;
 	int64 m_RegisterStateStart;
 	int m_RegisterFirst;
@@ -35,17 +88,22 @@ class CRegister
 	CMasterserverInfo m_aMasterserverInfo[IMasterServer::MAX_MASTERSERVERS];
 	int m_RegisterRegisteredServer;
 
+	static void RegisterThread(void *pUser);
+	void RegisterRun();
+	void RegisterUpdateState();
+	void RegisterRefreshAddresses();
+	void RegisterGotPacket(const CPacket *pPacket);
 	void RegisterNewState(int State);
-	void RegisterSendFwcheckresponse(NETADDR *pAddr);
+	void RegisterSend(NETADDR Addr, const void *pData, int DataSize);
+	void RegisterPrint(const char *pLine);
 	void RegisterSendHeartbeat(NETADDR Addr);
-	void RegisterSendCountRequest(NETADDR Addr);
-	void RegisterGotCount(struct CNetChunk *pChunk);
 
 public:
 	CRegister();
 	void Init(class CNetServer *pNetServer, class IEngineMasterServer *pMasterServer, class IConsole *pConsole);
 	void RegisterUpdate(int Nettype);
 	int RegisterProcessPacket(struct CNetChunk *pPacket);
+	void Shutdown();
 };
 
 #endif
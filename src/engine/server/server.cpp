@@ -20,14 +20,18 @@
 #include <engine/shared/filecollection.h>
 #include <engine/shared/mapchecker.h>
 #include <engine/shared/netban.h>
+#include <engine/shared/netcapture.h>
 #include <engine/shared/network.h>
 #include <engine/shared/packer.h>
+#include <engine/shared/profiler.h>
 #include <engine/shared/protocol.h>
 #include <engine/shared/snapshot.h>
 
 #include <engine/server/misc/mastersrv.h>
 
+#include "mapdownload.h"
 #include "register.h"
+#include "tickrecord.h"
 #include "server.h"
 
 #if defined(CONF_FAMILY_WINDOWS)
@@ -205,10 +209,8 @@ int CServerBan::BanExt(T *pBanPool, const typename T::CDataType *pData, int Seco
 
 		if (NetMatch(&Data, Server()->m_NetServer.ClientAddr(i)))
 		{
-			CNetHash NetHash(&Data);
 			char aBuf[256];
-			// This crashes while compiling?
-			MakeBanInfo(pBanPool->Find(&Data, &NetHash), aBuf, sizeof(aBuf), MSGTYPE_PLAYER);
+			MakeBanInfo(pBanPool->Find(&Data), aBuf, sizeof(aBuf), MSGTYPE_PLAYER);
 			Server()->m_NetServer.Drop(i, aBuf);
 		}
 	}
@@ -216,6 +218,20 @@ int CServerBan::BanExt(T *pBanPool, const typename T::CDataType *pData, int Seco
 	return Result;
 }
 
+void CServerBan::OnBansLoaded()
+{
+	// drop banned clients, the loaded bans don't go through BanExt
+	for (int i = 0; i < MAX_CLIENTS; ++i)
+	{
+		if (Server()->m_aClients[i].m_State == CServer::CClient::STATE_EMPTY)
+			continue;
+
+		char aBuf[256];
+		if (IsBanned(Server()->m_NetServer.ClientAddr(i), aBuf, sizeof(aBuf)))
+			Server()->m_NetServer.Drop(i, aBuf);
+	}
+}
+
 int CServerBan::BanAddr(const NETADDR *pAddr, int Seconds, const char *pReason)
 {
 	return BanExt(&m_BanAddrPool, pAddr, Seconds, pReason);
@@ -268,15 +284,28 @@ void CServerBan::ConBanExt(IConsole::IResult *pResult, void *pUser)
 void CServer::CClient::Reset()
 {
 	// reset input
-	for (int i = 0; i < 200; i++)
+	for (int i = 0; i < INPUT_RING_SIZE; i++)
+	{
 		m_aInputs[i].m_GameTick = -1;
-	m_CurrentInput = 0;
+		m_aInputs[i].m_Valid = false;
+	}
+	m_LateInputs = 0;
+	m_DuplicateInputs = 0;
 	mem_zero(&m_LatestInput, sizeof(m_LatestInput));
 
 	m_Snapshots.PurgeAll();
 	m_LastAckedSnapshot = -1;
 	m_LastInputTick = -1;
 	m_SnapRate = CClient::SNAPRATE_INIT;
+	m_SnapInterval = g_Config.m_SvHighBandwidth ? 1 : 2;
+	m_LastSnapTick = -1;
+	m_SnapBudget = g_Config.m_SvSnapBudget*1024;
+	m_SnapRange = 1.0f;
+	m_MinRtt = -1;
+	m_PeriodStart = 0;
+	m_Bandwidth = 0;
+	m_SnapBandwidth = 0;
+	m_SnapLoss = 0;
 	m_Score = 0;
 }
 
@@ -289,14 +318,38 @@ CServer::CServer() : m_DemoRecorder(&m_SnapshotDelta)
 	m_CurrentGameTick = 0;
 	m_RunServer = 1;
 
-	m_pCurrentMapData = 0;
+	m_pMapChunks = 0;
+	m_pOldMapChunks = 0;
 	m_CurrentMapSize = 0;
+	m_MapDownloadBudget = 0;
+	m_MapDownloadTime = 0;
+	m_MapDownloadFirst = 0;
 
 	m_MapReload = 0;
+	m_MapChanged = false;
+	m_aConfigFile[0] = 0;
+	m_ConfigWatch = 0;
+	m_Replaying = false;
+	m_TickReplaying = false;
 
 	m_RconClientID = IServer::RCON_CID_SERV;
 	m_RconAuthLevel = AUTHED_ADMIN;
 
+	m_ServerInfoCacheValid = false;
+	m_ServerInfoCacheSize = 0;
+	mem_zero(m_aInfoSources, sizeof(m_aInfoSources));
+
+	// the key keeps sources from picking addresses that collide
+	IOHANDLE KeyFile = io_open("/dev/urandom", IOFLAG_READ);
+	if (!KeyFile || io_read(KeyFile, m_aInfoSourceKey, sizeof(m_aInfoSourceKey)) != sizeof(m_aInfoSourceKey))
+	{
+		int64 Now = time_get();
+		m_aInfoSourceKey[0] = (unsigned)Now ^ (unsigned)(Now>>32);
+		m_aInfoSourceKey[1] = (unsigned)(size_t)this;
+	}
+	if (KeyFile)
+		io_close(KeyFile);
+
 	Init();
 }
 
@@ -331,6 +384,7 @@ int CServer::TrySetClientName(int ClientID, const char *pName)
 
 	// set the client name
 	str_copy(m_aClients[ClientID].m_aName, pName, MAX_NAME_LENGTH);
+	ExpireServerInfo();
 	return 0;
 }
 
@@ -370,6 +424,8 @@ void CServer::SetClientClan(int ClientID, const char *pClan)
 	if (ClientID < 0 || ClientID >= MAX_CLIENTS || m_aClients[ClientID].m_State < CClient::STATE_READY || !pClan)
 		return;
 
+	if (str_comp(m_aClients[ClientID].m_aClan, pClan) != 0)
+		ExpireServerInfo();
 	str_copy(m_aClients[ClientID].m_aClan, pClan, MAX_CLAN_LENGTH);
 }
 
@@ -378,6 +434,8 @@ void CServer::SetClientCountry(int ClientID, int Country)
 	if (ClientID < 0 || ClientID >= MAX_CLIENTS || m_aClients[ClientID].m_State < CClient::STATE_READY)
 		return;
 
+	if (m_aClients[ClientID].m_Country != Country)
+		ExpireServerInfo();
 	m_aClients[ClientID].m_Country = Country;
 }
 
@@ -385,6 +443,8 @@ void CServer::SetClientScore(int ClientID, int Score)
 {
 	if (ClientID < 0 || ClientID >= MAX_CLIENTS || m_aClients[ClientID].m_State < CClient::STATE_READY)
 		return;
+	if (m_aClients[ClientID].m_Score != Score)
+		ExpireServerInfo();
 	m_aClients[ClientID].m_Score = Score;
 }
 
@@ -468,11 +528,24 @@ int CServer::GetClientInfo(int ClientID, CClientInfo *pInfo)
 		pInfo->m_pName = m_aClients[ClientID].m_aName;
 		pInfo->m_Latency = m_aClients[ClientID].m_Latency;
 		pInfo->m_DDNetVersion = m_aClients[ClientID].m_DDNetVersion;
+		pInfo->m_LateInputs = m_aClients[ClientID].m_LateInputs;
+		pInfo->m_DuplicateInputs = m_aClients[ClientID].m_DuplicateInputs;
+		const CNetConnection *pConnection = m_NetServer.ClientConnection(ClientID);
+		pInfo->m_Rtt = pConnection->Rtt();
+		pInfo->m_RttVar = pConnection->RttVar();
+		pInfo->m_VitalChunks = pConnection->NumVitalChunks();
+		pInfo->m_Resends = pConnection->NumResends();
 		return 1;
 	} else {
 		pInfo->m_pName = "(unknown)";
 		pInfo->m_Latency = 999;
 		pInfo->m_DDNetVersion = 0;
+		pInfo->m_LateInputs = 0;
+		pInfo->m_DuplicateInputs = 0;
+		pInfo->m_Rtt = -1;
+		pInfo->m_RttVar = -1;
+		pInfo->m_VitalChunks = 0;
+		pInfo->m_Resends = 0;
 	}
 	return 0;
 }
@@ -483,6 +556,16 @@ void CServer::GetClientAddr(int ClientID, char *pAddrStr, int Size)
 		net_addr_str(m_NetServer.ClientAddr(ClientID), pAddrStr, Size, false);
 }
 
+bool CServer::GetClientAddr(int ClientID, NETADDR *pAddr)
+{
+	if (ClientID < 0 || ClientID >= MAX_CLIENTS || m_aClients[ClientID].m_State != CClient::STATE_INGAME)
+		return false;
+
+	*pAddr = *m_NetServer.ClientAddr(ClientID);
+	pAddr->port = 0;
+	return true;
+}
+
 const char *CServer::ClientName(int ClientID)
 {
 	if (ClientID < 0 || ClientID >= MAX_CLIENTS || m_aClients[ClientID].m_State == CServer::CClient::STATE_EMPTY)
@@ -520,6 +603,9 @@ bool CServer::ClientIngame(int ClientID)
 
 int CServer::MaxClients() const
 {
+	// a tick replay never opens the network
+	if (m_TickReplaying)
+		return clamp(g_Config.m_SvMaxClients, 1, (int)NET_MAX_CLIENTS);
 	return m_NetServer.MaxClients();
 }
 
@@ -554,7 +640,8 @@ int CServer::SendMsgEx(CMsgPacker *pMsg, int Flags, int ClientID, bool System)
 	if (!(Flags & MSGFLAG_NORECORD))
 		m_DemoRecorder.RecordMessage(pMsg->Data(), pMsg->Size());
 
-	if (!(Flags & MSGFLAG_NOSEND))
+	// the clients of a tick replay exist only for the game
+	if (!(Flags & MSGFLAG_NOSEND) && !m_TickReplaying)
 	{
 		if (ClientID == -1)
 		{
@@ -565,20 +652,26 @@ int CServer::SendMsgEx(CMsgPacker *pMsg, int Flags, int ClientID, bool System)
 				{
 					Packet.m_ClientID = i;
 					m_NetServer.Send(&Packet);
+					m_aClients[i].m_PeriodBytes += Packet.m_DataSize;
 				}
 		}
 		else
+		{
 			m_NetServer.Send(&Packet);
+			m_aClients[ClientID].m_PeriodBytes += Packet.m_DataSize;
+		}
 	}
 	return 0;
 }
 
 void CServer::DoSnapshot()
 {
+	CProfileScope Scope(CProfiler::PHASE_SNAP);
+
 	GameServer()->OnPreSnap();
 
 	// create snapshot for demo recording
-	if (m_DemoRecorder.IsRecording())
+	if (m_DemoRecorder.IsRecording() && (g_Config.m_SvHighBandwidth || (m_CurrentGameTick % 2) == 0))
 	{
 		char aData[CSnapshot::MAX_SIZE];
 		int SnapshotSize;
@@ -593,12 +686,19 @@ void CServer::DoSnapshot()
 	}
 
 	// create snapshots for all clients
+	int64 Now = time_get();
 	for (int i = 0; i < MAX_CLIENTS; i++)
 	{
 		// client must be ingame to recive snapshots
 		if (m_aClients[i].m_State != CClient::STATE_INGAME)
 			continue;
 
+		UpdateSnapRate(i, Now);
+
+		// the connection of the client decides how often it gets a snapshot
+		if (m_aClients[i].m_LastSnapTick >= 0 && m_CurrentGameTick - m_aClients[i].m_LastSnapTick < m_aClients[i].m_SnapInterval)
+			continue;
+
 		// this client is trying to recover, don't spam snapshots
 		if (m_aClients[i].m_SnapRate == CClient::SNAPRATE_RECOVER && (Tick() % 50) != 0)
 			continue;
@@ -620,13 +720,19 @@ void CServer::DoSnapshot()
 			int DeltaTick = -1;
 			int DeltaSize;
 
-			m_SnapshotBuilder.Init();
+			{
+				CProfileScope BuildScope(CProfiler::PHASE_SNAP_BUILD);
+				m_SnapshotBuilder.Init();
+
+				GameServer()->OnSnap(i);
 
-			GameServer()->OnSnap(i);
+				// finish snapshot
+				SnapshotSize = m_SnapshotBuilder.Finish(pData);
+				Crc = pData->Crc();
+			}
 
-			// finish snapshot
-			SnapshotSize = m_SnapshotBuilder.Finish(pData);
-			Crc = pData->Crc();
+			m_aClients[i].m_LastSnapTick = m_CurrentGameTick;
+			m_aClients[i].m_PeriodSnaps++;
 
 			// remove old snapshos
 			// keep 3 seconds worth of snapshots
@@ -651,7 +757,10 @@ void CServer::DoSnapshot()
 			}
 
 			// create delta
-			DeltaSize = m_SnapshotDelta.CreateDelta(pDeltashot, pData, aDeltaData);
+			{
+				CProfileScope DeltaScope(CProfiler::PHASE_SNAP_DELTA);
+				DeltaSize = m_SnapshotDelta.CreateDelta(pDeltashot, pData, aDeltaData);
+			}
 
 			if (DeltaSize)
 			{
@@ -660,8 +769,15 @@ void CServer::DoSnapshot()
 				const int MaxSize = MAX_SNAPSHOT_PACKSIZE;
 				int NumPackets;
 
-				SnapshotSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData);
+				{
+					CProfileScope CompressScope(CProfiler::PHASE_SNAP_COMPRESS);
+					SnapshotSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData);
+				}
 				NumPackets = (SnapshotSize + MaxSize - 1) / MaxSize;
+				m_aClients[i].m_PeriodSnapBytes += SnapshotSize;
+				UpdateSnapRange(i, SnapshotSize);
+
+				CProfileScope SendScope(CProfiler::PHASE_SNAP_SEND);
 
 				for (int n = 0, Left = SnapshotSize; Left; n++)
 				{
@@ -694,6 +810,9 @@ void CServer::DoSnapshot()
 			}
 			else
 			{
+				UpdateSnapRange(i, 0);
+
+				CProfileScope SendScope(CProfiler::PHASE_SNAP_SEND);
 				CMsgPacker Msg(NETMSG_SNAPEMPTY);
 				Msg.AddInt(m_CurrentGameTick);
 				Msg.AddInt(m_CurrentGameTick - DeltaTick);
@@ -705,6 +824,109 @@ void CServer::DoSnapshot()
 	GameServer()->OnPostSnap();
 }
 
+void CServer::UpdateSnapRate(int ClientID, int64 Now)
+{
+	CClient *pClient = &m_aClients[ClientID];
+	const CNetConnection *pConnection = m_NetServer.ClientConnection(ClientID);
+	if (pClient->m_PeriodStart && Now < pClient->m_PeriodStart + time_freq())
+		return;
+
+	int BaseInterval = g_Config.m_SvHighBandwidth ? 1 : 2;
+	int MaxInterval = max(g_Config.m_SvSnapIntervalMax, BaseInterval);
+	int MaxBudget = g_Config.m_SvSnapBudget*1024;
+
+	if (pClient->m_PeriodStart)
+	{
+		int64 Length = Now - pClient->m_PeriodStart;
+		pClient->m_Bandwidth = (int)(pClient->m_PeriodBytes*time_freq()/Length);
+		pClient->m_SnapBandwidth = (int)(pClient->m_PeriodSnapBytes*time_freq()/Length);
+
+		// every input acks the newest snapshot, so a snapshot that arrived
+		// together with a newer one looks lost if there were fewer inputs
+		int Expected = min(pClient->m_PeriodSnaps, pClient->m_PeriodInputs);
+		pClient->m_SnapLoss = Expected > 0 ? max(0, 100 - pClient->m_PeriodAcks*100/Expected) : 0;
+
+		if (!g_Config.m_SvSnapAdaptive)
+		{
+			pClient->m_SnapInterval = BaseInterval;
+			pClient->m_SnapBudget = MaxBudget;
+		}
+		else if (pClient->m_SnapRate == CClient::SNAPRATE_FULL)
+		{
+			// a growing rtt means the packets queue up somewhere on the way,
+			// the minimum creeps up to pick up a changed route
+			int Rtt = pConnection->Rtt();
+			if (Rtt >= 0)
+				pClient->m_MinRtt = pClient->m_MinRtt < 0 ? Rtt : min(pClient->m_MinRtt + 1, Rtt);
+			bool Queueing = Rtt >= 0 && Rtt - pClient->m_MinRtt > max((int)CClient::SNAP_QUEUE_DELAY, pClient->m_MinRtt);
+
+			int Resends = pConnection->NumResends() - pClient->m_PeriodResends;
+			int VitalChunks = pConnection->NumVitalChunks() - pClient->m_PeriodVitalChunks;
+			bool Resending = Resends > 0 && Resends*100 >= (VitalChunks + 1)*g_Config.m_SvSnapLoss;
+
+			bool Losing = Expected >= 5 && pClient->m_SnapLoss >= g_Config.m_SvSnapLoss;
+			bool Backlog = pConnection->NumUnacked() > CClient::SNAP_MAX_UNACKED;
+
+			if (Losing || Resending || Queueing || Backlog)
+			{
+				// back off fast, fewer and smaller snapshots
+				pClient->m_SnapInterval = min(pClient->m_SnapInterval + 1, MaxInterval);
+				int Budget = max(pClient->m_SnapBandwidth*3/4, (int)CClient::SNAP_MIN_BUDGET);
+				if (!pClient->m_SnapBudget || Budget < pClient->m_SnapBudget)
+					pClient->m_SnapBudget = Budget;
+			}
+			else if (pClient->m_SnapLoss < g_Config.m_SvSnapLoss/2)
+			{
+				// and recover slowly
+				if (pClient->m_SnapInterval > BaseInterval)
+					pClient->m_SnapInterval--;
+				if (pClient->m_SnapBudget)
+				{
+					pClient->m_SnapBudget += pClient->m_SnapBudget/8 + 1024;
+					if (!MaxBudget && pClient->m_SnapBudget > pClient->m_SnapBandwidth*2)
+						pClient->m_SnapBudget = 0;
+				}
+			}
+
+			// the budget holds even with the snapshots as small as they get
+			if (pClient->m_SnapBudget && pClient->m_SnapRange <= 0.0f && pClient->m_SnapBandwidth > pClient->m_SnapBudget)
+				pClient->m_SnapInterval = min(pClient->m_SnapInterval + 1, MaxInterval);
+
+			pClient->m_SnapInterval = clamp(pClient->m_SnapInterval, BaseInterval, MaxInterval);
+			if (MaxBudget && (!pClient->m_SnapBudget || pClient->m_SnapBudget > MaxBudget))
+				pClient->m_SnapBudget = MaxBudget;
+		}
+	}
+
+	pClient->m_PeriodStart = Now;
+	pClient->m_PeriodBytes = 0;
+	pClient->m_PeriodSnapBytes = 0;
+	pClient->m_PeriodSnaps = 0;
+	pClient->m_PeriodAcks = 0;
+	pClient->m_PeriodInputs = 0;
+	pClient->m_PeriodResends = pConnection->NumResends();
+	pClient->m_PeriodVitalChunks = pConnection->NumVitalChunks();
+}
+
+void CServer::UpdateSnapRange(int ClientID, int SnapshotSize)
+{
+	// leave out what is beyond the visible area while the snapshots are over
+	// the budget, what is on screen always goes in and only the interval grows
+	CClient *pClient = &m_aClients[ClientID];
+	int Budget = pClient->m_SnapBudget ? pClient->m_SnapBudget*pClient->m_SnapInterval/TickSpeed() : 0;
+	if (Budget && SnapshotSize > Budget)
+		pClient->m_SnapRange = max(pClient->m_SnapRange - 0.25f, 0.0f);
+	else if (!Budget || SnapshotSize < Budget*3/4)
+		pClient->m_SnapRange = min(pClient->m_SnapRange + 0.02f, 1.0f);
+}
+
+float CServer::SnapRange(int ClientID)
+{
+	if (ClientID < 0 || ClientID >= MAX_CLIENTS)
+		return 1.0f;
+	return m_aClients[ClientID].m_SnapRange;
+}
+
 int CServer::NewClientCallback(int ClientID, void *pUser)
 {
 	CServer *pThis = (CServer *)pUser;
@@ -717,6 +939,7 @@ int CServer::NewClientCallback(int ClientID, void *pUser)
 	pThis->m_aClients[ClientID].m_pRconCmdToSend = 0;
 	pThis->m_aClients[ClientID].m_DDNetVersion = 0;
 	pThis->m_aClients[ClientID].Reset();
+	pThis->ExpireServerInfo();
 	return 0;
 }
 
@@ -732,9 +955,13 @@ int CServer::DelClientCallback(int ClientID, const char *pReason, void *pUser)
 
 	// notify the mod about the drop
 	if (pThis->m_aClients[ClientID].m_State >= CClient::STATE_READY)
+	{
+		pThis->m_TickRecorder.Record(CTickRecord::TYPE_DROP, ClientID, pReason, str_length(pReason));
 		pThis->GameServer()->OnClientDrop(ClientID, pReason);
+	}
 
 	pThis->m_aClients[ClientID].m_State = CClient::STATE_EMPTY;
+	pThis->ExpireServerInfo();
 	pThis->m_aClients[ClientID].m_aName[0] = 0;
 	pThis->m_aClients[ClientID].m_aClan[0] = 0;
 	pThis->m_aClients[ClientID].m_Country = -1;
@@ -746,15 +973,9 @@ int CServer::DelClientCallback(int ClientID, const char *pReason, void *pUser)
 	return 0;
 }
 
-static int lastsent[MAX_CLIENTS];
-static int lastask[MAX_CLIENTS];
-static int lastasktick[MAX_CLIENTS];
-
 void CServer::SendMap(int ClientID)
 {
-	lastsent[ClientID] = 0;
-	lastask[ClientID] = 0;
-	lastasktick[ClientID] = Tick();
+	m_aClients[ClientID].m_MapTransfer.Start(m_CurrentMapSize, g_Config.m_SvMapWindow, time_get());
 
 	CMsgPacker Msg(NETMSG_MAP_CHANGE);
 	Msg.AddString(GetMapName(), 0);
@@ -763,6 +984,104 @@ void CServer::SendMap(int ClientID)
 	SendMsgEx(&Msg, MSGFLAG_VITAL | MSGFLAG_FLUSH, ClientID, true);
 }
 
+int CServer::SendMapChunk(int ClientID, int Chunk, int Flags)
+{
+	// drop faulty map data requests
+	int Size;
+	const unsigned char *pData = m_pMapChunks->Chunk(Chunk, &Size);
+	if(!pData || m_TickReplaying)
+		return 0;
+
+	// the message is packed already, it goes out without a copy and is not worth a demo
+	CNetChunk Packet;
+	mem_zero(&Packet, sizeof(CNetChunk));
+	Packet.m_ClientID = ClientID;
+	Packet.m_pData = pData;
+	Packet.m_DataSize = Size;
+	Packet.m_Flags = NETSENDFLAG_STATIC;
+	if(Flags & MSGFLAG_VITAL)
+		Packet.m_Flags |= NETSENDFLAG_VITAL;
+	if(Flags & MSGFLAG_FLUSH)
+		Packet.m_Flags |= NETSENDFLAG_FLUSH;
+	m_NetServer.Send(&Packet);
+
+	if(g_Config.m_Debug)
+	{
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "sending chunk %d with size %d", Chunk, Size);
+		Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "server", aBuf);
+	}
+	return Size;
+}
+
+void CServer::FreeMapChunks(bool Force)
+{
+	CMapChunks **ppChunks = &m_pOldMapChunks;
+	while(*ppChunks)
+	{
+		CMapChunks *pChunks = *ppChunks;
+		if(Force || !m_NetServer.RefersTo(pChunks->Data(), pChunks->DataSize()))
+		{
+			*ppChunks = pChunks->m_pNext;
+			delete pChunks;
+		}
+		else
+			ppChunks = &pChunks->m_pNext;
+	}
+}
+
+void CServer::SendMapChunks()
+{
+	CProfileScope Scope(CProfiler::PHASE_MAPDOWNLOAD);
+	int64 Now = time_get();
+
+	// refill the budget, at most a tenth of a second can be saved up
+	int64 Rate = (int64)g_Config.m_SvMapDownloadSpeed*1024;
+	if(Rate)
+	{
+		int64 Refill = min(Now - m_MapDownloadTime, time_freq())*Rate/time_freq();
+		if(Refill > 0)
+		{
+			m_MapDownloadBudget = min(m_MapDownloadBudget + Refill, max(Rate/10, (int64)CMapTransfer::CHUNK_SIZE));
+			m_MapDownloadTime = Now;
+		}
+	}
+	else
+		m_MapDownloadTime = Now;
+
+	// one chunk per downloader and round, so they share the budget evenly
+	int Next = m_MapDownloadFirst;
+	bool Sent = true;
+	while(Sent)
+	{
+		Sent = false;
+		for(int k = 0; k < MAX_CLIENTS; k++)
+		{
+			if(Rate && m_MapDownloadBudget < CMapTransfer::CHUNK_SIZE)
+				break;
+
+			int i = (m_MapDownloadFirst + k) % MAX_CLIENTS;
+			CMapTransfer *pTransfer = &m_aClients[i].m_MapTransfer;
+			if(m_aClients[i].m_State != CClient::STATE_CONNECTING || !pTransfer->Active())
+				continue;
+
+			int Chunk = pTransfer->NextChunk(Now);
+			if(Chunk < 0)
+				continue;
+
+			int Bytes = SendMapChunk(i, Chunk, MSGFLAG_FLUSH);
+			pTransfer->OnSent(Chunk, Now);
+			if(Rate)
+				m_MapDownloadBudget -= Bytes;
+			Sent = true;
+			Next = (i + 1) % MAX_CLIENTS;
+		}
+	}
+
+	// continue with the client after the last served one next time
+	m_MapDownloadFirst = Next;
+}
+
 void CServer::SendConnectionReady(int ClientID)
 {
 	CMsgPacker Msg(NETMSG_CON_READY);
@@ -874,47 +1193,14 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 			if (m_aClients[ClientID].m_State < CClient::STATE_CONNECTING)
 				return;
 
+			CProfileScope Scope(CProfiler::PHASE_MAPDOWNLOAD);
 			int Chunk = Unpacker.GetInt();
-			unsigned int ChunkSize = 1024 - 128;
-			unsigned int Offset = Chunk * ChunkSize;
-			int Last = 0;
-
-			lastask[ClientID] = Chunk;
-			lastasktick[ClientID] = Tick();
-			if (Chunk == 0)
-			{
-				lastsent[ClientID] = 0;
-			}
-
-			// drop faulty map data requests
-			if (Chunk < 0 || Offset > m_CurrentMapSize)
-				return;
-
-			if (Offset + ChunkSize >= m_CurrentMapSize)
-			{
-				ChunkSize = m_CurrentMapSize - Offset;
-				if (ChunkSize < 0)
-					ChunkSize = 0;
-				Last = 1;
-			}
-
-			if (lastsent[ClientID] < Chunk+g_Config.m_SvMapWindow && g_Config.m_SvFastDownload)
-				return;
-
-			CMsgPacker Msg(NETMSG_MAP_DATA);
-			Msg.AddInt(Last);
-			Msg.AddInt(m_CurrentMapCrc);
-			Msg.AddInt(Chunk);
-			Msg.AddInt(ChunkSize);
-			Msg.AddRaw(&m_pCurrentMapData[Offset], ChunkSize);
-			SendMsgEx(&Msg, MSGFLAG_VITAL | MSGFLAG_FLUSH, ClientID, true);
 
-			if (g_Config.m_Debug)
-			{
-				char aBuf[256];
-				str_format(aBuf, sizeof(aBuf), "sending chunk %d with size %d", Chunk, ChunkSize);
-				Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "server", aBuf);
-			}
+			// with fast download the requests only tell what arrived
+			if (g_Config.m_SvFastDownload)
+				m_aClients[ClientID].m_MapTransfer.OnRequest(Chunk, time_get());
+			else
+				SendMapChunk(ClientID, Chunk, MSGFLAG_VITAL | MSGFLAG_FLUSH);
 		}
 		else if (Msg == NETMSG_READY)
 		{
@@ -926,8 +1212,22 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 				char aBuf[256];
 				str_format(aBuf, sizeof(aBuf), "player is ready. ClientID=%d addr=%s", ClientID, aAddrStr);
 				Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", aBuf);
+
+				// clients that had the map already don't download anything
+				CMapTransfer *pTransfer = &m_aClients[ClientID].m_MapTransfer;
+				if (pTransfer->Active() && pTransfer->NumSent())
+				{
+					int64 Time = max(time_get() - pTransfer->StartTime(), (int64)1);
+					str_format(aBuf, sizeof(aBuf), "map download finished. ClientID=%d time=%.2fs speed=%dKB/s sent=%d resent=%d rtt=%dms window=%d",
+						ClientID, Time/(float)time_freq(), (int)(pTransfer->MapSize()*time_freq()/Time/1024), pTransfer->NumSent(),
+						pTransfer->NumResent(), pTransfer->Rtt(), pTransfer->Window());
+					Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", aBuf);
+				}
+				pTransfer->Stop();
 				m_aClients[ClientID].m_State = CClient::STATE_READY;
+				m_TickRecorder.Record(CTickRecord::TYPE_CONNECT, ClientID, 0, 0);
 				GameServer()->OnClientConnected(ClientID);
+				ExpireServerInfo();
 				SendConnectionReady(ClientID);
 			}
 		}
@@ -942,15 +1242,20 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 				str_format(aBuf, sizeof(aBuf), "player has entered the game. ClientID=%d addr=%s", ClientID, aAddrStr);
 				Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 				m_aClients[ClientID].m_State = CClient::STATE_INGAME;
+				m_TickRecorder.Record(CTickRecord::TYPE_ENTER, ClientID, 0, 0);
 				GameServer()->OnClientEnter(ClientID);
+				ExpireServerInfo();
 			}
 		}
 		else if (Msg == NETMSG_INPUT)
 		{
-			CClient::CInput *pInput;
 			int64 TagTime;
 
-			m_aClients[ClientID].m_LastAckedSnapshot = Unpacker.GetInt();
+			int LastAckedSnapshot = Unpacker.GetInt();
+			if (LastAckedSnapshot > m_aClients[ClientID].m_LastAckedSnapshot)
+				m_aClients[ClientID].m_PeriodAcks++;
+			m_aClients[ClientID].m_PeriodInputs++;
+			m_aClients[ClientID].m_LastAckedSnapshot = LastAckedSnapshot;
 			int IntendedTick = Unpacker.GetInt();
 			int Size = Unpacker.GetInt();
 
@@ -978,24 +1283,32 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 
 			m_aClients[ClientID].m_LastInputTick = IntendedTick;
 
-			pInput = &m_aClients[ClientID].m_aInputs[m_aClients[ClientID].m_CurrentInput];
-
 			if (IntendedTick <= Tick())
+			{
 				IntendedTick = Tick() + 1;
-
-			pInput->m_GameTick = IntendedTick;
+				m_aClients[ClientID].m_LateInputs++;
+			}
 
 			for (int i = 0; i < Size / 4; i++)
-				pInput->m_aData[i] = Unpacker.GetInt();
-
-			mem_copy(m_aClients[ClientID].m_LatestInput.m_aData, pInput->m_aData, MAX_INPUT_SIZE * sizeof(int));
+				m_aClients[ClientID].m_LatestInput.m_aData[i] = Unpacker.GetInt();
 
-			m_aClients[ClientID].m_CurrentInput++;
-			m_aClients[ClientID].m_CurrentInput %= 200;
+			// the first input queued for a tick is the one that gets applied
+			CClient::CInput *pInput = &m_aClients[ClientID].m_aInputs[IntendedTick % CClient::INPUT_RING_SIZE];
+			if (pInput->m_Valid && pInput->m_GameTick == IntendedTick)
+				m_aClients[ClientID].m_DuplicateInputs++;
+			else
+			{
+				pInput->m_GameTick = IntendedTick;
+				pInput->m_Valid = true;
+				mem_copy(pInput->m_aData, m_aClients[ClientID].m_LatestInput.m_aData, MAX_INPUT_SIZE * sizeof(int));
+			}
 
 			// call the mod with the fresh input data
 			if (m_aClients[ClientID].m_State == CClient::STATE_INGAME)
+			{
+				RecordInput(CTickRecord::TYPE_DIRECT_INPUT, ClientID, m_aClients[ClientID].m_LatestInput.m_aData);
 				GameServer()->OnClientDirectInput(ClientID, m_aClients[ClientID].m_LatestInput.m_aData);
+			}
 		}
 		else if (Msg == NETMSG_RCON_CMD)
 		{
@@ -1009,6 +1322,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 				m_RconClientID = ClientID;
 				m_RconAuthLevel = m_aClients[ClientID].m_Authed;
 				Console()->SetAccessLevel(m_aClients[ClientID].m_Authed == AUTHED_ADMIN ? IConsole::ACCESS_LEVEL_ADMIN : IConsole::ACCESS_LEVEL_MOD);
+				m_TickRecorder.Record(CTickRecord::TYPE_COMMAND, ClientID, pCmd, str_length(pCmd));
 				Console()->ExecuteLineFlag(pCmd, CFGFLAG_SERVER);
 				Console()->SetAccessLevel(IConsole::ACCESS_LEVEL_ADMIN);
 				m_RconClientID = IServer::RCON_CID_SERV;
@@ -1110,13 +1424,20 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 	{
 		// game message
 		if (m_aClients[ClientID].m_State >= CClient::STATE_READY)
+		{
+			m_TickRecorder.Record(CTickRecord::TYPE_MESSAGE, ClientID, pPacket->m_pData, pPacket->m_DataSize);
 			GameServer()->OnMessage(Msg, &Unpacker, ClientID);
+		}
 	}
 }
 
-void CServer::SendServerInfo(const NETADDR *pAddr, int Token)
+void CServer::ExpireServerInfo()
+{
+	m_ServerInfoCacheValid = false;
+}
+
+void CServer::CacheServerInfo()
 {
-	CNetChunk Packet;
 	CPacker p;
 	char aBuf[128];
 
@@ -1135,10 +1456,6 @@ void CServer::SendServerInfo(const NETADDR *pAddr, int Token)
 
 	p.Reset();
 
-	p.AddRaw(SERVERBROWSE_INFO, sizeof(SERVERBROWSE_INFO));
-	str_format(aBuf, sizeof(aBuf), "%d", Token);
-	p.AddString(aBuf, 6);
-
 	p.AddString(GameServer()->Version(), 32);
 
 	char bBuf[128];
@@ -1199,6 +1516,27 @@ void CServer::SendServerInfo(const NETADDR *pAddr, int Token)
 		}
 	}
 
+	// everything after the token, the requests only differ in it
+	m_ServerInfoCacheSize = p.Size();
+	mem_copy(m_aServerInfoCache, p.Data(), p.Size());
+	m_ServerInfoCacheValid = true;
+}
+
+void CServer::SendServerInfo(const NETADDR *pAddr, int Token)
+{
+	if (!m_ServerInfoCacheValid)
+		CacheServerInfo();
+
+	CNetChunk Packet;
+	CPacker p;
+	char aBuf[16];
+
+	p.Reset();
+	p.AddRaw(SERVERBROWSE_INFO, sizeof(SERVERBROWSE_INFO));
+	str_format(aBuf, sizeof(aBuf), "%d", Token);
+	p.AddString(aBuf, 6);
+	p.AddRaw(m_aServerInfoCache, m_ServerInfoCacheSize);
+
 	Packet.m_ClientID = -1;
 	Packet.m_Address = *pAddr;
 	Packet.m_Flags = NETSENDFLAG_CONNLESS;
@@ -1207,8 +1545,71 @@ void CServer::SendServerInfo(const NETADDR *pAddr, int Token)
 	m_NetServer.Send(&Packet);
 }
 
+unsigned CServer::HashInfoSource(const NETADDR *pAddr) const
+{
+	// keyed fnv-1a over the address without the port, mixed at the end
+	int Size = pAddr->type == NETTYPE_IPV4 ? 4 : 16;
+	unsigned Hash = (2166136261u^m_aInfoSourceKey[0])^pAddr->type;
+	for (int i = 0; i < Size; i++)
+		Hash = (Hash^pAddr->ip[i])*16777619u;
+	Hash ^= m_aInfoSourceKey[1];
+	Hash ^= Hash>>16;
+	Hash *= 0x85ebca6b;
+	Hash ^= Hash>>13;
+	Hash *= 0xc2b2ae35;
+	return Hash ^ (Hash>>16);
+}
+
+bool CServer::AllowServerInfoRequest(const NETADDR *pAddr)
+{
+	if (!g_Config.m_SvInfoMaxRequests)
+		return true;
+
+	NETADDR Addr = *pAddr;
+	Addr.port = 0;
+	int64 Now = time_get();
+
+	// look for the source, remember the first slot that is free to take
+	unsigned Hash = HashInfoSource(&Addr);
+	CInfoSource *pSource = 0;
+	CInfoSource *pFree = 0;
+	for (int i = 0; i < MAX_INFO_PROBES; i++)
+	{
+		CInfoSource *pSlot = &m_aInfoSources[(Hash+i) & (NUM_INFO_SOURCES-1)];
+		bool Expired = pSlot->m_WindowStart + time_freq() < Now;
+		if (pSlot->m_WindowStart && net_addr_comp(&pSlot->m_Addr, &Addr) == 0)
+		{
+			pSource = pSlot;
+			if (Expired)
+			{
+				pSource->m_WindowStart = Now;
+				pSource->m_Requests = 0;
+			}
+			break;
+		}
+		if (!pFree && (!pSlot->m_WindowStart || Expired))
+			pFree = pSlot;
+		// nothing was ever stored behind a slot that was never used
+		if (!pSlot->m_WindowStart)
+			break;
+	}
+
+	if (!pSource)
+	{
+		// the sources that are already tracked keep their answers while the table is full
+		if (!pFree)
+			return false;
+		pSource = pFree;
+		pSource->m_Addr = Addr;
+		pSource->m_WindowStart = Now;
+		pSource->m_Requests = 0;
+	}
+	return ++pSource->m_Requests <= g_Config.m_SvInfoMaxRequests;
+}
+
 void CServer::UpdateServerInfo()
 {
+	ExpireServerInfo();
 	for (int i = 0; i < MAX_CLIENTS; ++i)
 	{
 		if (m_aClients[i].m_State != CClient::STATE_EMPTY)
@@ -1218,6 +1619,7 @@ void CServer::UpdateServerInfo()
 
 void CServer::PumpNetwork()
 {
+	CProfileScope Scope(CProfiler::PHASE_NETWORK);
 	CNetChunk Packet;
 
 	m_NetServer.Update();
@@ -1231,7 +1633,8 @@ void CServer::PumpNetwork()
 			if (!m_Register.RegisterProcessPacket(&Packet))
 			{
 				if (Packet.m_DataSize == sizeof(SERVERBROWSE_GETINFO) + 1 &&
-					mem_comp(Packet.m_pData, SERVERBROWSE_GETINFO, sizeof(SERVERBROWSE_GETINFO)) == 0)
+					mem_comp(Packet.m_pData, SERVERBROWSE_GETINFO, sizeof(SERVERBROWSE_GETINFO)) == 0 &&
+					AllowServerInfoRequest(&Packet.m_Address))
 				{
 					SendServerInfo(&Packet.m_Address, ((unsigned char *)Packet.m_pData)[sizeof(SERVERBROWSE_GETINFO)]);
 				}
@@ -1242,45 +1645,8 @@ void CServer::PumpNetwork()
 	}
 
 	if(g_Config.m_SvFastDownload)
-	{
-		for (int i=0;i<MAX_CLIENTS;i++)
-		{
-			if (m_aClients[i].m_State != CClient::STATE_CONNECTING)
-				continue;
-			if (lastasktick[i] < Tick()-TickSpeed())
-			{
-				lastsent[i] = lastask[i];
-				lastasktick[i] = Tick();
-			}
-			if (lastask[i]<lastsent[i]-g_Config.m_SvMapWindow)
-				continue;
-			int Chunk = lastsent[i]++;
-			unsigned int ChunkSize = 1024-128;
-			unsigned int Offset = Chunk * ChunkSize;
-			int Last = 0;
-			// drop faulty map data requests
-			if(Chunk < 0 || Offset > m_CurrentMapSize)
-				continue;
-			if(Offset+ChunkSize >= m_CurrentMapSize)
-			{
-				ChunkSize = m_CurrentMapSize-Offset;
-				Last = 1;
-			}
-			CMsgPacker Msg(NETMSG_MAP_DATA);
-			Msg.AddInt(Last);
-			Msg.AddInt(m_CurrentMapCrc);
-			Msg.AddInt(Chunk);
-			Msg.AddInt(ChunkSize);
-			Msg.AddRaw(&m_pCurrentMapData[Offset], ChunkSize);
-			SendMsgEx(&Msg, MSGFLAG_FLUSH, i, true);
-			if(g_Config.m_Debug)
-			{
-				char aBuf[256];
-				str_format(aBuf, sizeof(aBuf), "sending chunk %d with size %d", Chunk, ChunkSize);
-				Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "server", aBuf);
-			}
-		}
-	}
+		SendMapChunks();
+	FreeMapChunks(false);
 
 	m_ServerBan.Update();
 	m_Econ.Update();
@@ -1333,15 +1699,21 @@ int CServer::LoadMap(const char *pMapName)
 	str_copy(m_aCurrentMap, pMapName, sizeof(m_aCurrentMap));
 	// map_set(df);
 
-	// load complete map into memory for download
+	// load complete map into memory and pack it for download
 	{
 		IOHANDLE File = Storage()->OpenFile(aBuf, IOFLAG_READ, IStorage::TYPE_ALL);
 		m_CurrentMapSize = (int)io_length(File);
-		if (m_pCurrentMapData)
-			mem_free(m_pCurrentMapData);
-		m_pCurrentMapData = (unsigned char *)mem_alloc(m_CurrentMapSize, 1);
-		io_read(File, m_pCurrentMapData, m_CurrentMapSize);
+		unsigned char *pMapData = (unsigned char *)mem_alloc_tag(m_CurrentMapSize, 1, MEMTAG_MAP);
+		io_read(File, pMapData, m_CurrentMapSize);
 		io_close(File);
+
+		if (m_pMapChunks)
+		{
+			m_pMapChunks->m_pNext = m_pOldMapChunks;
+			m_pOldMapChunks = m_pMapChunks;
+		}
+		m_pMapChunks = new CMapChunks(pMapData, m_CurrentMapSize, m_CurrentMapCrc);
+		mem_free(pMapData);
 	}
 	return 1;
 }
@@ -1356,12 +1728,16 @@ int CServer::Run()
 	//
 	m_PrintCBIndex = Console()->RegisterPrintCallback(g_Config.m_ConsoleOutputLevel, SendRconLineAuthed, this);
 
+	if (g_Config.m_DbgTickReplay[0])
+		return RunTickReplay();
+
 	// load map
 	if (!LoadMap(g_Config.m_SvMap))
 	{
 		dbg_msg("server", "failed to load map. mapname='%s'", g_Config.m_SvMap);
 		return -1;
 	}
+	m_MapChanged = false;
 
 	// start server
 	NETADDR BindAddr;
@@ -1393,12 +1769,33 @@ int CServer::Run()
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 
 	GameServer()->OnInit();
+	TickRecorder_HandleAutoStart();
 	str_format(aBuf, sizeof(aBuf), "version %s", GameServer()->NetVersion());
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 
 	// process pending commands
 	m_pConsole->StoreCommands(false);
 
+	// feed a capture into the server instead of the socket, on a virtual clock
+	int64 ReplayStartTime = 0;
+	if (g_Config.m_DbgReplay[0])
+	{
+		time_set_virtual(time_get_real());
+		if (!m_Replay.Open(Storage()->OpenFile(g_Config.m_DbgReplay, IOFLAG_READ, IStorage::TYPE_ALL), time_get()))
+		{
+			time_set_virtual(-1);
+			dbg_msg("server", "failed to open the capture. filename='%s'", g_Config.m_DbgReplay);
+			return -1;
+		}
+
+		g_Config.m_SvRegister = 0;
+		CNetBase::SetReplay(&m_Replay);
+		m_Replaying = true;
+		ReplayStartTime = time_get_real();
+		str_format(aBuf, sizeof(aBuf), "replaying '%s'", g_Config.m_DbgReplay);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+	}
+
 	// start game
 	{
 		int64 ReportTime = time_get();
@@ -1415,18 +1812,37 @@ int CServer::Run()
 
 		while (m_RunServer)
 		{
+			if (m_Replaying)
+			{
+				if (m_Replay.Done())
+				{
+					double Seconds = (time_get_real() - ReplayStartTime) / (double)time_freq();
+					str_format(aBuf, sizeof(aBuf), "replayed %d ticks in %.2fs (%.0f ticks/s), %d packets in (%d bytes), %d packets out (%d bytes)",
+						m_CurrentGameTick, Seconds, m_CurrentGameTick / max(Seconds, 0.001),
+						m_Replay.m_NumRecv, (int)m_Replay.m_BytesRecv, m_Replay.m_NumSent, (int)m_Replay.m_BytesSent);
+					Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+					break;
+				}
+
+				// jump to the next tick or packet, whatever comes first
+				int64 Next = min(TickStartTime(m_CurrentGameTick + 1) + 1, m_Replay.NextTime());
+				time_set_virtual(max(Next, time_get()));
+			}
+
 			int64 t = time_get();
 			int NewTicks = 0;
 
-			// load new map TODO: don't poll this
-			if (str_comp(g_Config.m_SvMap, m_aCurrentMap) != 0 || m_MapReload)
+			// load new map
+			if (m_MapReload || (m_MapChanged && str_comp(g_Config.m_SvMap, m_aCurrentMap) != 0))
 			{
 				m_MapReload = 0;
+				m_MapChanged = false;
 
 				// load map
 				if (LoadMap(g_Config.m_SvMap))
 				{
 					// new map loaded
+					m_TickRecorder.Stop();
 					GameServer()->OnShutdown();
 
 					for (int c = 0; c < MAX_CLIENTS; c++)
@@ -1443,6 +1859,7 @@ int CServer::Run()
 					m_CurrentGameTick = 0;
 					Kernel()->ReregisterInterface(GameServer());
 					GameServer()->OnInit();
+					TickRecorder_HandleAutoStart();
 					UpdateServerInfo();
 				}
 				else
@@ -1455,35 +1872,53 @@ int CServer::Run()
 
 			while (t > TickStartTime(m_CurrentGameTick + 1))
 			{
+				// the samples of the profiler reach from tick start to tick start
+				g_Profiler.EndTick(m_CurrentGameTick + 1);
+
 				m_CurrentGameTick++;
 				NewTicks++;
+				m_TickRecorder.Record(CTickRecord::TYPE_TICK_BEGIN, 0, 0, 0);
 
 				// apply new input
-				for (int c = 0; c < MAX_CLIENTS; c++)
 				{
-					if (m_aClients[c].m_State == CClient::STATE_EMPTY)
-						continue;
-					for (int i = 0; i < 200; i++)
+					CProfileScope Scope(CProfiler::PHASE_INPUT);
+					for (int c = 0; c < MAX_CLIENTS; c++)
 					{
-						if (m_aClients[c].m_aInputs[i].m_GameTick == Tick())
+						if (m_aClients[c].m_State == CClient::STATE_EMPTY)
+							continue;
+						CClient::CInput *pInput = &m_aClients[c].m_aInputs[Tick() % CClient::INPUT_RING_SIZE];
+						if (pInput->m_Valid && pInput->m_GameTick == Tick())
 						{
+							pInput->m_Valid = false;
 							if (m_aClients[c].m_State == CClient::STATE_INGAME)
-								GameServer()->OnClientPredictedInput(c, m_aClients[c].m_aInputs[i].m_aData);
-							break;
+							{
+								RecordInput(CTickRecord::TYPE_PREDICTED_INPUT, c, pInput->m_aData);
+								GameServer()->OnClientPredictedInput(c, pInput->m_aData);
+							}
 						}
 					}
 				}
 
-				GameServer()->OnTick();
+				{
+					CProfileScope Scope(CProfiler::PHASE_TICK);
+					GameServer()->OnTick();
+				}
+				m_TickRecorder.Record(CTickRecord::TYPE_TICK_END, 0, 0, 0);
 			}
 
 			// snap game
 			if (NewTicks)
 			{
-				if (g_Config.m_SvHighBandwidth || (m_CurrentGameTick % 2) == 0)
-					DoSnapshot();
+				DoSnapshot();
 
 				UpdateClientRconCommands();
+
+				if (m_ConfigWatch && fs_watch_changed(m_ConfigWatch))
+				{
+					str_format(aBuf, sizeof(aBuf), "'%s' changed, executing it again", m_aConfigFile);
+					Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+					Console()->ExecuteFile(m_aConfigFile);
+				}
 			}
 
 			// master server stuff
@@ -1493,31 +1928,15 @@ int CServer::Run()
 
 			if (ReportTime < time_get())
 			{
-				if (g_Config.m_Debug)
-				{
-					/*
-					static NETSTATS prev_stats;
-					NETSTATS stats;
-					netserver_stats(net, &stats);
-
-					perf_next();
-
-					if(config.dbg_pref)
-						perf_dump(&rootscope);
-
-					dbg_msg("server", "send=%8d recv=%8d",
-						(stats.send_bytes - prev_stats.send_bytes)/reportinterval,
-						(stats.recv_bytes - prev_stats.recv_bytes)/reportinterval);
-
-					prev_stats = stats;
-					*/
-				}
+				if (g_Config.m_DbgPref)
+					PrintPerf(false);
 
 				ReportTime += time_freq() * ReportInterval;
 			}
 
 			// wait for incomming data
-			net_socket_read_wait(m_NetServer.Socket(), 5);
+			if (!m_Replaying)
+				net_socket_read_wait(m_NetServer.Socket(), 5);
 		}
 	}
 	// disconnect all clients on shutdown
@@ -1529,11 +1948,19 @@ int CServer::Run()
 		m_Econ.Shutdown();
 	}
 
+	m_Register.Shutdown();
+	fs_watch_destroy(m_ConfigWatch);
+	m_ConfigWatch = 0;
+	m_TickRecorder.Stop();
 	GameServer()->OnShutdown();
 	m_pMap->Unload();
 
-	if (m_pCurrentMapData)
-		mem_free(m_pCurrentMapData);
+	// finish a running capture
+	CNetBase::CloseLog();
+
+	FreeMapChunks(true);
+	delete m_pMapChunks;
+	m_pMapChunks = 0;
 	return 0;
 }
 
@@ -1564,8 +1991,18 @@ void CServer::ConStatus(IConsole::IResult *pResult, void *pUser)
 			{
 				const char *pAuthStr = pThis->m_aClients[i].m_Authed == CServer::AUTHED_ADMIN ? "(Admin)" : pThis->m_aClients[i].m_Authed == CServer::AUTHED_MOD ? "(Mod)"
 																																								 : "";
-				str_format(aBuf, sizeof(aBuf), "id=%d addr=%s name='%s' client=%d score=%d %s", i, aAddrStr,
-						   pThis->m_aClients[i].m_aName, pThis->m_aClients[i].m_DDNetVersion, pThis->m_aClients[i].m_Score, pAuthStr);
+				const CNetConnection *pConnection = pThis->m_NetServer.ClientConnection(i);
+				str_format(aBuf, sizeof(aBuf), "id=%d addr=%s name='%s' client=%d score=%d late_inputs=%d dup_inputs=%d rtt=%d rttvar=%d resends=%d/%d bw=%.1fKB/s snap_interval=%d snap_range=%d%% snap_loss=%d%% %s", i, aAddrStr,
+						   pThis->m_aClients[i].m_aName, pThis->m_aClients[i].m_DDNetVersion, pThis->m_aClients[i].m_Score,
+						   pThis->m_aClients[i].m_LateInputs, pThis->m_aClients[i].m_DuplicateInputs, pConnection->Rtt(), pConnection->RttVar(),
+						   pConnection->NumResends(), pConnection->NumVitalChunks(), pThis->m_aClients[i].m_Bandwidth/1024.0f,
+						   pThis->m_aClients[i].m_SnapInterval, (int)(pThis->m_aClients[i].m_SnapRange*100+0.5f), pThis->m_aClients[i].m_SnapLoss, pAuthStr);
+			}
+			else if (pThis->m_aClients[i].m_State == CClient::STATE_CONNECTING && pThis->m_aClients[i].m_MapTransfer.Active())
+			{
+				const CMapTransfer *pTransfer = &pThis->m_aClients[i].m_MapTransfer;
+				str_format(aBuf, sizeof(aBuf), "id=%d addr=%s connecting map=%d%% speed=%dKB/s window=%d resent=%d/%d", i, aAddrStr,
+						   pTransfer->Progress(), pTransfer->Speed(time_get())/1024, pTransfer->Window(), pTransfer->NumResent(), pTransfer->NumSent());
 			}
 			else
 				str_format(aBuf, sizeof(aBuf), "id=%d addr=%s connecting", i, aAddrStr);
@@ -1612,6 +2049,179 @@ bool CServer::DemoRecorder_IsRecording()
 	return m_DemoRecorder.IsRecording();
 }
 
+void CServer::RecordInput(int Type, int ClientID, const int *pInput)
+{
+	if (!m_TickRecorder.IsRecording())
+		return;
+
+	// the game uses only the start of the input, leave out the zeros after it
+	int Size = MAX_INPUT_SIZE;
+	while (Size > 0 && pInput[Size-1] == 0)
+		Size--;
+	m_TickRecorder.Record(Type, ClientID, pInput, Size*sizeof(int));
+}
+
+void CServer::TickRecorder_HandleAutoStart()
+{
+	if (!g_Config.m_SvTickRecord)
+		return;
+
+	char aFilename[128];
+	char aDate[20];
+	str_timestamp(aDate, sizeof(aDate));
+	str_format(aFilename, sizeof(aFilename), "dumps/ticks_%s_%s.twticks", m_aCurrentMap, aDate);
+	if (m_TickRecorder.Start(Storage()->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE), m_aCurrentMap, m_CurrentMapCrc))
+	{
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "recording ticks to '%s'", aFilename);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+	}
+	else
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "failed to start the tick record");
+}
+
+int CServer::RunTickReplay()
+{
+	CTickRecordReader Reader;
+	if (!Reader.Open(Storage()->OpenFile(g_Config.m_DbgTickReplay, IOFLAG_READ, IStorage::TYPE_ALL)))
+	{
+		dbg_msg("server", "failed to open the tick record. filename='%s'", g_Config.m_DbgTickReplay);
+		return -1;
+	}
+
+	IOHANDLE HashFile = 0;
+	if (g_Config.m_DbgTickHash[0])
+	{
+		HashFile = Storage()->OpenFile(g_Config.m_DbgTickHash, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		if (!HashFile)
+		{
+			dbg_msg("server", "failed to open the hash file. filename='%s'", g_Config.m_DbgTickHash);
+			Reader.Close();
+			return -1;
+		}
+	}
+
+	// the clients only exist for the game, nothing goes over the network
+	m_TickReplaying = true;
+	m_NetServer.SetCallbacks(NewClientCallback, DelClientCallback, this);
+
+	// the game has to see the same random numbers and time on every replay
+	srand(0);
+	const int64 TimeBase = time_freq() * 1000;
+	time_set_virtual(TimeBase);
+
+	unsigned char aData[CTickRecord::MAX_DATA_SIZE+1];
+	int aInput[MAX_INPUT_SIZE];
+	int Type, ClientID, Size;
+	unsigned MapCrc = 0;
+	bool Started = false;
+	int64 StartTime = time_get_real();
+	while (Reader.Read(&Type, &ClientID, aData, &Size))
+	{
+		// map and settings come first
+		if (Type == CTickRecord::TYPE_MAP && Size >= 4)
+		{
+			MapCrc = (aData[0]<<24) | (aData[1]<<16) | (aData[2]<<8) | aData[3];
+			str_copy(g_Config.m_SvMap, (const char *)&aData[4], sizeof(g_Config.m_SvMap));
+			continue;
+		}
+		if (Type == CTickRecord::TYPE_CONFIG)
+		{
+			Console()->ExecuteLine((const char *)aData);
+			continue;
+		}
+
+		if (!Started)
+		{
+			if (!LoadMap(g_Config.m_SvMap))
+			{
+				dbg_msg("server", "failed to load map. mapname='%s'", g_Config.m_SvMap);
+				break;
+			}
+			if (m_CurrentMapCrc != MapCrc)
+				dbg_msg("server", "the map differs from the recorded one. crc=%08x recorded=%08x", m_CurrentMapCrc, MapCrc);
+
+			m_GameStartTime = time_get();
+			GameServer()->OnInit();
+			Started = true;
+		}
+
+		if (ClientID < 0 || ClientID >= MAX_CLIENTS)
+			continue;
+
+		switch (Type)
+		{
+		case CTickRecord::TYPE_TICK_BEGIN:
+			m_CurrentGameTick++;
+			time_set_virtual(TickStartTime(m_CurrentGameTick));
+			break;
+		case CTickRecord::TYPE_TICK_END:
+			GameServer()->OnTick();
+			if (HashFile)
+				GameServer()->WriteWorldHash(HashFile);
+			break;
+		case CTickRecord::TYPE_CONNECT:
+			NewClientCallback(ClientID, this);
+			m_aClients[ClientID].m_State = CClient::STATE_READY;
+			GameServer()->OnClientConnected(ClientID);
+			break;
+		case CTickRecord::TYPE_ENTER:
+			if (m_aClients[ClientID].m_State == CClient::STATE_READY)
+			{
+				m_aClients[ClientID].m_State = CClient::STATE_INGAME;
+				GameServer()->OnClientEnter(ClientID);
+			}
+			break;
+		case CTickRecord::TYPE_DROP:
+			if (m_aClients[ClientID].m_State != CClient::STATE_EMPTY)
+				DelClientCallback(ClientID, (const char *)aData, this);
+			break;
+		case CTickRecord::TYPE_DIRECT_INPUT:
+		case CTickRecord::TYPE_PREDICTED_INPUT:
+			if (m_aClients[ClientID].m_State != CClient::STATE_INGAME || Size > (int)sizeof(aInput))
+				break;
+			mem_zero(aInput, sizeof(aInput));
+			mem_copy(aInput, aData, Size);
+			if (Type == CTickRecord::TYPE_DIRECT_INPUT)
+				GameServer()->OnClientDirectInput(ClientID, aInput);
+			else
+				GameServer()->OnClientPredictedInput(ClientID, aInput);
+			break;
+		case CTickRecord::TYPE_MESSAGE:
+			if (m_aClients[ClientID].m_State >= CClient::STATE_READY)
+			{
+				CUnpacker Unpacker;
+				Unpacker.Reset(aData, Size);
+				int Msg = Unpacker.GetInt() >> 1;
+				GameServer()->OnMessage(Msg, &Unpacker, ClientID);
+			}
+			break;
+		case CTickRecord::TYPE_COMMAND:
+			m_RconClientID = ClientID;
+			Console()->ExecuteLineFlag((const char *)aData, CFGFLAG_SERVER);
+			m_RconClientID = IServer::RCON_CID_SERV;
+			break;
+		}
+	}
+	Reader.Close();
+
+	char aBuf[256];
+	double Seconds = (time_get_real() - StartTime) / (double)time_freq();
+	str_format(aBuf, sizeof(aBuf), "replayed %d ticks in %.2fs", m_CurrentGameTick, Seconds);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+
+	if (HashFile)
+		io_close(HashFile);
+	if (Started)
+	{
+		GameServer()->OnShutdown();
+		m_pMap->Unload();
+	}
+	time_set_virtual(-1);
+	m_TickReplaying = false;
+	return Started ? 0 : -1;
+}
+
 void CServer::ConRecord(IConsole::IResult *pResult, void *pUser)
 {
 	CServer *pServer = (CServer *)pUser;
@@ -1638,6 +2248,38 @@ void CServer::ConMapReload(IConsole::IResult *pResult, void *pUser)
 	((CServer *)pUser)->m_MapReload = 1;
 }
 
+void CServer::ConfigMapChanged(int Variable, void *pUser)
+{
+	((CServer *)pUser)->m_MapChanged = true;
+}
+
+void CServer::ConfigInfoChanged(int Variable, void *pUser)
+{
+	((CServer *)pUser)->ExpireServerInfo();
+}
+
+void CServer::ConfigReloadChanged(int Variable, void *pUser)
+{
+	CServer *pSelf = (CServer *)pUser;
+	fs_watch_destroy(pSelf->m_ConfigWatch);
+	pSelf->m_ConfigWatch = 0;
+
+	char aPath[512];
+	IOHANDLE File;
+	if(g_Config.m_SvConfigReload && pSelf->m_aConfigFile[0] &&
+		(File = pSelf->Storage()->OpenFile(pSelf->m_aConfigFile, IOFLAG_READ, IStorage::TYPE_ALL, aPath, sizeof(aPath))))
+	{
+		io_close(File);
+		pSelf->m_ConfigWatch = fs_watch_create(aPath);
+		if(!pSelf->m_ConfigWatch)
+		{
+			char aBuf[256];
+			str_format(aBuf, sizeof(aBuf), "failed to watch '%s'", aPath);
+			pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+		}
+	}
+}
+
 void CServer::ConLogout(IConsole::IResult *pResult, void *pUser)
 {
 	CServer *pServer = (CServer *)pUser;
@@ -1728,6 +2370,81 @@ void CServer::ConWhois(IConsole::IResult *pResult, void *pUser)
 	}
 }
 
+void CServer::PrintPerf(bool Full)
+{
+	char aBuf[256];
+	if(!Full)
+	{
+		// one line with the phases of the main loop
+		int Length = 0;
+		aBuf[0] = 0;
+		for(int i = 0; i < g_Profiler.NumPhases(); i++)
+		{
+			CProfiler::CStats Stats;
+			const char *pName = g_Profiler.PhaseName(i);
+			if(str_find(pName, ".") || !g_Profiler.GetStats(i, &Stats))
+				continue;
+			str_format(aBuf+Length, sizeof(aBuf)-Length, "%s%s %.0f/%.0f/%.0f", Length ? " " : "", pName, Stats.m_Avg, Stats.m_P99, Stats.m_Max);
+			Length = str_length(aBuf);
+		}
+		if(!Length)
+			return;
+		str_append(aBuf, " (avg/p99/max us)", sizeof(aBuf));
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "perf", aBuf);
+		return;
+	}
+
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "perf", "phase                       calls      min      avg      p99      max (us)");
+	for(int i = 0; i < g_Profiler.NumPhases(); i++)
+	{
+		CProfiler::CStats Stats;
+		if(!g_Profiler.GetStats(i, &Stats))
+			continue;
+		str_format(aBuf, sizeof(aBuf), "%-24s %8.1f %8.1f %8.1f %8.1f %8.1f", g_Profiler.PhaseName(i),
+			Stats.m_Calls, Stats.m_Min, Stats.m_Avg, Stats.m_P99, Stats.m_Max);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "perf", aBuf);
+	}
+}
+
+void CServer::ConPerf(IConsole::IResult *pResult, void *pUser)
+{
+	((CServer *)pUser)->PrintPerf(true);
+}
+
+void CServer::ConPerfTrace(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pServer = (CServer *)pUser;
+	if(g_Profiler.Tracing())
+	{
+		pServer->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "perf", "a trace is already running");
+		return;
+	}
+
+	char aFilename[128];
+	if(pResult->NumArguments() > 1)
+		str_format(aFilename, sizeof(aFilename), "%s.json", pResult->GetString(1));
+	else
+	{
+		char aDate[20];
+		str_timestamp(aDate, sizeof(aDate));
+		str_format(aFilename, sizeof(aFilename), "perf_%s.json", aDate);
+	}
+
+	IOHANDLE File = pServer->Storage()->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+	{
+		pServer->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "perf", "failed to open the trace file");
+		return;
+	}
+
+	int Ticks = clamp(pResult->GetInteger(0), 1, SERVER_TICK_SPEED*60);
+	g_Profiler.StartTrace(File, Ticks);
+
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "tracing %d ticks to '%s'", Ticks, aFilename);
+	pServer->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "perf", aBuf);
+}
+
 void CServer::RegisterCommands()
 {
 	m_pConsole = Kernel()->RequestInterface<IConsole>();
@@ -1746,6 +2463,8 @@ void CServer::RegisterCommands()
 
 	Console()->Register("reload", "", CFGFLAG_SERVER, ConMapReload, this, "Reload the map");
 	Console()->Register("whois", "", CFGFLAG_SERVER, ConWhois, this, "Show which player is authed");
+	Console()->Register("perf", "", CFGFLAG_SERVER, ConPerf, this, "Show where the time of the last ticks went");
+	Console()->Register("perf_trace", "i?s", CFGFLAG_SERVER, ConPerfTrace, this, "Write a Chrome trace of the next ticks to a file");
 
 	Console()->Chain("sv_name", ConchainSpecialInfoupdate, this);
 	Console()->Chain("password", ConchainSpecialInfoupdate, this);
@@ -1754,6 +2473,10 @@ void CServer::RegisterCommands()
 	Console()->Chain("mod_command", ConchainModCommandUpdate, this);
 	Console()->Chain("console_output_level", ConchainConsoleOutputLevelUpdate, this);
 
+	Console()->RegisterConfigCallback(CONFIG_SvMap, ConfigMapChanged, this);
+	Console()->RegisterConfigCallback(CONFIG_SvConfigReload, ConfigReloadChanged, this);
+	Console()->RegisterConfigCallback(CONFIG_SvSpectatorSlots, ConfigInfoChanged, this);
+
 	// register console commands in sub parts
 	m_ServerBan.InitServerBan(Console(), Storage(), this);
 	m_pGameServer->OnConsoleInit();
@@ -1843,7 +2566,7 @@ int main(int argc, const char **argv) // ignore_convention
 	if(File)
 	{
 		io_close(File);
-		pConsole->ExecuteFile("autoexec_server_twplus.cfg");
+		str_copy(pServer->m_aConfigFile, "autoexec_server_twplus.cfg", sizeof(pServer->m_aConfigFile));
 	} else {
 		str_format(aBuf, sizeof(aBuf), "failed to open 'autoexec_server_twplus.cfg', trying next config file...");
 		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "console", aBuf);
@@ -1851,14 +2574,15 @@ int main(int argc, const char **argv) // ignore_convention
 		IOHANDLE File2 = pStorage->OpenFile("autoexec_server.cfg", IOFLAG_READ, IStorage::TYPE_ALL);
 		if(File2)
 		{
-			pConsole->ExecuteFile("autoexec_server.cfg");
+			str_copy(pServer->m_aConfigFile, "autoexec_server.cfg", sizeof(pServer->m_aConfigFile));
 			io_close(File2);
 		} else {
 			str_format(aBuf, sizeof(aBuf), "failed to open 'autoexec_server.cfg', trying next config file...");
 			pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "console", aBuf);
-			pConsole->ExecuteFile("autoexec.cfg");
+			str_copy(pServer->m_aConfigFile, "autoexec.cfg", sizeof(pServer->m_aConfigFile));
 		}
 	}
+	pConsole->ExecuteFile(pServer->m_aConfigFile);
 
 	// parse the command line arguments
 	if (argc > 1)									  // ignore_convention
@@ -47,6 +47,7 @@ class CServerBan : public CNetBan
 	class CServer *m_pServer;
 
 	template<class T> int BanExt(T *pBanPool, const typename T::CDataType *pData, int Seconds, const char *pReason);
+	virtual void OnBansLoaded();
 
 public:
 	class CServer *Server() const { return m_pServer; }
@@ -94,7 +95,13 @@ public:
 
 			SNAPRATE_INIT=0,
 			SNAPRATE_FULL,
-			SNAPRATE_RECOVER
+			SNAPRATE_RECOVER,
+
+			SNAP_MIN_BUDGET=2*1024, // bytes per second
+			SNAP_MAX_UNACKED=32, // vital chunks waiting for their ack
+			SNAP_QUEUE_DELAY=100, // ms the rtt may grow over its minimum
+
+			INPUT_RING_SIZE=256, // inputs are stored at their tick modulo this
 		};
 
 		class CInput
@@ -102,6 +109,7 @@ public:
 		public:
 			int m_aData[MAX_INPUT_SIZE];
 			int m_GameTick; // the tick that was chosen for the input
+			bool m_Valid; // not applied yet
 		};
 
 		// connection state info
@@ -109,13 +117,36 @@ public:
 		int m_Latency;
 		int m_SnapRate;
 
+		// snapshot rate and size adapted to the connection, see UpdateSnapRate
+		int m_SnapInterval; // ticks between two snapshots
+		int m_LastSnapTick;
+		int m_SnapBudget; // bytes per second for the snapshots, 0 for no limit
+		float m_SnapRange; // part of the margin beyond the visible area in the snapshots, shrinks while they are over the budget
+		int m_MinRtt;
+
+		// measured over the current period, about a second
+		int64 m_PeriodStart;
+		int m_PeriodBytes;
+		int m_PeriodSnapBytes;
+		int m_PeriodSnaps;
+		int m_PeriodAcks; // snapshots the client acked newly
+		int m_PeriodInputs;
+		int m_PeriodResends; // resends and vital chunks of the connection at the start
+		int m_PeriodVitalChunks;
+
+		// results of the last period
+		int m_Bandwidth; // bytes per second
+		int m_SnapBandwidth;
+		int m_SnapLoss; // percent
+
 		int m_LastAckedSnapshot;
 		int m_LastInputTick;
 		CSnapshotStorage m_Snapshots;
 
 		CInput m_LatestInput;
-		CInput m_aInputs[200]; // TODO: handle input better
-		int m_CurrentInput;
+		CInput m_aInputs[INPUT_RING_SIZE];
+		int m_LateInputs; // arrived after their tick, moved to the next one
+		int m_DuplicateInputs; // another input was already queued for the tick
 
 		char m_aName[MAX_NAME_LENGTH];
 		char m_aClan[MAX_CLAN_LENGTH];
@@ -127,6 +158,8 @@ public:
 
 		const IConsole::CCommandInfo *m_pRconCmdToSend;
 
+		CMapTransfer m_MapTransfer;
+
 		void Reset();
 	};
 
@@ -139,22 +172,65 @@ public:
 	CEcon m_Econ;
 	CServerBan m_ServerBan;
 
+	// replay of a packet capture (dbg_replay)
+	CNetReplay m_Replay;
+	bool m_Replaying;
+
+	// record of the game inputs (sv_tick_record) and its headless replay (dbg_tickreplay)
+	CTickRecorder m_TickRecorder;
+	bool m_TickReplaying;
+
 	IEngineMap *m_pMap;
 
 	int64 m_GameStartTime;
 	//int m_CurrentGameTick;
 	int m_RunServer;
 	int m_MapReload;
+	bool m_MapChanged; // sv_map got a new value
 	int m_RconClientID;
 	int m_RconAuthLevel;
 	int m_PrintCBIndex;
 
+	// server info without the token, rebuilt when it expired
+	unsigned char m_aServerInfoCache[NET_MAX_PAYLOAD];
+	int m_ServerInfoCacheSize;
+	bool m_ServerInfoCacheValid;
+
+	// server info requests per source address in the current second, an
+	// open addressing table with a keyed hash so sources can't be made to
+	// collide. Slots get reused once their window ran out
+	enum
+	{
+		NUM_INFO_SOURCES=4096, // power of two
+		MAX_INFO_PROBES=32,
+	};
+	struct CInfoSource
+	{
+		NETADDR m_Addr; // port zeroed
+		int64 m_WindowStart; // 0 if the slot was never used
+		int m_Requests;
+	};
+	CInfoSource m_aInfoSources[NUM_INFO_SOURCES];
+	unsigned m_aInfoSourceKey[2];
+
+	unsigned HashInfoSource(const NETADDR *pAddr) const;
+
 	int64 m_Lastheartbeat;
 	//static NETADDR4 master_server;
 
 	char m_aCurrentMap[64];
 	unsigned m_CurrentMapCrc;
-	unsigned char *m_pCurrentMapData;
+
+	// autoexec config and its watch for sv_config_reload
+	char m_aConfigFile[128];
+	FSWATCH m_ConfigWatch;
+
+	// bytes the map downloads may still send, shared by all downloaders
+	int64 m_MapDownloadBudget;
+	int64 m_MapDownloadTime;
+	int m_MapDownloadFirst;
+	class CMapChunks *m_pMapChunks;
+	class CMapChunks *m_pOldMapChunks; // still referred to by connections
 	int m_CurrentMapSize;
 
 	CDemoRecorder m_DemoRecorder;
@@ -186,6 +262,7 @@ public:
 	int IsAuthed(int ClientID);
 	int GetClientInfo(int ClientID, CClientInfo *pInfo);
 	void GetClientAddr(int ClientID, char *pAddrStr, int Size);
+	bool GetClientAddr(int ClientID, NETADDR *pAddr);
 	const char *ClientName(int ClientID);
 	const char *ClientClan(int ClientID);
 	int ClientCountry(int ClientID);
@@ -196,11 +273,16 @@ public:
 	int SendMsgEx(CMsgPacker *pMsg, int Flags, int ClientID, bool System);
 
 	void DoSnapshot();
+	void UpdateSnapRate(int ClientID, int64 Now);
+	void UpdateSnapRange(int ClientID, int SnapshotSize);
 
 	static int NewClientCallback(int ClientID, void *pUser);
 	static int DelClientCallback(int ClientID, const char *pReason, void *pUser);
 
 	void SendMap(int ClientID);
+	int SendMapChunk(int ClientID, int Chunk, int Flags);
+	void SendMapChunks();
+	void FreeMapChunks(bool Force);
 	void SendConnectionReady(int ClientID);
 	void SendRconLine(int ClientID, const char *pLine);
 	static void SendRconLineAuthed(const char *pLine, void *pUser);
@@ -211,16 +293,23 @@ public:
 
 	void ProcessClientPacket(CNetChunk *pPacket);
 
+	void CacheServerInfo();
 	void SendServerInfo(const NETADDR *pAddr, int Token);
+	bool AllowServerInfoRequest(const NETADDR *pAddr);
+	virtual void ExpireServerInfo();
 	void UpdateServerInfo();
 
 	void PumpNetwork();
+	void PrintPerf(bool Full);
 
 	char *GetMapName();
 	int LoadMap(const char *pMapName);
 
 	void InitRegister(CNetServer *pNetServer, IEngineMasterServer *pMasterServer, IConsole *pConsole);
 	int Run();
+	int RunTickReplay();
+	void TickRecorder_HandleAutoStart();
+	void RecordInput(int Type, int ClientID, const int *pInput);
 
 	static void ConKick(IConsole::IResult *pResult, void *pUser);
 	static void ConStatus(IConsole::IResult *pResult, void *pUser);
@@ -228,6 +317,9 @@ public:
 	static void ConRecord(IConsole::IResult *pResult, void *pUser);
 	static void ConStopRecord(IConsole::IResult *pResult, void *pUser);
 	static void ConMapReload(IConsole::IResult *pResult, void *pUser);
+	static void ConfigMapChanged(int Variable, void *pUser);
+	static void ConfigInfoChanged(int Variable, void *pUser);
+	static void ConfigReloadChanged(int Variable, void *pUser);
 	static void ConLogout(IConsole::IResult *pResult, void *pUser);
 	static void ConchainSpecialInfoupdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainMaxclientsperipUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
@@ -235,6 +327,8 @@ public:
 	static void ConchainConsoleOutputLevelUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	//
 	static void ConWhois(IConsole::IResult *pResult, void *pUser);
+	static void ConPerf(IConsole::IResult *pResult, void *pUser);
+	static void ConPerfTrace(IConsole::IResult *pResult, void *pUser);
 
 	void RegisterCommands();
 
@@ -242,6 +336,7 @@ public:
 	virtual int SnapNewID();
 	virtual void SnapFreeID(int ID);
 	virtual void *SnapNewItem(int Type, int ID, int Size);
+	virtual float SnapRange(int ClientID);
 	void SnapSetStaticsize(int ItemType, int Size);
 };
 
@@ -0,0 +1,120 @@
+/* File is created for the TW+ mod
+ */
+
+#include <engine/shared/config.h>
+
+#include "tickrecord.h"
+
+static const char s_aTickRecordMagic[6] = {'T', 'W', 'T', 'I', 'C', 'K'};
+
+// settings that must not end up in a record or must not be replayed
+static bool SkipSetting(const char *pName)
+{
+	return str_find(pName, "password") || str_comp(pName, "sv_tick_record") == 0 ||
+		str_comp(pName, "dbg_tickreplay") == 0 || str_comp(pName, "dbg_tickhash") == 0 || str_comp(pName, "dbg_replay") == 0;
+}
+
+static void EscapeParam(char *pDst, const char *pSrc, int Size)
+{
+	for(int i = 0; *pSrc && i < Size - 2; ++i)
+	{
+		if(*pSrc == '"' || *pSrc == '\\') // escape \ and "
+			*pDst++ = '\\';
+		*pDst++ = *pSrc++;
+	}
+	*pDst = 0;
+}
+
+bool CTickRecorder::Start(IOHANDLE File, const char *pMap, unsigned MapCrc)
+{
+	if(!File || m_File)
+		return false;
+
+	unsigned char aHeader[CTickRecord::HEADER_SIZE];
+	mem_copy(aHeader, s_aTickRecordMagic, sizeof(s_aTickRecordMagic));
+	aHeader[6] = CTickRecord::VERSION;
+	io_write(File, aHeader, sizeof(aHeader));
+	m_File = File;
+
+	unsigned char aMap[128+4];
+	aMap[0] = (MapCrc>>24)&0xff;
+	aMap[1] = (MapCrc>>16)&0xff;
+	aMap[2] = (MapCrc>>8)&0xff;
+	aMap[3] = MapCrc&0xff;
+	str_copy((char *)&aMap[4], pMap, sizeof(aMap)-4);
+	Record(CTickRecord::TYPE_MAP, 0, aMap, 4+str_length(pMap));
+
+	char aLineBuf[1024*2];
+	char aEscapeBuf[1024*2];
+
+	#define MACRO_CONFIG_INT(Name,ScriptName,def,min,max,flags,desc) if(((flags)&CFGFLAG_SERVER) && !SkipSetting(#ScriptName)){ str_format(aLineBuf, sizeof(aLineBuf), "%s %i", #ScriptName, g_Config.m_##Name); Record(CTickRecord::TYPE_CONFIG, 0, aLineBuf, str_length(aLineBuf)); }
+	#define MACRO_CONFIG_STR(Name,ScriptName,len,def,flags,desc) if(((flags)&CFGFLAG_SERVER) && !SkipSetting(#ScriptName)){ EscapeParam(aEscapeBuf, g_Config.m_##Name, sizeof(aEscapeBuf)); str_format(aLineBuf, sizeof(aLineBuf), "%s \"%s\"", #ScriptName, aEscapeBuf); Record(CTickRecord::TYPE_CONFIG, 0, aLineBuf, str_length(aLineBuf)); }
+
+	#include <engine/shared/config_variables.h>
+
+	#undef MACRO_CONFIG_INT
+	#undef MACRO_CONFIG_STR
+
+	return true;
+}
+
+void CTickRecorder::Stop()
+{
+	if(m_File)
+		io_close(m_File);
+	m_File = 0;
+}
+
+void CTickRecorder::Record(int Type, int ClientID, const void *pData, int Size)
+{
+	if(!m_File || Size < 0 || Size > CTickRecord::MAX_DATA_SIZE)
+		return;
+
+	unsigned char aHeader[CTickRecord::RECORD_HEADER_SIZE];
+	aHeader[0] = Type;
+	aHeader[1] = ClientID;
+	aHeader[2] = (Size>>8)&0xff;
+	aHeader[3] = Size&0xff;
+	io_write(m_File, aHeader, sizeof(aHeader));
+	if(Size)
+		io_write(m_File, pData, Size);
+}
+
+bool CTickRecordReader::Open(IOHANDLE File)
+{
+	if(!File)
+		return false;
+
+	unsigned char aHeader[CTickRecord::HEADER_SIZE];
+	if(io_read(File, aHeader, sizeof(aHeader)) != sizeof(aHeader) ||
+		mem_comp(aHeader, s_aTickRecordMagic, sizeof(s_aTickRecordMagic)) != 0 || aHeader[6] != CTickRecord::VERSION)
+	{
+		io_close(File);
+		return false;
+	}
+
+	m_File = File;
+	return true;
+}
+
+void CTickRecordReader::Close()
+{
+	if(m_File)
+		io_close(m_File);
+	m_File = 0;
+}
+
+bool CTickRecordReader::Read(int *pType, int *pClientID, unsigned char *pData, int *pSize)
+{
+	unsigned char aHeader[CTickRecord::RECORD_HEADER_SIZE];
+	if(!m_File || io_read(m_File, aHeader, sizeof(aHeader)) != sizeof(aHeader))
+		return false;
+
+	*pType = aHeader[0];
+	*pClientID = aHeader[1];
+	*pSize = (aHeader[2]<<8) | aHeader[3];
+	if(*pSize > CTickRecord::MAX_DATA_SIZE || io_read(m_File, pData, *pSize) != (unsigned)*pSize)
+		return false;
+	pData[*pSize] = 0;
+	return true;
+}
@@ -0,0 +1,83 @@
+/* File is created for the TW+ mod
+ */
+
+#ifndef ENGINE_SERVER_TICKRECORD_H
+#define ENGINE_SERVER_TICKRECORD_H
+
+#include <base/system.h>
+
+/*
+	Tick record file:
+		header: "TWTICK" magic, 1 byte version
+		records:
+			1 byte type
+			1 byte client id
+			2 bytes size (big endian)
+			size bytes of data
+
+	A record starts with the map and the config, followed by everything the
+	game got from the server in the order it got it. Replaying the records
+	against the same map gives the same world, tick by tick.
+	Input data is kept in host byte order.
+*/
+
+class CTickRecord
+{
+public:
+	enum
+	{
+		TYPE_MAP=0, // 4 bytes crc, map name
+		TYPE_CONFIG, // console line
+		TYPE_TICK_BEGIN, // the tick counter advanced
+		TYPE_TICK_END, // the game ticked
+		TYPE_CONNECT,
+		TYPE_ENTER,
+		TYPE_DROP, // reason
+		TYPE_DIRECT_INPUT, // input data
+		TYPE_PREDICTED_INPUT, // input data
+		TYPE_MESSAGE, // raw game message
+		TYPE_COMMAND, // rcon command
+
+		VERSION=1,
+		HEADER_SIZE=7,
+		RECORD_HEADER_SIZE=4,
+		MAX_DATA_SIZE=2048,
+	};
+};
+
+class CTickRecorder
+{
+	IOHANDLE m_File;
+
+public:
+	CTickRecorder() : m_File(0) {}
+
+	/**
+	 * Starts the record with the map and all server settings, takes
+	 * ownership of the file
+	 */
+	bool Start(IOHANDLE File, const char *pMap, unsigned MapCrc);
+	void Stop();
+	bool IsRecording() const { return m_File != 0; }
+
+	void Record(int Type, int ClientID, const void *pData, int Size);
+};
+
+class CTickRecordReader
+{
+	IOHANDLE m_File;
+
+public:
+	CTickRecordReader() : m_File(0) {}
+
+	bool Open(IOHANDLE File);
+	void Close();
+
+	/**
+	 * Reads the next record into pData, which needs MAX_DATA_SIZE+1 bytes
+	 * as the data gets null terminated. Returns false at the end
+	 */
+	bool Read(int *pType, int *pClientID, unsigned char *pData, int *pSize);
+};
+
+#endif
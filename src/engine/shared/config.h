@@ -14,6 +14,18 @@ struct CConfiguration
 
 extern CConfiguration g_Config;
 
+// ids of the config variables, see IConsole::RegisterConfigCallback
+enum
+{
+	#define MACRO_CONFIG_INT(Name,ScriptName,Def,Min,Max,Save,Desc) CONFIG_##Name,
+	#define MACRO_CONFIG_STR(Name,ScriptName,Len,Def,Save,Desc) CONFIG_##Name,
+	#include "config_variables.h"
+	#undef MACRO_CONFIG_INT
+	#undef MACRO_CONFIG_STR
+
+	NUM_CONFIG_VARIABLES
+};
+
 enum
 {
 	CFGFLAG_SAVE=1,
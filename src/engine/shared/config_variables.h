@@ -18,7 +18,13 @@ MACRO_CONFIG_INT(SvExternalPort, sv_external_port, 0, 0, 0, CFGFLAG_SERVER, "Ext
 MACRO_CONFIG_STR(SvMap, sv_map, 128, "dm1", CFGFLAG_SERVER, "Map to use on the server")
 MACRO_CONFIG_INT(SvMaxClients, sv_max_clients, 8, 1, MAX_CLIENTS, CFGFLAG_SERVER, "Maximum number of clients that are allowed on a server")
 MACRO_CONFIG_INT(SvMaxClientsPerIP, sv_max_clients_per_ip, 4, 1, MAX_CLIENTS, CFGFLAG_SERVER, "Maximum number of clients with the same IP that can connect to the server")
+MACRO_CONFIG_INT(SvVanillaClients, sv_vanilla_clients, 1, 0, 1, CFGFLAG_SERVER, "Accept clients without security token support, they get a slot before proving their address")
+MACRO_CONFIG_INT(SvInfoMaxRequests, sv_info_max_requests, 10, 0, 1000, CFGFLAG_SERVER, "Maximum number of server info requests per second from one address (0 for no limit)")
 MACRO_CONFIG_INT(SvHighBandwidth, sv_high_bandwidth, 0, 0, 1, CFGFLAG_SERVER, "Use high bandwidth mode. Doubles the bandwidth required for the server. LAN use only")
+MACRO_CONFIG_INT(SvSnapAdaptive, sv_snap_adaptive, 1, 0, 1, CFGFLAG_SERVER, "Adapt the snapshot rate and size of every client to its connection")
+MACRO_CONFIG_INT(SvSnapBudget, sv_snap_budget, 0, 0, 1000, CFGFLAG_SERVER, "Snapshot bandwidth per client in KB/s (0 = no limit)")
+MACRO_CONFIG_INT(SvSnapIntervalMax, sv_snap_interval_max, 5, 1, 25, CFGFLAG_SERVER, "Most ticks between two snapshots of a client on a bad connection")
+MACRO_CONFIG_INT(SvSnapLoss, sv_snap_loss, 15, 1, 100, CFGFLAG_SERVER, "Snapshot loss in percent at which a client gets fewer snapshots")
 MACRO_CONFIG_INT(SvRegister, sv_register, 1, 0, 1, CFGFLAG_SERVER, "Register server with master server for public listing")
 MACRO_CONFIG_STR(SvRconPassword, sv_rcon_password, 32, "", CFGFLAG_SERVER, "Remote console password (full access)")
 MACRO_CONFIG_STR(SvRconModPassword, sv_rcon_mod_password, 32, "", CFGFLAG_SERVER, "Remote console password for moderators (limited access)")
@@ -26,6 +32,8 @@ MACRO_CONFIG_INT(SvRconMaxTries, sv_rcon_max_tries, 3, 0, 100, CFGFLAG_SERVER, "
 MACRO_CONFIG_INT(SvRconBantime, sv_rcon_bantime, 5, 0, 1440, CFGFLAG_SERVER, "The time a client gets banned if remote console authentication fails. 0 makes it just use kick")
 MACRO_CONFIG_INT(SvAutoDemoRecord, sv_auto_demo_record, 0, 0, 1, CFGFLAG_SERVER, "Automatically record demos")
 MACRO_CONFIG_INT(SvAutoDemoMax, sv_auto_demo_max, 10, 0, 1000, CFGFLAG_SERVER, "Maximum number of automatically recorded demos (0 = no limit)")
+MACRO_CONFIG_INT(SvTickRecord, sv_tick_record, 0, 0, 1, CFGFLAG_SERVER, "Record the inputs of every map for determinism checks")
+MACRO_CONFIG_INT(SvConfigReload, sv_config_reload, 0, 0, 1, CFGFLAG_SERVER, "Execute the autoexec config again whenever the file is saved")
 
 MACRO_CONFIG_STR(EcBindaddr, ec_bindaddr, 128, "localhost", CFGFLAG_ECON, "Address to bind the external console to. Anything but 'localhost' is dangerous")
 MACRO_CONFIG_INT(EcPort, ec_port, 0, 0, 0, CFGFLAG_ECON, "Port to use for the external console")
@@ -37,8 +45,11 @@ MACRO_CONFIG_INT(EcOutputLevel, ec_output_level, 1, 0, 2, CFGFLAG_ECON, "Adjusts
 MACRO_CONFIG_INT(Debug, debug, 0, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SERVER, "Debug mode")
 MACRO_CONFIG_INT(DbgStress, dbg_stress, 0, 0, 0, CFGFLAG_CLIENT|CFGFLAG_SERVER, "Stress systems")
 MACRO_CONFIG_INT(DbgStressNetwork, dbg_stress_network, 0, 0, 0, CFGFLAG_CLIENT|CFGFLAG_SERVER, "Stress network")
-MACRO_CONFIG_INT(DbgPref, dbg_pref, 0, 0, 1, CFGFLAG_SERVER, "Performance outputs")
+MACRO_CONFIG_INT(DbgPref, dbg_pref, 0, 0, 1, CFGFLAG_SERVER, "Print the tick profiler summary every few seconds")
 MACRO_CONFIG_INT(DbgGraphs, dbg_graphs, 0, 0, 1, CFGFLAG_CLIENT, "Performance graphs")
+MACRO_CONFIG_STR(DbgReplay, dbg_replay, 128, "", CFGFLAG_SERVER, "Packet capture to replay as fast as possible before shutting down")
+MACRO_CONFIG_STR(DbgTickReplay, dbg_tickreplay, 128, "", CFGFLAG_SERVER, "Tick record to replay without network before shutting down")
+MACRO_CONFIG_STR(DbgTickHash, dbg_tickhash, 128, "", CFGFLAG_SERVER, "File to write the world hash of every replayed tick to")
 MACRO_CONFIG_INT(DbgHitch, dbg_hitch, 0, 0, 0, CFGFLAG_SERVER, "Hitch warnings")
 MACRO_CONFIG_STR(DbgStressServer, dbg_stress_server, 32, "localhost", CFGFLAG_CLIENT, "Server to stress")
 MACRO_CONFIG_INT(DbgResizable, dbg_resizable, 0, 0, 0, CFGFLAG_CLIENT, "Enables window resizing")
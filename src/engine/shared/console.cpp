@@ -188,6 +188,24 @@ int CConsole::RegisterPrintCallback(int OutputLevel, FPrintCallback pfnPrintCall
 	return m_NumPrintCB++;
 }
 
+void CConsole::RegisterConfigCallback(int Variable, FConfigCallback pfnFunc, void *pUserData)
+{
+	dbg_assert(m_NumConfigCB < MAX_CONFIG_CB, "too many config callbacks");
+	m_aConfigCB[m_NumConfigCB].m_Variable = Variable;
+	m_aConfigCB[m_NumConfigCB].m_pfnConfigCallback = pfnFunc;
+	m_aConfigCB[m_NumConfigCB].m_pConfigCallbackUserData = pUserData;
+	m_NumConfigCB++;
+}
+
+void CConsole::ConfigChanged(int Variable)
+{
+	for(int i = 0; i < m_NumConfigCB; i++)
+	{
+		if(m_aConfigCB[i].m_Variable == Variable)
+			m_aConfigCB[i].m_pfnConfigCallback(Variable, m_aConfigCB[i].m_pConfigCallbackUserData);
+	}
+}
+
 void CConsole::SetPrintOutputLevel(int Index, int OutputLevel)
 {
 	if(Index >= 0 && Index < MAX_PRINT_CB)
@@ -506,6 +524,7 @@ struct CIntVariableData
 	int *m_pVariable;
 	int m_Min;
 	int m_Max;
+	int m_Variable;
 };
 
 struct CStrVariableData
@@ -513,6 +532,7 @@ struct CStrVariableData
 	IConsole *m_pConsole;
 	char *m_pStr;
 	int m_MaxSize;
+	int m_Variable;
 };
 
 static void IntVariableCommand(IConsole::IResult *pResult, void *pUserData)
@@ -532,7 +552,11 @@ static void IntVariableCommand(IConsole::IResult *pResult, void *pUserData)
 				Val = pData->m_Max;
 		}
 
-		*(pData->m_pVariable) = Val;
+		if(*(pData->m_pVariable) != Val)
+		{
+			*(pData->m_pVariable) = Val;
+			pData->m_pConsole->ConfigChanged(pData->m_Variable);
+		}
 	}
 	else
 	{
@@ -548,6 +572,9 @@ static void StrVariableCommand(IConsole::IResult *pResult, void *pUserData)
 
 	if(pResult->NumArguments())
 	{
+		char aOld[1024];
+		str_copy(aOld, pData->m_pStr, sizeof(aOld));
+
 		const char *pString = pResult->GetString(0);
 		if(!str_utf8_check(pString))
 		{
@@ -568,6 +595,9 @@ static void StrVariableCommand(IConsole::IResult *pResult, void *pUserData)
 		}
 		else
 			str_copy(pData->m_pStr, pString, pData->m_MaxSize);
+
+		if(str_comp(aOld, pData->m_pStr) != 0)
+			pData->m_pConsole->ConfigChanged(pData->m_Variable);
 	}
 	else
 	{
@@ -660,6 +690,7 @@ CConsole::CConsole(int FlagMask)
 	m_pFirstExec = 0;
 	mem_zero(m_aPrintCB, sizeof(m_aPrintCB));
 	m_NumPrintCB = 0;
+	m_NumConfigCB = 0;
 
 	m_pStorage = 0;
 
@@ -676,13 +707,13 @@ CConsole::CConsole(int FlagMask)
 	// TODO: this should disappear
 	#define MACRO_CONFIG_INT(Name,ScriptName,Def,Min,Max,Flags,Desc) \
 	{ \
-		static CIntVariableData Data = { this, &g_Config.m_##Name, Min, Max }; \
+		static CIntVariableData Data = { this, &g_Config.m_##Name, Min, Max, CONFIG_##Name }; \
 		Register(#ScriptName, "?i", Flags, IntVariableCommand, &Data, Desc); \
 	}
 
 	#define MACRO_CONFIG_STR(Name,ScriptName,Len,Def,Flags,Desc) \
 	{ \
-		static CStrVariableData Data = { this, g_Config.m_##Name, Len }; \
+		static CStrVariableData Data = { this, g_Config.m_##Name, Len, CONFIG_##Name }; \
 		Register(#ScriptName, "?r", Flags, StrVariableCommand, &Data, Desc); \
 	}
 
@@ -747,7 +778,7 @@ void CConsole::Register(const char *pName, const char *pParams,
 	bool DoAdd = false;
 	if(pCommand == 0)
 	{
-		pCommand = new(mem_alloc(sizeof(CCommand), sizeof(void*))) CCommand;
+		pCommand = new(mem_alloc_tag(sizeof(CCommand), sizeof(void*), MEMTAG_CONSOLE)) CCommand;
 		DoAdd = true;
 	}
 	pCommand->m_pfnCallback = pfnFunc;
@@ -868,7 +899,7 @@ void CConsole::Chain(const char *pName, FChainCommandCallback pfnChainFunc, void
 		return;
 	}
 
-	CChain *pChainInfo = (CChain *)mem_alloc(sizeof(CChain), sizeof(void*));
+	CChain *pChainInfo = (CChain *)mem_alloc_tag(sizeof(CChain), sizeof(void*), MEMTAG_CONSOLE);
 
 	// store info
 	pChainInfo->m_pfnChainCallback = pfnChainFunc;
@@ -70,6 +70,19 @@ class CConsole : public IConsole
 	} m_aPrintCB[MAX_PRINT_CB];
 	int m_NumPrintCB;
 
+	enum
+	{
+		MAX_CONFIG_CB = 32,
+	};
+
+	struct
+	{
+		int m_Variable;
+		FConfigCallback m_pfnConfigCallback;
+		void *m_pConfigCallbackUserData;
+	} m_aConfigCB[MAX_CONFIG_CB];
+	int m_NumConfigCB;
+
 	enum
 	{
 		CONSOLE_MAX_STR_LENGTH = 1024,
@@ -169,6 +182,9 @@ public:
 	virtual void Chain(const char *pName, FChainCommandCallback pfnChainFunc, void *pUser);
 	virtual void StoreCommands(bool Store);
 
+	virtual void RegisterConfigCallback(int Variable, FConfigCallback pfnFunc, void *pUserData);
+	virtual void ConfigChanged(int Variable);
+
 	virtual bool LineIsValid(const char *pStr);
 	virtual void ExecuteLine(const char *pStr);
 	virtual void ExecuteLineFlag(const char *pStr, int FlagMask);
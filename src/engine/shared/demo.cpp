@@ -654,7 +654,7 @@ int CDemoPlayer::Load(class IStorage *pStorage, class IConsole *pConsole, const
 	else if(MapSize > 0)
 	{
 		// get map data
-		unsigned char *pMapData = (unsigned char *)mem_alloc(MapSize, 1);
+		unsigned char *pMapData = (unsigned char *)mem_alloc_tag(MapSize, 1, MEMTAG_MAP);
 		io_read(m_File, pMapData, MapSize);
 
 		// save map
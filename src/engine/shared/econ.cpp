@@ -9,17 +9,17 @@ int CEcon::NewClientCallback(int ClientID, void *pUser)
 {
 	CEcon *pThis = (CEcon *)pUser;
 
-	char aAddrStr[NETADDR_MAXSTRSIZE];
-	net_addr_str(pThis->m_NetConsole.ClientAddr(ClientID), aAddrStr, sizeof(aAddrStr), true);
-	char aBuf[128];
-	str_format(aBuf, sizeof(aBuf), "client accepted. cid=%d addr=%s'", ClientID, aAddrStr);
-	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "econ", aBuf);
-
-	pThis->m_aClients[ClientID].m_State = CClient::STATE_CONNECTED;
-	pThis->m_aClients[ClientID].m_TimeConnected = time_get();
-	pThis->m_aClients[ClientID].m_AuthTries = 0;
+	// runs on the net thread
+	CEvent Event;
+	Event.m_Type = CEvent::TYPE_NEW;
+	Event.m_ClientID = ClientID;
+	Event.m_Generation = pThis->m_NetConsole.ClientGeneration(ClientID);
+	Event.m_Addr = *pThis->m_NetConsole.ClientAddr(ClientID);
+	Event.m_aLine[0] = 0;
 
-	pThis->m_NetConsole.Send(ClientID, "Enter password:");
+	// the game would never know about the client, so no timeout would drop it
+	if(!pThis->m_Events.push(Event))
+		pThis->m_NetConsole.Drop(ClientID, "server busy");
 	return 0;
 }
 
@@ -27,16 +27,56 @@ int CEcon::DelClientCallback(int ClientID, const char *pReason, void *pUser)
 {
 	CEcon *pThis = (CEcon *)pUser;
 
-	char aAddrStr[NETADDR_MAXSTRSIZE];
-	net_addr_str(pThis->m_NetConsole.ClientAddr(ClientID), aAddrStr, sizeof(aAddrStr), true);
-	char aBuf[256];
-	str_format(aBuf, sizeof(aBuf), "client dropped. cid=%d addr=%s reason='%s'", ClientID, aAddrStr, pReason);
-	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "econ", aBuf);
-
-	pThis->m_aClients[ClientID].m_State = CClient::STATE_EMPTY;
+	// runs on the net thread
+	CEvent Event;
+	Event.m_Type = CEvent::TYPE_DEL;
+	Event.m_ClientID = ClientID;
+	Event.m_Generation = pThis->m_NetConsole.ClientGeneration(ClientID);
+	Event.m_Addr = *pThis->m_NetConsole.ClientAddr(ClientID);
+	str_copy(Event.m_aLine, pReason, sizeof(Event.m_aLine));
+	if(!pThis->m_Events.push(Event))
+	{
+		pThis->m_aPendingDels[ClientID] = Event;
+		pThis->m_aDelPending[ClientID] = true;
+	}
 	return 0;
 }
 
+void CEcon::NetThread(void *pUser)
+{
+	CEcon *pThis = (CEcon *)pUser;
+	CEvent Event;
+	Event.m_Type = CEvent::TYPE_LINE;
+
+	while(!pThis->m_Stop)
+	{
+		pThis->m_NetConsole.Wait(5);
+
+		for(int i = 0; i < NET_MAX_CONSOLE_CLIENTS; i++)
+		{
+			if(pThis->m_aDelPending[i] && pThis->m_Events.push(pThis->m_aPendingDels[i]))
+				pThis->m_aDelPending[i] = false;
+		}
+
+		CDrop Drop;
+		while(pThis->m_Drops.pop(&Drop))
+		{
+			if(pThis->m_NetConsole.ClientGeneration(Drop.m_ClientID) == Drop.m_Generation)
+				pThis->m_NetConsole.Drop(Drop.m_ClientID, Drop.m_aReason);
+		}
+
+		pThis->m_NetConsole.Update();
+
+		// lines wait in the connection while the game is behind
+		while(pThis->m_Events.size() < MAX_EVENTS-RESERVED_EVENTS &&
+			pThis->m_NetConsole.Recv(Event.m_aLine, (int)(sizeof(Event.m_aLine))-1, &Event.m_ClientID))
+		{
+			Event.m_Generation = pThis->m_NetConsole.ClientGeneration(Event.m_ClientID);
+			pThis->m_Events.push(Event);
+		}
+	}
+}
+
 void CEcon::SendLineCB(const char *pLine, void *pUserData)
 {
 	static_cast<CEcon *>(pUserData)->Send(-1, pLine);
@@ -57,7 +97,7 @@ void CEcon::ConLogout(IConsole::IResult *pResult, void *pUserData)
 	CEcon *pThis = static_cast<CEcon *>(pUserData);
 
 	if(pThis->m_UserClientID >= 0 && pThis->m_UserClientID < NET_MAX_CONSOLE_CLIENTS && pThis->m_aClients[pThis->m_UserClientID].m_State != CClient::STATE_EMPTY)
-		pThis->m_NetConsole.Drop(pThis->m_UserClientID, "Logout");
+		pThis->RequestDrop(pThis->m_UserClientID, "Logout");
 }
 
 void CEcon::Init(IConsole *pConsole, CNetBan *pNetBan)
@@ -65,10 +105,17 @@ void CEcon::Init(IConsole *pConsole, CNetBan *pNetBan)
 	m_pConsole = pConsole;
 
 	for(int i = 0; i < NET_MAX_CONSOLE_CLIENTS; i++)
+	{
 		m_aClients[i].m_State = CClient::STATE_EMPTY;
+		m_aClients[i].m_Generation = 0;
+		m_aDelPending[i] = false;
+		m_aDropPending[i] = false;
+	}
 
 	m_Ready = false;
 	m_UserClientID = -1;
+	m_pThread = 0;
+	m_Stop = false;
 
 	if(g_Config.m_EcPort == 0 || g_Config.m_EcPassword[0] == 0)
 		return;
@@ -99,65 +146,147 @@ void CEcon::Init(IConsole *pConsole, CNetBan *pNetBan)
 		m_PrintCBIndex = Console()->RegisterPrintCallback(g_Config.m_EcOutputLevel, SendLineCB, this);
 
 		Console()->Register("logout", "", CFGFLAG_ECON, ConLogout, this, "Logout of econ");
+
+		m_pThread = teethread_create(NetThread, this);
 	}
 	else
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD,"econ", "couldn't open socket. port might already be in use");
 }
 
-void CEcon::Update()
+void CEcon::RequestDrop(int ClientID, const char *pReason)
 {
-	if(!m_Ready)
+	CDrop Drop;
+	Drop.m_ClientID = ClientID;
+	Drop.m_Generation = m_aClients[ClientID].m_Generation;
+	str_copy(Drop.m_aReason, pReason, sizeof(Drop.m_aReason));
+	if(!m_Drops.push(Drop))
+	{
+		// Update tries again, the client would stay online otherwise
+		m_aPendingDrops[ClientID] = Drop;
+		m_aDropPending[ClientID] = true;
+	}
+
+	// gone for the game already, the net thread reports back when it dropped the client
+	m_aClients[ClientID].m_State = CClient::STATE_EMPTY;
+}
+
+void CEcon::OnNewClient(const CEvent *pEvent)
+{
+	CClient *pClient = &m_aClients[pEvent->m_ClientID];
+	pClient->m_Generation = pEvent->m_Generation;
+	pClient->m_Addr = pEvent->m_Addr;
+
+	// check if we just should drop the client
+	char aBuf[128];
+	if(m_NetConsole.NetBan() && m_NetConsole.NetBan()->IsBanned(&pEvent->m_Addr, aBuf, sizeof(aBuf)))
+	{
+		RequestDrop(pEvent->m_ClientID, aBuf);
 		return;
+	}
+
+	char aAddrStr[NETADDR_MAXSTRSIZE];
+	net_addr_str(&pEvent->m_Addr, aAddrStr, sizeof(aAddrStr), true);
+	str_format(aBuf, sizeof(aBuf), "client accepted. cid=%d addr=%s'", pEvent->m_ClientID, aAddrStr);
+	Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "econ", aBuf);
+
+	pClient->m_State = CClient::STATE_CONNECTED;
+	pClient->m_TimeConnected = time_get();
+	pClient->m_AuthTries = 0;
+
+	m_NetConsole.Send(pEvent->m_ClientID, pClient->m_Generation, "Enter password:");
+}
+
+void CEcon::OnDelClient(const CEvent *pEvent)
+{
+	CClient *pClient = &m_aClients[pEvent->m_ClientID];
+	if(pClient->m_Generation != pEvent->m_Generation)
+	{
+		// the game missed the client, the one it knows about is gone for sure
+		if((int)(pEvent->m_Generation - pClient->m_Generation) > 0)
+			pClient->m_State = CClient::STATE_EMPTY;
+		return;
+	}
 
-	m_NetConsole.Update();
+	char aAddrStr[NETADDR_MAXSTRSIZE];
+	net_addr_str(&pEvent->m_Addr, aAddrStr, sizeof(aAddrStr), true);
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "client dropped. cid=%d addr=%s reason='%s'", pEvent->m_ClientID, aAddrStr, pEvent->m_aLine);
+	Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "econ", aBuf);
+
+	pClient->m_State = CClient::STATE_EMPTY;
+}
 
-	char aBuf[NET_MAX_PACKETSIZE];
-	int ClientID;
+void CEcon::OnLine(const CEvent *pEvent)
+{
+	int ClientID = pEvent->m_ClientID;
+	CClient *pClient = &m_aClients[ClientID];
+	if(pClient->m_Generation != pEvent->m_Generation)
+		return;
 
-	while(m_NetConsole.Recv(aBuf, (int)(sizeof(aBuf))-1, &ClientID))
+	if(pClient->m_State == CClient::STATE_CONNECTED)
 	{
-		dbg_assert(m_aClients[ClientID].m_State != CClient::STATE_EMPTY, "got message from empty slot");
-		if(m_aClients[ClientID].m_State == CClient::STATE_CONNECTED)
+		if(str_comp(pEvent->m_aLine, g_Config.m_EcPassword) == 0)
 		{
-			if(str_comp(aBuf, g_Config.m_EcPassword) == 0)
-			{
-				m_aClients[ClientID].m_State = CClient::STATE_AUTHED;
-				m_NetConsole.Send(ClientID, "Authentication successful. External console access granted.");
+			pClient->m_State = CClient::STATE_AUTHED;
+			m_NetConsole.Send(ClientID, pClient->m_Generation, "Authentication successful. External console access granted.");
 
-				str_format(aBuf, sizeof(aBuf), "cid=%d authed", ClientID);
-				Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "econ", aBuf);
-			}
-			else
-			{
-				m_aClients[ClientID].m_AuthTries++;
-				char aMsg[128];
-				str_format(aMsg, sizeof(aMsg), "Wrong password %d/%d.", m_aClients[ClientID].m_AuthTries, MAX_AUTH_TRIES);
-				m_NetConsole.Send(ClientID, aMsg);
-				if(m_aClients[ClientID].m_AuthTries >= MAX_AUTH_TRIES)
-				{
-					if(!g_Config.m_EcBantime)
-						m_NetConsole.Drop(ClientID, "Too many authentication tries");
-					else
-						m_NetConsole.NetBan()->BanAddr(m_NetConsole.ClientAddr(ClientID), g_Config.m_EcBantime*60, "Too many authentication tries");
-				}
-			}
+			char aBuf[128];
+			str_format(aBuf, sizeof(aBuf), "cid=%d authed", ClientID);
+			Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "econ", aBuf);
 		}
-		else if(m_aClients[ClientID].m_State == CClient::STATE_AUTHED)
+		else
 		{
-			char aFormatted[256];
-			str_format(aFormatted, sizeof(aFormatted), "cid=%d cmd='%s'", ClientID, aBuf);
-			Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", aFormatted);
-			m_UserClientID = ClientID;
-			Console()->ExecuteLine(aBuf);
-			m_UserClientID = -1;
+			pClient->m_AuthTries++;
+			char aMsg[128];
+			str_format(aMsg, sizeof(aMsg), "Wrong password %d/%d.", pClient->m_AuthTries, MAX_AUTH_TRIES);
+			m_NetConsole.Send(ClientID, pClient->m_Generation, aMsg);
+			if(pClient->m_AuthTries >= MAX_AUTH_TRIES)
+			{
+				if(!g_Config.m_EcBantime)
+					RequestDrop(ClientID, "Too many authentication tries");
+				else
+					m_NetConsole.NetBan()->BanAddr(&pClient->m_Addr, g_Config.m_EcBantime*60, "Too many authentication tries");
+			}
 		}
 	}
+	else if(pClient->m_State == CClient::STATE_AUTHED)
+	{
+		char aFormatted[256];
+		str_format(aFormatted, sizeof(aFormatted), "cid=%d cmd='%s'", ClientID, pEvent->m_aLine);
+		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", aFormatted);
+		m_UserClientID = ClientID;
+		Console()->ExecuteLine(pEvent->m_aLine);
+		m_UserClientID = -1;
+	}
+}
+
+void CEcon::Update()
+{
+	if(!m_Ready)
+		return;
+
+	for(int i = 0; i < NET_MAX_CONSOLE_CLIENTS; i++)
+	{
+		if(m_aDropPending[i] && m_Drops.push(m_aPendingDrops[i]))
+			m_aDropPending[i] = false;
+	}
+
+	CEvent Event;
+	while(m_Events.pop(&Event))
+	{
+		if(Event.m_Type == CEvent::TYPE_NEW)
+			OnNewClient(&Event);
+		else if(Event.m_Type == CEvent::TYPE_DEL)
+			OnDelClient(&Event);
+		else
+			OnLine(&Event);
+	}
 
 	for(int i = 0; i < NET_MAX_CONSOLE_CLIENTS; ++i)
 	{
 		if(m_aClients[i].m_State == CClient::STATE_CONNECTED &&
 			time_get() > m_aClients[i].m_TimeConnected + g_Config.m_EcAuthTimeout * time_freq())
-			m_NetConsole.Drop(i, "authentication timeout");
+			RequestDrop(i, "authentication timeout");
 	}
 }
 
@@ -171,11 +300,11 @@ void CEcon::Send(int ClientID, const char *pLine)
 		for(int i = 0; i < NET_MAX_CONSOLE_CLIENTS; i++)
 		{
 			if(m_aClients[i].m_State == CClient::STATE_AUTHED)
-				m_NetConsole.Send(i, pLine);
+				m_NetConsole.Send(i, m_aClients[i].m_Generation, pLine);
 		}
 	}
 	else if(ClientID >= 0 && ClientID < NET_MAX_CONSOLE_CLIENTS && m_aClients[ClientID].m_State == CClient::STATE_AUTHED)
-		m_NetConsole.Send(ClientID, pLine);
+		m_NetConsole.Send(ClientID, m_aClients[ClientID].m_Generation, pLine);
 }
 
 void CEcon::Shutdown()
@@ -183,5 +312,11 @@ void CEcon::Shutdown()
 	if(!m_Ready)
 		return;
 
+	m_Stop = true;
+	thread_wait(m_pThread);
+	m_pThread = 0;
+
+	// hand out what is left of the output before closing
 	m_NetConsole.Close();
+	m_Ready = false;
 }
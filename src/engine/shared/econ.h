@@ -1,14 +1,31 @@
 #ifndef ENGINE_SHARED_ECON_H
 #define ENGINE_SHARED_ECON_H
 
+#include <base/tl/spsc_queue.h>
+
 #include "network.h"
 
 
+/*
+	The econ sockets are served by an own thread, so a slow or stuck
+	console client never holds up the game. The thread passes new and
+	dropped clients and their lines on to Update, which handles them on
+	the game thread. Output goes straight into the per client buffers of
+	the console network, drops go back to the thread.
+
+	Nothing gets lost while the queues are full: a new client the game
+	can't hear about is dropped right away, dropped clients and drop
+	requests are kept per slot and passed on again later.
+*/
 class CEcon
 {
 	enum
 	{
 		MAX_AUTH_TRIES=3,
+
+		MAX_EVENTS=64,
+		// room kept for new and dropped clients while lines wait
+		RESERVED_EVENTS=2*NET_MAX_CONSOLE_CLIENTS+1,
 	};
 
 	class CClient
@@ -24,9 +41,34 @@ class CEcon
 		int m_State;
 		int64 m_TimeConnected;
 		int m_AuthTries;
+		unsigned m_Generation;
+		NETADDR m_Addr;
 	};
 	CClient m_aClients[NET_MAX_CONSOLE_CLIENTS];
 
+	struct CEvent
+	{
+		enum
+		{
+			TYPE_NEW=0,
+			TYPE_DEL,
+			TYPE_LINE,
+		};
+
+		int m_Type;
+		int m_ClientID;
+		unsigned m_Generation;
+		NETADDR m_Addr;
+		char m_aLine[NET_MAX_PACKETSIZE]; // line or drop reason
+	};
+
+	struct CDrop
+	{
+		int m_ClientID;
+		unsigned m_Generation;
+		char m_aReason[128];
+	};
+
 	IConsole *m_pConsole;
 	CNetConsole m_NetConsole;
 
@@ -34,12 +76,30 @@ class CEcon
 	int m_PrintCBIndex;
 	int m_UserClientID;
 
+	void *m_pThread;
+	volatile bool m_Stop;
+	spsc_queue<CEvent, MAX_EVENTS> m_Events;
+	spsc_queue<CDrop, 32> m_Drops;
+
+	// waiting for room in the queues, per slot. Only the newest connection
+	// of a slot can be online, so a newer one replaces what is waiting
+	CEvent m_aPendingDels[NET_MAX_CONSOLE_CLIENTS]; // net thread
+	bool m_aDelPending[NET_MAX_CONSOLE_CLIENTS];
+	CDrop m_aPendingDrops[NET_MAX_CONSOLE_CLIENTS]; // game thread
+	bool m_aDropPending[NET_MAX_CONSOLE_CLIENTS];
+
 	static void SendLineCB(const char *pLine, void *pUserData);
 	static void ConchainEconOutputLevelUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConLogout(IConsole::IResult *pResult, void *pUserData);
 
 	static int NewClientCallback(int ClientID, void *pUser);
 	static int DelClientCallback(int ClientID, const char *pReason, void *pUser);
+	static void NetThread(void *pUser);
+
+	void OnNewClient(const CEvent *pEvent);
+	void OnDelClient(const CEvent *pEvent);
+	void OnLine(const CEvent *pEvent);
+	void RequestDrop(int ClientID, const char *pReason);
 
 public:
 	IConsole *Console() { return m_pConsole; }
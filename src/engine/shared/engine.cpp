@@ -33,6 +33,23 @@ public:
 		mem_debug_dump(pEngine->m_pStorage->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE));
 	}
 
+	static void Con_DbgMemstats(IConsole::IResult *pResult, void *pUserData)
+	{
+		CEngine *pEngine = static_cast<CEngine *>(pUserData);
+		char aBuf[128];
+		for(int i = 0; i < NUM_MEMTAGS; i++)
+		{
+			const MEMSTATS *pStats = mem_stats_tag(i);
+			str_format(aBuf, sizeof(aBuf), "%s: %dk in %d blocks, %d allocations", mem_tag_name(i),
+				pStats->allocated/1024, pStats->active_allocations, pStats->total_allocations);
+			pEngine->m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "memory", aBuf);
+		}
+		const MEMSTATS *pStats = mem_stats();
+		str_format(aBuf, sizeof(aBuf), "total: %dk in %d blocks, %d allocations",
+			pStats->allocated/1024, pStats->active_allocations, pStats->total_allocations);
+		pEngine->m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "memory", aBuf);
+	}
+
 	static void Con_DbgLognetwork(IConsole::IResult *pResult, void *pUserData)
 	{
 		CEngine *pEngine = static_cast<CEngine *>(pUserData);
@@ -46,11 +63,9 @@ public:
 		{
 			char aBuf[32];
 			str_timestamp(aBuf, sizeof(aBuf));
-			char aFilenameSent[128], aFilenameRecv[128];
-			str_format(aFilenameSent, sizeof(aFilenameSent), "dumps/network_sent_%s.txt", aBuf);
-			str_format(aFilenameRecv, sizeof(aFilenameRecv), "dumps/network_recv_%s.txt", aBuf);
-			CNetBase::OpenLog(pEngine->m_pStorage->OpenFile(aFilenameSent, IOFLAG_WRITE, IStorage::TYPE_SAVE),
-								pEngine->m_pStorage->OpenFile(aFilenameRecv, IOFLAG_WRITE, IStorage::TYPE_SAVE));
+			char aFilename[128];
+			str_format(aFilename, sizeof(aFilename), "dumps/network_%s.twcap", aBuf);
+			CNetBase::OpenLog(pEngine->m_pStorage->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE));
 			pEngine->m_Logging = true;
 		}
 	}
@@ -88,6 +103,7 @@ public:
 			return;
 
 		m_pConsole->Register("dbg_dumpmem", "", CFGFLAG_SERVER|CFGFLAG_CLIENT, Con_DbgDumpmem, this, "Dump the memory");
+		m_pConsole->Register("dbg_memstats", "", CFGFLAG_SERVER|CFGFLAG_CLIENT, Con_DbgMemstats, this, "Print the memory usage of the subsystems");
 		m_pConsole->Register("dbg_lognetwork", "", CFGFLAG_SERVER|CFGFLAG_CLIENT, Con_DbgLognetwork, this, "Log the network");
 	}
 
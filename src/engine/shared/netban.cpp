@@ -3,6 +3,7 @@
 #include <engine/console.h>
 #include <engine/storage.h>
 #include <engine/shared/config.h>
+#include <engine/shared/linereader.h>
 
 #include "netban.h"
 
@@ -19,101 +20,301 @@ bool CNetBan::StrAllnum(const char *pStr)
 }
 
 
-CNetBan::CNetHash::CNetHash(const NETADDR *pAddr)
+// bit of the key, counted from the most significant one
+static inline int KeyBit(const unsigned char *pKey, int Index)
 {
-	if(pAddr->type==NETTYPE_IPV4)
-		m_Hash = (pAddr->ip[0]+pAddr->ip[1]+pAddr->ip[2]+pAddr->ip[3])&0xFF;
-	else
-		m_Hash = (pAddr->ip[0]+pAddr->ip[1]+pAddr->ip[2]+pAddr->ip[3]+pAddr->ip[4]+pAddr->ip[5]+pAddr->ip[6]+pAddr->ip[7]+
-			pAddr->ip[8]+pAddr->ip[9]+pAddr->ip[10]+pAddr->ip[11]+pAddr->ip[12]+pAddr->ip[13]+pAddr->ip[14]+pAddr->ip[15])&0xFF;
-	m_HashIndex = 0;
+	return (pKey[Index>>3]>>(7-(Index&7)))&1;
+}
+
+static bool KeyMatch(const unsigned char *pPrefix, int Length, const unsigned char *pKey)
+{
+	int Bytes = Length>>3;
+	if(Bytes && mem_comp(pPrefix, pKey, Bytes) != 0)
+		return false;
+	return !(Length&7) || !((pPrefix[Bytes]^pKey[Bytes])&(0xff<<(8-(Length&7))));
 }
 
-CNetBan::CNetHash::CNetHash(const CNetRange *pRange)
+// number of leading bits the keys have in common
+static int CommonBits(const unsigned char *pKey1, const unsigned char *pKey2, int MaxLength)
 {
-	m_Hash = 0;
-	m_HashIndex = 0;
-	for(int i = 0; pRange->m_LB.ip[i] == pRange->m_UB.ip[i]; ++i)
+	int Length = 0;
+	for(int i = 0; Length < MaxLength; i++, Length += 8)
 	{
-		m_Hash += pRange->m_LB.ip[i];
-		++m_HashIndex;
+		unsigned Diff = pKey1[i]^pKey2[i];
+		if(Diff)
+		{
+			for(; !(Diff&0x80); Diff <<= 1)
+				Length++;
+			break;
+		}
 	}
-	m_Hash &= 0xFF;
+	return min(Length, MaxLength);
 }
 
-int CNetBan::CNetHash::MakeHashArray(const NETADDR *pAddr, CNetHash aHash[17])
+int CNetBan::MakePrefixes(const NETADDR *pAddr, CPrefix *pPrefixes)
 {
-	int Length = pAddr->type==NETTYPE_IPV4 ? 4 : 16;
-	aHash[0].m_Hash = 0;
-	aHash[0].m_HashIndex = 0;
-	for(int i = 1, Sum = 0; i <= Length; ++i)
+	mem_zero(pPrefixes, sizeof(CPrefix));
+	pPrefixes->m_IPv6 = pAddr->type != NETTYPE_IPV4;
+	pPrefixes->m_Length = pPrefixes->m_IPv6 ? 128 : 32;
+	mem_copy(pPrefixes->m_aKey, pAddr->ip, pPrefixes->m_Length/8);
+	return 1;
+}
+
+int CNetBan::MakePrefixes(const CNetRange *pRange, CPrefix *pPrefixes)
+{
+	bool IPv6 = pRange->m_LB.type != NETTYPE_IPV4;
+	int Bytes = IPv6 ? 16 : 4;
+	unsigned char aCur[16], aLast[16];
+	mem_copy(aCur, pRange->m_LB.ip, Bytes);
+
+	// cover the range with the largest aligned blocks, from the lower bound up
+	int Num = 0;
+	while(Num < CPrefix::MAX_PREFIXES)
 	{
-		Sum += pAddr->ip[i-1];
-		aHash[i].m_Hash = Sum&0xFF;
-		aHash[i].m_HashIndex = i%Length;
+		int Size = 0;
+		while(Size < Bytes*8 && !((aCur[Bytes-1-Size/8]>>(Size%8))&1))
+			Size++;
+
+		for(;; Size--)
+		{
+			mem_copy(aLast, aCur, Bytes);
+			for(int i = 0; i < Size/8; i++)
+				aLast[Bytes-1-i] = 0xff;
+			if(Size%8)
+				aLast[Bytes-1-Size/8] |= (1<<(Size%8))-1;
+			if(Size == 0 || mem_comp(aLast, pRange->m_UB.ip, Bytes) <= 0)
+				break;
+		}
+
+		CPrefix *pPrefix = &pPrefixes[Num++];
+		mem_zero(pPrefix, sizeof(CPrefix));
+		mem_copy(pPrefix->m_aKey, aCur, Bytes);
+		pPrefix->m_Length = Bytes*8-Size;
+		pPrefix->m_IPv6 = IPv6;
+
+		if(mem_comp(aLast, pRange->m_UB.ip, Bytes) >= 0)
+			break;
+
+		// next block starts right after this one
+		mem_copy(aCur, aLast, Bytes);
+		for(int i = Bytes-1; i >= 0 && ++aCur[i] == 0; i--);
 	}
-	return Length;
+	return Num;
 }
 
 
-template<class T, int HashCount>
-typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Add(const T *pData, const CBanInfo *pInfo,  const CNetHash *pNetHash)
+template<class T>
+typename CNetBan::CBanTrie<T>::CNode **CNetBan::CBanTrie<T>::Root(const CPrefix *pPrefix)
 {
-	if(!m_pFirstFree)
-		return 0;
+	if(pPrefix->m_IPv6 || pPrefix->m_Length < TABLE_BITS)
+		return &m_apRoots[pPrefix->m_IPv6];
 
-	// create new ban
-	CBan<T> *pBan = m_pFirstFree;
-	pBan->m_Data = *pData;
-	pBan->m_Info = *pInfo;
-	pBan->m_NetHash = *pNetHash;
-	if(pBan->m_pNext)
-		pBan->m_pNext->m_pPrev = pBan->m_pPrev;
-	if(pBan->m_pPrev)
-		pBan->m_pPrev->m_pNext = pBan->m_pNext;
-	else
-		m_pFirstFree = pBan->m_pNext;
+	if(!m_ppTable)
+	{
+		m_ppTable = new CNode*[1<<TABLE_BITS];
+		mem_zero(m_ppTable, sizeof(CNode*)*(1<<TABLE_BITS));
+	}
+	return &m_ppTable[(pPrefix->m_aKey[0]<<8)|pPrefix->m_aKey[1]];
+}
+
+template<class T>
+typename CNetBan::CBanTrie<T>::CNode *CNetBan::CBanTrie<T>::NewNode(const CPrefix *pPrefix, int Length)
+{
+	CNode *pNode = new CNode;
+	mem_zero(pNode, sizeof(CNode));
+	mem_copy(pNode->m_Prefix.m_aKey, pPrefix->m_aKey, (Length+7)/8);
+	if(Length&7)
+		pNode->m_Prefix.m_aKey[Length>>3] &= 0xff<<(8-(Length&7));
+	pNode->m_Prefix.m_Length = Length;
+	pNode->m_Prefix.m_IPv6 = pPrefix->m_IPv6;
+	return pNode;
+}
 
-	// add it to the hash list
-	if(m_paaHashList[pNetHash->m_HashIndex][pNetHash->m_Hash])
-		m_paaHashList[pNetHash->m_HashIndex][pNetHash->m_Hash]->m_pHashPrev = pBan;
-	pBan->m_pHashPrev = 0;
-	pBan->m_pHashNext = m_paaHashList[pNetHash->m_HashIndex][pNetHash->m_Hash];
-	m_paaHashList[pNetHash->m_HashIndex][pNetHash->m_Hash] = pBan;
+template<class T>
+void CNetBan::CBanTrie<T>::DeleteNode(CNode *pNode)
+{
+	if(!pNode)
+		return;
 
-	// insert it into the used list
-	if(m_pFirstUsed)
+	while(pNode->m_pEntries)
 	{
-		for(CBan<T> *p = m_pFirstUsed; ; p = p->m_pNext)
+		CEntry *pEntry = pNode->m_pEntries;
+		pNode->m_pEntries = pEntry->m_pNext;
+		delete pEntry;
+	}
+	DeleteNode(pNode->m_apChildren[0]);
+	DeleteNode(pNode->m_apChildren[1]);
+	delete pNode;
+}
+
+template<class T>
+void CNetBan::CBanTrie<T>::Insert(const CPrefix *pPrefix, CBan<T> *pBan)
+{
+	CNode **ppNode = Root(pPrefix);
+	CNode *pTarget = 0;
+	while(!pTarget)
+	{
+		CNode *pNode = *ppNode;
+		if(!pNode)
 		{
-			if(p->m_Info.m_Expires == CBanInfo::EXPIRES_NEVER || (pInfo->m_Expires != CBanInfo::EXPIRES_NEVER && pInfo->m_Expires <= p->m_Info.m_Expires))
-			{
-				// insert before
-				pBan->m_pNext = p;
-				pBan->m_pPrev = p->m_pPrev;
-				if(p->m_pPrev)
-					p->m_pPrev->m_pNext = pBan;
-				else
-					m_pFirstUsed = pBan;
-				p->m_pPrev = pBan;
-				break;
-			}
+			pTarget = *ppNode = NewNode(pPrefix, pPrefix->m_Length);
+			break;
+		}
+
+		int Common = CommonBits(pNode->m_Prefix.m_aKey, pPrefix->m_aKey, min(pNode->m_Prefix.m_Length, pPrefix->m_Length));
+		if(Common < pNode->m_Prefix.m_Length)
+		{
+			// the prefix leaves the path of the node, split it
+			CNode *pSplit = NewNode(pPrefix, Common);
+			pSplit->m_apChildren[KeyBit(pNode->m_Prefix.m_aKey, Common)] = pNode;
+			*ppNode = pSplit;
+			if(Common == pPrefix->m_Length)
+				pTarget = pSplit;
+			else
+				pTarget = pSplit->m_apChildren[KeyBit(pPrefix->m_aKey, Common)] = NewNode(pPrefix, pPrefix->m_Length);
+		}
+		else if(pNode->m_Prefix.m_Length == pPrefix->m_Length)
+			pTarget = pNode;
+		else
+			ppNode = &pNode->m_apChildren[KeyBit(pPrefix->m_aKey, pNode->m_Prefix.m_Length)];
+	}
+
+	CEntry *pEntry = new CEntry;
+	pEntry->m_pBan = pBan;
+	pEntry->m_pNext = pTarget->m_pEntries;
+	pTarget->m_pEntries = pEntry;
+}
 
-			if(!p->m_pNext)
+template<class T>
+void CNetBan::CBanTrie<T>::RemoveEntry(CNode **ppNode, const CPrefix *pPrefix, const CBan<T> *pBan)
+{
+	CNode *pNode = *ppNode;
+	if(!pNode || pNode->m_Prefix.m_Length > pPrefix->m_Length || !KeyMatch(pNode->m_Prefix.m_aKey, pNode->m_Prefix.m_Length, pPrefix->m_aKey))
+		return;
+
+	if(pNode->m_Prefix.m_Length < pPrefix->m_Length)
+		RemoveEntry(&pNode->m_apChildren[KeyBit(pPrefix->m_aKey, pNode->m_Prefix.m_Length)], pPrefix, pBan);
+	else
+	{
+		for(CEntry **ppEntry = &pNode->m_pEntries; *ppEntry; ppEntry = &(*ppEntry)->m_pNext)
+		{
+			if((*ppEntry)->m_pBan == pBan)
 			{
-				// last entry
-				p->m_pNext = pBan;
-				pBan->m_pPrev = p;
-				pBan->m_pNext = 0;
+				CEntry *pEntry = *ppEntry;
+				*ppEntry = pEntry->m_pNext;
+				delete pEntry;
 				break;
 			}
 		}
 	}
+
+	// nodes without bans are only needed where the trie branches
+	if(!pNode->m_pEntries && !(pNode->m_apChildren[0] && pNode->m_apChildren[1]))
+	{
+		*ppNode = pNode->m_apChildren[0] ? pNode->m_apChildren[0] : pNode->m_apChildren[1];
+		delete pNode;
+	}
+}
+
+template<class T>
+void CNetBan::CBanTrie<T>::Remove(const CPrefix *pPrefix, const CBan<T> *pBan)
+{
+	RemoveEntry(Root(pPrefix), pPrefix, pBan);
+}
+
+template<class T>
+typename CNetBan::CBan<T> *CNetBan::CBanTrie<T>::Find(const CPrefix *pPrefix, const T *pData) const
+{
+	const CNode *pNode;
+	if(pPrefix->m_IPv6 || pPrefix->m_Length < TABLE_BITS)
+		pNode = m_apRoots[pPrefix->m_IPv6];
 	else
+		pNode = m_ppTable ? m_ppTable[(pPrefix->m_aKey[0]<<8)|pPrefix->m_aKey[1]] : 0;
+	while(pNode && pNode->m_Prefix.m_Length < pPrefix->m_Length && KeyMatch(pNode->m_Prefix.m_aKey, pNode->m_Prefix.m_Length, pPrefix->m_aKey))
+		pNode = pNode->m_apChildren[KeyBit(pPrefix->m_aKey, pNode->m_Prefix.m_Length)];
+
+	if(!pNode || pNode->m_Prefix.m_Length != pPrefix->m_Length || !KeyMatch(pNode->m_Prefix.m_aKey, pNode->m_Prefix.m_Length, pPrefix->m_aKey))
+		return 0;
+
+	for(const CEntry *pEntry = pNode->m_pEntries; pEntry; pEntry = pEntry->m_pNext)
 	{
-		m_pFirstUsed = pBan;
-		pBan->m_pNext = pBan->m_pPrev = 0;
+		if(NetComp(&pEntry->m_pBan->m_Data, pData) == 0)
+			return pEntry->m_pBan;
 	}
+	return 0;
+}
+
+template<class T>
+typename CNetBan::CBan<T> *CNetBan::CBanTrie<T>::MatchNode(const CNode *pNode, const unsigned char *pKey, int Length)
+{
+	CBan<T> *pMatch = 0;
+	while(pNode && KeyMatch(pNode->m_Prefix.m_aKey, pNode->m_Prefix.m_Length, pKey))
+	{
+		// deeper prefixes are more specific
+		if(pNode->m_pEntries)
+			pMatch = pNode->m_pEntries->m_pBan;
+		if(pNode->m_Prefix.m_Length == Length)
+			break;
+		pNode = pNode->m_apChildren[KeyBit(pKey, pNode->m_Prefix.m_Length)];
+	}
+	return pMatch;
+}
+
+template<class T>
+typename CNetBan::CBan<T> *CNetBan::CBanTrie<T>::Match(const NETADDR *pAddr) const
+{
+	if(pAddr->type != NETTYPE_IPV4)
+		return MatchNode(m_apRoots[1], pAddr->ip, 128);
+
+	// the table holds the longer prefixes
+	CBan<T> *pMatch = m_ppTable ? MatchNode(m_ppTable[(pAddr->ip[0]<<8)|pAddr->ip[1]], pAddr->ip, 32) : 0;
+	return pMatch ? pMatch : MatchNode(m_apRoots[0], pAddr->ip, 32);
+}
+
+template<class T>
+void CNetBan::CBanTrie<T>::Reset()
+{
+	for(int i = 0; i < 2; i++)
+	{
+		DeleteNode(m_apRoots[i]);
+		m_apRoots[i] = 0;
+	}
+	if(m_ppTable)
+	{
+		for(int i = 0; i < 1<<TABLE_BITS; i++)
+			DeleteNode(m_ppTable[i]);
+		delete[] m_ppTable;
+		m_ppTable = 0;
+	}
+}
+
+
+template<class T>
+typename CNetBan::CBan<T> *CNetBan::CBanPool<T>::Add(const T *pData, const CBanInfo *pInfo)
+{
+	// create new ban
+	CBan<T> *pBan = new CBan<T>;
+	pBan->m_Data = *pData;
+	pBan->m_Info = *pInfo;
+	pBan->m_HeapIndex = -1;
+
+	// append it to the used list
+	pBan->m_pNext = 0;
+	pBan->m_pPrev = m_pLastUsed;
+	if(m_pLastUsed)
+		m_pLastUsed->m_pNext = pBan;
+	else
+		m_pFirstUsed = pBan;
+	m_pLastUsed = pBan;
+
+	if(pInfo->m_Expires != CBanInfo::EXPIRES_NEVER)
+		HeapInsert(pBan);
+
+	// add it to the trie
+	CPrefix aPrefixes[CPrefix::MAX_PREFIXES];
+	int NumPrefixes = MakePrefixes(pData, aPrefixes);
+	for(int i = 0; i < NumPrefixes; i++)
+		m_Trie.Insert(&aPrefixes[i], pBan);
 
 	// update ban count
 	++m_CountUsed;
@@ -121,35 +322,30 @@ typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Add(const T *pData,
 	return pBan;
 }
 
-template<class T, int HashCount>
-int CNetBan::CBanPool<T, HashCount>::Remove(CBan<T> *pBan)
+template<class T>
+int CNetBan::CBanPool<T>::Remove(CBan<T> *pBan)
 {
 	if(pBan == 0)
 		return -1;
 
-	// remove from hash list
-	if(pBan->m_pHashNext)
-		pBan->m_pHashNext->m_pHashPrev = pBan->m_pHashPrev;
-	if(pBan->m_pHashPrev)
-		pBan->m_pHashPrev->m_pHashNext = pBan->m_pHashNext;
-	else
-		m_paaHashList[pBan->m_NetHash.m_HashIndex][pBan->m_NetHash.m_Hash] = pBan->m_pHashNext;
-	pBan->m_pHashNext = pBan->m_pHashPrev = 0;
+	// remove from the trie
+	CPrefix aPrefixes[CPrefix::MAX_PREFIXES];
+	int NumPrefixes = MakePrefixes(&pBan->m_Data, aPrefixes);
+	for(int i = 0; i < NumPrefixes; i++)
+		m_Trie.Remove(&aPrefixes[i], pBan);
+
+	HeapRemove(pBan);
 
 	// remove from used list
 	if(pBan->m_pNext)
 		pBan->m_pNext->m_pPrev = pBan->m_pPrev;
+	else
+		m_pLastUsed = pBan->m_pPrev;
 	if(pBan->m_pPrev)
 		pBan->m_pPrev->m_pNext = pBan->m_pNext;
 	else
 		m_pFirstUsed = pBan->m_pNext;
-
-	// add to recycle list
-	if(m_pFirstFree)
-		m_pFirstFree->m_pPrev = pBan;
-	pBan->m_pPrev = 0;
-	pBan->m_pNext = m_pFirstFree;
-	m_pFirstFree = pBan;
+	delete pBan;
 
 	// update ban count
 	--m_CountUsed;
@@ -157,75 +353,41 @@ int CNetBan::CBanPool<T, HashCount>::Remove(CBan<T> *pBan)
 	return 0;
 }
 
-template<class T, int HashCount>
-void CNetBan::CBanPool<T, HashCount>::Update(CBan<CDataType> *pBan, const CBanInfo *pInfo)
+template<class T>
+void CNetBan::CBanPool<T>::Update(CBan<CDataType> *pBan, const CBanInfo *pInfo)
 {
+	HeapRemove(pBan);
 	pBan->m_Info = *pInfo;
-
-	// remove from used list
-	if(pBan->m_pNext)
-		pBan->m_pNext->m_pPrev = pBan->m_pPrev;
-	if(pBan->m_pPrev)
-		pBan->m_pPrev->m_pNext = pBan->m_pNext;
-	else
-		m_pFirstUsed = pBan->m_pNext;
-
-	// insert it into the used list
-	if(m_pFirstUsed)
-	{
-		for(CBan<T> *p = m_pFirstUsed; ; p = p->m_pNext)
-		{
-			if(p->m_Info.m_Expires == CBanInfo::EXPIRES_NEVER || (pInfo->m_Expires != CBanInfo::EXPIRES_NEVER && pInfo->m_Expires <= p->m_Info.m_Expires))
-			{
-				// insert before
-				pBan->m_pNext = p;
-				pBan->m_pPrev = p->m_pPrev;
-				if(p->m_pPrev)
-					p->m_pPrev->m_pNext = pBan;
-				else
-					m_pFirstUsed = pBan;
-				p->m_pPrev = pBan;
-				break;
-			}
-
-			if(!p->m_pNext)
-			{
-				// last entry
-				p->m_pNext = pBan;
-				pBan->m_pPrev = p;
-				pBan->m_pNext = 0;
-				break;
-			}
-		}
-	}
-	else
-	{
-		m_pFirstUsed = pBan;
-		pBan->m_pNext = pBan->m_pPrev = 0;
-	}
+	if(pInfo->m_Expires != CBanInfo::EXPIRES_NEVER)
+		HeapInsert(pBan);
 }
 
-template<class T, int HashCount>
-void CNetBan::CBanPool<T, HashCount>::Reset()
+template<class T>
+void CNetBan::CBanPool<T>::Reset()
 {
-	mem_zero(m_paaHashList, sizeof(m_paaHashList));
-	mem_zero(m_aBans, sizeof(m_aBans));
-	m_pFirstUsed = 0;
-	m_CountUsed = 0;
-
-	for(int i = 1; i < MAX_BANS-1; ++i)
+	m_Trie.Reset();
+	m_aExpiryHeap.clear();
+	while(m_pFirstUsed)
 	{
-		m_aBans[i].m_pNext = &m_aBans[i+1];
-		m_aBans[i].m_pPrev = &m_aBans[i-1];
+		CBan<T> *pBan = m_pFirstUsed;
+		m_pFirstUsed = pBan->m_pNext;
+		delete pBan;
 	}
+	m_pLastUsed = 0;
+	m_CountUsed = 0;
+}
 
-	m_aBans[0].m_pNext = &m_aBans[1];
-	m_aBans[MAX_BANS-1].m_pPrev = &m_aBans[MAX_BANS-2];
-	m_pFirstFree = &m_aBans[0];
+template<class T>
+typename CNetBan::CBan<T> *CNetBan::CBanPool<T>::Find(const T *pData) const
+{
+	// a ban is stored at all of its prefixes, the first one is enough
+	CPrefix aPrefixes[CPrefix::MAX_PREFIXES];
+	MakePrefixes(pData, aPrefixes);
+	return m_Trie.Find(&aPrefixes[0], pData);
 }
 
-template<class T, int HashCount>
-typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Get(int Index) const
+template<class T>
+typename CNetBan::CBan<T> *CNetBan::CBanPool<T>::Get(int Index) const
 {
 	if(Index < 0 || Index >= Num())
 		return 0;
@@ -239,6 +401,76 @@ typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Get(int Index) const
 	return 0;
 }
 
+template<class T>
+void CNetBan::CBanPool<T>::HeapSwap(int Index1, int Index2)
+{
+	CBan<T> *pBan = m_aExpiryHeap[Index1];
+	m_aExpiryHeap[Index1] = m_aExpiryHeap[Index2];
+	m_aExpiryHeap[Index2] = pBan;
+	m_aExpiryHeap[Index1]->m_HeapIndex = Index1;
+	m_aExpiryHeap[Index2]->m_HeapIndex = Index2;
+}
+
+template<class T>
+void CNetBan::CBanPool<T>::HeapUp(int Index)
+{
+	while(Index > 0 && m_aExpiryHeap[Index]->m_Info.m_Expires < m_aExpiryHeap[(Index-1)/2]->m_Info.m_Expires)
+	{
+		HeapSwap(Index, (Index-1)/2);
+		Index = (Index-1)/2;
+	}
+}
+
+template<class T>
+void CNetBan::CBanPool<T>::HeapDown(int Index)
+{
+	while(1)
+	{
+		int Smallest = Index;
+		for(int Child = Index*2+1; Child <= Index*2+2 && Child < m_aExpiryHeap.size(); Child++)
+		{
+			if(m_aExpiryHeap[Child]->m_Info.m_Expires < m_aExpiryHeap[Smallest]->m_Info.m_Expires)
+				Smallest = Child;
+		}
+		if(Smallest == Index)
+			break;
+		HeapSwap(Index, Smallest);
+		Index = Smallest;
+	}
+}
+
+template<class T>
+void CNetBan::CBanPool<T>::HeapInsert(CBan<T> *pBan)
+{
+	pBan->m_HeapIndex = m_aExpiryHeap.add(pBan);
+	HeapUp(pBan->m_HeapIndex);
+}
+
+template<class T>
+void CNetBan::CBanPool<T>::HeapRemove(CBan<T> *pBan)
+{
+	int Index = pBan->m_HeapIndex;
+	if(Index < 0)
+		return;
+
+	// move the last ban into the gap
+	int Last = m_aExpiryHeap.size()-1;
+	HeapSwap(Index, Last);
+	m_aExpiryHeap.remove_index_fast(Last);
+	pBan->m_HeapIndex = -1;
+	if(Index < Last)
+	{
+		HeapDown(Index);
+		HeapUp(Index);
+	}
+}
+
+// the pools are used outside of this file as well
+template class CNetBan::CBanTrie<NETADDR>;
+template class CNetBan::CBanTrie<CNetRange>;
+template class CNetBan::CBanPool<NETADDR>;
+template class CNetBan::CBanPool<CNetRange>;
+
 
 template<class T>
 void CNetBan::MakeBanInfo(const CBan<T> *pBan, char *pBuf, unsigned BuffSize, int Type) const
@@ -301,8 +533,7 @@ int CNetBan::Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, c
 	str_copy(Info.m_aReason, pReason, sizeof(Info.m_aReason));
 
 	// check if it already exists
-	CNetHash NetHash(pData);
-	CBan<typename T::CDataType> *pBan = pBanPool->Find(pData, &NetHash);
+	CBan<typename T::CDataType> *pBan = pBanPool->Find(pData);
 	if(pBan)
 	{
 		// adjust the ban
@@ -314,24 +545,17 @@ int CNetBan::Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, c
 	}
 
 	// add ban and print result
-	pBan = pBanPool->Add(pData, &Info, &NetHash);
-	if(pBan)
-	{
-		char aBuf[128];
-		MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_BANADD);
-		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
-		return 0;
-	}
-	else
-		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban failed (full banlist)");
-	return -1;
+	pBan = pBanPool->Add(pData, &Info);
+	char aBuf[128];
+	MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_BANADD);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+	return 0;
 }
 
 template<class T>
 int CNetBan::Unban(T *pBanPool, const typename T::CDataType *pData)
 {
-	CNetHash NetHash(pData);
-	CBan<typename T::CDataType> *pBan = pBanPool->Find(pData, &NetHash);
+	CBan<typename T::CDataType> *pBan = pBanPool->Find(pData);
 	if(pBan)
 	{
 		char aBuf[256];
@@ -362,6 +586,7 @@ void CNetBan::Init(IConsole *pConsole, IStorage *pStorage)
 	Console()->Register("unban_all", "", CFGFLAG_SERVER|CFGFLAG_MASTER|CFGFLAG_STORE, ConUnbanAll, this, "Unban all entries");
 	Console()->Register("bans", "", CFGFLAG_SERVER|CFGFLAG_MASTER|CFGFLAG_STORE, ConBans, this, "Show banlist");
 	Console()->Register("bans_save", "s", CFGFLAG_SERVER|CFGFLAG_MASTER|CFGFLAG_STORE, ConBansSave, this, "Save banlist in a file");
+	Console()->Register("bans_load", "s?ir", CFGFLAG_SERVER|CFGFLAG_MASTER|CFGFLAG_STORE, ConBansLoad, this, "Ban all addresses and prefixes listed in a file for x minutes (0 for life)");
 }
 
 void CNetBan::Update()
@@ -370,17 +595,17 @@ void CNetBan::Update()
 
 	// remove expired bans
 	char aBuf[256], aNetStr[256];
-	while(m_BanAddrPool.First() && m_BanAddrPool.First()->m_Info.m_Expires != CBanInfo::EXPIRES_NEVER && m_BanAddrPool.First()->m_Info.m_Expires < Now)
+	while(m_BanAddrPool.FirstExpiring() && m_BanAddrPool.FirstExpiring()->m_Info.m_Expires < Now)
 	{
-		str_format(aBuf, sizeof(aBuf), "ban %s expired", NetToString(&m_BanAddrPool.First()->m_Data, aNetStr, sizeof(aNetStr)));
+		str_format(aBuf, sizeof(aBuf), "ban %s expired", NetToString(&m_BanAddrPool.FirstExpiring()->m_Data, aNetStr, sizeof(aNetStr)));
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
-		m_BanAddrPool.Remove(m_BanAddrPool.First());
+		m_BanAddrPool.Remove(m_BanAddrPool.FirstExpiring());
 	}
-	while(m_BanRangePool.First() && m_BanRangePool.First()->m_Info.m_Expires != CBanInfo::EXPIRES_NEVER && m_BanRangePool.First()->m_Info.m_Expires < Now)
+	while(m_BanRangePool.FirstExpiring() && m_BanRangePool.FirstExpiring()->m_Info.m_Expires < Now)
 	{
-		str_format(aBuf, sizeof(aBuf), "ban %s expired", NetToString(&m_BanRangePool.First()->m_Data, aNetStr, sizeof(aNetStr)));
+		str_format(aBuf, sizeof(aBuf), "ban %s expired", NetToString(&m_BanRangePool.FirstExpiring()->m_Data, aNetStr, sizeof(aNetStr)));
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
-		m_BanRangePool.Remove(m_BanRangePool.First());
+		m_BanRangePool.Remove(m_BanRangePool.FirstExpiring());
 	}
 }
 
@@ -443,32 +668,107 @@ int CNetBan::UnbanByIndex(int Index)
 	return Result;
 }
 
-bool CNetBan::IsBanned(const NETADDR *pAddr, char *pBuf, unsigned BufferSize) const
+int CNetBan::LoadBans(const char *pFilename, int Seconds, const char *pReason)
 {
-	CNetHash aHash[17];
-	int Length = CNetHash::MakeHashArray(pAddr, aHash);
+	IOHANDLE File = Storage()->OpenFile(pFilename, IOFLAG_READ, IStorage::TYPE_ALL);
+	if(!File)
+		return -1;
+
+	CBanInfo Info = {0};
+	Info.m_Expires = Seconds > 0 ? time_timestamp()+Seconds : CBanInfo::EXPIRES_NEVER;
+	str_copy(Info.m_aReason, pReason, sizeof(Info.m_aReason));
 
+	// one address or prefix (addr/bits) per line, '#' starts a comment
+	CLineReader LineReader;
+	LineReader.Init(File);
+	int Count = 0, NumInvalid = 0;
+	char *pLine;
+	while((pLine = LineReader.Get()))
+	{
+		pLine = str_skip_whitespaces(pLine);
+		if(!pLine[0] || pLine[0] == '#')
+			continue;
+		*str_skip_to_whitespace(pLine) = 0;
+
+		int Bits = -1;
+		char *pSlash = (char *)str_find(pLine, "/");
+		if(pSlash)
+		{
+			*pSlash = 0;
+			Bits = StrAllnum(pSlash+1) && pSlash[1] ? str_toint(pSlash+1) : -2;
+		}
+
+		NETADDR Addr;
+		if(Bits == -2 || net_addr_from_str(&Addr, pLine) != 0 || Bits > (Addr.type == NETTYPE_IPV4 ? 32 : 128))
+		{
+			NumInvalid++;
+			continue;
+		}
+		Addr.port = 0;
+
+		if(Bits == -1 || Bits == (Addr.type == NETTYPE_IPV4 ? 32 : 128))
+		{
+			if(NetMatch(&Addr, &m_LocalhostIPV4) || NetMatch(&Addr, &m_LocalhostIPV6))
+				continue;
+			CBanAddr *pBan = m_BanAddrPool.Find(&Addr);
+			if(pBan)
+				m_BanAddrPool.Update(pBan, &Info);
+			else
+				m_BanAddrPool.Add(&Addr, &Info);
+		}
+		else
+		{
+			// the range of all addresses that start with the prefix
+			CNetRange Range;
+			Range.m_LB = Addr;
+			Range.m_UB = Addr;
+			for(int i = Bits; i < (Addr.type == NETTYPE_IPV4 ? 32 : 128); i++)
+			{
+				Range.m_LB.ip[i>>3] &= ~(0x80>>(i&7));
+				Range.m_UB.ip[i>>3] |= 0x80>>(i&7);
+			}
+			if(NetMatch(&Range, &m_LocalhostIPV4) || NetMatch(&Range, &m_LocalhostIPV6))
+				continue;
+			CBanRange *pBan = m_BanRangePool.Find(&Range);
+			if(pBan)
+				m_BanRangePool.Update(pBan, &Info);
+			else
+				m_BanRangePool.Add(&Range, &Info);
+		}
+		Count++;
+	}
+	io_close(File);
+
+	if(Count)
+		OnBansLoaded();
+
+	if(NumInvalid)
+	{
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "skipped %d invalid lines in '%s'", NumInvalid, pFilename);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+	}
+	return Count;
+}
+
+bool CNetBan::IsBanned(const NETADDR *pAddr, char *pBuf, unsigned BufferSize) const
+{
 	// check ban adresses
-	CBanAddr *pBan = m_BanAddrPool.Find(pAddr, &aHash[Length]);
+	CBanAddr *pBan = m_BanAddrPool.Match(pAddr);
 	if(pBan)
 	{
 		MakeBanInfo(pBan, pBuf, BufferSize, MSGTYPE_PLAYER);
 		return true;
 	}
 
-	// check ban ranges
-	for(int i = Length-1; i >= 0; --i)
+	// check ban ranges, the most specific one wins
+	CBanRange *pBanRange = m_BanRangePool.Match(pAddr);
+	if(pBanRange)
 	{
-		for(CBanRange *pBan = m_BanRangePool.First(&aHash[i]); pBan; pBan = pBan->m_pHashNext)
-		{
-			if(NetMatch(&pBan->m_Data, pAddr, i, Length))
-			{
-				MakeBanInfo(pBan, pBuf, BufferSize, MSGTYPE_PLAYER);
-				return true;
-			}
-		}
+		MakeBanInfo(pBanRange, pBuf, BufferSize, MSGTYPE_PLAYER);
+		return true;
 	}
-	
+
 	return false;
 }
 
@@ -601,3 +901,19 @@ void CNetBan::ConBansSave(IConsole::IResult *pResult, void *pUser)
 	str_format(aBuf, sizeof(aBuf), "saved banlist to '%s'", pResult->GetString(0));
 	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
 }
+
+void CNetBan::ConBansLoad(IConsole::IResult *pResult, void *pUser)
+{
+	CNetBan *pThis = static_cast<CNetBan *>(pUser);
+
+	int Minutes = pResult->NumArguments()>1 ? clamp(pResult->GetInteger(1), 0, 44640) : 0;
+	const char *pReason = pResult->NumArguments()>2 ? pResult->GetString(2) : "No reason given";
+
+	char aBuf[256];
+	int Count = pThis->LoadBans(pResult->GetString(0), Minutes*60, pReason);
+	if(Count < 0)
+		str_format(aBuf, sizeof(aBuf), "failed to load banlist from '%s'", pResult->GetString(0));
+	else
+		str_format(aBuf, sizeof(aBuf), "loaded %d %s from '%s'", Count, Count==1?"ban":"bans", pResult->GetString(0));
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+}
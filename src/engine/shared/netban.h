@@ -2,6 +2,7 @@
 #define ENGINE_SHARED_NETBAN_H
 
 #include <base/system.h>
+#include <base/tl/array.h>
 
 
 inline int NetComp(const NETADDR *pAddr1, const NETADDR *pAddr2)
@@ -63,19 +64,6 @@ protected:
 	// todo: move?
 	static bool StrAllnum(const char *pStr);
 
-	class CNetHash
-	{
-	public:
-		int m_Hash;
-		int m_HashIndex;	// matching parts for ranges, 0 for addr
-
-		CNetHash() {}	
-		CNetHash(const NETADDR *pAddr);
-		CNetHash(const CNetRange *pRange);
-
-		static int MakeHashArray(const NETADDR *pAddr, CNetHash aHash[17]);
-	};
-
 	struct CBanInfo
 	{
 		enum
@@ -91,59 +79,111 @@ protected:
 	{
 		T m_Data;
 		CBanInfo m_Info;
-		CNetHash m_NetHash;
-
-		// hash list
-		CBan *m_pHashNext;
-		CBan *m_pHashPrev;
+		int m_HeapIndex;	// position in the expiry heap, -1 for bans that never expire
 
-		// used or free list
+		// used list
 		CBan *m_pNext;
 		CBan *m_pPrev;
 	};
 
-	template<class T, int HashCount> class CBanPool
+	// leading bits of an address, a range is covered by a set of them
+	struct CPrefix
+	{
+		enum
+		{
+			MAX_PREFIXES=256,	// a range over 128 bits splits into at most 254 prefixes
+		};
+		unsigned char m_aKey[16];
+		int m_Length;	// in bits
+		bool m_IPv6;
+	};
+
+	static int MakePrefixes(const NETADDR *pAddr, CPrefix *pPrefixes);
+	static int MakePrefixes(const CNetRange *pRange, CPrefix *pPrefixes);
+
+	/*
+		Path compressed binary trie over the address bits. Every node keeps the
+		bans that cover exactly its prefix, a lookup walks down the bits of the
+		address and returns the ban of the longest matching prefix. Longer ipv4
+		prefixes start in a table indexed by their first 16 bits, which saves
+		most of the levels a lookup would otherwise walk through.
+	*/
+	template<class T> class CBanTrie
+	{
+		enum
+		{
+			TABLE_BITS=16,
+		};
+
+		struct CEntry
+		{
+			CBan<T> *m_pBan;
+			CEntry *m_pNext;
+		};
+
+		struct CNode
+		{
+			CPrefix m_Prefix;
+			CNode *m_apChildren[2];
+			CEntry *m_pEntries;
+		};
+
+		CNode *m_apRoots[2];	// ipv4, ipv6
+		CNode **m_ppTable;	// ipv4 prefixes with at least TABLE_BITS bits
+
+		CNode **Root(const CPrefix *pPrefix);
+		static CNode *NewNode(const CPrefix *pPrefix, int Length);
+		static void DeleteNode(CNode *pNode);
+		static void RemoveEntry(CNode **ppNode, const CPrefix *pPrefix, const CBan<T> *pBan);
+		static CBan<T> *MatchNode(const CNode *pNode, const unsigned char *pKey, int Length);
+
+	public:
+		CBanTrie() : m_ppTable(0) { m_apRoots[0] = m_apRoots[1] = 0; }
+
+		void Insert(const CPrefix *pPrefix, CBan<T> *pBan);
+		void Remove(const CPrefix *pPrefix, const CBan<T> *pBan);
+		CBan<T> *Find(const CPrefix *pPrefix, const T *pData) const;
+		CBan<T> *Match(const NETADDR *pAddr) const;
+		void Reset();
+	};
+
+	template<class T> class CBanPool
 	{
 	public:
 		typedef T CDataType;
 
-		CBan<CDataType> *Add(const CDataType *pData, const CBanInfo *pInfo, const CNetHash *pNetHash);
+		CBanPool() : m_pFirstUsed(0), m_pLastUsed(0), m_CountUsed(0) {}
+		~CBanPool() { Reset(); }
+
+		CBan<CDataType> *Add(const CDataType *pData, const CBanInfo *pInfo);
 		int Remove(CBan<CDataType> *pBan);
 		void Update(CBan<CDataType> *pBan, const CBanInfo *pInfo);
 		void Reset();
-	
+
 		int Num() const { return m_CountUsed; }
-		bool IsFull() const { return m_CountUsed == MAX_BANS; }
 
 		CBan<CDataType> *First() const { return m_pFirstUsed; }
-		CBan<CDataType> *First(const CNetHash *pNetHash) const { return m_paaHashList[pNetHash->m_HashIndex][pNetHash->m_Hash]; }
-		CBan<CDataType> *Find(const CDataType *pData, const CNetHash *pNetHash) const
-		{
-			for(CBan<CDataType> *pBan = m_paaHashList[pNetHash->m_HashIndex][pNetHash->m_Hash]; pBan; pBan = pBan->m_pHashNext)
-			{
-				if(NetComp(&pBan->m_Data, pData) == 0)
-					return pBan;
-			}
-
-			return 0;
-		}
+		CBan<CDataType> *FirstExpiring() const { return m_aExpiryHeap.size() ? m_aExpiryHeap[0] : 0; }
+		CBan<CDataType> *Find(const CDataType *pData) const;
+		CBan<CDataType> *Match(const NETADDR *pAddr) const { return m_Trie.Match(pAddr); }
 		CBan<CDataType> *Get(int Index) const;
 
 	private:
-		enum
-		{
-			MAX_BANS=1024,
-		};
-
-		CBan<CDataType> *m_paaHashList[HashCount][256];
-		CBan<CDataType> m_aBans[MAX_BANS];
-		CBan<CDataType> *m_pFirstFree;
+		void HeapSwap(int Index1, int Index2);
+		void HeapUp(int Index);
+		void HeapDown(int Index);
+		void HeapInsert(CBan<CDataType> *pBan);
+		void HeapRemove(CBan<CDataType> *pBan);
+
+		CBanTrie<CDataType> m_Trie;
+		array<CBan<CDataType> *> m_aExpiryHeap;
 		CBan<CDataType> *m_pFirstUsed;
+		CBan<CDataType> *m_pLastUsed;
 		int m_CountUsed;
 	};
 
-	typedef CBanPool<NETADDR, 1> CBanAddrPool;
-	typedef CBanPool<CNetRange, 16> CBanRangePool;
+	typedef CBanPool<NETADDR> CBanAddrPool;
+	typedef CBanPool<CNetRange> CBanRangePool;
 	typedef CBan<NETADDR> CBanAddr;
 	typedef CBan<CNetRange> CBanRange;
 	
@@ -151,6 +191,9 @@ protected:
 	template<class T> int Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, const char *pReason);
 	template<class T> int Unban(T *pBanPool, const typename T::CDataType *pData);
 
+	// called after bans were added from a banlist file
+	virtual void OnBansLoaded() {}
+
 	class IConsole *m_pConsole;
 	class IStorage *m_pStorage;
 	CBanAddrPool m_BanAddrPool;
@@ -180,6 +223,7 @@ public:
 	int UnbanByIndex(int Index);
 	void UnbanAll() { m_BanAddrPool.Reset(); m_BanRangePool.Reset(); }
 	bool IsBanned(const NETADDR *pAddr, char *pBuf, unsigned BufferSize) const;
+	int LoadBans(const char *pFilename, int Seconds, const char *pReason);
 
 	static void ConBan(class IConsole::IResult *pResult, void *pUser);
 	static void ConBanRange(class IConsole::IResult *pResult, void *pUser);
@@ -188,6 +232,7 @@ public:
 	static void ConUnbanAll(class IConsole::IResult *pResult, void *pUser);
 	static void ConBans(class IConsole::IResult *pResult, void *pUser);
 	static void ConBansSave(class IConsole::IResult *pResult, void *pUser);
+	static void ConBansLoad(class IConsole::IResult *pResult, void *pUser);
 };
 
 #endif
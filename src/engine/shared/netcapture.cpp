@@ -0,0 +1,241 @@
+/* File is created for the TW+ mod
+ */
+
+#include <base/math.h>
+
+#include "netcapture.h"
+
+static const char s_aCaptureMagic[5] = {'T', 'W', 'C', 'A', 'P'};
+
+static unsigned char *PackInt(unsigned char *pDst, int64 Value, int Bytes)
+{
+	for(int i = Bytes-1; i >= 0; i--)
+	{
+		pDst[i] = Value&0xff;
+		Value >>= 8;
+	}
+	return pDst + Bytes;
+}
+
+static const unsigned char *UnpackInt(const unsigned char *pSrc, int64 *pValue, int Bytes)
+{
+	int64 Value = 0;
+	for(int i = 0; i < Bytes; i++)
+		Value = (Value<<8) | pSrc[i];
+	*pValue = Value;
+	return pSrc + Bytes;
+}
+
+CNetCapture::CNetCapture()
+{
+	m_File = 0;
+	m_pThread = 0;
+	m_Lock = 0;
+	m_apBuffers[0] = 0;
+	m_apBuffers[1] = 0;
+	m_NumDropped = 0;
+}
+
+bool CNetCapture::Open(IOHANDLE File)
+{
+	if(!File || m_File)
+		return false;
+
+	unsigned char aHeader[HEADER_SIZE];
+	mem_copy(aHeader, s_aCaptureMagic, sizeof(s_aCaptureMagic));
+	aHeader[5] = VERSION;
+	io_write(File, aHeader, sizeof(aHeader));
+
+	m_File = File;
+	m_StartTime = time_get_real();
+	m_Lock = lock_create();
+	for(int i = 0; i < 2; i++)
+	{
+		m_apBuffers[i] = (unsigned char *)mem_alloc_tag(BUFFER_SIZE, 1, MEMTAG_NET);
+		m_aBufferSize[i] = 0;
+	}
+	m_Current = 0;
+	m_Pending = -1;
+	m_Stop = false;
+	m_NumDropped = 0;
+	m_pThread = teethread_create(WriterThread, this);
+	return true;
+}
+
+void CNetCapture::Close()
+{
+	if(!m_File)
+		return;
+
+	m_Stop = true;
+	thread_wait(m_pThread);
+	m_pThread = 0;
+
+	// the thread wrote the pending buffer, the current one is left
+	io_write(m_File, m_apBuffers[m_Current], m_aBufferSize[m_Current]);
+	io_close(m_File);
+	m_File = 0;
+
+	lock_destroy(m_Lock);
+	m_Lock = 0;
+	for(int i = 0; i < 2; i++)
+	{
+		mem_free(m_apBuffers[i]);
+		m_apBuffers[i] = 0;
+	}
+}
+
+void CNetCapture::WriterThread(void *pUser)
+{
+	CNetCapture *pThis = (CNetCapture *)pUser;
+	while(1)
+	{
+		int Pending = pThis->m_Pending;
+		if(Pending != -1)
+		{
+			io_write(pThis->m_File, pThis->m_apBuffers[Pending], pThis->m_aBufferSize[Pending]);
+			lock_wait(pThis->m_Lock);
+			pThis->m_Pending = -1;
+			lock_release(pThis->m_Lock);
+		}
+		else if(pThis->m_Stop)
+			break;
+		else
+			thread_sleep(10);
+	}
+}
+
+void CNetCapture::Write(int Type, const NETADDR *pAddr, const void *pData, int Size)
+{
+	if(!m_File || Size < 0 || Size > MAX_PACKET_SIZE)
+		return;
+
+	lock_wait(m_Lock);
+	if(m_aBufferSize[m_Current] + RECORD_HEADER_SIZE + Size > BUFFER_SIZE)
+	{
+		// the writer is still busy with the other buffer
+		if(m_Pending != -1)
+		{
+			m_NumDropped++;
+			lock_release(m_Lock);
+			return;
+		}
+		m_Pending = m_Current;
+		m_Current ^= 1;
+		m_aBufferSize[m_Current] = 0;
+	}
+
+	unsigned char *pDst = m_apBuffers[m_Current] + m_aBufferSize[m_Current];
+	pDst = PackInt(pDst, (time_get_real() - m_StartTime) * 1000000 / time_freq(), 8);
+	pDst = PackInt(pDst, Type, 1);
+	pDst = PackInt(pDst, pAddr->type, 1);
+	mem_copy(pDst, pAddr->ip, sizeof(pAddr->ip));
+	pDst += sizeof(pAddr->ip);
+	pDst = PackInt(pDst, pAddr->port, 2);
+	pDst = PackInt(pDst, Size, 2);
+	mem_copy(pDst, pData, Size);
+	m_aBufferSize[m_Current] += RECORD_HEADER_SIZE + Size;
+	lock_release(m_Lock);
+}
+
+bool CNetCaptureReader::Open(IOHANDLE File)
+{
+	if(!File)
+		return false;
+
+	unsigned char aHeader[CNetCapture::HEADER_SIZE];
+	if(io_read(File, aHeader, sizeof(aHeader)) != sizeof(aHeader) ||
+		mem_comp(aHeader, s_aCaptureMagic, sizeof(s_aCaptureMagic)) != 0 || aHeader[5] != CNetCapture::VERSION)
+	{
+		io_close(File);
+		return false;
+	}
+
+	m_File = File;
+	return true;
+}
+
+void CNetCaptureReader::Close()
+{
+	if(m_File)
+		io_close(m_File);
+	m_File = 0;
+}
+
+bool CNetCaptureReader::Read(CNetCapture::CRecord *pRecord, unsigned char *pData, int MaxSize)
+{
+	unsigned char aHeader[CNetCapture::RECORD_HEADER_SIZE];
+	if(!m_File || io_read(m_File, aHeader, sizeof(aHeader)) != sizeof(aHeader))
+		return false;
+
+	int64 Value;
+	const unsigned char *pSrc = UnpackInt(aHeader, &pRecord->m_Time, 8);
+	pSrc = UnpackInt(pSrc, &Value, 1);
+	pRecord->m_Type = (int)Value;
+	mem_zero(&pRecord->m_Addr, sizeof(pRecord->m_Addr));
+	pSrc = UnpackInt(pSrc, &Value, 1);
+	pRecord->m_Addr.type = (unsigned)Value;
+	mem_copy(pRecord->m_Addr.ip, pSrc, sizeof(pRecord->m_Addr.ip));
+	pSrc += sizeof(pRecord->m_Addr.ip);
+	pSrc = UnpackInt(pSrc, &Value, 2);
+	pRecord->m_Addr.port = (unsigned short)Value;
+	UnpackInt(pSrc, &Value, 2);
+	pRecord->m_Size = (int)Value;
+
+	if(pRecord->m_Size > MaxSize || io_read(m_File, pData, pRecord->m_Size) != (unsigned)pRecord->m_Size)
+		return false;
+	return true;
+}
+
+CNetReplay::CNetReplay()
+{
+	m_HasNext = false;
+	m_StartTime = 0;
+	m_NumRecv = 0;
+	m_NumSent = 0;
+	m_BytesRecv = 0;
+	m_BytesSent = 0;
+}
+
+bool CNetReplay::Open(IOHANDLE File, int64 StartTime)
+{
+	if(!m_Reader.Open(File))
+		return false;
+
+	m_StartTime = StartTime;
+	ReadNext();
+	return true;
+}
+
+void CNetReplay::Close()
+{
+	m_Reader.Close();
+	m_HasNext = false;
+}
+
+void CNetReplay::ReadNext()
+{
+	// only the received packets are fed back, the server produces the sent ones again
+	do
+		m_HasNext = m_Reader.Read(&m_Next, m_aNextData, sizeof(m_aNextData));
+	while(m_HasNext && m_Next.m_Type != CNetCapture::TYPE_RECV);
+}
+
+int64 CNetReplay::NextTime() const
+{
+	return m_StartTime + m_Next.m_Time * time_freq() / 1000000;
+}
+
+int CNetReplay::Recv(NETADDR *pAddr, unsigned char *pBuffer, int MaxSize)
+{
+	if(!m_HasNext || NextTime() > time_get())
+		return 0;
+
+	*pAddr = m_Next.m_Addr;
+	int Size = min(m_Next.m_Size, MaxSize);
+	mem_copy(pBuffer, m_aNextData, Size);
+	m_NumRecv++;
+	m_BytesRecv += Size;
+	ReadNext();
+	return Size;
+}
@@ -0,0 +1,137 @@
+/* File is created for the TW+ mod
+ */
+
+#ifndef ENGINE_SHARED_NETCAPTURE_H
+#define ENGINE_SHARED_NETCAPTURE_H
+
+#include <base/system.h>
+
+/*
+	Capture file:
+		header: "TWCAP" magic, 1 byte version
+		records:
+			8 bytes time in microseconds since the capture started
+			1 byte type (received or sent)
+			1 byte net type, 16 bytes ip, 2 bytes port of the remote address
+			2 bytes size
+			size bytes of the raw udp packet
+
+	All numbers are big endian.
+*/
+
+class CNetCapture
+{
+public:
+	enum
+	{
+		TYPE_RECV=0,
+		TYPE_SEND,
+
+		VERSION=1,
+		HEADER_SIZE=6,
+		RECORD_HEADER_SIZE=30,
+		MAX_PACKET_SIZE=1400,
+	};
+
+	struct CRecord
+	{
+		int64 m_Time; // microseconds since the capture started
+		int m_Type;
+		NETADDR m_Addr;
+		int m_Size;
+	};
+
+	CNetCapture();
+
+	/**
+	 * Starts capturing to the file and takes ownership of it
+	 */
+	bool Open(IOHANDLE File);
+	void Close();
+	bool IsOpen() const { return m_File != 0; }
+
+	/**
+	 * Queues a packet, the file is written by a background thread. Packets
+	 * get dropped while both buffers are full
+	 */
+	void Write(int Type, const NETADDR *pAddr, const void *pData, int Size);
+
+	int NumDropped() const { return m_NumDropped; }
+
+private:
+	enum
+	{
+		BUFFER_SIZE=256*1024,
+	};
+
+	static void WriterThread(void *pUser);
+
+	IOHANDLE m_File;
+	void *m_pThread;
+	LOCK m_Lock;
+	int64 m_StartTime;
+
+	unsigned char *m_apBuffers[2];
+	int m_aBufferSize[2];
+	int m_Current; // buffer the packets go to
+	volatile int m_Pending; // buffer the thread has to write or -1
+	volatile bool m_Stop;
+	int m_NumDropped;
+};
+
+class CNetCaptureReader
+{
+	IOHANDLE m_File;
+
+public:
+	CNetCaptureReader() : m_File(0) {}
+
+	bool Open(IOHANDLE File);
+	void Close();
+
+	/**
+	 * Reads the next packet, returns false at the end of the capture
+	 */
+	bool Read(CNetCapture::CRecord *pRecord, unsigned char *pData, int MaxSize);
+};
+
+/**
+ * Feeds the received packets of a capture back into the network, on a
+ * virtual clock that jumps from packet to packet
+ */
+class CNetReplay
+{
+	CNetCaptureReader m_Reader;
+	CNetCapture::CRecord m_Next;
+	unsigned char m_aNextData[CNetCapture::MAX_PACKET_SIZE];
+	bool m_HasNext;
+	int64 m_StartTime; // virtual time of the capture start
+
+	void ReadNext();
+
+public:
+	CNetReplay();
+
+	bool Open(IOHANDLE File, int64 StartTime);
+	void Close();
+
+	bool Done() const { return !m_HasNext; }
+
+	/**
+	 * Virtual time the next packet arrives at
+	 */
+	int64 NextTime() const;
+
+	/**
+	 * Fetches a packet that arrived by the virtual time, like net_udp_recv
+	 */
+	int Recv(NETADDR *pAddr, unsigned char *pBuffer, int MaxSize);
+
+	// statistics
+	int m_NumRecv;
+	int m_NumSent;
+	int64 m_BytesRecv;
+	int64 m_BytesSent;
+};
+
+#endif
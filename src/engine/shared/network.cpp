@@ -4,6 +4,7 @@
 
 
 #include "config.h"
+#include "netcapture.h"
 #include "network.h"
 #include "huffman.h"
 
@@ -98,23 +99,23 @@ void CNetBase::SendPacketConnless(NETSOCKET Socket, NETADDR *pAddr, const void *
 	aBuffer[4] = 0xff;
 	aBuffer[5] = 0xff;
 	mem_copy(&aBuffer[6], pData, DataSize);
-	net_udp_send(Socket, pAddr, aBuffer, 6+DataSize);
+	SendRaw(Socket, pAddr, aBuffer, 6+DataSize);
 }
 
-void CNetBase::SendPacket(NETSOCKET Socket, NETADDR *pAddr, CNetPacketConstruct *pPacket)
+void CNetBase::SendPacket(NETSOCKET Socket, NETADDR *pAddr, CNetPacketConstruct *pPacket, int SecurityToken)
 {
 	unsigned char aBuffer[NET_MAX_PACKETSIZE];
 	int CompressedSize = -1;
 	int FinalSize = -1;
 
-	// log the data
-	if(ms_DataLogSent)
+	// the token goes behind the chunks, the packet stays as it was afterwards
+	int DataSize = pPacket->m_DataSize;
+	if(SecurityToken != NET_SECURITY_TOKEN_UNSUPPORTED)
 	{
-		int Type = 1;
-		io_write(ms_DataLogSent, &Type, sizeof(Type));
-		io_write(ms_DataLogSent, &pPacket->m_DataSize, sizeof(pPacket->m_DataSize));
-		io_write(ms_DataLogSent, &pPacket->m_aChunkData, pPacket->m_DataSize);
-		io_flush(ms_DataLogSent);
+		if(pPacket->m_DataSize + NET_SECURITY_TOKEN_SIZE > (int)sizeof(pPacket->m_aChunkData))
+			return;
+		WriteSecurityToken(&pPacket->m_aChunkData[pPacket->m_DataSize], SecurityToken);
+		pPacket->m_DataSize += NET_SECURITY_TOKEN_SIZE;
 	}
 
 	// compress
@@ -141,18 +142,38 @@ void CNetBase::SendPacket(NETSOCKET Socket, NETADDR *pAddr, CNetPacketConstruct
 		aBuffer[0] = ((pPacket->m_Flags<<4)&0xf0)|((pPacket->m_Ack>>8)&0xf);
 		aBuffer[1] = pPacket->m_Ack&0xff;
 		aBuffer[2] = pPacket->m_NumChunks;
-		net_udp_send(Socket, pAddr, aBuffer, FinalSize);
+		SendRaw(Socket, pAddr, aBuffer, FinalSize);
+	}
 
-		// log raw socket data
-		if(ms_DataLogSent)
-		{
-			int Type = 0;
-			io_write(ms_DataLogSent, &Type, sizeof(Type));
-			io_write(ms_DataLogSent, &FinalSize, sizeof(FinalSize));
-			io_write(ms_DataLogSent, aBuffer, FinalSize);
-			io_flush(ms_DataLogSent);
-		}
+	pPacket->m_DataSize = DataSize;
+}
+
+void CNetBase::SendRaw(NETSOCKET Socket, NETADDR *pAddr, const void *pData, int DataSize)
+{
+	if(ms_Capture.IsOpen())
+		ms_Capture.Write(CNetCapture::TYPE_SEND, pAddr, pData, DataSize);
+
+	if(ms_pReplay)
+	{
+		ms_pReplay->m_NumSent++;
+		ms_pReplay->m_BytesSent += DataSize;
+		return;
 	}
+
+	net_udp_send(Socket, pAddr, pData, DataSize);
+}
+
+int CNetBase::RecvPacket(NETSOCKET Socket, NETADDR *pAddr, unsigned char *pBuffer, int MaxSize)
+{
+	int Bytes;
+	if(ms_pReplay)
+		Bytes = ms_pReplay->Recv(pAddr, pBuffer, MaxSize);
+	else
+		Bytes = net_udp_recv(Socket, pAddr, pBuffer, MaxSize);
+
+	if(Bytes > 0 && ms_Capture.IsOpen())
+		ms_Capture.Write(CNetCapture::TYPE_RECV, pAddr, pBuffer, Bytes);
+	return Bytes;
 }
 
 // TODO: rename this function
@@ -165,16 +186,6 @@ int CNetBase::UnpackPacket(unsigned char *pBuffer, int Size, CNetPacketConstruct
 		return -1;
 	}
 
-	// log the data
-	if(ms_DataLogRecv)
-	{
-		int Type = 0;
-		io_write(ms_DataLogRecv, &Type, sizeof(Type));
-		io_write(ms_DataLogRecv, &Size, sizeof(Size));
-		io_write(ms_DataLogRecv, pBuffer, Size);
-		io_flush(ms_DataLogRecv);
-	}
-
 	// read the packet
 	pPacket->m_Flags = pBuffer[0]>>4;
 	pPacket->m_Ack = ((pBuffer[0]&0xf)<<8) | pBuffer[1];
@@ -211,22 +222,30 @@ int CNetBase::UnpackPacket(unsigned char *pBuffer, int Size, CNetPacketConstruct
 		return -1;
 	}
 
-	// log the data
-	if(ms_DataLogRecv)
-	{
-		int Type = 1;
-		io_write(ms_DataLogRecv, &Type, sizeof(Type));
-		io_write(ms_DataLogRecv, &pPacket->m_DataSize, sizeof(pPacket->m_DataSize));
-		io_write(ms_DataLogRecv, pPacket->m_aChunkData, pPacket->m_DataSize);
-		io_flush(ms_DataLogRecv);
-	}
-
 	// return success
 	return 0;
 }
 
 
-void CNetBase::SendControlMsg(NETSOCKET Socket, NETADDR *pAddr, int Ack, int ControlMsg, const void *pExtra, int ExtraSize)
+void CNetBase::WriteSecurityToken(unsigned char *pData, int SecurityToken)
+{
+	pData[0] = SecurityToken&0xff;
+	pData[1] = (SecurityToken>>8)&0xff;
+	pData[2] = (SecurityToken>>16)&0xff;
+	pData[3] = (SecurityToken>>24)&0xff;
+}
+
+bool CNetBase::StripSecurityToken(CNetPacketConstruct *pPacket, int SecurityToken)
+{
+	if(pPacket->m_DataSize < NET_SECURITY_TOKEN_SIZE)
+		return false;
+	if(ReadSecurityToken(&pPacket->m_aChunkData[pPacket->m_DataSize-NET_SECURITY_TOKEN_SIZE]) != SecurityToken)
+		return false;
+	pPacket->m_DataSize -= NET_SECURITY_TOKEN_SIZE;
+	return true;
+}
+
+void CNetBase::SendControlMsg(NETSOCKET Socket, NETADDR *pAddr, int Ack, int ControlMsg, const void *pExtra, int ExtraSize, int SecurityToken)
 {
 	CNetPacketConstruct Construct;
 	Construct.m_Flags = NET_PACKETFLAG_CONTROL;
@@ -237,7 +256,7 @@ void CNetBase::SendControlMsg(NETSOCKET Socket, NETADDR *pAddr, int Ack, int Con
 	mem_copy(&Construct.m_aChunkData[1], pExtra, ExtraSize);
 
 	// send the control message
-	CNetBase::SendPacket(Socket, pAddr, &Construct);
+	CNetBase::SendPacket(Socket, pAddr, &Construct, SecurityToken);
 }
 
 
@@ -288,44 +307,27 @@ int CNetBase::IsSeqInBackroom(int Seq, int Ack)
 	return 0;
 }
 
-IOHANDLE CNetBase::ms_DataLogSent = 0;
-IOHANDLE CNetBase::ms_DataLogRecv = 0;
+CNetCapture CNetBase::ms_Capture;
+CNetReplay *CNetBase::ms_pReplay = 0;
 CHuffman CNetBase::ms_Huffman;
 
 
-void CNetBase::OpenLog(IOHANDLE DataLogSent, IOHANDLE DataLogRecv)
+void CNetBase::OpenLog(IOHANDLE Capture)
 {
-	if(DataLogSent)
-	{
-		ms_DataLogSent = DataLogSent;
-		dbg_msg("network", "logging sent packages");
-	}
-	else
-		dbg_msg("network", "failed to start logging sent packages");
-
-	if(DataLogRecv)
-	{
-		ms_DataLogRecv = DataLogRecv;
-		dbg_msg("network", "logging recv packages");
-	}
+	if(ms_Capture.Open(Capture))
+		dbg_msg("network", "capturing packets");
 	else
-		dbg_msg("network", "failed to start logging recv packages");
+		dbg_msg("network", "failed to start capturing packets");
 }
 
 void CNetBase::CloseLog()
 {
-	if(ms_DataLogSent)
-	{
-		dbg_msg("network", "stopped logging sent packages");
-		io_close(ms_DataLogSent);
-		ms_DataLogSent = 0;
-	}
-
-	if(ms_DataLogRecv)
+	if(ms_Capture.IsOpen())
 	{
-		dbg_msg("network", "stopped logging recv packages");
-		io_close(ms_DataLogRecv);
-		ms_DataLogRecv = 0;
+		if(ms_Capture.NumDropped())
+			dbg_msg("network", "dropped %d packets of the capture", ms_Capture.NumDropped());
+		dbg_msg("network", "stopped capturing packets");
+		ms_Capture.Close();
 	}
 }
 
@@ -5,6 +5,7 @@
 
 #include "ringbuffer.h"
 #include "huffman.h"
+#include "timerwheel.h"
 
 /*
 
@@ -22,6 +23,15 @@ CURRENT:
 		unsigned char flags_size; // 2bit flags, 6 bit size
 		unsigned char size_seq; // 4bit size, 4bit seq
 		(unsigned char seq;) // 8bit seq, if vital flag is set
+
+	security token (ddnet 0.6 extension):
+		a client that supports it sends "TKEN" after the connect control message,
+		padded to NET_TOKENREQUEST_DATASIZE. The server answers with connect+accept,
+		"TKEN" and a token derived from the client address and a secret, without
+		keeping any state. The client appends the token to every packet it sends,
+		the server only gives it a slot once a packet with the right token arrives
+		and appends the token to everything it sends to the client from then on.
+		The token is added to the chunk data before compression.
 */
 
 enum
@@ -30,6 +40,7 @@ enum
 	NETSENDFLAG_VITAL=1,
 	NETSENDFLAG_CONNLESS=2,
 	NETSENDFLAG_FLUSH=4,
+	NETSENDFLAG_STATIC=8, // the data stays valid until it was acked or the connection got reset
 
 	NETSTATE_OFFLINE=0,
 	NETSTATE_CONNECTING,
@@ -51,6 +62,7 @@ enum
 	NET_MAX_CLIENTS = 64,
 	NET_MAX_CLIENTS_VANILLA = 16,
 	NET_MAX_CONSOLE_CLIENTS = 4,
+	NET_CONSOLE_OUTPUT_SIZE = 1<<16, // power of two
 	NET_MAX_SEQUENCE = 1<<10,
 	NET_SEQUENCE_MASK = NET_MAX_SEQUENCE-1,
 
@@ -67,6 +79,7 @@ enum
 
 	NET_CHUNKFLAG_VITAL=1,
 	NET_CHUNKFLAG_RESEND=2,
+	NET_CHUNKFLAG_STATIC=4, // never goes on the wire, the resend buffer only refers to the data
 
 	NET_CTRLMSG_KEEPALIVE=0,
 	NET_CTRLMSG_CONNECT=1,
@@ -76,10 +89,22 @@ enum
 
 	NET_CONN_BUFFERSIZE=1024*32,
 
+	// bounds of the retransmission timeout in milliseconds
+	NET_RTO_MIN=100,
+	NET_RTO_MAX=3000,
+	NET_RTO_MAX_BACKOFF=5,
+
+	NET_SECURITY_TOKEN_UNKNOWN=-1,
+	NET_SECURITY_TOKEN_UNSUPPORTED=0,
+	NET_SECURITY_TOKEN_SIZE=4,
+	NET_TOKENREQUEST_DATASIZE=512,
+
 	NET_ENUM_TERMINATOR
 };
 
 
+static const unsigned char SECURITY_TOKEN_MAGIC[4] = {'T', 'K', 'E', 'N'};
+
 typedef int (*NETFUNC_DELCLIENT)(int ClientID, const char* pReason, void *pUser);
 typedef int (*NETFUNC_NEWCLIENT)(int ClientID, void *pUser);
 
@@ -140,6 +165,7 @@ private:
 	unsigned m_State;
 
 	int m_Token;
+	int m_SecurityToken;
 	int m_RemoteClosed;
 	bool m_BlockCloseMsg;
 
@@ -149,6 +175,16 @@ private:
 	int64 m_LastRecvTime;
 	int64 m_LastSendTime;
 
+	// smoothed round trip time and its variance, -1 until the first ack
+	int64 m_Srtt;
+	int64 m_RttVar;
+	int m_RtoBackoff;
+
+	// vital chunks sent for the first time and again
+	int m_NumVitalChunks;
+	int m_NumResends;
+	int m_NumUnacked; // vital chunks waiting for their ack
+
 	char m_ErrorString[256];
 
 	CNetPacketConstruct m_Construct;
@@ -162,23 +198,39 @@ private:
 	void ResetStats();
 	void SetError(const char *pString);
 	void AckChunks(int Ack);
+	void UpdateRtt(int64 Rtt);
+	int64 Rto() const;
 
 	int QueueChunkEx(int Flags, int DataSize, const void *pData, int Sequence);
 	void SendControl(int ControlMsg, const void *pExtra, int ExtraSize);
+	void SendConnect();
 	void ResendChunk(CNetChunkResend *pResend);
 	void Resend();
 
 public:
 	void Init(NETSOCKET Socket, bool BlockCloseMsg);
 	int Connect(NETADDR *pAddr);
+	void DirectInit(const NETADDR *pAddr, int SecurityToken);
 	void Disconnect(const char *pReason);
 
 	int Update();
+	int Update(int64 Now);
 	int Flush();
 
+	/**
+	 * Time Update has something to do next: a resend, flush, keepalive or
+	 * timeout. 0 after an error, -1 while offline
+	 */
+	int64 NextUpdate();
+
 	int Feed(CNetPacketConstruct *pPacket, NETADDR *pAddr);
 	int QueueChunk(int Flags, int DataSize, const void *pData);
 
+	/**
+	 * Whether chunks waiting for their ack refer to static data in the range
+	 */
+	bool RefersTo(const void *pData, int Size);
+
 	const char *ErrorString();
 	void SignalResend();
 	int State() const { return m_State; }
@@ -192,6 +244,14 @@ public:
 	int64 ConnectTime() const { return m_LastUpdateTime; }
 
 	int AckSequence() const { return m_Ack; }
+	int SecurityToken() const { return m_SecurityToken; }
+
+	// round trip time and its variance in milliseconds, -1 if unknown
+	int Rtt() const { return m_Srtt < 0 ? -1 : (int)(m_Srtt*1000/time_freq()); }
+	int RttVar() const { return m_Srtt < 0 ? -1 : (int)(m_RttVar*1000/time_freq()); }
+	int NumVitalChunks() const { return m_NumVitalChunks; }
+	int NumResends() const { return m_NumResends; }
+	int NumUnacked() const { return m_NumUnacked; }
 };
 
 class CConsoleNetConnection
@@ -210,6 +270,15 @@ private:
 	bool m_LineEndingDetected;
 	char m_aLineEnding[3];
 
+	// lines waiting to be sent, Send writes behind m_OutputWrite and Flush
+	// reads behind m_OutputRead, so both can run at the same time
+	char m_aOutput[NET_CONSOLE_OUTPUT_SIZE];
+	volatile unsigned m_OutputRead;
+	volatile unsigned m_OutputWrite;
+	int m_NumDropped;
+
+	void QueueOutput(const char *pData, int Size);
+
 public:
 	void Init(NETSOCKET Socket, const NETADDR *pAddr);
 	void Disconnect(const char *pReason);
@@ -217,10 +286,18 @@ public:
 	int State() const { return m_State; }
 	const NETADDR *PeerAddress() const { return &m_PeerAddr; }
 	const char *ErrorString() const { return m_aErrorString; }
+	NETSOCKET Socket() const { return m_Socket; }
+	bool HasOutput() const { return m_OutputRead != m_OutputWrite; }
 
 	void Reset();
 	int Update();
+
+	/**
+	 * Queues the line, it gets dropped if the client does not keep up.
+	 * The next line that fits tells how many got dropped
+	 */
 	int Send(const char *pLine);
+	int Flush();
 	int Recv(char *pLine, int MaxLength);
 };
 
@@ -250,6 +327,7 @@ public:
 	{
 	public:
 		CNetConnection m_Connection;
+		CTimerWheel::CTimer m_Timer;
 	};
 
 	NETSOCKET m_Socket;
@@ -258,12 +336,29 @@ public:
 	int m_MaxClients;
 	int m_MaxClientsPerIP;
 
+	// slots are only updated when their next deadline is due
+	CTimerWheel m_Timers;
+	int64 m_UpdateTime;
+
+	// the token secret changes every now and then, the previous one stays valid
+	unsigned m_aaSecret[2][4];
+	int64 m_SecretTime;
+
 	NETFUNC_NEWCLIENT m_pfnNewClient;
 	NETFUNC_DELCLIENT m_pfnDelClient;
 	void *m_UserPtr;
 
 	CNetRecvUnpacker m_RecvUnpacker;
 
+	void NewSecret(unsigned *pSecret);
+	static unsigned MixSecurityToken(unsigned Hash, unsigned Value);
+	int GetSecurityToken(const NETADDR *pAddr, int Secret) const;
+	bool IsValidSecurityToken(const NETADDR *pAddr, int SecurityToken) const;
+	int GetClientSlot(const NETADDR *pAddr) const;
+	int TryAcceptClient(NETADDR *pAddr, int SecurityToken);
+	void ScheduleSlot(int Slot);
+	static void UpdateSlot(CTimerWheel::CTimer *pTimer, void *pUser);
+
 public:
 	int SetCallbacks(NETFUNC_NEWCLIENT pfnNewClient, NETFUNC_DELCLIENT pfnDelClient, void *pUser);
 
@@ -281,6 +376,8 @@ public:
 
 	// status requests
 	const NETADDR *ClientAddr(int ClientID) const { return m_aSlots[ClientID].m_Connection.PeerAddress(); }
+	const CNetConnection *ClientConnection(int ClientID) const { return &m_aSlots[ClientID].m_Connection; }
+	bool RefersTo(const void *pData, int Size);
 	NETSOCKET Socket() const { return m_Socket; }
 	class CNetBan *NetBan() const { return m_pNetBan; }
 	int NetType() const { return m_Socket.type; }
@@ -290,16 +387,24 @@ public:
 	void SetMaxClientsPerIP(int Max);
 };
 
+/*
+	The console network is driven by an own thread: Update, Recv, Drop
+	and Wait run there. Send may be called by another thread, the output
+	lock keeps it from writing to a slot that is being reused. A slot
+	gets a new generation whenever a client takes it.
+*/
 class CNetConsole
 {
 	struct CSlot
 	{
 		CConsoleNetConnection m_Connection;
+		unsigned m_Generation;
 	};
 
 	NETSOCKET m_Socket;
 	class CNetBan *m_pNetBan;
 	CSlot m_aSlots[NET_MAX_CONSOLE_CLIENTS];
+	LOCK m_OutputLock;
 
 	NETFUNC_NEWCLIENT m_pfnNewClient;
 	NETFUNC_DELCLIENT m_pfnDelClient;
@@ -316,15 +421,21 @@ public:
 
 	//
 	int Recv(char *pLine, int MaxLength, int *pClientID = 0);
-	int Send(int ClientID, const char *pLine);
+	int Send(int ClientID, unsigned Generation, const char *pLine);
 	int Update();
 
+	/**
+	 * Waits until a socket is readable or pending output can be sent
+	 */
+	void Wait(int Time);
+
 	//
 	int AcceptClient(NETSOCKET Socket, const NETADDR *pAddr);
 	int Drop(int ClientID, const char *pReason);
 
 	// status requests
 	const NETADDR *ClientAddr(int ClientID) const { return m_aSlots[ClientID].m_Connection.PeerAddress(); }
+	unsigned ClientGeneration(int ClientID) const { return m_aSlots[ClientID].m_Generation; }
 	class CNetBan *NetBan() const { return m_pNetBan; }
 };
 
@@ -368,21 +479,34 @@ public:
 // TODO: both, fix these. This feels like a junk class for stuff that doesn't fit anywere
 class CNetBase
 {
-	static IOHANDLE ms_DataLogSent;
-	static IOHANDLE ms_DataLogRecv;
+	static class CNetCapture ms_Capture;
+	static class CNetReplay *ms_pReplay;
 	static CHuffman ms_Huffman;
+
+	static void SendRaw(NETSOCKET Socket, NETADDR *pAddr, const void *pData, int DataSize);
 public:
-	static void OpenLog(IOHANDLE DataLogSent, IOHANDLE DataLogRecv);
+	static void OpenLog(IOHANDLE Capture);
 	static void CloseLog();
+
+	// while a replay runs the packets come from it and nothing gets sent
+	static void SetReplay(class CNetReplay *pReplay) { ms_pReplay = pReplay; }
+	static bool Replaying() { return ms_pReplay != 0; }
+	static int RecvPacket(NETSOCKET Socket, NETADDR *pAddr, unsigned char *pBuffer, int MaxSize);
+
 	static void Init();
 	static int Compress(const void *pData, int DataSize, void *pOutput, int OutputSize);
 	static int Decompress(const void *pData, int DataSize, void *pOutput, int OutputSize);
 
-	static void SendControlMsg(NETSOCKET Socket, NETADDR *pAddr, int Ack, int ControlMsg, const void *pExtra, int ExtraSize);
+	static void SendControlMsg(NETSOCKET Socket, NETADDR *pAddr, int Ack, int ControlMsg, const void *pExtra, int ExtraSize, int SecurityToken = NET_SECURITY_TOKEN_UNSUPPORTED);
 	static void SendPacketConnless(NETSOCKET Socket, NETADDR *pAddr, const void *pData, int DataSize);
-	static void SendPacket(NETSOCKET Socket, NETADDR *pAddr, CNetPacketConstruct *pPacket);
+	static void SendPacket(NETSOCKET Socket, NETADDR *pAddr, CNetPacketConstruct *pPacket, int SecurityToken = NET_SECURITY_TOKEN_UNSUPPORTED);
 	static int UnpackPacket(unsigned char *pBuffer, int Size, CNetPacketConstruct *pPacket);
 
+	static int ReadSecurityToken(const unsigned char *pData) { return pData[0] | (pData[1]<<8) | (pData[2]<<16) | (pData[3]<<24); }
+	static void WriteSecurityToken(unsigned char *pData, int SecurityToken);
+	// checks and removes the token at the end of the packet data
+	static bool StripSecurityToken(CNetPacketConstruct *pPacket, int SecurityToken);
+
 	// The backroom is ack-NET_MAX_SEQUENCE/2. Used for knowing if we acked a packet or not
 	static int IsSeqInBackroom(int Seq, int Ack);
 };
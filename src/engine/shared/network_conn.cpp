@@ -1,5 +1,6 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
 #include <base/system.h>
 #include "config.h"
 #include "network.h"
@@ -19,7 +20,14 @@ void CNetConnection::Reset()
 	m_LastSendTime = 0;
 	m_LastRecvTime = 0;
 	m_LastUpdateTime = 0;
+	m_Srtt = -1;
+	m_RttVar = 0;
+	m_RtoBackoff = 0;
+	m_NumVitalChunks = 0;
+	m_NumResends = 0;
+	m_NumUnacked = 0;
 	m_Token = -1;
+	m_SecurityToken = NET_SECURITY_TOKEN_UNSUPPORTED;
 	mem_zero(&m_PeerAddr, sizeof(m_PeerAddr));
 
 	m_Buffer.Init();
@@ -49,6 +57,8 @@ void CNetConnection::Init(NETSOCKET Socket, bool BlockCloseMsg)
 
 void CNetConnection::AckChunks(int Ack)
 {
+	int64 Now = time_get();
+	int64 Rtt = -1;
 	while(1)
 	{
 		CNetChunkResend *pResend = m_Buffer.First();
@@ -56,10 +66,43 @@ void CNetConnection::AckChunks(int Ack)
 			break;
 
 		if(CNetBase::IsSeqInBackroom(pResend->m_Sequence, Ack))
+		{
+			// a resent chunk doesn't tell which of the sends got acked
+			if(pResend->m_LastSendTime == pResend->m_FirstSendTime)
+				Rtt = Now - pResend->m_FirstSendTime;
 			m_Buffer.PopFirst();
+			m_NumUnacked--;
+		}
 		else
 			break;
 	}
+
+	if(Rtt >= 0)
+		UpdateRtt(Rtt);
+}
+
+void CNetConnection::UpdateRtt(int64 Rtt)
+{
+	// same smoothing as tcp (rfc 6298)
+	if(m_Srtt < 0)
+	{
+		m_Srtt = Rtt;
+		m_RttVar = Rtt/2;
+	}
+	else
+	{
+		m_RttVar = (3*m_RttVar + absolute(m_Srtt - Rtt))/4;
+		m_Srtt = (7*m_Srtt + Rtt)/8;
+	}
+	m_RtoBackoff = 0;
+}
+
+int64 CNetConnection::Rto() const
+{
+	// one second until the first ack, doubled for every timeout in a row
+	int64 Rto = m_Srtt < 0 ? time_freq() : m_Srtt + max(time_freq()/100, 4*m_RttVar);
+	Rto = max(Rto, time_freq()*NET_RTO_MIN/1000) << m_RtoBackoff;
+	return min(Rto, time_freq()*NET_RTO_MAX/1000);
 }
 
 void CNetConnection::SignalResend()
@@ -75,7 +118,7 @@ int CNetConnection::Flush()
 
 	// send of the packets
 	m_Construct.m_Ack = m_Ack;
-	CNetBase::SendPacket(m_Socket, &m_PeerAddr, &m_Construct);
+	CNetBase::SendPacket(m_Socket, &m_PeerAddr, &m_Construct, m_SecurityToken);
 
 	// update send times
 	m_LastSendTime = time_get();
@@ -89,8 +132,8 @@ int CNetConnection::QueueChunkEx(int Flags, int DataSize, const void *pData, int
 {
 	unsigned char *pChunkData;
 
-	// check if we have space for it, if not, flush the connection
-	if(m_Construct.m_DataSize + DataSize + NET_MAX_CHUNKHEADERSIZE > (int)sizeof(m_Construct.m_aChunkData))
+	// check if we have space for it and the security token, if not, flush the connection
+	if(m_Construct.m_DataSize + DataSize + NET_MAX_CHUNKHEADERSIZE > (int)sizeof(m_Construct.m_aChunkData) - NET_SECURITY_TOKEN_SIZE)
 		Flush();
 
 	// pack all the data
@@ -111,17 +154,25 @@ int CNetConnection::QueueChunkEx(int Flags, int DataSize, const void *pData, int
 
 	if(Flags&NET_CHUNKFLAG_VITAL && !(Flags&NET_CHUNKFLAG_RESEND))
 	{
-		// save packet if we need to resend
-		CNetChunkResend *pResend = m_Buffer.Allocate(sizeof(CNetChunkResend)+DataSize);
+		// save packet if we need to resend, static data is only referred to
+		bool Static = Flags&NET_CHUNKFLAG_STATIC;
+		CNetChunkResend *pResend = m_Buffer.Allocate(sizeof(CNetChunkResend)+(Static ? 0 : DataSize));
 		if(pResend)
 		{
 			pResend->m_Sequence = Sequence;
 			pResend->m_Flags = Flags;
 			pResend->m_DataSize = DataSize;
-			pResend->m_pData = (unsigned char *)(pResend+1);
 			pResend->m_FirstSendTime = time_get();
 			pResend->m_LastSendTime = pResend->m_FirstSendTime;
-			mem_copy(pResend->m_pData, pData, DataSize);
+			if(Static)
+				pResend->m_pData = (unsigned char *)pData;
+			else
+			{
+				pResend->m_pData = (unsigned char *)(pResend+1);
+				mem_copy(pResend->m_pData, pData, DataSize);
+			}
+			m_NumVitalChunks++;
+			m_NumUnacked++;
 		}
 		else
 		{
@@ -141,17 +192,36 @@ int CNetConnection::QueueChunk(int Flags, int DataSize, const void *pData)
 	return QueueChunkEx(Flags, DataSize, pData, m_Sequence);
 }
 
+bool CNetConnection::RefersTo(const void *pData, int Size)
+{
+	const unsigned char *pStart = (const unsigned char *)pData;
+	for(CNetChunkResend *pResend = m_Buffer.First(); pResend; pResend = m_Buffer.Next(pResend))
+		if(pResend->m_Flags&NET_CHUNKFLAG_STATIC && pResend->m_pData >= pStart && pResend->m_pData < pStart+Size)
+			return true;
+	return false;
+}
+
 void CNetConnection::SendControl(int ControlMsg, const void *pExtra, int ExtraSize)
 {
 	// send the control message
 	m_LastSendTime = time_get();
-	CNetBase::SendControlMsg(m_Socket, &m_PeerAddr, m_Ack, ControlMsg, pExtra, ExtraSize);
+	CNetBase::SendControlMsg(m_Socket, &m_PeerAddr, m_Ack, ControlMsg, pExtra, ExtraSize, m_SecurityToken);
+}
+
+void CNetConnection::SendConnect()
+{
+	// ask for a security token, the padding makes the request at least as large as the answer
+	unsigned char aRequest[NET_TOKENREQUEST_DATASIZE];
+	mem_zero(aRequest, sizeof(aRequest));
+	mem_copy(aRequest, SECURITY_TOKEN_MAGIC, sizeof(SECURITY_TOKEN_MAGIC));
+	SendControl(NET_CTRLMSG_CONNECT, aRequest, sizeof(aRequest));
 }
 
 void CNetConnection::ResendChunk(CNetChunkResend *pResend)
 {
 	QueueChunkEx(pResend->m_Flags|NET_CHUNKFLAG_RESEND, pResend->m_DataSize, pResend->m_pData, pResend->m_Sequence);
 	pResend->m_LastSendTime = time_get();
+	m_NumResends++;
 }
 
 void CNetConnection::Resend()
@@ -170,10 +240,25 @@ int CNetConnection::Connect(NETADDR *pAddr)
 	m_PeerAddr = *pAddr;
 	mem_zero(m_ErrorString, sizeof(m_ErrorString));
 	m_State = NET_CONNSTATE_CONNECT;
-	SendControl(NET_CTRLMSG_CONNECT, 0, 0);
+	m_SecurityToken = NET_SECURITY_TOKEN_UNKNOWN;
+	SendConnect();
 	return 0;
 }
 
+void CNetConnection::DirectInit(const NETADDR *pAddr, int SecurityToken)
+{
+	// the client proved its address with the token, there is no handshake left
+	Reset();
+	int64 Now = time_get();
+	m_State = NET_CONNSTATE_ONLINE;
+	m_PeerAddr = *pAddr;
+	mem_zero(m_ErrorString, sizeof(m_ErrorString));
+	m_LastSendTime = Now;
+	m_LastRecvTime = Now;
+	m_LastUpdateTime = Now;
+	m_SecurityToken = SecurityToken;
+}
+
 void CNetConnection::Disconnect(const char *pReason)
 {
 	if(State() == NET_CONNSTATE_OFFLINE)
@@ -198,6 +283,15 @@ int CNetConnection::Feed(CNetPacketConstruct *pPacket, NETADDR *pAddr)
 {
 	int64 Now = time_get();
 
+	// packets of a token connection have to end with the token
+	if(m_SecurityToken != NET_SECURITY_TOKEN_UNKNOWN && m_SecurityToken != NET_SECURITY_TOKEN_UNSUPPORTED &&
+		!CNetBase::StripSecurityToken(pPacket, m_SecurityToken))
+	{
+		if(g_Config.m_Debug)
+			dbg_msg("connection", "dropped packet with a wrong security token");
+		return 0;
+	}
+
 	// check if resend is requested
 	if(pPacket->m_Flags&NET_PACKETFLAG_RESEND)
 		Resend();
@@ -260,6 +354,17 @@ int CNetConnection::Feed(CNetPacketConstruct *pPacket, NETADDR *pAddr)
 				// connection made
 				if(CtrlMsg == NET_CTRLMSG_CONNECTACCEPT)
 				{
+					// servers without security tokens answer without the magic
+					if(m_SecurityToken == NET_SECURITY_TOKEN_UNKNOWN)
+					{
+						if(pPacket->m_DataSize >= 1+(int)sizeof(SECURITY_TOKEN_MAGIC)+NET_SECURITY_TOKEN_SIZE &&
+							mem_comp(&pPacket->m_aChunkData[1], SECURITY_TOKEN_MAGIC, sizeof(SECURITY_TOKEN_MAGIC)) == 0)
+							m_SecurityToken = CNetBase::ReadSecurityToken(&pPacket->m_aChunkData[1+sizeof(SECURITY_TOKEN_MAGIC)]);
+						else
+							m_SecurityToken = NET_SECURITY_TOKEN_UNSUPPORTED;
+						if(g_Config.m_Debug)
+							dbg_msg("connection", "security token %s", m_SecurityToken != NET_SECURITY_TOKEN_UNSUPPORTED ? "received" : "not supported by the server");
+					}
 					m_LastRecvTime = Now;
 					SendControl(NET_CTRLMSG_ACCEPT, 0, 0);
 					m_State = NET_CONNSTATE_ONLINE;
@@ -291,8 +396,11 @@ int CNetConnection::Feed(CNetPacketConstruct *pPacket, NETADDR *pAddr)
 
 int CNetConnection::Update()
 {
-	int64 Now = time_get();
+	return Update(time_get());
+}
 
+int CNetConnection::Update(int64 Now)
+{
 	if(State() == NET_CONNSTATE_OFFLINE || State() == NET_CONNSTATE_ERROR)
 		return 0;
 
@@ -318,35 +426,82 @@ int CNetConnection::Update()
 		}
 		else
 		{
-			// resend packet if we havn't got it acked in 1 second
-			if(Now-pResend->m_LastSendTime > time_freq())
-				ResendChunk(pResend);
+			// resend everything that wasn't acked in time together
+			int64 Rto = this->Rto();
+			bool Resent = false;
+			for(; pResend; pResend = m_Buffer.Next(pResend))
+			{
+				if(Now-pResend->m_LastSendTime > Rto)
+				{
+					ResendChunk(pResend);
+					Resent = true;
+				}
+			}
+
+			if(Resent)
+			{
+				Flush();
+				if(m_RtoBackoff < NET_RTO_MAX_BACKOFF)
+					m_RtoBackoff++;
+			}
 		}
 	}
 
 	// send keep alives if nothing has happend for 250ms
 	if(State() == NET_CONNSTATE_ONLINE)
 	{
-		if(time_get()-m_LastSendTime > time_freq()/2) // flush connection after 500ms if needed
+		if(Now-m_LastSendTime > time_freq()/2) // flush connection after 500ms if needed
 		{
 			int NumFlushedChunks = Flush();
 			if(NumFlushedChunks && g_Config.m_Debug)
 				dbg_msg("connection", "flushed connection due to timeout. %d chunks.", NumFlushedChunks);
 		}
 
-		if(time_get()-m_LastSendTime > time_freq())
+		if(Now-m_LastSendTime > time_freq())
 			SendControl(NET_CTRLMSG_KEEPALIVE, 0, 0);
 	}
 	else if(State() == NET_CONNSTATE_CONNECT)
 	{
-		if(time_get()-m_LastSendTime > time_freq()/2) // send a new connect every 500ms
-			SendControl(NET_CTRLMSG_CONNECT, 0, 0);
+		if(Now-m_LastSendTime > time_freq()/2) // send a new connect every 500ms
+			SendConnect();
 	}
 	else if(State() == NET_CONNSTATE_PENDING)
 	{
-		if(time_get()-m_LastSendTime > time_freq()/2) // send a new connect/accept every 500ms
+		if(Now-m_LastSendTime > time_freq()/2) // send a new connect/accept every 500ms
 			SendControl(NET_CTRLMSG_CONNECTACCEPT, 0, 0);
 	}
 
 	return 0;
 }
+
+int64 CNetConnection::NextUpdate()
+{
+	if(State() == NET_CONNSTATE_OFFLINE)
+		return -1;
+	if(State() == NET_CONNSTATE_ERROR)
+		return 0;
+
+	// the same deadlines Update checks
+	int64 Next;
+	if(State() == NET_CONNSTATE_CONNECT)
+		Next = m_LastSendTime + time_freq()/2;
+	else
+	{
+		Next = m_LastRecvTime + time_freq()*10;
+		if(State() == NET_CONNSTATE_PENDING || m_Construct.m_NumChunks || m_Construct.m_Flags)
+			Next = min(Next, m_LastSendTime + time_freq()/2);
+		if(State() == NET_CONNSTATE_ONLINE)
+			Next = min(Next, m_LastSendTime + time_freq());
+	}
+
+	CNetChunkResend *pResend = m_Buffer.First();
+	if(pResend)
+	{
+		Next = min(Next, pResend->m_FirstSendTime + time_freq()*10);
+		int64 Rto = this->Rto();
+		for(; pResend; pResend = m_Buffer.Next(pResend))
+			Next = min(Next, pResend->m_LastSendTime + Rto);
+	}
+
+	return Next;
+}
@@ -27,6 +27,7 @@ bool CNetConsole::Open(NETADDR BindAddr, CNetBan *pNetBan, int Flags)
 
 	for(int i = 0; i < NET_MAX_CONSOLE_CLIENTS; i++)
 		m_aSlots[i].m_Connection.Reset();
+	m_OutputLock = lock_create();
 
 	return true;
 }
@@ -40,20 +41,28 @@ void CNetConsole::SetCallbacks(NETFUNC_NEWCLIENT pfnNewClient, NETFUNC_DELCLIENT
 
 int CNetConsole::Close()
 {
+	lock_wait(m_OutputLock);
 	for(int i = 0; i < NET_MAX_CONSOLE_CLIENTS; i++)
 		m_aSlots[i].m_Connection.Disconnect("closing console");
+	lock_release(m_OutputLock);
 
 	net_tcp_close(m_Socket);
+	lock_destroy(m_OutputLock);
 
 	return 0;
 }
 
 int CNetConsole::Drop(int ClientID, const char *pReason)
 {
+	if(m_aSlots[ClientID].m_Connection.State() == NET_CONNSTATE_OFFLINE)
+		return 0;
+
 	if(m_pfnDelClient)
 		m_pfnDelClient(ClientID, pReason, m_UserPtr);
 
+	lock_wait(m_OutputLock);
 	m_aSlots[ClientID].m_Connection.Disconnect(pReason);
+	lock_release(m_OutputLock);
 
 	return 0;
 }
@@ -81,7 +90,10 @@ int CNetConsole::AcceptClient(NETSOCKET Socket, const NETADDR *pAddr)
 	// accept client
 	if(!aError[0] && FreeSlot != -1)
 	{
+		lock_wait(m_OutputLock);
 		m_aSlots[FreeSlot].m_Connection.Init(Socket, pAddr);
+		m_aSlots[FreeSlot].m_Generation++;
+		lock_release(m_OutputLock);
 		if(m_pfnNewClient)
 			m_pfnNewClient(FreeSlot, m_UserPtr);
 		return 0;
@@ -102,24 +114,17 @@ int CNetConsole::Update()
 	NETSOCKET Socket;
 	NETADDR Addr;
 
+	// the ban list belongs to the game thread, the new client callback checks it
 	if(net_tcp_accept(m_Socket, &Socket, &Addr) > 0)
-	{
-		// check if we just should drop the packet
-		char aBuf[128];
-		if(NetBan() && NetBan()->IsBanned(&Addr, aBuf, sizeof(aBuf)))
-		{
-			// banned, reply with a message and drop
-			net_tcp_send(Socket, aBuf, str_length(aBuf));
-			net_tcp_close(Socket);
-		}
-		else
-			AcceptClient(Socket, &Addr);
-	}
+		AcceptClient(Socket, &Addr);
 
 	for(int i = 0; i < NET_MAX_CONSOLE_CLIENTS; i++)
 	{
 		if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_ONLINE)
+		{
 			m_aSlots[i].m_Connection.Update();
+			m_aSlots[i].m_Connection.Flush();
+		}
 		if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_ERROR)
 			Drop(i, m_aSlots[i].m_Connection.ErrorString());
 	}
@@ -141,10 +146,31 @@ int CNetConsole::Recv(char *pLine, int MaxLength, int *pClientID)
 	return 0;
 }
 
-int CNetConsole::Send(int ClientID, const char *pLine)
+void CNetConsole::Wait(int Time)
+{
+	NETSOCKET aSockets[NET_MAX_CONSOLE_CLIENTS+1];
+	int aWrite[NET_MAX_CONSOLE_CLIENTS+1];
+	int Num = 0;
+
+	aSockets[Num] = m_Socket;
+	aWrite[Num++] = 0;
+	for(int i = 0; i < NET_MAX_CONSOLE_CLIENTS; i++)
+	{
+		if(m_aSlots[i].m_Connection.State() != NET_CONNSTATE_ONLINE)
+			continue;
+		aSockets[Num] = m_aSlots[i].m_Connection.Socket();
+		aWrite[Num++] = m_aSlots[i].m_Connection.HasOutput();
+	}
+
+	net_socket_wait(aSockets, aWrite, Num, Time);
+}
+
+int CNetConsole::Send(int ClientID, unsigned Generation, const char *pLine)
 {
-	if(m_aSlots[ClientID].m_Connection.State() == NET_CONNSTATE_ONLINE)
-		return m_aSlots[ClientID].m_Connection.Send(pLine);
-	else
-		return -1;
+	int Result = -1;
+	lock_wait(m_OutputLock);
+	if(m_aSlots[ClientID].m_Generation == Generation && m_aSlots[ClientID].m_Connection.State() == NET_CONNSTATE_ONLINE)
+		Result = m_aSlots[ClientID].m_Connection.Send(pLine);
+	lock_release(m_OutputLock);
+	return Result;
 }
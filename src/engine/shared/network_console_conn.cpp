@@ -1,6 +1,8 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
 #include <base/system.h>
+#include <base/tl/threading.h>
 #include "network.h"
 
 void CConsoleNetConnection::Reset()
@@ -14,6 +16,9 @@ void CConsoleNetConnection::Reset()
 	m_Socket.ipv6sock = -1;
 	m_aBuffer[0] = 0;
 	m_BufferOffset = 0;
+	m_OutputRead = 0;
+	m_OutputWrite = 0;
+	m_NumDropped = 0;
 
 	m_LineEndingDetected = false;
 	#if defined(CONF_FAMILY_WINDOWS)
@@ -45,6 +50,7 @@ void CConsoleNetConnection::Disconnect(const char *pReason)
 
 	if(pReason && pReason[0])
 		Send(pReason);
+	Flush();
 
 	net_tcp_close(m_Socket);
 
@@ -151,6 +157,17 @@ int CConsoleNetConnection::Recv(char *pLine, int MaxLength)
 	return 0;
 }
 
+void CConsoleNetConnection::QueueOutput(const char *pData, int Size)
+{
+	unsigned Write = m_OutputWrite;
+	int Offset = Write % NET_CONSOLE_OUTPUT_SIZE;
+	int Part = min(Size, NET_CONSOLE_OUTPUT_SIZE - Offset);
+	mem_copy(&m_aOutput[Offset], pData, Part);
+	mem_copy(m_aOutput, pData + Part, Size - Part);
+	sync_barrier();
+	m_OutputWrite = Write + Size;
+}
+
 int CConsoleNetConnection::Send(const char *pLine)
 {
 	if(State() != NET_CONNSTATE_ONLINE)
@@ -163,23 +180,56 @@ int CConsoleNetConnection::Send(const char *pLine)
 	aBuf[Length+1] = m_aLineEnding[1];
 	aBuf[Length+2] = m_aLineEnding[2];
 	Length += 3;
-	const char *pData = aBuf;
 
-	while(true)
+	// a client that does not keep up loses lines instead of holding up the server
+	char aSummary[64];
+	int SummaryLength = 0;
+	if(m_NumDropped)
+	{
+		str_format(aSummary, (int)(sizeof(aSummary))-3, "-- %d lines dropped --", m_NumDropped);
+		SummaryLength = str_length(aSummary);
+		mem_copy(&aSummary[SummaryLength], m_aLineEnding, 3);
+		SummaryLength += 3;
+	}
+
+	if(SummaryLength + Length > NET_CONSOLE_OUTPUT_SIZE - (int)(m_OutputWrite - m_OutputRead))
+	{
+		m_NumDropped++;
+		return -1;
+	}
+
+	if(SummaryLength)
+		QueueOutput(aSummary, SummaryLength);
+	QueueOutput(aBuf, Length);
+	m_NumDropped = 0;
+	return 0;
+}
+
+int CConsoleNetConnection::Flush()
+{
+	// everything queued so far goes out with as few sends as possible
+	while(State() == NET_CONNSTATE_ONLINE && HasOutput())
 	{
-		int Send = net_tcp_send(m_Socket, pData, Length);
-		if(Send < 0)
+		unsigned Read = m_OutputRead;
+		int Offset = Read % NET_CONSOLE_OUTPUT_SIZE;
+		int Size = min((int)(m_OutputWrite - Read), NET_CONSOLE_OUTPUT_SIZE - Offset);
+		sync_barrier();
+
+		int Sent = net_tcp_send(m_Socket, &m_aOutput[Offset], Size);
+		if(Sent < 0)
 		{
+			if(net_would_block())
+				return 0;
+
 			m_State = NET_CONNSTATE_ERROR;
 			str_copy(m_aErrorString, "failed to send packet", sizeof(m_aErrorString));
 			return -1;
 		}
 
-		if(Send >= Length)
-			break;
-
-		pData += Send;
-		Length -= Send;
+		sync_barrier();
+		m_OutputRead = Read + Sent;
+		if(Sent < Size)
+			return 0;
 	}
 
 	return 0;
@@ -4,6 +4,7 @@
 
 #include <engine/console.h>
 
+#include "config.h"
 #include "netban.h"
 #include "network.h"
 
@@ -28,8 +29,17 @@ bool CNetServer::Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int Ma
 
 	m_MaxClientsPerIP = MaxClientsPerIP;
 
+	mem_zero(m_aaSecret, sizeof(m_aaSecret));
+	NewSecret(m_aaSecret[0]);
+	NewSecret(m_aaSecret[1]);
+	m_SecretTime = time_get();
+
+	m_Timers.Init(time_get());
 	for(int i = 0; i < NET_MAX_CLIENTS; i++)
+	{
 		m_aSlots[i].m_Connection.Init(m_Socket, true);
+		m_aSlots[i].m_Timer.m_ID = i;
+	}
 
 	return true;
 }
@@ -62,26 +72,160 @@ int CNetServer::Drop(int ClientID, const char *pReason)
 		m_pfnDelClient(ClientID, pReason, m_UserPtr);
 
 	m_aSlots[ClientID].m_Connection.Disconnect(pReason);
+	ScheduleSlot(ClientID);
 
 	return 0;
 }
 
+void CNetServer::ScheduleSlot(int Slot)
+{
+	CSlot *pSlot = &m_aSlots[Slot];
+	int64 Next = pSlot->m_Connection.NextUpdate();
+	if(Next < 0)
+		m_Timers.Cancel(&pSlot->m_Timer);
+	else if(!pSlot->m_Timer.Scheduled() || Next < m_Timers.ExpireTime(&pSlot->m_Timer))
+		m_Timers.Schedule(&pSlot->m_Timer, Next);
+}
+
+void CNetServer::UpdateSlot(CTimerWheel::CTimer *pTimer, void *pUser)
+{
+	CNetServer *pThis = (CNetServer *)pUser;
+	int Slot = pTimer->m_ID;
+	CNetConnection *pConnection = &pThis->m_aSlots[Slot].m_Connection;
+
+	pConnection->Update(pThis->m_UpdateTime);
+	if(pConnection->State() == NET_CONNSTATE_ERROR)
+	{
+		if(pThis->m_UpdateTime - pConnection->ConnectTime() < time_freq() && pThis->NetBan())
+			pThis->NetBan()->BanAddr(pThis->ClientAddr(Slot), 60, "Stressing network");
+		else
+			pThis->Drop(Slot, pConnection->ErrorString());
+	}
+	pThis->ScheduleSlot(Slot);
+}
+
 int CNetServer::Update()
 {
 	int64 Now = time_get();
+	m_UpdateTime = Now;
+
+	// tokens stay valid for one to two minutes
+	if(Now - m_SecretTime > time_freq()*60)
+	{
+		mem_copy(m_aaSecret[1], m_aaSecret[0], sizeof(m_aaSecret[1]));
+		NewSecret(m_aaSecret[0]);
+		m_SecretTime = Now;
+	}
+	// only the connections with a due deadline
+	m_Timers.Advance(Now, UpdateSlot, this);
+
+	return 0;
+}
+
+void CNetServer::NewSecret(unsigned *pSecret)
+{
+	IOHANDLE File = io_open("/dev/urandom", IOFLAG_READ);
+	if(File)
+	{
+		bool Read = io_read(File, pSecret, sizeof(m_aaSecret[0])) == sizeof(m_aaSecret[0]);
+		io_close(File);
+		if(Read)
+			return;
+	}
+
+	// no random source, at least make it hard to guess
+	int64 Now = time_get();
+	for(int i = 0; i < 4; i++)
+		pSecret[i] = MixSecurityToken(pSecret[i] ^ m_aaSecret[1][i], (unsigned)(Now>>(i*8)) ^ (unsigned)(Now>>32));
+}
+
+unsigned CNetServer::MixSecurityToken(unsigned Hash, unsigned Value)
+{
+	Hash ^= Value;
+	Hash *= 0x5bd1e995;
+	Hash ^= Hash>>15;
+	Hash *= 0x27d4eb2d;
+	return Hash ^ (Hash>>13);
+}
+
+int CNetServer::GetSecurityToken(const NETADDR *pAddr, int Secret) const
+{
+	const unsigned *pSecret = m_aaSecret[Secret];
+	unsigned Hash = MixSecurityToken(pSecret[0], pAddr->type ^ pSecret[1]);
+	for(int i = 0; i < 16; i += 4)
+		Hash = MixSecurityToken(Hash, ((pAddr->ip[i]<<24) | (pAddr->ip[i+1]<<16) | (pAddr->ip[i+2]<<8) | pAddr->ip[i+3]) ^ pSecret[1+i/4%3]);
+	Hash = MixSecurityToken(Hash ^ pSecret[3], pAddr->port ^ pSecret[2]);
+
+	// both values have a special meaning
+	int SecurityToken = (int)Hash;
+	if(SecurityToken == NET_SECURITY_TOKEN_UNKNOWN || SecurityToken == NET_SECURITY_TOKEN_UNSUPPORTED)
+		SecurityToken = 1;
+	return SecurityToken;
+}
+
+bool CNetServer::IsValidSecurityToken(const NETADDR *pAddr, int SecurityToken) const
+{
+	// the server that made the capture handed out the tokens
+	if(CNetBase::Replaying())
+		return SecurityToken != NET_SECURITY_TOKEN_UNKNOWN && SecurityToken != NET_SECURITY_TOKEN_UNSUPPORTED;
+	return SecurityToken == GetSecurityToken(pAddr, 0) || SecurityToken == GetSecurityToken(pAddr, 1);
+}
+
+int CNetServer::GetClientSlot(const NETADDR *pAddr) const
+{
+	for(int i = 0; i < MaxClients(); i++)
+	{
+		if(m_aSlots[i].m_Connection.State() != NET_CONNSTATE_OFFLINE &&
+			net_addr_comp(m_aSlots[i].m_Connection.PeerAddress(), pAddr) == 0)
+			return i;
+	}
+	return -1;
+}
+
+int CNetServer::TryAcceptClient(NETADDR *pAddr, int SecurityToken)
+{
+	// only allow a specific number of players with the same ip
+	NETADDR ThisAddr = *pAddr, OtherAddr;
+	int FoundAddr = 1;
+	ThisAddr.port = 0;
+	for(int i = 0; i < MaxClients(); ++i)
+	{
+		if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_OFFLINE)
+			continue;
+
+		OtherAddr = *m_aSlots[i].m_Connection.PeerAddress();
+		OtherAddr.port = 0;
+		if(!net_addr_comp(&ThisAddr, &OtherAddr))
+		{
+			if(FoundAddr++ >= m_MaxClientsPerIP)
+			{
+				char aBuf[128];
+				str_format(aBuf, sizeof(aBuf), "Only %d players with the same IP are allowed", m_MaxClientsPerIP);
+				CNetBase::SendControlMsg(m_Socket, pAddr, 0, NET_CTRLMSG_CLOSE, aBuf, sizeof(aBuf), SecurityToken);
+				return -1;
+			}
+		}
+	}
+
 	for(int i = 0; i < MaxClients(); i++)
 	{
-		m_aSlots[i].m_Connection.Update();
-		if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_ERROR)
+		if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_OFFLINE)
 		{
-			if(Now - m_aSlots[i].m_Connection.ConnectTime() < time_freq() && NetBan())
-				NetBan()->BanAddr(ClientAddr(i), 60, "Stressing network");
+			// vanilla clients still do the connect+accept handshake
+			if(SecurityToken == NET_SECURITY_TOKEN_UNSUPPORTED)
+				m_aSlots[i].m_Connection.Feed(&m_RecvUnpacker.m_Data, pAddr);
 			else
-				Drop(i, m_aSlots[i].m_Connection.ErrorString());
+				m_aSlots[i].m_Connection.DirectInit(pAddr, SecurityToken);
+			ScheduleSlot(i);
+			if(m_pfnNewClient)
+				m_pfnNewClient(i, m_UserPtr);
+			return i;
 		}
 	}
 
-	return 0;
+	const char FullMsg[] = "This server is full";
+	CNetBase::SendControlMsg(m_Socket, pAddr, 0, NET_CTRLMSG_CLOSE, FullMsg, sizeof(FullMsg), SecurityToken);
+	return -1;
 }
 
 /*
@@ -98,7 +242,7 @@ int CNetServer::Recv(CNetChunk *pChunk)
 			return 1;
 
 		// TODO: empty the recvinfo
-		int Bytes = net_udp_recv(m_Socket, &Addr, m_RecvUnpacker.m_aBuffer, NET_MAX_PACKETSIZE);
+		int Bytes = CNetBase::RecvPacket(m_Socket, &Addr, m_RecvUnpacker.m_aBuffer, NET_MAX_PACKETSIZE);
 
 		// no more packets for now
 		if(Bytes <= 0)
@@ -127,81 +271,52 @@ int CNetServer::Recv(CNetChunk *pChunk)
 			else
 			{
 				// TODO: check size here
-				if(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONTROL && m_RecvUnpacker.m_Data.m_aChunkData[0] == NET_CTRLMSG_CONNECT)
+				CNetPacketConstruct *pData = &m_RecvUnpacker.m_Data;
+				int Slot = GetClientSlot(&Addr);
+				if(pData->m_Flags&NET_PACKETFLAG_CONTROL && pData->m_DataSize && pData->m_aChunkData[0] == NET_CTRLMSG_CONNECT)
 				{
-					bool Found = false;
+					// silent ignore.. we got this client already
+					if(Slot != -1)
+						continue;
 
-					// check if we already got this client
-					for(int i = 0; i < MaxClients(); i++)
+					if(pData->m_DataSize >= 1+(int)sizeof(SECURITY_TOKEN_MAGIC) &&
+						mem_comp(&pData->m_aChunkData[1], SECURITY_TOKEN_MAGIC, sizeof(SECURITY_TOKEN_MAGIC)) == 0)
 					{
-						if(m_aSlots[i].m_Connection.State() != NET_CONNSTATE_OFFLINE &&
-							net_addr_comp(m_aSlots[i].m_Connection.PeerAddress(), &Addr) == 0)
-						{
-							Found = true; // silent ignore.. we got this client already
-							break;
-						}
+						// answer with the token and forget about the client until it sends it back
+						int SecurityToken = GetSecurityToken(&Addr, 0);
+						CNetBase::SendControlMsg(m_Socket, &Addr, 0, NET_CTRLMSG_CONNECTACCEPT, SECURITY_TOKEN_MAGIC, sizeof(SECURITY_TOKEN_MAGIC), SecurityToken);
 					}
-
-					// client that wants to connect
-					if(!Found)
+					else if(g_Config.m_SvVanillaClients)
+						TryAcceptClient(&Addr, NET_SECURITY_TOKEN_UNSUPPORTED);
+					else
 					{
-						// only allow a specific number of players with the same ip
-						NETADDR ThisAddr = Addr, OtherAddr;
-						int FoundAddr = 1;
-						ThisAddr.port = 0;
-						for(int i = 0; i < MaxClients(); ++i)
-						{
-							if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_OFFLINE)
-								continue;
-
-							OtherAddr = *m_aSlots[i].m_Connection.PeerAddress();
-							OtherAddr.port = 0;
-							if(!net_addr_comp(&ThisAddr, &OtherAddr))
-							{
-								if(FoundAddr++ >= m_MaxClientsPerIP)
-								{
-									char aBuf[128];
-									str_format(aBuf, sizeof(aBuf), "Only %d players with the same IP are allowed", m_MaxClientsPerIP);
-									CNetBase::SendControlMsg(m_Socket, &Addr, 0, NET_CTRLMSG_CLOSE, aBuf, sizeof(aBuf));
-									return 0;
-								}
-							}
-						}
-
-						for(int i = 0; i < MaxClients(); i++)
-						{
-							if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_OFFLINE)
-							{
-								Found = true;
-								m_aSlots[i].m_Connection.Feed(&m_RecvUnpacker.m_Data, &Addr);
-								if(m_pfnNewClient)
-									m_pfnNewClient(i, m_UserPtr);
-								
-								break;
-							}
-						}
-
-						if(!Found)
-						{
-							const char FullMsg[] = "This server is full";
-							CNetBase::SendControlMsg(m_Socket, &Addr, 0, NET_CTRLMSG_CLOSE, FullMsg, sizeof(FullMsg));
-						}
+						const char aMsg[] = "This server requires a client with security token support";
+						CNetBase::SendControlMsg(m_Socket, &Addr, 0, NET_CTRLMSG_CLOSE, aMsg, sizeof(aMsg));
 					}
 				}
 				else
 				{
-					// normal packet, find matching slot
-					for(int i = 0; i < MaxClients(); i++)
+					if(Slot == -1)
 					{
-						if(net_addr_comp(m_aSlots[i].m_Connection.PeerAddress(), &Addr) == 0)
-						{
-							if(m_aSlots[i].m_Connection.Feed(&m_RecvUnpacker.m_Data, &Addr))
-							{
-								if(m_RecvUnpacker.m_Data.m_DataSize)
-									m_RecvUnpacker.Start(&Addr, &m_aSlots[i].m_Connection, i);
-							}
-						}
+						// a client that got a token sends it back with its accept or its first packet
+						bool Accept = !(pData->m_Flags&NET_PACKETFLAG_CONTROL) || (pData->m_DataSize && pData->m_aChunkData[0] == NET_CTRLMSG_ACCEPT);
+						if(!Accept || pData->m_DataSize < NET_SECURITY_TOKEN_SIZE)
+							continue;
+						int SecurityToken = CNetBase::ReadSecurityToken(&pData->m_aChunkData[pData->m_DataSize-NET_SECURITY_TOKEN_SIZE]);
+						if(!IsValidSecurityToken(&Addr, SecurityToken))
+							continue;
+						Slot = TryAcceptClient(&Addr, SecurityToken);
+						if(Slot == -1)
+							continue;
 					}
+
+					// normal packet
+					if(m_aSlots[Slot].m_Connection.Feed(pData, &Addr))
+					{
+						if(pData->m_DataSize)
+							m_RecvUnpacker.Start(&Addr, &m_aSlots[Slot].m_Connection, Slot);
+					}
+					ScheduleSlot(Slot);
 				}
 			}
 		}
@@ -230,11 +345,14 @@ int CNetServer::Send(CNetChunk *pChunk)
 
 		if(pChunk->m_Flags&NETSENDFLAG_VITAL)
 			Flags = NET_CHUNKFLAG_VITAL;
+		if(pChunk->m_Flags&NETSENDFLAG_STATIC)
+			Flags |= NET_CHUNKFLAG_STATIC;
 
 		if(m_aSlots[pChunk->m_ClientID].m_Connection.QueueChunk(Flags, pChunk->m_DataSize, pChunk->m_pData) == 0)
 		{
 			if(pChunk->m_Flags&NETSENDFLAG_FLUSH)
 				m_aSlots[pChunk->m_ClientID].m_Connection.Flush();
+			ScheduleSlot(pChunk->m_ClientID);
 		}
 		else
 		{
@@ -244,6 +362,14 @@ int CNetServer::Send(CNetChunk *pChunk)
 	return 0;
 }
 
+bool CNetServer::RefersTo(const void *pData, int Size)
+{
+	for(int i = 0; i < MaxClients(); i++)
+		if(m_aSlots[i].m_Connection.RefersTo(pData, Size))
+			return true;
+	return false;
+}
+
 void CNetServer::SetMaxClientsPerIP(int Max)
 {
 	// clamp
@@ -0,0 +1,183 @@
+/* File is created for the TW+ mod
+ */
+
+#include <base/math.h>
+
+#include "profiler.h"
+
+CProfiler g_Profiler;
+
+static const char *s_apEnginePhases[CProfiler::NUM_ENGINE_PHASES] = {
+	"input",
+	"tick",
+	"snap",
+	"snap.build",
+	"snap.delta",
+	"snap.compress",
+	"snap.send",
+	"network",
+	"network.mapdownload",
+};
+
+CProfiler::CProfiler()
+{
+	mem_zero(m_aPhases, sizeof(m_aPhases));
+	m_NumPhases = 0;
+	for(int i = 0; i < NUM_ENGINE_PHASES; i++)
+		Register(s_apEnginePhases[i]);
+
+	m_TraceFile = 0;
+	m_TraceRequest = 0;
+	m_TraceTicks = 0;
+	m_TraceStart = 0;
+	m_pTraceEvents = 0;
+	m_NumTraceEvents = 0;
+}
+
+int CProfiler::Register(const char *pName)
+{
+	for(int i = 0; i < m_NumPhases; i++)
+		if(str_comp(m_aPhases[i].m_aName, pName) == 0)
+			return i;
+
+	dbg_assert(m_NumPhases < MAX_PHASES, "too many profiler phases");
+	str_copy(m_aPhases[m_NumPhases].m_aName, pName, sizeof(m_aPhases[m_NumPhases].m_aName));
+	return m_NumPhases++;
+}
+
+void CProfiler::Add(int Phase, int64 Start, int64 End)
+{
+	m_aPhases[Phase].m_Current += End - Start;
+	m_aPhases[Phase].m_CurrentCalls++;
+
+	if(m_TraceTicks > 0 && m_NumTraceEvents < MAX_TRACE_EVENTS)
+	{
+		CTraceEvent *pEvent = &m_pTraceEvents[m_NumTraceEvents++];
+		pEvent->m_Phase = Phase;
+		pEvent->m_Start = Start;
+		pEvent->m_End = End;
+	}
+}
+
+void CProfiler::EndTick(int Tick)
+{
+	int64 Freq = time_freq();
+	for(int i = 0; i < m_NumPhases; i++)
+	{
+		CPhase *pPhase = &m_aPhases[i];
+		// ticks without the phase don't count, snapshots are not taken every tick
+		if(!pPhase->m_CurrentCalls)
+			continue;
+
+		int64 Time = pPhase->m_Current * 1000000000 / Freq;
+		pPhase->m_aTime[pPhase->m_Next] = Time < 0x7fffffff ? (int)Time : 0x7fffffff;
+		pPhase->m_aCalls[pPhase->m_Next] = pPhase->m_CurrentCalls;
+		pPhase->m_Next = (pPhase->m_Next+1) % WINDOW_SIZE;
+		if(pPhase->m_Samples < WINDOW_SIZE)
+			pPhase->m_Samples++;
+		pPhase->m_Current = 0;
+		pPhase->m_CurrentCalls = 0;
+	}
+
+	// the trace covers whole ticks
+	if(m_TraceRequest)
+	{
+		m_TraceTicks = m_TraceRequest;
+		m_TraceRequest = 0;
+		m_TraceStart = time_get_real();
+	}
+	else if(m_TraceTicks > 0 && --m_TraceTicks == 0)
+		WriteTrace();
+
+	if(m_TraceTicks > 0 && m_NumTraceEvents < MAX_TRACE_EVENTS)
+	{
+		CTraceEvent *pEvent = &m_pTraceEvents[m_NumTraceEvents++];
+		pEvent->m_Phase = -1;
+		pEvent->m_Start = time_get_real();
+		pEvent->m_End = Tick;
+	}
+}
+
+bool CProfiler::StartTrace(IOHANDLE File, int Ticks)
+{
+	if(Tracing() || Ticks <= 0)
+		return false;
+
+	m_pTraceEvents = (CTraceEvent *)mem_alloc(sizeof(CTraceEvent)*MAX_TRACE_EVENTS, 1);
+	m_NumTraceEvents = 0;
+	m_TraceFile = File;
+	m_TraceRequest = Ticks;
+	return true;
+}
+
+void CProfiler::WriteTrace()
+{
+	char aBuf[256];
+	int64 Freq = time_freq();
+
+	io_write(m_TraceFile, "{\"traceEvents\":[\n", 17);
+	for(int i = 0; i < m_NumTraceEvents; i++)
+	{
+		const CTraceEvent *pEvent = &m_pTraceEvents[i];
+		double Start = (pEvent->m_Start - m_TraceStart) * 1000000.0 / Freq;
+		if(pEvent->m_Phase < 0)
+			str_format(aBuf, sizeof(aBuf), "{\"name\":\"tick %d\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":%.3f}",
+				(int)pEvent->m_End, Start);
+		else
+			str_format(aBuf, sizeof(aBuf), "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f}",
+				m_aPhases[pEvent->m_Phase].m_aName, Start, (pEvent->m_End - pEvent->m_Start) * 1000000.0 / Freq);
+		io_write(m_TraceFile, aBuf, str_length(aBuf));
+		io_write(m_TraceFile, i+1 < m_NumTraceEvents ? ",\n" : "\n", i+1 < m_NumTraceEvents ? 2 : 1);
+	}
+	io_write(m_TraceFile, "]}\n", 3);
+	io_close(m_TraceFile);
+
+	m_TraceFile = 0;
+	mem_free(m_pTraceEvents);
+	m_pTraceEvents = 0;
+	m_NumTraceEvents = 0;
+}
+
+bool CProfiler::GetStats(int Phase, CStats *pStats) const
+{
+	if(Phase < 0 || Phase >= m_NumPhases || !m_aPhases[Phase].m_Samples)
+		return false;
+	const CPhase *pPhase = &m_aPhases[Phase];
+
+	// the slowest percent of the ticks, the smallest of them is the 99th percentile
+	enum { MAX_TOP=WINDOW_SIZE/100+1 };
+	int aTop[MAX_TOP];
+	int NumTop = pPhase->m_Samples/100+1;
+	for(int i = 0; i < NumTop; i++)
+		aTop[i] = -1;
+
+	int Min = pPhase->m_aTime[0];
+	int Max = Min;
+	int64 Sum = 0;
+	int Calls = 0;
+	for(int i = 0; i < pPhase->m_Samples; i++)
+	{
+		int Time = pPhase->m_aTime[i];
+		Min = min(Min, Time);
+		Max = max(Max, Time);
+		Sum += Time;
+		Calls += pPhase->m_aCalls[i];
+
+		// keep the top sorted from slowest to fastest
+		if(Time > aTop[NumTop-1])
+		{
+			int j = NumTop-1;
+			for(; j > 0 && aTop[j-1] < Time; j--)
+				aTop[j] = aTop[j-1];
+			aTop[j] = Time;
+		}
+	}
+
+	pStats->m_Samples = pPhase->m_Samples;
+	pStats->m_Calls = Calls / (float)pPhase->m_Samples;
+	pStats->m_Min = Min / 1000.0f;
+	pStats->m_Avg = Sum / (float)pPhase->m_Samples / 1000.0f;
+	pStats->m_P99 = aTop[NumTop-1] / 1000.0f;
+	pStats->m_Max = Max / 1000.0f;
+	return true;
+}
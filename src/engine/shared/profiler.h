@@ -0,0 +1,122 @@
+/* File is created for the TW+ mod
+ */
+
+#ifndef ENGINE_SHARED_PROFILER_H
+#define ENGINE_SHARED_PROFILER_H
+
+#include <base/system.h>
+
+/**
+ * Measures where the server spends its ticks.
+ *
+ * Code marks a phase with a CProfileScope, the time of all scopes of a phase
+ * is summed up until the next tick starts. The sums of the last ticks are kept
+ * to give rolling statistics per phase. For a closer look the single scopes of
+ * some ticks can be dumped as a Chrome trace (chrome://tracing).
+ */
+class CProfiler
+{
+public:
+	enum
+	{
+		// phases of the engine, the game registers its own ones
+		PHASE_INPUT=0,
+		PHASE_TICK,
+		PHASE_SNAP,
+		PHASE_SNAP_BUILD,
+		PHASE_SNAP_DELTA,
+		PHASE_SNAP_COMPRESS,
+		PHASE_SNAP_SEND,
+		PHASE_NETWORK,
+		PHASE_MAPDOWNLOAD,
+		NUM_ENGINE_PHASES,
+
+		MAX_PHASES=48,
+		MAX_NAME_LENGTH=32,
+		WINDOW_SIZE=512, // ticks the statistics are taken over
+		MAX_TRACE_EVENTS=1<<16,
+	};
+
+	// times in microseconds
+	struct CStats
+	{
+		int m_Samples;
+		float m_Calls; // scopes per tick
+		float m_Min;
+		float m_Avg;
+		float m_P99;
+		float m_Max;
+	};
+
+	CProfiler();
+
+	/**
+	 * Returns the phase with the given name, creating it if needed. Names are
+	 * dotted paths, a phase contains the time of the phases below it
+	 */
+	int Register(const char *pName);
+
+	void Add(int Phase, int64 Start, int64 End);
+
+	/**
+	 * Closes the samples of the running tick, called before a tick starts
+	 */
+	void EndTick(int Tick);
+
+	/**
+	 * Records all scopes of the next ticks and writes them to the file, which
+	 * gets closed afterwards
+	 */
+	bool StartTrace(IOHANDLE File, int Ticks);
+	bool Tracing() const { return m_pTraceEvents != 0; }
+
+	int NumPhases() const { return m_NumPhases; }
+	const char *PhaseName(int Phase) const { return m_aPhases[Phase].m_aName; }
+	bool GetStats(int Phase, CStats *pStats) const;
+
+private:
+	struct CPhase
+	{
+		char m_aName[MAX_NAME_LENGTH];
+		int64 m_Current; // time spent in the running tick
+		int m_CurrentCalls;
+		int m_aTime[WINDOW_SIZE]; // nanoseconds of the last ticks
+		int m_aCalls[WINDOW_SIZE];
+		int m_Next;
+		int m_Samples;
+	};
+
+	struct CTraceEvent
+	{
+		int m_Phase; // -1 marks the start of a tick
+		int64 m_Start;
+		int64 m_End; // number of the tick for tick marks
+	};
+
+	void WriteTrace();
+
+	CPhase m_aPhases[MAX_PHASES];
+	int m_NumPhases;
+
+	// trace
+	IOHANDLE m_TraceFile;
+	int m_TraceRequest; // ticks to trace from the next tick on
+	int m_TraceTicks; // ticks left to trace
+	int64 m_TraceStart;
+	CTraceEvent *m_pTraceEvents;
+	int m_NumTraceEvents;
+};
+
+extern CProfiler g_Profiler;
+
+class CProfileScope
+{
+	int m_Phase;
+	int64 m_Start;
+
+public:
+	CProfileScope(int Phase) : m_Phase(Phase), m_Start(time_get_real()) {}
+	~CProfileScope() { g_Profiler.Add(m_Phase, m_Start, time_get_real()); }
+};
+
+#endif
@@ -434,7 +434,7 @@ void CSnapshotStorage::Add(int Tick, int64 Tagtime, int DataSize, void *pData, i
 	if(CreateAlt)
 		TotalSize += DataSize;
 
-	CHolder *pHolder = (CHolder *)mem_alloc(TotalSize, 1);
+	CHolder *pHolder = (CHolder *)mem_alloc_tag(TotalSize, 1, MEMTAG_SNAPSHOT);
 
 	// set data
 	pHolder->m_Tick = Tick;
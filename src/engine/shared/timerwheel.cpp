@@ -0,0 +1,118 @@
+/* File is created for the TW+ mod
+ */
+
+#include "timerwheel.h"
+
+void CTimerWheel::Init(int64 Now)
+{
+	mem_zero(m_apLevel0, sizeof(m_apLevel0));
+	mem_zero(m_apLevel1, sizeof(m_apLevel1));
+	m_TickLength = time_freq()/1000;
+	if(m_TickLength < 1)
+		m_TickLength = 1;
+	m_CurrentTick = ToTick(Now);
+	m_NumTimers = 0;
+}
+
+CTimerWheel::CTimer **CTimerWheel::Bucket(const CTimer *pTimer)
+{
+	int64 Delta = pTimer->m_Expire - m_CurrentTick;
+	if(Delta < LEVEL_SIZE)
+		return &m_apLevel0[pTimer->m_Expire&LEVEL_MASK];
+	if(Delta < (LEVEL_SIZE-1)*LEVEL_SIZE)
+		return &m_apLevel1[(pTimer->m_Expire>>LEVEL_BITS)&LEVEL_MASK];
+	// too far away, wait in the last bucket
+	return &m_apLevel1[((m_CurrentTick>>LEVEL_BITS)+LEVEL_MASK)&LEVEL_MASK];
+}
+
+void CTimerWheel::Insert(CTimer *pTimer)
+{
+	CTimer **ppBucket = Bucket(pTimer);
+	pTimer->m_ppBucket = ppBucket;
+	pTimer->m_pPrev = 0;
+	pTimer->m_pNext = *ppBucket;
+	if(*ppBucket)
+		(*ppBucket)->m_pPrev = pTimer;
+	*ppBucket = pTimer;
+}
+
+void CTimerWheel::Unlink(CTimer *pTimer)
+{
+	if(pTimer->m_pPrev)
+		pTimer->m_pPrev->m_pNext = pTimer->m_pNext;
+	else
+		*pTimer->m_ppBucket = pTimer->m_pNext;
+	if(pTimer->m_pNext)
+		pTimer->m_pNext->m_pPrev = pTimer->m_pPrev;
+	pTimer->m_pPrev = 0;
+	pTimer->m_pNext = 0;
+	pTimer->m_ppBucket = 0;
+}
+
+void CTimerWheel::Schedule(CTimer *pTimer, int64 Time)
+{
+	if(pTimer->Scheduled())
+		Unlink(pTimer);
+	else
+		m_NumTimers++;
+
+	int64 Tick = ToTick(Time);
+	pTimer->m_Expire = Tick > m_CurrentTick ? Tick : m_CurrentTick+1;
+	Insert(pTimer);
+}
+
+void CTimerWheel::Cancel(CTimer *pTimer)
+{
+	if(!pTimer->Scheduled())
+		return;
+	Unlink(pTimer);
+	pTimer->m_Expire = -1;
+	m_NumTimers--;
+}
+
+int64 CTimerWheel::ExpireTime(const CTimer *pTimer) const
+{
+	return pTimer->Scheduled() ? pTimer->m_Expire*m_TickLength : -1;
+}
+
+void CTimerWheel::Advance(int64 Now, FTimerCallback pfnCallback, void *pUser)
+{
+	int64 Target = ToTick(Now);
+	while(m_CurrentTick < Target)
+	{
+		if(!m_NumTimers)
+		{
+			m_CurrentTick = Target;
+			break;
+		}
+
+		m_CurrentTick++;
+
+		// the first level wrapped, sort in the next block of the second level
+		if((m_CurrentTick&LEVEL_MASK) == 0)
+		{
+			CTimer **ppBucket = &m_apLevel1[(m_CurrentTick>>LEVEL_BITS)&LEVEL_MASK];
+			CTimer *pTimer = *ppBucket;
+			*ppBucket = 0;
+			while(pTimer)
+			{
+				CTimer *pNext = pTimer->m_pNext;
+				if(pTimer->m_Expire < m_CurrentTick)
+					pTimer->m_Expire = m_CurrentTick;
+				Insert(pTimer);
+				pTimer = pNext;
+			}
+		}
+
+		// timers scheduled from the callback land in later ticks
+		CTimer **ppBucket = &m_apLevel0[m_CurrentTick&LEVEL_MASK];
+		while(*ppBucket)
+		{
+			CTimer *pTimer = *ppBucket;
+			Unlink(pTimer);
+			pTimer->m_Expire = -1;
+			m_NumTimers--;
+			pfnCallback(pTimer, pUser);
+		}
+	}
+}
@@ -0,0 +1,77 @@
+/* File is created for the TW+ mod
+ */
+
+#ifndef ENGINE_SHARED_TIMERWHEEL_H
+#define ENGINE_SHARED_TIMERWHEEL_H
+
+#include <base/system.h>
+
+/*
+	Hierarchical timer wheel with a resolution of one millisecond. The first
+	level has a bucket for each of the next 256 ticks, the second level one
+	for each of the next 255 blocks of 256 ticks. Timers that are further
+	out wait in the last bucket and get sorted in again on the way.
+	When the first level wraps, the matching second level bucket moves down.
+*/
+class CTimerWheel
+{
+public:
+	class CTimer
+	{
+		friend class CTimerWheel;
+		CTimer *m_pPrev;
+		CTimer *m_pNext;
+		CTimer **m_ppBucket;
+		int64 m_Expire; // tick, -1 if not scheduled
+
+	public:
+		CTimer() : m_pPrev(0), m_pNext(0), m_ppBucket(0), m_Expire(-1), m_ID(-1) {}
+		bool Scheduled() const { return m_Expire >= 0; }
+
+		int m_ID;
+	};
+
+	typedef void (*FTimerCallback)(CTimer *pTimer, void *pUser);
+
+	CTimerWheel() { Init(0); }
+	void Init(int64 Now);
+
+	/**
+	 * Schedules the timer for the time (as from time_get), moves it if it
+	 * was scheduled already. Times in the past expire with the next tick
+	 */
+	void Schedule(CTimer *pTimer, int64 Time);
+	void Cancel(CTimer *pTimer);
+
+	/**
+	 * Time the timer is scheduled for, -1 if it is not
+	 */
+	int64 ExpireTime(const CTimer *pTimer) const;
+
+	/**
+	 * Calls the callback for every timer that expired by the time. The
+	 * timer is not scheduled anymore at that point and can be scheduled again
+	 */
+	void Advance(int64 Now, FTimerCallback pfnCallback, void *pUser);
+
+private:
+	enum
+	{
+		LEVEL_BITS=8,
+		LEVEL_SIZE=1<<LEVEL_BITS,
+		LEVEL_MASK=LEVEL_SIZE-1,
+	};
+
+	CTimer *m_apLevel0[LEVEL_SIZE];
+	CTimer *m_apLevel1[LEVEL_SIZE];
+	int64 m_CurrentTick;
+	int64 m_TickLength;
+	int m_NumTimers;
+
+	int64 ToTick(int64 Time) const { return Time / m_TickLength; }
+	void Insert(CTimer *pTimer);
+	void Unlink(CTimer *pTimer);
+	CTimer **Bucket(const CTimer *pTimer);
+};
+
+#endif
@@ -0,0 +1,420 @@
+/* File is created for the TW+ mod
+ */
+
+#include <engine/shared/config.h>
+#include "gamecontext.h"
+#include "botengine.h"
+
+CBotEngine::CBotEngine()
+{
+	m_pGameServer = 0;
+	m_Width = 0;
+	m_Height = 0;
+	m_SearchGeneration = 0;
+	m_NumSeen = 0;
+	m_NextThink = 0;
+	m_Seed = 1;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		m_aSeenIndex[i] = -1;
+		OnBotAdded(i);
+	}
+}
+
+void CBotEngine::Init(CGameContext *pGameServer)
+{
+	m_pGameServer = pGameServer;
+	m_Width = GameServer()->Collision()->GetWidth();
+	m_Height = GameServer()->Collision()->GetHeight();
+	BuildGraph();
+
+	char aBuf[128];
+	str_format(aBuf, sizeof(aBuf), "navigation graph with %d nodes and %d edges", NumNodes(), NumEdges());
+	GameServer()->Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "bots", aBuf);
+}
+
+void CBotEngine::OnBotAdded(int ClientID)
+{
+	CBot *pBot = &m_aBots[ClientID];
+	pBot->m_Direction = 1;
+	pBot->m_Aggro = -1;
+	pBot->m_RetargetTick = 0;
+	pBot->m_TicksSinceFire = 0;
+	pBot->m_NextNode = -1;
+	pBot->m_RoamNode = -1;
+	pBot->m_RoamTick = 0;
+}
+
+int CBotEngine::Random()
+{
+	m_Seed = m_Seed*1103515245+12345;
+	return (m_Seed>>16)&0x7fff;
+}
+
+bool CBotEngine::IsFree(int x, int y)
+{
+	if(x < 0 || y < 0 || x >= m_Width || y >= m_Height)
+		return false;
+	int Flags = GameServer()->Collision()->GetCollisionAt(x*32+16, y*32+16);
+	return !(Flags&(CCollision::COLFLAG_SOLID|CCollision::COLFLAG_DEATH|CCollision::COLFLAG_SLOWDEATH));
+}
+
+bool CBotEngine::IsSolid(int x, int y)
+{
+	if(x < 0 || y < 0 || x >= m_Width || y >= m_Height)
+		return true;
+	return GameServer()->Collision()->GetCollisionAt(x*32+16, y*32+16)&CCollision::COLFLAG_SOLID;
+}
+
+int CBotEngine::TileNode(int x, int y) const
+{
+	if(x < 0 || y < 0 || x >= m_Width || y >= m_Height)
+		return -1;
+	return m_lTileNode[y*m_Width+x];
+}
+
+int CBotEngine::LocateNode(vec2 Pos) const
+{
+	// characters in the air belong to the node they land on
+	int x = (int)Pos.x/32;
+	int y = (int)Pos.y/32;
+	if(x < 0 || y < 0 || x >= m_Width || y >= m_Height)
+		return -1;
+	for(int i = 0; i < MAX_FALL && y+i < m_Height; i++)
+	{
+		int Node = m_lTileNode[(y+i)*m_Width+x];
+		if(Node >= 0)
+			return Node;
+	}
+	return -1;
+}
+
+void CBotEngine::BuildGraph()
+{
+	m_lTileNode.set_size(m_Width*m_Height);
+	m_lNodeTile.clear();
+	for(int y = 0; y < m_Height; y++)
+	{
+		for(int x = 0; x < m_Width; x++)
+		{
+			m_lTileNode[y*m_Width+x] = -1;
+			if(IsFree(x, y) && IsSolid(x, y+1))
+				m_lTileNode[y*m_Width+x] = m_lNodeTile.add(y*m_Width+x);
+		}
+	}
+
+	m_lEdgeStart.set_size(NumNodes()+1);
+	m_lEdges.clear();
+	for(int n = 0; n < NumNodes(); n++)
+	{
+		m_lEdgeStart[n] = m_lEdges.size();
+		int x = m_lNodeTile[n]%m_Width;
+		int y = m_lNodeTile[n]/m_Width;
+		for(int Dir = -1; Dir <= 1; Dir += 2)
+		{
+			// walk to the next tile or drop off the edge
+			for(int Fall = 0; Fall < MAX_FALL && IsFree(x+Dir, y+Fall); Fall++)
+			{
+				int Target = TileNode(x+Dir, y+Fall);
+				if(Target >= 0)
+				{
+					m_lEdges.add(Target);
+					break;
+				}
+			}
+
+			// jump onto ledges, the way there has to be free
+			for(int Up = 1; Up <= JUMP_HEIGHT && IsFree(x, y-Up); Up++)
+			{
+				for(int Side = 1; Side <= JUMP_WIDTH && IsFree(x+Dir*Side, y-Up); Side++)
+				{
+					int Target = TileNode(x+Dir*Side, y-Up);
+					if(Target >= 0)
+					{
+						m_lEdges.add(Target);
+						break;
+					}
+				}
+			}
+		}
+	}
+	m_lEdgeStart[NumNodes()] = m_lEdges.size();
+
+	m_lVisited.set_size(NumNodes());
+	for(int i = 0; i < NumNodes(); i++)
+		m_lVisited[i] = 0;
+	m_lFirstHop.set_size(NumNodes());
+	m_lQueue.set_size(NumNodes());
+	m_SearchGeneration = 0;
+}
+
+int CBotEngine::FindNextNode(int From, int To)
+{
+	if(From < 0 || To < 0 || From == To)
+		return -1;
+
+	if(++m_SearchGeneration == 0)
+	{
+		for(int i = 0; i < m_lVisited.size(); i++)
+			m_lVisited[i] = 0;
+		m_SearchGeneration = 1;
+	}
+
+	// breadth first until the budget runs out, then head for the visited node closest to the goal
+	int ToX = m_lNodeTile[To]%m_Width;
+	int ToY = m_lNodeTile[To]/m_Width;
+	int Best = -1;
+	int BestDist = -1;
+	int Head = 0;
+	int Tail = 0;
+	m_lVisited[From] = m_SearchGeneration;
+	m_lFirstHop[From] = -1;
+	m_lQueue[Tail++] = From;
+	while(Head < Tail && Head < g_Config.m_SvBotPathBudget)
+	{
+		int Node = m_lQueue[Head++];
+		int dx = m_lNodeTile[Node]%m_Width - ToX;
+		int dy = m_lNodeTile[Node]/m_Width - ToY;
+		if(Best < 0 || dx*dx+dy*dy < BestDist)
+		{
+			Best = Node;
+			BestDist = dx*dx+dy*dy;
+		}
+		if(Node == To)
+			break;
+
+		for(int e = m_lEdgeStart[Node]; e < m_lEdgeStart[Node+1]; e++)
+		{
+			int Next = m_lEdges[e];
+			if(m_lVisited[Next] == m_SearchGeneration)
+				continue;
+			m_lVisited[Next] = m_SearchGeneration;
+			m_lFirstHop[Next] = Node == From ? Next : m_lFirstHop[Node];
+			m_lQueue[Tail++] = Next;
+		}
+	}
+	return m_lFirstHop[Best];
+}
+
+void CBotEngine::UpdateView()
+{
+	m_NumSeen = 0;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		m_aSeenIndex[i] = -1;
+		CPlayer *pPlayer = GameServer()->m_apPlayers[i];
+		if(!pPlayer || !pPlayer->GetCharacter())
+			continue;
+
+		CSeen *pSeen = &m_aSeen[m_NumSeen];
+		pSeen->m_Pos = pPlayer->GetCharacter()->m_Pos;
+		pSeen->m_ClientID = i;
+		pSeen->m_Team = pPlayer->GetTeam();
+		pSeen->m_Node = NODE_UNKNOWN;
+		m_aSeenIndex[i] = m_NumSeen++;
+	}
+}
+
+int CBotEngine::SeenNode(int Index)
+{
+	if(m_aSeen[Index].m_Node == NODE_UNKNOWN)
+		m_aSeen[Index].m_Node = LocateNode(m_aSeen[Index].m_Pos);
+	return m_aSeen[Index].m_Node;
+}
+
+int CBotEngine::FindTarget(int ClientID, vec2 Pos, int Team, int Level) const
+{
+	// vertical distance is multiplied by a factor, since screens are larger horizontally
+	float Range = Level == 4 ? 750.0f : 850.0f;
+	float BestDist = Range*Range;
+	bool Teamplay = GameServer()->m_pController->IsTeamplay();
+	int Target = -1;
+	for(int i = 0; i < m_NumSeen; i++)
+	{
+		const CSeen *pSeen = &m_aSeen[i];
+		if(pSeen->m_ClientID == ClientID || (Teamplay && pSeen->m_Team == Team))
+			continue;
+		float dx = pSeen->m_Pos.x - Pos.x;
+		float dy = pSeen->m_Pos.y - Pos.y;
+		float Dist = dx*dx + 1.35f*dy*dy;
+		if(Dist < BestDist)
+		{
+			BestDist = Dist;
+			Target = pSeen->m_ClientID;
+		}
+	}
+	return Target;
+}
+
+void CBotEngine::Think(int ClientID)
+{
+	CPlayer *pPlayer = GameServer()->m_apPlayers[ClientID];
+	CBot *pBot = &m_aBots[ClientID];
+	int Self = m_aSeenIndex[ClientID];
+	pBot->m_NextNode = -1;
+	if(Self < 0)
+		return;
+
+	int Tick = GameServer()->Server()->Tick();
+	if(pPlayer->m_isBot >= 4 && pBot->m_RetargetTick <= Tick)
+	{
+		pBot->m_Aggro = FindTarget(ClientID, m_aSeen[Self].m_Pos, pPlayer->GetTeam(), pPlayer->m_isBot);
+		pBot->m_RetargetTick = Tick + GameServer()->Server()->TickSpeed();
+	}
+
+	int Node = SeenNode(Self);
+	if(pPlayer->m_isBot < 3 || Node < 0)
+		return;
+
+	// chase the target, or roam between random spots of the map
+	int Goal = -1;
+	if(pBot->m_Aggro >= 0 && m_aSeenIndex[pBot->m_Aggro] >= 0)
+		Goal = SeenNode(m_aSeenIndex[pBot->m_Aggro]);
+	if(Goal < 0)
+	{
+		if(pBot->m_RoamNode < 0 || pBot->m_RoamNode == Node || pBot->m_RoamTick <= Tick)
+		{
+			pBot->m_RoamNode = Random()%NumNodes();
+			pBot->m_RoamTick = Tick + GameServer()->Server()->TickSpeed()*10;
+		}
+		Goal = pBot->m_RoamNode;
+	}
+	pBot->m_NextNode = FindNextNode(Node, Goal);
+}
+
+void CBotEngine::Act(int ClientID)
+{
+	CPlayer *pPlayer = GameServer()->m_apPlayers[ClientID];
+	CCharacter *pChr = pPlayer->GetCharacter();
+	CBot *pBot = &m_aBots[ClientID];
+	IGameController *pController = GameServer()->m_pController;
+	int Level = pPlayer->m_isBot;
+	int Tick = GameServer()->Server()->Tick();
+
+	CNetObj_PlayerInput Input;
+	mem_zero(&Input, sizeof(Input));
+	Input.m_PlayerFlags = PLAYERFLAG_PLAYING;
+	Input.m_WantedWeapon = WEAPON_GUN+1;
+	Input.m_NextWeapon = WEAPON_GUN+1;
+	Input.m_PrevWeapon = WEAPON_GUN+1;
+
+	// if there are no clients connected, the bots will idle
+	if(GameServer()->m_ClientCount <= 0)
+	{
+		pPlayer->OnPredictedInput(&Input);
+		pPlayer->OnDirectInput(&Input);
+		return;
+	}
+
+	Input.m_TargetX = (Random() % 128) - 64; // look randomly
+	Input.m_TargetY = (Random() % 128) - 64;
+	Input.m_Fire = true;
+	if(!pController->IsInstagib()) // make non-automatic weapons work, but still have ammo reload work in instagib
+		Input.m_Fire = Tick % 2 == 1;
+	if(pController->IsInstagib())
+		Input.m_WantedWeapon = WEAPON_RIFLE+1;
+	if(pController->IsGrenade())
+		Input.m_WantedWeapon = WEAPON_GRENADE+1;
+
+	if(Level >= 3 && pChr)
+	{
+		if(pBot->m_NextNode >= 0)
+		{
+			// follow the path, jump when the next node is higher
+			int NodeX = m_lNodeTile[pBot->m_NextNode]%m_Width;
+			int NodeY = m_lNodeTile[pBot->m_NextNode]/m_Width;
+			float dx = NodeX*32+16 - pChr->m_Pos.x;
+			if(dx > 8.0f)
+				pBot->m_Direction = 1;
+			else if(dx < -8.0f)
+				pBot->m_Direction = -1;
+			if(NodeY < (int)pChr->m_Pos.y/32)
+				Input.m_Jump = Tick%4 == 0;
+			if(NodeY == (int)pChr->m_Pos.y/32 && absolute(dx) <= 8.0f)
+				pBot->m_NextNode = -1;
+		}
+		else
+		{
+			// off the graph, move and occasionally jump
+			if(Random() % (SERVER_TICK_SPEED*2) == 1)
+				pBot->m_Direction = -pBot->m_Direction;
+			if(Random() % (SERVER_TICK_SPEED*2) == 1)
+				Input.m_Jump = true;
+		}
+		Input.m_Direction = pBot->m_Direction;
+	}
+
+	if(Level >= 4 && pChr)
+	{
+		if(pBot->m_Aggro == -1)
+		{
+			pBot->m_TicksSinceFire = 0; // reset
+			Input.m_Fire = false; // do not shoot by default
+		}
+		else
+		{
+			pBot->m_TicksSinceFire++;
+			int LaserReload = g_Config.m_SvLaserReloadTime / GameServer()->Server()->TickSpeed();
+			if(pController->IsGrenade())
+				Input.m_Fire = Level >= 5 || pBot->m_TicksSinceFire > 50;
+			else if(pController->IsInstagib())
+				Input.m_Fire = Level >= 6 || (Level == 5 && pBot->m_TicksSinceFire > 5 + LaserReload) || pBot->m_TicksSinceFire > 20 + LaserReload;
+			else
+				Input.m_Fire = pBot->m_TicksSinceFire > 10; // 10 = 0.2s
+			if(Input.m_Fire)
+				pBot->m_TicksSinceFire = 0; // reset
+			if(Level >= 5 && !pController->IsGrenade() && !pController->IsInstagib())
+				Input.m_Fire = Tick % 2 == 1;
+
+			// aim
+			int Target = m_aSeenIndex[pBot->m_Aggro];
+			if(Target >= 0)
+			{
+				vec2 Diff = m_aSeen[Target].m_Pos - pChr->m_Pos;
+				Input.m_TargetX = Diff.x;
+				Input.m_TargetY = Diff.y;
+				if(pController->IsGrenade()) // grenade curve correction, somewhat
+					Input.m_TargetY = Input.m_TargetY + (-absolute(Input.m_TargetX)*0.3);
+				if(Level <= 5) // aim worse
+				{
+					float d = length(Diff);
+					Input.m_TargetX = (float)Input.m_TargetX + (d * 0.3 * ((float)(Random() % 64) / 64.0 - 0.5));
+					Input.m_TargetY = (float)Input.m_TargetY + (d * 0.3 * ((float)(Random() % 64) / 64.0 - 0.5));
+				}
+			}
+		}
+	}
+
+	pPlayer->OnPredictedInput(&Input);
+	pPlayer->OnDirectInput(&Input);
+	if(pChr)
+		pChr->SetAmmo(WEAPON_GUN, 10);
+}
+
+void CBotEngine::Tick()
+{
+	if(GameServer()->m_World.m_Paused)
+		return;
+
+	UpdateView();
+
+	// plan for a limited number of bots, round robin
+	int Budget = g_Config.m_SvBotThinkBudget;
+	for(int n = 0; n < MAX_CLIENTS && Budget > 0; n++)
+	{
+		int i = (m_NextThink+n)%MAX_CLIENTS;
+		CPlayer *pPlayer = GameServer()->m_apPlayers[i];
+		if(!pPlayer || pPlayer->m_isBot < 2)
+			continue;
+		Think(i);
+		m_NextThink = (i+1)%MAX_CLIENTS;
+		Budget--;
+	}
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		CPlayer *pPlayer = GameServer()->m_apPlayers[i];
+		if(pPlayer && pPlayer->m_isBot >= 2)
+			Act(i);
+	}
+}
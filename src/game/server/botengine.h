@@ -0,0 +1,114 @@
+/* File is created for the TW+ mod
+ */
+
+#ifndef GAME_SERVER_BOTENGINE_H
+#define GAME_SERVER_BOTENGINE_H
+
+#include <base/vmath.h>
+#include <base/tl/array.h>
+#include <engine/shared/protocol.h>
+
+/**
+ * Drives the inputs of the server side bots.
+ *
+ * The walkable tiles of the map are turned into a navigation graph when the
+ * map is loaded and the living characters are gathered once per tick into a
+ * view that all bots query. Only a budget of bots plans each tick, the others
+ * keep following their last plan.
+ */
+class CBotEngine
+{
+public:
+	CBotEngine();
+
+	/**
+	 * Builds the navigation graph, the collision has to be initialized
+	 */
+	void Init(class CGameContext *pGameServer);
+
+	/**
+	 * Forget the plan of a slot that just became a bot
+	 */
+	void OnBotAdded(int ClientID);
+
+	/**
+	 * Plans and sends the inputs of all bots, after the players ticked
+	 */
+	void Tick();
+
+	int NumNodes() const { return m_lNodeTile.size(); }
+	int NumEdges() const { return m_lEdges.size(); }
+
+private:
+	enum
+	{
+		JUMP_HEIGHT=4, // tiles a bot can climb with a jump
+		JUMP_WIDTH=3,
+		MAX_FALL=24, // highest drop a bot walks off
+
+		NODE_UNKNOWN=-2,
+	};
+
+	// character seen in the current tick
+	struct CSeen
+	{
+		vec2 m_Pos;
+		int m_ClientID;
+		int m_Team;
+		int m_Node; // NODE_UNKNOWN until a bot asks for it
+	};
+
+	struct CBot
+	{
+		int m_Direction; // last moved direction
+		int m_Aggro; // client the bot is after or -1
+		int m_RetargetTick;
+		int m_TicksSinceFire;
+		int m_NextNode; // next node on the path or -1
+		int m_RoamNode; // where the bot walks to without aggro or -1
+		int m_RoamTick;
+	};
+
+	class CGameContext *GameServer() const { return m_pGameServer; }
+
+	bool IsFree(int x, int y);
+	bool IsSolid(int x, int y);
+	int TileNode(int x, int y) const;
+	int LocateNode(vec2 Pos) const;
+	void BuildGraph();
+	int FindNextNode(int From, int To);
+
+	void UpdateView();
+	int SeenNode(int Index);
+	int FindTarget(int ClientID, vec2 Pos, int Team, int Level) const;
+	void Think(int ClientID);
+	void Act(int ClientID);
+	int Random();
+
+	class CGameContext *m_pGameServer;
+
+	// navigation graph, a node is a free tile right above a solid one
+	int m_Width;
+	int m_Height;
+	array<int> m_lTileNode; // node of every tile or -1
+	array<int> m_lNodeTile;
+	array<int> m_lEdgeStart; // first edge of every node, one more entry than nodes
+	array<int> m_lEdges; // target nodes
+
+	// path search
+	array<unsigned> m_lVisited;
+	array<int> m_lFirstHop;
+	array<int> m_lQueue;
+	unsigned m_SearchGeneration;
+
+	// shared view
+	CSeen m_aSeen[MAX_CLIENTS];
+	int m_NumSeen;
+	int m_aSeenIndex[MAX_CLIENTS]; // index into m_aSeen or -1
+
+	CBot m_aBots[MAX_CLIENTS];
+	int m_NextThink; // round robin position of the planning budget
+	unsigned m_Seed;
+};
+
+#endif
@@ -6,598 +6,639 @@
 #include <engine/shared/config.h>
 #include <stdio.h>
 
+void CGameContext::RegisterChatCommands()
+{
+	m_ChatCommands.Register("info", "", CChatCommands::AUTH_NONE, 0, 0, ChatInfo, this, "Information about the mod");
+	m_ChatCommands.Register("credits", "", CChatCommands::AUTH_NONE, 0, 0, ChatCredits, this, "See some credits");
+	m_ChatCommands.Register("help", "", CChatCommands::AUTH_NONE, 0, 0, ChatHelp, this, "Show information about the current gamemode");
+	m_ChatCommands.Register("cmdlist", "", CChatCommands::AUTH_NONE, 0, 0, ChatCmdlist, this, "Show the available commands");
+	m_ChatCommands.Register("stop", "", CChatCommands::AUTH_NONE, CChatCommands::FLAG_NOPREFIX, 0, ChatStop, this, "Pause the game");
+	m_ChatCommands.Register("go", "", CChatCommands::AUTH_NONE, CChatCommands::FLAG_NOPREFIX, 0, ChatGo, this, "Start the game");
+	m_ChatCommands.Register("restart", "", CChatCommands::AUTH_NONE, CChatCommands::FLAG_NOPREFIX, 0, ChatRestart, this, "Start a new round");
+	m_ChatCommands.Register("1on1", "", CChatCommands::AUTH_NONE, 0, 0, ChatXonX, this, "Starts a war");
+	m_ChatCommands.Register("2on2", "", CChatCommands::AUTH_NONE, 0, 0, ChatXonX, this, "Starts a war");
+	m_ChatCommands.Register("3on3", "", CChatCommands::AUTH_NONE, 0, 0, ChatXonX, this, "Starts a war");
+	m_ChatCommands.Register("4on4", "", CChatCommands::AUTH_NONE, 0, 0, ChatXonX, this, "Starts a war");
+	m_ChatCommands.Register("5on5", "", CChatCommands::AUTH_NONE, 0, 0, ChatXonX, this, "Starts a war");
+	m_ChatCommands.Register("6on6", "", CChatCommands::AUTH_NONE, 0, 0, ChatXonX, this, "Starts a war");
+	m_ChatCommands.Register("reset", "", CChatCommands::AUTH_NONE, 0, 0, ChatReset, this, "Reset the Spectator Slots");
+	m_ChatCommands.Register("stats_all", "?r", CChatCommands::AUTH_NONE, 0, &g_Config.m_SvChatCommandCooldown, ChatStatsAll, this, "[<Name/ID>]");
+	m_ChatCommands.Register("stats", "?r", CChatCommands::AUTH_NONE, 0, &g_Config.m_SvChatCommandCooldown, ChatStats, this, "[<Name/ID>]");
+	m_ChatCommands.Register("sayto", "?r", CChatCommands::AUTH_NONE, 0, 0, ChatWhisper, this, "<Name/ID> <Message>");
+	m_ChatCommands.Register("st", "?r", CChatCommands::AUTH_NONE, 0, 0, ChatWhisper, this, "<Name/ID> <Message>");
+	m_ChatCommands.Register("pm", "?r", CChatCommands::AUTH_NONE, 0, 0, ChatWhisper, this, "<Name/ID> <Message>");
+	m_ChatCommands.Register("w", "?r", CChatCommands::AUTH_NONE, 0, 0, ChatWhisper, this, "<Name/ID> <Message>");
+	m_ChatCommands.Register("whisper", "?r", CChatCommands::AUTH_NONE, 0, 0, ChatWhisper, this, "<Name/ID> <Message>");
+	m_ChatCommands.Register("me", "?r", CChatCommands::AUTH_NONE, 0, 0, ChatMe, this, "<Message>");
+	m_ChatCommands.Register("ans", "?r", CChatCommands::AUTH_NONE, 0, 0, ChatAnswer, this, "<Message>");
+	m_ChatCommands.Register("r", "?r", CChatCommands::AUTH_NONE, 0, 0, ChatAnswer, this, "<Message>");
+	m_ChatCommands.Register("c", "?r", CChatCommands::AUTH_NONE, 0, 0, ChatAnswer, this, "<Message>");
+	m_ChatCommands.Register("emote", "?s?i", CChatCommands::AUTH_NONE, 0, 0, ChatEmote, this, "<type> <sec>");
+	m_ChatCommands.Register("spec", "i", CChatCommands::AUTH_MOD, 0, 0, ChatSetTeam, this, "<client id>");
+	m_ChatCommands.Register("red", "i", CChatCommands::AUTH_MOD, 0, 0, ChatSetTeam, this, "<client id>");
+	m_ChatCommands.Register("blue", "i", CChatCommands::AUTH_MOD, 0, 0, ChatSetTeam, this, "<client id>");
+	m_ChatCommands.Register("pause", "", CChatCommands::AUTH_NONE, 0, 0, ChatPause, this, "Rejoin a LMS round that has not started yet");
+}
+
 // return value: true if message should be sent publicly, false if it's a command and the msg should not be sent to others.
 bool CGameContext::ShowCommand(int ClientID, CPlayer* pPlayer, const char* pMessage, int *pTeam)
 {
-	if(StrLeftComp(pMessage, "go") || StrLeftComp(pMessage, "stop") || StrLeftComp(pMessage, "restart"))
-	{/* Do nothing */}
-	// else if(pMessage[0] == '/' || pMessage[0] == '!')
-	else if (pMessage[0] == '/')
-		pMessage++;
-	else
+	int Result = m_ChatCommands.Execute(pMessage, ClientID, Server()->IsAuthed(ClientID), Server()->Tick());
+	if(Result == CChatCommands::EXEC_NONE)
 		return true;
 
-	int Len = 0;
-
-	// AuthLevel > 0  => Moderator/Admin
-	int AuthLevel = Server()->IsAuthed(ClientID);
 	// It's a command so we set Team to CHAT_ALL that things like restart can't be written in teamchat and will be visible for everybody
 	*pTeam = CHAT_ALL;
 
-	if(StrLeftComp(pMessage, "info"))
+	char aBuf[256];
+	switch(Result)
 	{
-		char aBuf[128];
-		str_format(aBuf, sizeof(aBuf), "TW+ Mod v.%s created by Teetime, Modified v%s by Pointer.", MOD_VERSION_TEETIME, MOD_VERSION);
+	case CChatCommands::EXEC_PUBLIC:
+		return true;
+	case CChatCommands::EXEC_USAGE:
+		str_format(aBuf, sizeof(aBuf), "Usage: \"/%s %s\"", m_ChatCommands.LastName(), m_ChatCommands.LastHelp());
+		SendChatTarget(ClientID, aBuf);
+		break;
+	case CChatCommands::EXEC_COOLDOWN:
+		str_format(aBuf, sizeof(aBuf), "Please wait %d seconds before using \"/%s\" again", (m_ChatCommands.LastCooldownLeft()+Server()->TickSpeed()-1)/Server()->TickSpeed(), m_ChatCommands.LastName());
 		SendChatTarget(ClientID, aBuf);
+		break;
+	case CChatCommands::EXEC_UNKNOWN:
+		SendChatTarget(ClientID, "No such command. Type \"/cmdlist\" to get a list of available commands");
+		break;
+	}
+	return false;
+}
 
-		SendChatTarget(ClientID, "For a list of available commands type \"/cmdlist\"");
+bool CGameContext::ChatInfo(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
 
-		str_format(aBuf, sizeof(aBuf), "Gametype: %s", GameType());
-		SendChatTarget(ClientID, aBuf);
+	char aBuf[128];
+	str_format(aBuf, sizeof(aBuf), "TW+ Mod v.%s created by Teetime, Modified v%s by Pointer.", MOD_VERSION_TEETIME, MOD_VERSION);
+	pSelf->SendChatTarget(ClientID, aBuf);
 
-		if(m_pController->IsIFreeze())
-				SendChatTarget(ClientID, "iFreeze is originally created by Tom94. Big thanks to him");
-		if (strcmp(g_Config.m_SvInfoGithub, "") != 0)
-			SendChatTarget(ClientID, g_Config.m_SvInfoGithub);
-		if (strcmp(g_Config.m_SvInfoContact, "") != 0)
-			SendChatTarget(ClientID, g_Config.m_SvInfoContact);
-		return false;
+	pSelf->SendChatTarget(ClientID, "For a list of available commands type \"/cmdlist\"");
+
+	str_format(aBuf, sizeof(aBuf), "Gametype: %s", pSelf->GameType());
+	pSelf->SendChatTarget(ClientID, aBuf);
+
+	if(pSelf->m_pController->IsIFreeze())
+			pSelf->SendChatTarget(ClientID, "iFreeze is originally created by Tom94. Big thanks to him");
+	if (strcmp(g_Config.m_SvInfoGithub, "") != 0)
+		pSelf->SendChatTarget(ClientID, g_Config.m_SvInfoGithub);
+	if (strcmp(g_Config.m_SvInfoContact, "") != 0)
+		pSelf->SendChatTarget(ClientID, g_Config.m_SvInfoContact);
+	return false;
+}
+
+bool CGameContext::ChatCredits(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
+
+	pSelf->SendChatTarget(ClientID, "Credits goes to the whole Teeworlds-community and especially");
+	pSelf->SendChatTarget(ClientID, "to BotoX, Tom and Greyfox. This mod has some of their ideas included.");
+	pSelf->SendChatTarget(ClientID, "Also thanks to fisted and eeeee for their amazing loltext.");
+	pSelf->SendChatTarget(ClientID, "Slightly modified by Pointer.");
+	return false;
+}
+
+bool CGameContext::ChatHelp(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
+
+	if (pSelf->StrLeftComp(pSelf->GameType(), "DM+")) {
+		pSelf->SendChatTarget(ClientID, "DM+ gametype: 'death match'. Kill other tees for points. You can pick up weapons to use. Pick up hearts and shields to restore your health and armor!");
+	} else if (pSelf->StrLeftComp(pSelf->GameType(), "CTF+")) {
+		pSelf->SendChatTarget(ClientID, "CTF+ gametype: 'capture the flag'. Pick up the flag of the other team and bring it to your own flag for points. You can pick up weapons to use. Pick up hearts and shields to restore your health and armor!");
+	} else if (pSelf->StrLeftComp(pSelf->GameType(), "TDM+")) {
+		pSelf->SendChatTarget(ClientID, "TDM+ gametype: 'team death match'. Kill tees of the other team for points. You can pick up weapons to use. Pick up hearts and shields to restore your health and armor!");
+	}
+	else if (pSelf->StrLeftComp(pSelf->GameType(), "gDM+")) {
+		pSelf->SendChatTarget(ClientID, "gDM+ gametype: 'death match'. Kill other tees for points. You can only use your grenade launcher, and it insta-kills");
+	} else if (pSelf->StrLeftComp(pSelf->GameType(), "gCTF+")) {
+		pSelf->SendChatTarget(ClientID, "gCTF+ gametype: 'capture the flag'. Pick up the flag of the other team and bring it to your own flag for points. You can only use your grenade launcher, and it insta-kills");
+	} else if (pSelf->StrLeftComp(pSelf->GameType(), "gTDM+")) {
+		pSelf->SendChatTarget(ClientID, "gTDM+ gametype: 'team death match'. Kill tees of the other team for points. You can only use your grenade launcher, and it insta-kills");
+	}
+	else if (pSelf->StrLeftComp(pSelf->GameType(), "iDM+")) {
+		pSelf->SendChatTarget(ClientID, "iDM+ gametype: 'death match'. Kill other tees for points. You can only use your laser rifle, and it insta-kills");
+	} else if (pSelf->StrLeftComp(pSelf->GameType(), "iCTF+")) {
+		pSelf->SendChatTarget(ClientID, "iCTF+ gametype: 'capture the flag'. Pick up the flag of the other team and bring it to your own flag for points. You can only use your laser rifle, and it insta-kills");
+	} else if (pSelf->StrLeftComp(pSelf->GameType(), "iTDM+")) {
+		pSelf->SendChatTarget(ClientID, "iTDM+ gametype: 'team death match'. Kill tees of the other team for points. You can only use your laser rifle, and it insta-kills");
 	}
-	else if(StrLeftComp(pMessage, "credits"))
+	else if (pSelf->StrLeftComp(pSelf->GameType(), "HTF")) {
+		pSelf->SendChatTarget(ClientID, "HTF gametype: 'hold the flag'. While holding the flag you gain points. You can pick up weapons to use. Pick up hearts and shields to restore your health and armor!");
+	} else if (pSelf->StrLeftComp(pSelf->GameType(), "gHTF")) {
+		pSelf->SendChatTarget(ClientID, "gHTF gametype: 'hold the flag'. While holding the flag you gain points. You can only use your grenade launcher, and it insta-kills");
+	} else if (pSelf->StrLeftComp(pSelf->GameType(), "iHTF")) {
+		pSelf->SendChatTarget(ClientID, "iHTF gametype: 'hold the flag'. While holding the flag you gain points. You can only use your laser rifle, and it insta-kills");
+	} else if (pSelf->StrLeftComp(pSelf->GameType(), "THTF")) {
+		pSelf->SendChatTarget(ClientID, "THTF gametype: 'team hold the flag'. While holding the flag your team gains points. You can pick up weapons to use. Pick up hearts and shields to restore your health and armor!");
+	} else if (pSelf->StrLeftComp(pSelf->GameType(), "gTHTF")) {
+		pSelf->SendChatTarget(ClientID, "gTHTF gametype: 'team hold the flag'. While holding the flag your team gains points. You can only use your grenade launcher, and it insta-kills");
+	} else if (pSelf->StrLeftComp(pSelf->GameType(), "iTHTF")) {
+		pSelf->SendChatTarget(ClientID, "iTHTF gametype: ' team hold the flag'. While holding the flag your team gains points. You can only use your laser rifle, and it insta-kills");
+	}
+	else if (pSelf->StrLeftComp(pSelf->GameType(), "LMS+")) {
+		pSelf->SendChatTarget(ClientID, "LMS+ gametype: 'last man standing'. Kill all others, but avoid dying too much to win. You can pick up weapons to use. Pick up hearts and shields to restore your health and armor!");
+	} else if (pSelf->StrLeftComp(pSelf->GameType(), "gLMS+")) {
+		pSelf->SendChatTarget(ClientID, "gLMS+ gametype: 'last man standing'. Kill all others, but avoid dying too much to win. You can only use your grenade launcher, and it insta-kills");
+	} else if (pSelf->StrLeftComp(pSelf->GameType(), "iLMS+")) {
+		pSelf->SendChatTarget(ClientID, "iLMS+ gametype: 'last man standing'. Kill all others, but avoid dying too much to win. You can only use your laser rifle, and it insta-kills");
+	} else if (pSelf->StrLeftComp(pSelf->GameType(), "LTS+")) {
+		pSelf->SendChatTarget(ClientID, "LTS+ gametype: 'last team standing'. Kill the other team, but avoid dying too much to win. You can pick up weapons to use. Pick up hearts and shields to restore your health and armor!");
+	} else if (pSelf->StrLeftComp(pSelf->GameType(), "gLTS+")) {
+		pSelf->SendChatTarget(ClientID, "gLTS+ gametype: 'last team standing'. Kill the other team, but avoid dying too much to win. You can only use your grenade launcher, and it insta-kills");
+	} else if (pSelf->StrLeftComp(pSelf->GameType(), "iLTS+")) {
+		pSelf->SendChatTarget(ClientID, "iLTS+ gametype: 'last team standing'. Kill the other team, but avoid dying too much to win. You can only use your laser rifle, and it insta-kills");
+	}
+	else if (pSelf->StrLeftComp(pSelf->GameType(), "iFreeze+")) {
+		pSelf->SendChatTarget(ClientID, "iFreeze gametype: freeze all tees of the other team to win. Stand near a frozen teammate to melt them.");
+	} else if (pSelf->StrLeftComp(pSelf->GameType(), "nDM+")) {
+		char aBuf[1024] = "No message (this should not appear)";
+		str_format(aBuf, sizeof(aBuf), "No items Death Match: Kill other tees for points. You can only use one weapon. The weapon will change every %d seconds", g_Config.m_SvNDMTime);
+		pSelf->SendChatTarget(ClientID, aBuf);
+	}
+	else {
+		pSelf->SendChatTarget(ClientID, "The current gametype is unknown");
+	}
+	// SendChatTarget(ClientID, "DM gametype: 'death match'; you kill other tees, and get points. The player with the most points wins.");
+	// SendChatTarget(ClientID, "TDM gametype: same as dm, but with teams.");
+	// SendChatTarget(ClientID, "CTF gametype: 'capture the flag'; take the other team's flag to your own, and get points for your team.");
+	// SendChatTarget(ClientID, "(g) stand for grenade; (i) for instagib.");
+	// SendChatTarget(ClientID, "iFreeze gametype: freeze all tees of the other team to win. Stand near your teammates to melt them.");
+	return false;
+}
+
+bool CGameContext::ChatCmdlist(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
+	int AuthLevel = pSelf->Server()->IsAuthed(ClientID);
+
+	pSelf->SendChatTarget(ClientID, "----- Commands -----");
+	pSelf->SendChatTarget(ClientID, "\"/info\" Information about the mod");
+	pSelf->SendChatTarget(ClientID, "\"/credits\" See some credits");
+	pSelf->SendChatTarget(ClientID, "\"/stats or /stats_all\" Show player stats");
+	pSelf->SendChatTarget(ClientID, "\"/help\" Show information about the current gamemode");
+
+	if(g_Config.m_SvPrivateMessage || AuthLevel)
 	{
-		SendChatTarget(ClientID, "Credits goes to the whole Teeworlds-community and especially");
-		SendChatTarget(ClientID, "to BotoX, Tom and Greyfox. This mod has some of their ideas included.");
-		SendChatTarget(ClientID, "Also thanks to fisted and eeeee for their amazing loltext.");
-		SendChatTarget(ClientID, "Slightly modified by Pointer.");
-		return false;
+		pSelf->SendChatTarget(ClientID, "\"/w <Name/ID> <Msg>\" Send a private message to a player");
+		pSelf->SendChatTarget(ClientID, "\"/c <Msg>\" Answer to the player, the last PM came from");
 	}
-	else if(StrLeftComp(pMessage, "help"))
+	if(g_Config.m_SvChatMe || AuthLevel)
 	{
-		if (StrLeftComp(GameType(), "DM+")) {
-			SendChatTarget(ClientID, "DM+ gametype: 'death match'. Kill other tees for points. You can pick up weapons to use. Pick up hearts and shields to restore your health and armor!");
-		} else if (StrLeftComp(GameType(), "CTF+")) {
-			SendChatTarget(ClientID, "CTF+ gametype: 'capture the flag'. Pick up the flag of the other team and bring it to your own flag for points. You can pick up weapons to use. Pick up hearts and shields to restore your health and armor!");
-		} else if (StrLeftComp(GameType(), "TDM+")) {
-			SendChatTarget(ClientID, "TDM+ gametype: 'team death match'. Kill tees of the other team for points. You can pick up weapons to use. Pick up hearts and shields to restore your health and armor!");
-		}
-		else if (StrLeftComp(GameType(), "gDM+")) {
-			SendChatTarget(ClientID, "gDM+ gametype: 'death match'. Kill other tees for points. You can only use your grenade launcher, and it insta-kills");
-		} else if (StrLeftComp(GameType(), "gCTF+")) {
-			SendChatTarget(ClientID, "gCTF+ gametype: 'capture the flag'. Pick up the flag of the other team and bring it to your own flag for points. You can only use your grenade launcher, and it insta-kills");
-		} else if (StrLeftComp(GameType(), "gTDM+")) {
-			SendChatTarget(ClientID, "gTDM+ gametype: 'team death match'. Kill tees of the other team for points. You can only use your grenade launcher, and it insta-kills");
-		}
-		else if (StrLeftComp(GameType(), "iDM+")) {
-			SendChatTarget(ClientID, "iDM+ gametype: 'death match'. Kill other tees for points. You can only use your laser rifle, and it insta-kills");
-		} else if (StrLeftComp(GameType(), "iCTF+")) {
-			SendChatTarget(ClientID, "iCTF+ gametype: 'capture the flag'. Pick up the flag of the other team and bring it to your own flag for points. You can only use your laser rifle, and it insta-kills");
-		} else if (StrLeftComp(GameType(), "iTDM+")) {
-			SendChatTarget(ClientID, "iTDM+ gametype: 'team death match'. Kill tees of the other team for points. You can only use your laser rifle, and it insta-kills");
-		}
-		else if (StrLeftComp(GameType(), "HTF")) {
-			SendChatTarget(ClientID, "HTF gametype: 'hold the flag'. While holding the flag you gain points. You can pick up weapons to use. Pick up hearts and shields to restore your health and armor!");
-		} else if (StrLeftComp(GameType(), "gHTF")) {
-			SendChatTarget(ClientID, "gHTF gametype: 'hold the flag'. While holding the flag you gain points. You can only use your grenade launcher, and it insta-kills");
-		} else if (StrLeftComp(GameType(), "iHTF")) {
-			SendChatTarget(ClientID, "iHTF gametype: 'hold the flag'. While holding the flag you gain points. You can only use your laser rifle, and it insta-kills");
-		} else if (StrLeftComp(GameType(), "THTF")) {
-			SendChatTarget(ClientID, "THTF gametype: 'team hold the flag'. While holding the flag your team gains points. You can pick up weapons to use. Pick up hearts and shields to restore your health and armor!");
-		} else if (StrLeftComp(GameType(), "gTHTF")) {
-			SendChatTarget(ClientID, "gTHTF gametype: 'team hold the flag'. While holding the flag your team gains points. You can only use your grenade launcher, and it insta-kills");
-		} else if (StrLeftComp(GameType(), "iTHTF")) {
-			SendChatTarget(ClientID, "iTHTF gametype: ' team hold the flag'. While holding the flag your team gains points. You can only use your laser rifle, and it insta-kills");
-		}
-		else if (StrLeftComp(GameType(), "LMS+")) {
-			SendChatTarget(ClientID, "LMS+ gametype: 'last man standing'. Kill all others, but avoid dying too much to win. You can pick up weapons to use. Pick up hearts and shields to restore your health and armor!");
-		} else if (StrLeftComp(GameType(), "gLMS+")) {
-			SendChatTarget(ClientID, "gLMS+ gametype: 'last man standing'. Kill all others, but avoid dying too much to win. You can only use your grenade launcher, and it insta-kills");
-		} else if (StrLeftComp(GameType(), "iLMS+")) {
-			SendChatTarget(ClientID, "iLMS+ gametype: 'last man standing'. Kill all others, but avoid dying too much to win. You can only use your laser rifle, and it insta-kills");
-		} else if (StrLeftComp(GameType(), "LTS+")) {
-			SendChatTarget(ClientID, "LTS+ gametype: 'last team standing'. Kill the other team, but avoid dying too much to win. You can pick up weapons to use. Pick up hearts and shields to restore your health and armor!");
-		} else if (StrLeftComp(GameType(), "gLTS+")) {
-			SendChatTarget(ClientID, "gLTS+ gametype: 'last team standing'. Kill the other team, but avoid dying too much to win. You can only use your grenade launcher, and it insta-kills");
-		} else if (StrLeftComp(GameType(), "iLTS+")) {
-			SendChatTarget(ClientID, "iLTS+ gametype: 'last team standing'. Kill the other team, but avoid dying too much to win. You can only use your laser rifle, and it insta-kills");
-		}
-		else if (StrLeftComp(GameType(), "iFreeze+")) {
-			SendChatTarget(ClientID, "iFreeze gametype: freeze all tees of the other team to win. Stand near a frozen teammate to melt them.");
-		} else if (StrLeftComp(GameType(), "nDM+")) {
-			char aBuf[1024] = "No message (this should not appear)";
-			str_format(aBuf, sizeof(aBuf), "No items Death Match: Kill other tees for points. You can only use one weapon. The weapon will change every %d seconds", g_Config.m_SvNDMTime);
-			SendChatTarget(ClientID, aBuf);
-		}
-		else {
-			SendChatTarget(ClientID, "The current gametype is unknown");
-		}
-		// SendChatTarget(ClientID, "DM gametype: 'death match'; you kill other tees, and get points. The player with the most points wins.");
-		// SendChatTarget(ClientID, "TDM gametype: same as dm, but with teams.");
-		// SendChatTarget(ClientID, "CTF gametype: 'capture the flag'; take the other team's flag to your own, and get points for your team.");
-		// SendChatTarget(ClientID, "(g) stand for grenade; (i) for instagib.");
-		// SendChatTarget(ClientID, "iFreeze gametype: freeze all tees of the other team to win. Stand near your teammates to melt them.");
-		return false;
+		pSelf->SendChatTarget(ClientID, "\"/me <Msg>\" will display <yourname> <Msg> in the chat");
 	}
-	else if(StrLeftComp(pMessage, "cmdlist"))
+
+	if(g_Config.m_SvStopGoFeature)
 	{
-		SendChatTarget(ClientID, "----- Commands -----");
-		SendChatTarget(ClientID, "\"/info\" Information about the mod");
-		SendChatTarget(ClientID, "\"/credits\" See some credits");
-		SendChatTarget(ClientID, "\"/stats or /stats_all\" Show player stats");
-		SendChatTarget(ClientID, "\"/help\" Show information about the current gamemode");
+		pSelf->SendChatTarget(ClientID, "\"/stop\" Pause the game");
+		pSelf->SendChatTarget(ClientID, "\"/go\" Start the game");
+		pSelf->SendChatTarget(ClientID, "\"/restart\" Start a new round");
+	}
 
-		if(g_Config.m_SvPrivateMessage || AuthLevel)
-		{
-			SendChatTarget(ClientID, "\"/w <Name/ID> <Msg>\" Send a private message to a player");
-			SendChatTarget(ClientID, "\"/c <Msg>\" Answer to the player, the last PM came from");
-		}
-		if(g_Config.m_SvChatMe || AuthLevel)
-		{
-			SendChatTarget(ClientID, "\"/me <Msg>\" will display <yourname> <Msg> in the chat");
-		}
+	if(g_Config.m_SvXonxFeature)
+	{
+		pSelf->SendChatTarget(ClientID, "\"/reset\" Reset the Spectator Slots");
+		pSelf->SendChatTarget(ClientID, "\"/1on1\" - \"6on6\" Starts a war");
+	}
 
-		if(g_Config.m_SvStopGoFeature)
-		{
-			SendChatTarget(ClientID, "\"/stop\" Pause the game");
-			SendChatTarget(ClientID, "\"/go\" Start the game");
-			SendChatTarget(ClientID, "\"/restart\" Start a new round");
-		}
+	if(pSelf->CanExec(ClientID, "set_team"))
+	{
+		pSelf->SendChatTarget(ClientID, "\"/spec <client id>\" Set player to spectators");
+		pSelf->SendChatTarget(ClientID, "\"/red <client id>\" Set player to red team");
+		pSelf->SendChatTarget(ClientID, "\"/blue <client id>\" Set player to blue team");
+	}
+	return false;
+}
 
-		if(g_Config.m_SvXonxFeature)
-		{
-			SendChatTarget(ClientID, "\"/reset\" Reset the Spectator Slots");
-			SendChatTarget(ClientID, "\"/1on1\" - \"6on6\" Starts a war");
-		}
+bool CGameContext::ChatStop(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
 
-		if(CanExec(ClientID, "set_team"))
-		{
-			SendChatTarget(ClientID, "\"/spec <client id>\" Set player to spectators");
-			SendChatTarget(ClientID, "\"/red <client id>\" Set player to red team");
-			SendChatTarget(ClientID, "\"/blue <client id>\" Set player to blue team");
-		}
-		return false;
-	}
-	else if(StrLeftComp(pMessage, "stop"))
+	if(pSelf->m_apPlayers[ClientID]->GetTeam() != TEAM_SPECTATORS)
 	{
-		if(pPlayer->GetTeam() != TEAM_SPECTATORS)
+		if(g_Config.m_SvStopGoFeature)
 		{
-			if(g_Config.m_SvStopGoFeature)
+			if(!pSelf->m_World.m_Paused)
 			{
-				if(!m_World.m_Paused)
-				{
-					m_World.m_Paused = true;
-					SendChat(-1, CHAT_ALL, "Game paused.");
-				}
-				m_pController->m_FakeWarmup = 0;
+				pSelf->m_World.m_Paused = true;
+				pSelf->SendChat(-1, CHAT_ALL, "Game paused.");
 			}
-			else
-				SendChatTarget(ClientID, "This feature is not available at the moment.");
+			pSelf->m_pController->m_FakeWarmup = 0;
 		}
-		return true;
+		else
+			pSelf->SendChatTarget(ClientID, "This feature is not available at the moment.");
 	}
-	else if(StrLeftComp(pMessage, "go"))
+	return true;
+}
+
+bool CGameContext::ChatGo(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
+
+	if(pSelf->m_apPlayers[ClientID]->GetTeam() != TEAM_SPECTATORS)
+	{
+		if(g_Config.m_SvStopGoFeature)
 		{
-			if(pPlayer->GetTeam() != TEAM_SPECTATORS)
-			{
-				if(g_Config.m_SvStopGoFeature)
-				{
-					m_pController->m_FakeWarmup = Server()->TickSpeed() * g_Config.m_SvGoTime;
-				}
-				else
-					SendChatTarget(ClientID, "This feature is not available at the moment.");
-			}
-			return true;
+			pSelf->m_pController->m_FakeWarmup = pSelf->Server()->TickSpeed() * g_Config.m_SvGoTime;
 		}
-	else if(StrLeftComp(pMessage, "restart"))
+		else
+			pSelf->SendChatTarget(ClientID, "This feature is not available at the moment.");
+	}
+	return true;
+}
+
+bool CGameContext::ChatRestart(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
+
+	if(pSelf->m_apPlayers[ClientID]->GetTeam() != TEAM_SPECTATORS)
 	{
-		if(pPlayer->GetTeam() != TEAM_SPECTATORS)
+		if(g_Config.m_SvStopGoFeature)
 		{
-			if(g_Config.m_SvStopGoFeature)
+			if(pSelf->m_pController->IsWarmup())
 			{
-				if(m_pController->IsWarmup())
-				{
-					m_pController->DoWarmup(0);
-					m_pController->m_FakeWarmup = 0;
-				}
-				else
-					m_pController->DoWarmup(g_Config.m_SvGoTime);
+				pSelf->m_pController->DoWarmup(0);
+				pSelf->m_pController->m_FakeWarmup = 0;
 			}
 			else
-				SendChatTarget(ClientID, "This feature is not available at the moment.");
+				pSelf->m_pController->DoWarmup(g_Config.m_SvGoTime);
 		}
-		return true;
+		else
+			pSelf->SendChatTarget(ClientID, "This feature is not available at the moment.");
 	}
-	else if(StrLeftComp(pMessage, "1on1") || StrLeftComp(pMessage, "2on2") || StrLeftComp(pMessage, "3on3") ||
-			StrLeftComp(pMessage, "4on4") || StrLeftComp(pMessage, "5on5") || StrLeftComp(pMessage, "6on6"))
+	return true;
+}
+
+bool CGameContext::ChatXonX(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
+
+	if(pSelf->m_apPlayers[ClientID]->GetTeam() != TEAM_SPECTATORS)
 	{
-		if(pPlayer->GetTeam() != TEAM_SPECTATORS)
+		if(!g_Config.m_SvXonxFeature)
 		{
-			if(!g_Config.m_SvXonxFeature)
-			{
-				SendChatTarget(ClientID, "This feature is not available at the moment.");
-				return false;
-			}
-			else
-			{
-				int Mode = (int)pMessage[0] - (int)'0';
-				g_Config.m_SvSpectatorSlots = MAX_CLIENTS - 2*Mode;
-				m_pController->DoWarmup(g_Config.m_SvWarTime);
-				char aBuf[128];
+			pSelf->SendChatTarget(ClientID, "This feature is not available at the moment.");
+			return false;
+		}
+		else
+		{
+			int Mode = (int)pResult->m_pCommand[0] - (int)'0';
+			g_Config.m_SvSpectatorSlots = MAX_CLIENTS - 2*Mode;
+			pSelf->Console()->ConfigChanged(CONFIG_SvSpectatorSlots);
+			pSelf->m_pController->DoWarmup(g_Config.m_SvWarTime);
+			char aBuf[128];
 
-				str_format(aBuf, sizeof(aBuf), "Upcoming %don%d! Please stay on spectator", Mode, Mode);
-				SendBroadcast(aBuf, -1);
+			str_format(aBuf, sizeof(aBuf), "Upcoming %don%d! Please stay on spectator", Mode, Mode);
+			pSelf->SendBroadcast(aBuf, -1);
 
-				str_format(aBuf, sizeof(aBuf), "The %don%d will start in %d seconds!", Mode, Mode, g_Config.m_SvWarTime);
-				SendChat(-1, CHAT_ALL, aBuf);
-			}
+			str_format(aBuf, sizeof(aBuf), "The %don%d will start in %d seconds!", Mode, Mode, g_Config.m_SvWarTime);
+			pSelf->SendChat(-1, CHAT_ALL, aBuf);
 		}
-
-		return true;
 	}
-	else if(StrLeftComp(pMessage, "reset"))
+
+	return true;
+}
+
+bool CGameContext::ChatReset(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
+
+	if(pSelf->m_apPlayers[ClientID]->GetTeam() != TEAM_SPECTATORS)
 	{
-		if(pPlayer->GetTeam() != TEAM_SPECTATORS)
+		if(!g_Config.m_SvXonxFeature)
 		{
-			if(!g_Config.m_SvXonxFeature)
-			{
-				SendChatTarget(ClientID, "This feature is not available at the moment.");
-				return false;
-			}
-			else
-			{
-				g_Config.m_SvSpectatorSlots = 0;
-				SendChat(-1, CHAT_ALL, "Reset spectator slots");
-			}
+			pSelf->SendChatTarget(ClientID, "This feature is not available at the moment.");
+			return false;
+		}
+		else
+		{
+			g_Config.m_SvSpectatorSlots = 0;
+			pSelf->Console()->ConfigChanged(CONFIG_SvSpectatorSlots);
+			pSelf->SendChat(-1, CHAT_ALL, "Reset spectator slots");
 		}
-		return true;
 	}
-	else if((Len = StrLeftComp(pMessage, "stats_all")))
-	{
-		int ReceiverID = -1;
-		char aBuf[32] = { 0 };
-		CPlayer *pP = pPlayer;
+	return true;
+}
 
-		if (sscanf(pMessage, "stats_all %2s", aBuf) > 0)
-		{
-			pMessage += Len;
+CPlayer *CGameContext::ChatStatsPlayer(CChatCommands::CResult *pResult, char *pTitle, int TitleSize)
+{
+	int ClientID = pResult->m_ClientID;
+	pTitle[0] = 0;
+	if(!pResult->NumArguments())
+		return m_apPlayers[ClientID];
+
+	int ReceiverID = -1;
+	ParsePlayerName(const_cast<char *>(pResult->GetString(0)), &ReceiverID);
+	if(!IsValidCID(ReceiverID))
+	{
+		SendChatTarget(ClientID, "No player with this name ingame");
+		return 0;
+	}
 
-			ParsePlayerName((char*) pMessage, &ReceiverID);
+	str_format(pTitle, TitleSize, "(%s) ", Server()->ClientName(ReceiverID));
+	return m_apPlayers[ReceiverID];
+}
 
-			if(IsValidCID(ReceiverID))
-			{
-				pP = m_apPlayers[ReceiverID];
-				str_format(aBuf, sizeof(aBuf), "(%s) ", Server()->ClientName(ReceiverID));
-			}
-			else
-			{
-				SendChatTarget(ClientID, "No player with this name ingame");
-				return false;
-			}
-		}
-		// 	struct Stats
-		// {
-		// 	int m_Shots[NUM_WEAPONS];
-		// 	int m_TotalShots;
-		// 	int m_Kills;
-		// 	int m_Deaths;
-		// 	int m_Hits;
-		// 	int m_Captures;
-		// 	int m_LostFlags;
-		// 	double m_FastestCapture;
-		// } m_Stats;
-		char aaBuf[5][128];
-		str_format(aaBuf[0], sizeof(aaBuf[0]), "--- Statistics %s---", aBuf);
-		str_format(aaBuf[1], sizeof(aaBuf[1]), "Shots: {%d, %d, %d, %d, %d, %d} Tot. %d", pP->m_Stats.m_Shots[0], pP->m_Stats.m_Shots[1], pP->m_Stats.m_Shots[2], pP->m_Stats.m_Shots[3], pP->m_Stats.m_Shots[4], pP->m_Stats.m_Shots[5], pP->m_Stats.m_TotalShots);
-		str_format(aaBuf[2], sizeof(aaBuf[2]), "Kills: %d, Deaths: %d, Hits: %d", pP->m_Stats.m_Kills, pP->m_Stats.m_Deaths, pP->m_Stats.m_Hits);
-		str_format(aaBuf[3], sizeof(aaBuf[3]), "Flags: %d, Lost: %d, Fastest: %.2f", pP->m_Stats.m_Captures, pP->m_Stats.m_LostFlags, pP->m_Stats.m_FastestCapture);
-		str_format(aaBuf[4], sizeof(aaBuf[4]), "K/D Ratio: %.2f", (pP->m_Stats.m_Deaths > 0) ? ((float) pP->m_Stats.m_Kills / (float) pP->m_Stats.m_Deaths) : 0);
-
-		for (int i = 0; i < 5; i++)
-			SendChatTarget(ClientID, aaBuf[i]);
+bool CGameContext::ChatStatsAll(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
 
+	char aBuf[32];
+	CPlayer *pP = pSelf->ChatStatsPlayer(pResult, aBuf, sizeof(aBuf));
+	if(!pP)
 		return false;
-	}
-	else if((Len = StrLeftComp(pMessage, "stats")))
-	{
-		int ReceiverID = -1;
-		char aBuf[32] = { 0 };
-		CPlayer *pP = pPlayer;
-
-		if (sscanf(pMessage, "stats %2s", aBuf) > 0)
-		{
-			pMessage += Len;
 
-			ParsePlayerName((char*) pMessage, &ReceiverID);
+	char aaBuf[5][128];
+	str_format(aaBuf[0], sizeof(aaBuf[0]), "--- Statistics %s---", aBuf);
+	str_format(aaBuf[1], sizeof(aaBuf[1]), "Shots: {%d, %d, %d, %d, %d, %d} Tot. %d", pP->m_Stats.m_Shots[0], pP->m_Stats.m_Shots[1], pP->m_Stats.m_Shots[2], pP->m_Stats.m_Shots[3], pP->m_Stats.m_Shots[4], pP->m_Stats.m_Shots[5], pP->m_Stats.m_TotalShots);
+	str_format(aaBuf[2], sizeof(aaBuf[2]), "Kills: %d, Deaths: %d, Hits: %d", pP->m_Stats.m_Kills, pP->m_Stats.m_Deaths, pP->m_Stats.m_Hits);
+	str_format(aaBuf[3], sizeof(aaBuf[3]), "Flags: %d, Lost: %d, Fastest: %.2f", pP->m_Stats.m_Captures, pP->m_Stats.m_LostFlags, pP->m_Stats.m_FastestCapture);
+	str_format(aaBuf[4], sizeof(aaBuf[4]), "K/D Ratio: %.2f", (pP->m_Stats.m_Deaths > 0) ? ((float) pP->m_Stats.m_Kills / (float) pP->m_Stats.m_Deaths) : 0);
 
-			if(IsValidCID(ReceiverID))
-			{
-				pP = m_apPlayers[ReceiverID];
-				str_format(aBuf, sizeof(aBuf), "(%s) ", Server()->ClientName(ReceiverID));
-			}
-			else
-			{
-				SendChatTarget(ClientID, "No player with this name ingame");
-				return false;
-			}
-		}
+	for (int i = 0; i < 5; i++)
+		pSelf->SendChatTarget(ClientID, aaBuf[i]);
 
-		char aaBuf[5][128];
-		str_format(aaBuf[0], sizeof(aaBuf[0]), "--- Statistics %s---", aBuf);
-		str_format(aaBuf[1], sizeof(aaBuf[1]), "Total Shots: %d", pP->m_Stats.m_TotalShots);
-		str_format(aaBuf[2], sizeof(aaBuf[2]), "Kills: %d", pP->m_Stats.m_Kills);
-		str_format(aaBuf[3], sizeof(aaBuf[3]), "Deaths: %d", pP->m_Stats.m_Deaths);
-		str_format(aaBuf[4], sizeof(aaBuf[4]), "Ratio: %.2f", (pP->m_Stats.m_Deaths > 0) ? ((float) pP->m_Stats.m_Kills / (float) pP->m_Stats.m_Deaths) : 0);
+	return false;
+}
 
-		for (int i = 0; i < 5; i++)
-			SendChatTarget(ClientID, aaBuf[i]);
+bool CGameContext::ChatStats(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
 
+	char aBuf[32];
+	CPlayer *pP = pSelf->ChatStatsPlayer(pResult, aBuf, sizeof(aBuf));
+	if(!pP)
 		return false;
-	}
-	else if((Len=StrLeftComp(pMessage, "sayto")) || (Len=StrLeftComp(pMessage, "st")) || (Len=StrLeftComp(pMessage, "pm")) ||
-			(Len=StrLeftComp(pMessage, "w")) || (Len=StrLeftComp(pMessage, "whisper")))
-	{
-		if(!g_Config.m_SvPrivateMessage && !AuthLevel)
-			SendChatTarget(ClientID, "This feature is not available at the moment.");
-		else
-		{
-			int ReceiverID = -1;
 
-			char *pMsg = str_skip_whitespaces(const_cast<char*>(pMessage + Len));
+	char aaBuf[5][128];
+	str_format(aaBuf[0], sizeof(aaBuf[0]), "--- Statistics %s---", aBuf);
+	str_format(aaBuf[1], sizeof(aaBuf[1]), "Total Shots: %d", pP->m_Stats.m_TotalShots);
+	str_format(aaBuf[2], sizeof(aaBuf[2]), "Kills: %d", pP->m_Stats.m_Kills);
+	str_format(aaBuf[3], sizeof(aaBuf[3]), "Deaths: %d", pP->m_Stats.m_Deaths);
+	str_format(aaBuf[4], sizeof(aaBuf[4]), "Ratio: %.2f", (pP->m_Stats.m_Deaths > 0) ? ((float) pP->m_Stats.m_Kills / (float) pP->m_Stats.m_Deaths) : 0);
 
-			if(pMsg[0] == '\0')
-			{
-				SendChatTarget(ClientID, "Usage: \"/w <Name/ID> <Message>\"");
-				return false;
-			}
-
-			int Len = ParsePlayerName(pMsg, &ReceiverID);
+	for (int i = 0; i < 5; i++)
+		pSelf->SendChatTarget(ClientID, aaBuf[i]);
 
-			if(IsValidCID(ReceiverID))
-			{
-				if(ReceiverID == ClientID)
-				{
-					SendChatTarget(ClientID, "You can't send yourself a private message");
-				}
-				else
-				{
-					pMsg = str_skip_whitespaces(pMsg + Len);
+	return false;
+}
 
-					if(pMsg[0] == '\0')
-						SendChatTarget(ClientID, "Your message is empty");
-					else
-					{
-						char aBuf[512];
-						IServer::CClientInfo Info;
-						int infoExists = Server()->GetClientInfo(ReceiverID, &Info);
-						int ddnetversion = Info.m_DDNetVersion;
-						if (infoExists && ddnetversion > VERSION_DDNET_WHISPER) {
-							SendChatPrivate(ReceiverID, ClientID, CHAT_WHISPER_RECV, pMsg);
-						} else {
-							str_format(aBuf, sizeof(aBuf), "You received a private message from %s (ID: %d)", Server()->ClientName(ClientID), ClientID);
-							SendChatTarget(ReceiverID, aBuf);
-							str_format(aBuf, sizeof(aBuf), "← %s: %s", Server()->ClientName(ClientID), pMsg);
-							SendChatTarget(ReceiverID, aBuf);
-						}
-
-						infoExists = Server()->GetClientInfo(ClientID, &Info);
-						ddnetversion = Info.m_DDNetVersion;
-						if (infoExists && ddnetversion > VERSION_DDNET_WHISPER) {
-							SendChatPrivate(ClientID, ReceiverID, CHAT_WHISPER_SEND, pMsg);
-						} else {
-							str_format(aBuf, sizeof(aBuf), "→ %s: %s", Server()->ClientName(ReceiverID), pMsg);
-							SendChatTarget(ClientID, aBuf);
-						}
-
-						m_apPlayers[ReceiverID]->m_LastPMReceivedFrom = ClientID;
-						m_apPlayers[ClientID]->m_LastPMReceivedFrom = ReceiverID;
-
-						str_format(aBuf, sizeof(aBuf), "%d:%s sent a PM to %d:%s", ClientID, Server()->ClientName(ClientID), ReceiverID, Server()->ClientName(ReceiverID));
-						Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "PM", aBuf);
-					}
-				}
-			}
-			else
-				SendChatTarget(ClientID, "No player with this name or ID found");
-		}
-		return false;
+void CGameContext::SendPrivateMessage(int ClientID, int ReceiverID, const char *pMsg)
+{
+	char aBuf[512];
+	IServer::CClientInfo Info;
+	int infoExists = Server()->GetClientInfo(ReceiverID, &Info);
+	int ddnetversion = Info.m_DDNetVersion;
+	if (infoExists && ddnetversion > VERSION_DDNET_WHISPER) {
+		SendChatPrivate(ReceiverID, ClientID, CHAT_WHISPER_RECV, pMsg);
+	} else {
+		str_format(aBuf, sizeof(aBuf), "← %s: %s", Server()->ClientName(ClientID), pMsg);
+		SendChatTarget(ReceiverID, aBuf);
 	}
-	else if(Len=StrLeftComp(pMessage, "me"))
-	{
-		if(!g_Config.m_SvChatMe && !AuthLevel)
-			SendChatTarget(ClientID, "This feature is not available at the moment.");
-		else
-		{
-			int ReceiverID = -1;
 
-			char *pMsg = str_skip_whitespaces(const_cast<char*>(pMessage + Len));
+	infoExists = Server()->GetClientInfo(ClientID, &Info);
+	ddnetversion = Info.m_DDNetVersion;
+	if (infoExists && ddnetversion > VERSION_DDNET_WHISPER) {
+		SendChatPrivate(ClientID, ReceiverID, CHAT_WHISPER_SEND, pMsg);
+	} else {
+		str_format(aBuf, sizeof(aBuf), "→ %s: %s", Server()->ClientName(ReceiverID), pMsg);
+		SendChatTarget(ClientID, aBuf);
+	}
 
-			if(pMsg[0] == '\0')
-			{
-				SendChatTarget(ClientID, "Usage: \"/me <Message>\"");
-				return false;
-			}
+	m_apPlayers[ReceiverID]->m_LastPMReceivedFrom = ClientID;
+	m_apPlayers[ClientID]->m_LastPMReceivedFrom = ReceiverID;
 
-			int Len = ParsePlayerName(pMsg, &ReceiverID);
-			pMsg = str_skip_whitespaces(pMsg + Len);
+	str_format(aBuf, sizeof(aBuf), "%d:%s sent a PM to %d:%s", ClientID, Server()->ClientName(ClientID), ReceiverID, Server()->ClientName(ReceiverID));
+	Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "PM", aBuf);
+}
 
-			if(pMsg[0] == '\0')
-				SendChatTarget(ClientID, "Your message is empty");
-			else
-			{
-				char aBuf[512];
+bool CGameContext::ChatWhisper(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
 
-				str_format(aBuf, sizeof(aBuf), "### '%s' %s", Server()->ClientName(ClientID), pMsg);
-				SendChat(-1, CGameContext::CHAT_ALL, aBuf);
+	if(!g_Config.m_SvPrivateMessage && !pSelf->Server()->IsAuthed(ClientID))
+		pSelf->SendChatTarget(ClientID, "This feature is not available at the moment.");
+	else
+	{
+		int ReceiverID = -1;
 
-				Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "ME", aBuf);
-			}
+		if(!pResult->NumArguments())
+		{
+			pSelf->SendChatTarget(ClientID, "Usage: \"/w <Name/ID> <Message>\"");
+			return false;
 		}
-		return false;
-	}
-	else if((Len=StrLeftComp(pMessage, "ans")) || (Len=StrLeftComp(pMessage, "r") || (Len=StrLeftComp(pMessage, "c"))))
-	{
-		if(!g_Config.m_SvPrivateMessage && !AuthLevel)
-			SendChatTarget(ClientID, "This feature is not available at the moment.");
-		else
+
+		char *pMsg = const_cast<char *>(pResult->GetString(0));
+		int Len = pSelf->ParsePlayerName(pMsg, &ReceiverID);
+
+		if(pSelf->IsValidCID(ReceiverID))
 		{
-			int LastChatterID = m_apPlayers[ClientID]->m_LastPMReceivedFrom;
-			if(IsValidCID(LastChatterID))
+			if(ReceiverID == ClientID)
 			{
-				char *pMsg = str_skip_whitespaces(const_cast<char *>(pMessage+Len));
+				pSelf->SendChatTarget(ClientID, "You can't send yourself a private message");
+			}
+			else
+			{
+				pMsg = str_skip_whitespaces(pMsg + Len);
 
 				if(pMsg[0] == '\0')
-					SendChatTarget(ClientID, "Your Message is empty.");
+					pSelf->SendChatTarget(ClientID, "Your message is empty");
 				else
 				{
-					char aBuf[512];
-					// str_format(aBuf, sizeof(aBuf), "%s: %s", Server()->ClientName(ClientID), pMsg);
-					// SendChatTarget(LastChatterID, aBuf);
-					// SendChatTarget(ClientID, "PM successfully sent");
+					// tell clients without whisper support who the message comes from
 					IServer::CClientInfo Info;
-					int infoExists = Server()->GetClientInfo(LastChatterID, &Info);
-					int ddnetversion = Info.m_DDNetVersion;
-					if (infoExists && ddnetversion > VERSION_DDNET_WHISPER) {
-						SendChatPrivate(LastChatterID, ClientID, CHAT_WHISPER_RECV, pMsg);
-					} else {
-						str_format(aBuf, sizeof(aBuf), "← %s: %s", Server()->ClientName(ClientID), pMsg);
-						SendChatTarget(LastChatterID, aBuf);
-					}
-
-					infoExists = Server()->GetClientInfo(ClientID, &Info);
-					ddnetversion = Info.m_DDNetVersion;
-					if (infoExists && ddnetversion > VERSION_DDNET_WHISPER) {
-						SendChatPrivate(ClientID, LastChatterID, CHAT_WHISPER_SEND, pMsg);
-					} else {
-						str_format(aBuf, sizeof(aBuf), "→ %s: %s", Server()->ClientName(LastChatterID), pMsg);
-						SendChatTarget(ClientID, aBuf);
+					if(!pSelf->Server()->GetClientInfo(ReceiverID, &Info) || Info.m_DDNetVersion <= VERSION_DDNET_WHISPER)
+					{
+						char aBuf[128];
+						str_format(aBuf, sizeof(aBuf), "You received a private message from %s (ID: %d)", pSelf->Server()->ClientName(ClientID), ClientID);
+						pSelf->SendChatTarget(ReceiverID, aBuf);
 					}
-
-					m_apPlayers[LastChatterID]->m_LastPMReceivedFrom = ClientID;
-					m_apPlayers[ClientID]->m_LastPMReceivedFrom = LastChatterID;
-
-					str_format(aBuf, sizeof(aBuf), "%d:%s sent a PM to %d:%s", ClientID, Server()->ClientName(ClientID), LastChatterID, Server()->ClientName(LastChatterID));
-					Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "PM", aBuf);
+					pSelf->SendPrivateMessage(ClientID, ReceiverID, pMsg);
 				}
 			}
-			else
-			{
-				if(LastChatterID == -1)
-					SendChatTarget(ClientID, "Please first write a PM with /sayto or /w");
-				else if(LastChatterID == -2)
-					SendChatTarget(ClientID, "The original player left, please use /sayto or /w to write a new PM");
-				else //dafuq?
-					SendChatTarget(ClientID, "Something went kinda wrong. Use /sayto or /w");
-			}
 		}
-		return false;
+		else
+			pSelf->SendChatTarget(ClientID, "No player with this name or ID found");
 	}
-	else if(StrLeftComp(pMessage, "emote"))
+	return false;
+}
+
+bool CGameContext::ChatMe(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
+
+	if(!g_Config.m_SvChatMe && !pSelf->Server()->IsAuthed(ClientID))
+		pSelf->SendChatTarget(ClientID, "This feature is not available at the moment.");
+	else
 	{
-		char aType[16];
-		int Time = -1, Args;
-		if(!pPlayer->GetCharacter())
+		int ReceiverID = -1;
+
+		if(!pResult->NumArguments())
 		{
-			SendChatTarget(ClientID, "\"emote\" is not available at the moment. Join game or wait till you spawn to set.");
+			pSelf->SendChatTarget(ClientID, "Usage: \"/me <Message>\"");
 			return false;
 		}
 
-		if((Args = sscanf(pMessage, "emote %15s %d", aType, &Time)) >= 1)
+		char *pMsg = const_cast<char *>(pResult->GetString(0));
+		int Len = pSelf->ParsePlayerName(pMsg, &ReceiverID);
+		pMsg = str_skip_whitespaces(pMsg + Len);
+
+		if(pMsg[0] == '\0')
+			pSelf->SendChatTarget(ClientID, "Your message is empty");
+		else
 		{
-			if(Args < 2 || Time < 0)
-				Time = 2;
-
-			int Tick = Server()->Tick() + Time*Server()->TickSpeed();
-
-			if(!str_comp_nocase(aType, "surprise"))
-				pPlayer->GetCharacter()->SetEmoteFix(EMOTE_SURPRISE, Tick);
-			else if(!str_comp_nocase(aType, "blink"))
-				pPlayer->GetCharacter()->SetEmoteFix(EMOTE_BLINK, Tick);
-			else if(!str_comp_nocase(aType, "happy"))
-				pPlayer->GetCharacter()->SetEmoteFix(EMOTE_HAPPY, Tick);
-			else if(!str_comp_nocase(aType, "pain"))
-				pPlayer->GetCharacter()->SetEmoteFix(EMOTE_PAIN, Tick);
-			else if(!str_comp_nocase(aType, "angry"))
-				pPlayer->GetCharacter()->SetEmoteFix(EMOTE_ANGRY, Tick);
-			else if(!str_comp_nocase(aType, "normal"))
-				pPlayer->GetCharacter()->SetEmoteFix(EMOTE_NORMAL, Tick);
+			char aBuf[512];
+
+			str_format(aBuf, sizeof(aBuf), "### '%s' %s", pSelf->Server()->ClientName(ClientID), pMsg);
+			pSelf->SendChat(-1, CGameContext::CHAT_ALL, aBuf);
+
+			pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "ME", aBuf);
+		}
+	}
+	return false;
+}
+
+bool CGameContext::ChatAnswer(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
+
+	if(!g_Config.m_SvPrivateMessage && !pSelf->Server()->IsAuthed(ClientID))
+		pSelf->SendChatTarget(ClientID, "This feature is not available at the moment.");
+	else
+	{
+		int LastChatterID = pSelf->m_apPlayers[ClientID]->m_LastPMReceivedFrom;
+		if(pSelf->IsValidCID(LastChatterID))
+		{
+			if(!pResult->NumArguments())
+				pSelf->SendChatTarget(ClientID, "Your Message is empty.");
 			else
-				SendChatTarget(ClientID, "Unkown emote. Type \"/emote\"");
+				pSelf->SendPrivateMessage(ClientID, LastChatterID, pResult->GetString(0));
 		}
 		else
 		{
-			SendChatTarget(ClientID, "Usage: /emote <type> <sec>. Use as type: \"surprise\", \"blink\", \"happy\", \"pain\", \"angry\" or \"normal\".");
-			SendChatTarget(ClientID, "Example: \"/emote pain 10\" for showing 10 seconds emote pain.");
+			if(LastChatterID == -1)
+				pSelf->SendChatTarget(ClientID, "Please first write a PM with /sayto or /w");
+			else if(LastChatterID == -2)
+				pSelf->SendChatTarget(ClientID, "The original player left, please use /sayto or /w to write a new PM");
+			else //dafuq?
+				pSelf->SendChatTarget(ClientID, "Something went kinda wrong. Use /sayto or /w");
 		}
+	}
+	return false;
+}
 
+bool CGameContext::ChatEmote(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
+	CPlayer *pPlayer = pSelf->m_apPlayers[ClientID];
+
+	if(!pPlayer->GetCharacter())
+	{
+		pSelf->SendChatTarget(ClientID, "\"emote\" is not available at the moment. Join game or wait till you spawn to set.");
 		return false;
 	}
-	else if(StrLeftComp(pMessage, "spec"))
+
+	if(pResult->NumArguments() >= 1)
 	{
-		if(AuthLevel && CanExec(ClientID, "set_team"))
-		{
-			int ID;
-			if(sscanf(pMessage, "spec %d", &ID) == 1)
-			{
-				if (!IsValidCID(ID))
-					SendChatTarget(ClientID, "Invalid ID");
-				else
-					m_apPlayers[ID]->SetTeam(TEAM_SPECTATORS);
-			}
-		}
-		else {SendChatTarget(ClientID, "No such command. Type \"/cmdlist\" to get a list of available commands");}
-		return false; //true;
+		const char *pType = pResult->GetString(0);
+		int Time = pResult->NumArguments() >= 2 ? pResult->GetInteger(1) : -1;
+		if(Time < 0)
+			Time = 2;
+
+		int Tick = pSelf->Server()->Tick() + Time*pSelf->Server()->TickSpeed();
+
+		if(!str_comp_nocase(pType, "surprise"))
+			pPlayer->GetCharacter()->SetEmoteFix(EMOTE_SURPRISE, Tick);
+		else if(!str_comp_nocase(pType, "blink"))
+			pPlayer->GetCharacter()->SetEmoteFix(EMOTE_BLINK, Tick);
+		else if(!str_comp_nocase(pType, "happy"))
+			pPlayer->GetCharacter()->SetEmoteFix(EMOTE_HAPPY, Tick);
+		else if(!str_comp_nocase(pType, "pain"))
+			pPlayer->GetCharacter()->SetEmoteFix(EMOTE_PAIN, Tick);
+		else if(!str_comp_nocase(pType, "angry"))
+			pPlayer->GetCharacter()->SetEmoteFix(EMOTE_ANGRY, Tick);
+		else if(!str_comp_nocase(pType, "normal"))
+			pPlayer->GetCharacter()->SetEmoteFix(EMOTE_NORMAL, Tick);
+		else
+			pSelf->SendChatTarget(ClientID, "Unkown emote. Type \"/emote\"");
 	}
-	else if(StrLeftComp(pMessage, "red"))
+	else
 	{
-		if(AuthLevel && CanExec(ClientID, "set_team"))
-		{
-			int ID;
-			if(sscanf(pMessage, "red %d", &ID) == 1)
-			{
-				if (!IsValidCID(ID))
-					SendChatTarget(ClientID, "Invalid ID");
-				else
-					m_apPlayers[ID]->SetTeam(TEAM_RED);
-			}
-		}
-		else {SendChatTarget(ClientID, "No such command. Type \"/cmdlist\" to get a list of available commands");}
-		return false; //true;
+		pSelf->SendChatTarget(ClientID, "Usage: /emote <type> <sec>. Use as type: \"surprise\", \"blink\", \"happy\", \"pain\", \"angry\" or \"normal\".");
+		pSelf->SendChatTarget(ClientID, "Example: \"/emote pain 10\" for showing 10 seconds emote pain.");
 	}
-	else if(StrLeftComp(pMessage, "blue"))
+
+	return false;
+}
+
+bool CGameContext::ChatSetTeam(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
+
+	if(!pSelf->CanExec(ClientID, "set_team"))
 	{
-		if(AuthLevel && CanExec(ClientID, "set_team"))
-		{
-			int ID;
-			if (sscanf(pMessage, "blue %d", &ID) == 1)
-			{
-				if (!IsValidCID(ID))
-					SendChatTarget(ClientID, "Invalid ID");
-				else
-					m_apPlayers[ID]->SetTeam(TEAM_BLUE);
-			}
-		}
-		else {SendChatTarget(ClientID, "No such command. Type \"/cmdlist\" to get a list of available commands");}
-		return false; //true;
+		pSelf->SendChatTarget(ClientID, "No such command. Type \"/cmdlist\" to get a list of available commands");
+		return false;
 	}
-	else if(StrLeftComp(pMessage, "pause") && m_pController->IsLMS() && m_apPlayers[ClientID] && m_apPlayers[ClientID]->m_Lives <= 0)
+
+	int ID = pResult->GetInteger(0);
+	if(!pSelf->IsValidCID(ID))
+		pSelf->SendChatTarget(ClientID, "Invalid ID");
+	else if(!str_comp(pResult->m_pCommand, "spec"))
+		pSelf->m_apPlayers[ID]->SetTeam(TEAM_SPECTATORS);
+	else if(!str_comp(pResult->m_pCommand, "red"))
+		pSelf->m_apPlayers[ID]->SetTeam(TEAM_RED);
+	else
+		pSelf->m_apPlayers[ID]->SetTeam(TEAM_BLUE);
+	return false;
+}
+
+bool CGameContext::ChatPause(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
+
+	if(!pSelf->m_pController->IsLMS() || pSelf->m_apPlayers[ClientID]->m_Lives > 0)
 	{
-		int PlayerCount = 0, AliveCount = 0;
-		for (int i = 0; i < MAX_CLIENTS; i++)
-		{
-			if (m_apPlayers[i] && m_apPlayers[i]->m_IsReady && IsClientPlayer(i)) {
-				if (m_apPlayers[i] && m_apPlayers[i]->m_Lives > 0)
-					AliveCount++;
+		pSelf->SendChatTarget(ClientID, "No such command. Type \"/cmdlist\" to get a list of available commands");
+		return false;
+	}
 
-				PlayerCount++;
-			}
+	int PlayerCount = 0, AliveCount = 0;
+	for (int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if (pSelf->m_apPlayers[i] && pSelf->m_apPlayers[i]->m_IsReady && pSelf->IsClientPlayer(i)) {
+			if (pSelf->m_apPlayers[i] && pSelf->m_apPlayers[i]->m_Lives > 0)
+				AliveCount++;
+
+			PlayerCount++;
 		}
-		if (PlayerCount <= 1)
-			m_apPlayers[ClientID]->m_Lives = g_Config.m_SvLMSLives;
-		else
-			SendBroadcast("Please wait until the end of the round", ClientID);
 	}
+	if (PlayerCount <= 1)
+		pSelf->m_apPlayers[ClientID]->m_Lives = g_Config.m_SvLMSLives;
 	else
-		SendChatTarget(ClientID, "No such command. Type \"/cmdlist\" to get a list of available commands");
-
+		pSelf->SendBroadcast("Please wait until the end of the round", ClientID);
 	return false;
 }
 
@@ -0,0 +1,166 @@
+/* File is created for the TW+ mod
+ */
+
+#include <base/system.h>
+#include "chatcommands.h"
+
+static unsigned HashName(const char *pName, int Length)
+{
+	unsigned Hash = 5381;
+	for(int i = 0; i < Length; i++)
+		Hash = ((Hash << 5) + Hash) + pName[i];
+	return Hash;
+}
+
+int CChatCommands::CResult::GetInteger(int Index) const
+{
+	if(Index < 0 || Index >= m_NumArgs)
+		return 0;
+	return str_toint(m_apArgs[Index]);
+}
+
+const char *CChatCommands::CResult::GetString(int Index) const
+{
+	if(Index < 0 || Index >= m_NumArgs)
+		return "";
+	return m_apArgs[Index];
+}
+
+CChatCommands::CChatCommands()
+{
+	m_NumCommands = 0;
+	for(int i = 0; i < NUM_BUCKETS; i++)
+		m_aBuckets[i] = -1;
+	m_pLast = 0;
+	m_LastCooldownLeft = 0;
+}
+
+void CChatCommands::Register(const char *pName, const char *pParams, int AuthLevel, int Flags, const int *pCooldown, FCommandCallback pfnFunc, void *pUser, const char *pHelp)
+{
+	if(m_NumCommands == MAX_COMMANDS)
+	{
+		dbg_msg("chatcommands", "too many commands, '%s' not registered", pName);
+		return;
+	}
+
+	int Length = str_length(pName);
+	if(Find(pName, Length))
+	{
+		dbg_msg("chatcommands", "command '%s' registered twice", pName);
+		return;
+	}
+
+	CCommand *pCommand = &m_aCommands[m_NumCommands];
+	pCommand->m_pName = pName;
+	pCommand->m_pParams = pParams;
+	pCommand->m_pHelp = pHelp;
+	pCommand->m_AuthLevel = AuthLevel;
+	pCommand->m_Flags = Flags;
+	pCommand->m_pCooldown = pCooldown;
+	pCommand->m_pfnCallback = pfnFunc;
+	pCommand->m_pUserData = pUser;
+	mem_zero(pCommand->m_aLastUse, sizeof(pCommand->m_aLastUse));
+
+	unsigned Bucket = HashName(pName, Length)%NUM_BUCKETS;
+	pCommand->m_Next = m_aBuckets[Bucket];
+	m_aBuckets[Bucket] = m_NumCommands++;
+}
+
+CChatCommands::CCommand *CChatCommands::Find(const char *pName, int Length)
+{
+	for(int i = m_aBuckets[HashName(pName, Length)%NUM_BUCKETS]; i >= 0; i = m_aCommands[i].m_Next)
+	{
+		if(str_comp_num(m_aCommands[i].m_pName, pName, Length) == 0 && m_aCommands[i].m_pName[Length] == 0)
+			return &m_aCommands[i];
+	}
+	return 0;
+}
+
+bool CChatCommands::ParseArgs(CResult *pResult, const char *pParams, char *pStr)
+{
+	bool Optional = false;
+	pResult->m_NumArgs = 0;
+
+	for(; *pParams; pParams++)
+	{
+		if(*pParams == '?')
+		{
+			Optional = true;
+			continue;
+		}
+
+		pStr = str_skip_whitespaces(pStr);
+		if(!*pStr)
+			return Optional;
+		if(pResult->m_NumArgs == MAX_ARGS)
+			return false;
+
+		pResult->m_apArgs[pResult->m_NumArgs++] = pStr;
+		if(*pParams == 'r')
+			return true;
+
+		char *pEnd = str_skip_to_whitespace(pStr);
+		if(*pParams == 'i')
+		{
+			char *p = pStr;
+			if(*p == '-')
+				p++;
+			if(p == pEnd)
+				return false;
+			for(; p < pEnd; p++)
+				if(*p < '0' || *p > '9')
+					return false;
+		}
+
+		if(*pEnd)
+			*pEnd++ = 0;
+		pStr = pEnd;
+	}
+	return true;
+}
+
+int CChatCommands::Execute(const char *pMessage, int ClientID, int AuthLevel, int Tick)
+{
+	m_pLast = 0;
+	m_LastCooldownLeft = 0;
+
+	bool Prefixed = pMessage[0] == '/';
+	if(Prefixed)
+		pMessage++;
+
+	int Length = 0;
+	while(pMessage[Length] && pMessage[Length] != ' ')
+		Length++;
+
+	CCommand *pCommand = Find(pMessage, Length);
+	if(!Prefixed && (!pCommand || !(pCommand->m_Flags&FLAG_NOPREFIX)))
+		return EXEC_NONE;
+	if(!pCommand || pCommand->m_AuthLevel > AuthLevel)
+		return EXEC_UNKNOWN;
+	m_pLast = pCommand;
+
+	// authed players are not limited
+	int *pLastUse = &pCommand->m_aLastUse[ClientID];
+	int Cooldown = pCommand->m_pCooldown ? *pCommand->m_pCooldown*SERVER_TICK_SPEED : 0;
+	if(Cooldown && AuthLevel == AUTH_NONE && *pLastUse && *pLastUse+Cooldown > Tick)
+	{
+		m_LastCooldownLeft = *pLastUse+Cooldown-Tick;
+		return EXEC_COOLDOWN;
+	}
+
+	CResult Result;
+	Result.m_pCommand = pCommand->m_pName;
+	Result.m_ClientID = ClientID;
+	str_copy(Result.m_aLine, pMessage+Length, sizeof(Result.m_aLine));
+	if(!ParseArgs(&Result, pCommand->m_pParams, Result.m_aLine))
+		return EXEC_USAGE;
+
+	*pLastUse = Tick;
+	return pCommand->m_pfnCallback(&Result, pCommand->m_pUserData) ? EXEC_PUBLIC : EXEC_PRIVATE;
+}
+
+void CChatCommands::ResetClient(int ClientID)
+{
+	for(int i = 0; i < m_NumCommands; i++)
+		m_aCommands[i].m_aLastUse[ClientID] = 0;
+}
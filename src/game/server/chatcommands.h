@@ -0,0 +1,113 @@
+/* File is created for the TW+ mod
+ */
+
+#ifndef GAME_SERVER_CHATCOMMANDS_H
+#define GAME_SERVER_CHATCOMMANDS_H
+
+#include <engine/shared/protocol.h>
+
+/**
+ * Hashed table of the commands players can use in chat
+ */
+class CChatCommands
+{
+public:
+	enum
+	{
+		MAX_COMMANDS=64,
+		MAX_ARGS=4,
+		MAX_LINE_LENGTH=512,
+		NUM_BUCKETS=64,
+
+		AUTH_NONE=0,
+		AUTH_MOD,
+		AUTH_ADMIN,
+
+		FLAG_NOPREFIX=1, // also triggered without a leading '/'
+	};
+
+	class CResult
+	{
+		char m_aLine[MAX_LINE_LENGTH];
+		const char *m_apArgs[MAX_ARGS];
+		int m_NumArgs;
+
+		friend class CChatCommands;
+	public:
+		const char *m_pCommand;
+		int m_ClientID;
+
+		int NumArguments() const { return m_NumArgs; }
+		int GetInteger(int Index) const;
+		const char *GetString(int Index) const;
+	};
+
+	/**
+	 * Returns true if the message should also be sent publicly
+	 */
+	typedef bool (*FCommandCallback)(CResult *pResult, void *pUserData);
+
+	enum
+	{
+		EXEC_NONE=0, // not a command, send the message as usual
+		EXEC_PUBLIC, // executed, send the message as usual
+		EXEC_PRIVATE, // executed, don't send the message
+		EXEC_UNKNOWN, // no such command or not allowed to use it
+		EXEC_USAGE, // the arguments don't match
+		EXEC_COOLDOWN, // used again too soon
+	};
+
+	CChatCommands();
+
+	/**
+	 * Params: 'i' integer, 's' word, 'r' rest of the line, all after '?' are optional.
+	 * pCooldown points to the seconds a player has to wait between uses, 0 for none.
+	 * It is read on every use, so a config variable applies right away
+	 */
+	void Register(const char *pName, const char *pParams, int AuthLevel, int Flags, const int *pCooldown, FCommandCallback pfnFunc, void *pUser, const char *pHelp);
+
+	/**
+	 * Runs the command in pMessage, returns one of EXEC_*
+	 */
+	int Execute(const char *pMessage, int ClientID, int AuthLevel, int Tick);
+
+	/**
+	 * Information about the command of the last Execute call
+	 */
+	const char *LastName() const { return m_pLast ? m_pLast->m_pName : ""; }
+	const char *LastParams() const { return m_pLast ? m_pLast->m_pParams : ""; }
+	const char *LastHelp() const { return m_pLast ? m_pLast->m_pHelp : ""; }
+	int LastCooldownLeft() const { return m_LastCooldownLeft; }
+
+	/**
+	 * Forget the cooldowns of a client slot
+	 */
+	void ResetClient(int ClientID);
+
+private:
+	struct CCommand
+	{
+		const char *m_pName;
+		const char *m_pParams;
+		const char *m_pHelp;
+		int m_AuthLevel;
+		int m_Flags;
+		const int *m_pCooldown;
+		FCommandCallback m_pfnCallback;
+		void *m_pUserData;
+		int m_Next; // next command in the bucket or -1
+		int m_aLastUse[MAX_CLIENTS];
+	};
+
+	CCommand *Find(const char *pName, int Length);
+	bool ParseArgs(CResult *pResult, const char *pParams, char *pStr);
+
+	CCommand m_aCommands[MAX_COMMANDS];
+	int m_NumCommands;
+	int m_aBuckets[NUM_BUCKETS];
+
+	const CCommand *m_pLast;
+	int m_LastCooldownLeft;
+};
+
+#endif
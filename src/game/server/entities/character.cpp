@@ -824,9 +824,9 @@ void CCharacter::Tick()
 					m_MeltTicks++;
 					FoundMelter = true;
 					// Send "thawed" on half of melttime
-					if (m_MeltTicks == (int)(Server()->TickSpeed() * g_Config.m_SvIFreezeMeltTime * 0.0005f))
+					if (m_MeltTicks == GameServer()->m_IFreezeThawTicks)
 						GameServer()->SendBroadcast("You are being thawed", m_pPlayer->GetCID());
-					else if (m_MeltTicks >= Server()->TickSpeed() * g_Config.m_SvIFreezeMeltTime * 0.001f)
+					else if (m_MeltTicks >= GameServer()->m_IFreezeMeltTicks)
 						Melt(apCloseChars[i]->GetPlayer()->GetCID());
 					break;
 				}
@@ -1195,6 +1195,7 @@ void CCharacter::Die(int Killer, int Weapon)
 			   Killer, Server()->ClientName(Killer),
 			   m_pPlayer->GetCID(), Server()->ClientName(m_pPlayer->GetCID()), Weapon, ModeSpecial);
 	GameServer()->Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "game", aBuf);
+	GameServer()->m_pController->SaveKill(Killer, m_pPlayer->GetCID(), Weapon, ModeSpecial);
 
 	if (GameServer()->m_pController->IsInstagib())
 	{
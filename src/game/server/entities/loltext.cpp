@@ -3,10 +3,11 @@
 #include <game/server/gamecontext.h>
 #include "loltext.h"
 
-ClolPlasma *CLoltext::s_aapPlasma[MAX_LOLTEXTS][MAX_PLASMA_PER_LOLTEXT];
-int CLoltext::s_aExpire[MAX_LOLTEXTS];
+CLoltext::CGlyph CLoltext::s_aGlyphs[256];
+bool CLoltext::s_GlyphsInited = false;
+CLoltext *CLoltext::s_apTexts[MAX_LOLTEXTS];
 
-ClolPlasma::ClolPlasma(CGameWorld *pGameWorld, CEntity *pParent, vec2 Pos, vec2 Vel, int Lifespan)
+CLoltext::CLoltext(CGameWorld *pGameWorld, CEntity *pParent, vec2 Pos, vec2 Vel, int Lifespan)
 : CEntity(pGameWorld, CGameWorld::ENTTYPE_LASER)
 {
 	m_LocalPos = vec2(0.0f, 0.0f);
@@ -16,15 +17,45 @@ ClolPlasma::ClolPlasma(CGameWorld *pGameWorld, CEntity *pParent, vec2 Pos, vec2
 	m_Life = Lifespan;
 	m_StartTick = Server()->Tick();
 	m_pParent = pParent;
+	m_TextID = -1;
+	m_NumPoints = 0;
+	m_BoxMin = vec2(0.0f, 0.0f);
+	m_BoxMax = vec2(0.0f, 0.0f);
 	GameWorld()->InsertEntity(this);
 }
 
-void ClolPlasma::Reset()
+CLoltext::~CLoltext()
+{
+	for(int i = 0; i < m_NumPoints; i++)
+		Server()->SnapFreeID(m_aIDs[i]);
+	if(m_TextID >= 0 && s_apTexts[m_TextID] == this)
+		s_apTexts[m_TextID] = 0;
+}
+
+void CLoltext::AddPoint(vec2 Offset)
+{
+	if(m_NumPoints == 0)
+	{
+		m_BoxMin = Offset;
+		m_BoxMax = Offset;
+	}
+	else
+	{
+		m_BoxMin = vec2(min(m_BoxMin.x, Offset.x), min(m_BoxMin.y, Offset.y));
+		m_BoxMax = vec2(max(m_BoxMax.x, Offset.x), max(m_BoxMax.y, Offset.y));
+	}
+
+	m_aPoints[m_NumPoints] = Offset;
+	m_aIDs[m_NumPoints] = Server()->SnapNewID();
+	m_NumPoints++;
+}
+
+void CLoltext::Reset()
 {
 	GameWorld()->DestroyEntity(this);
 }
 
-void ClolPlasma::Tick()
+void CLoltext::Tick()
 {
 	if (m_Life < 0)
 	{
@@ -36,23 +67,51 @@ void ClolPlasma::Tick()
 	CEntity::m_Pos = (m_pParent?m_pParent->m_Pos:vec2(0.0f,0.0f)) + m_StartOff + (m_LocalPos += m_Vel);
 }
 
-void ClolPlasma::Snap(int SnappingClient)
+void CLoltext::Snap(int SnappingClient)
 {
-	if (NetworkClipped(SnappingClient))
-		return;
-
-
-	CNetObj_Laser *pObj = static_cast<CNetObj_Laser*>
-	            (Server()->SnapNewItem(NETOBJTYPE_LASER, m_ID, sizeof(CNetObj_Laser)));
+	// clip against the point of the bounding box closest to the view
+	if(SnappingClient != -1)
+	{
+		vec2 ViewPos = GameServer()->m_apPlayers[SnappingClient]->m_ViewPos;
+		vec2 Closest = vec2(clamp(ViewPos.x, m_Pos.x+m_BoxMin.x, m_Pos.x+m_BoxMax.x), clamp(ViewPos.y, m_Pos.y+m_BoxMin.y, m_Pos.y+m_BoxMax.y));
+		if(NetworkClipped(SnappingClient, Closest))
+			return;
+	}
 
-	pObj->m_X = (int)m_Pos.x;
-	pObj->m_Y = (int)m_Pos.y;
-	pObj->m_FromX = (int)m_Pos.x;
-	pObj->m_FromY = (int)m_Pos.y;
-	pObj->m_StartTick = m_StartTick;
+	for(int i = 0; i < m_NumPoints; i++)
+	{
+		CNetObj_Laser *pObj = static_cast<CNetObj_Laser*>
+		            (Server()->SnapNewItem(NETOBJTYPE_LASER, m_aIDs[i], sizeof(CNetObj_Laser)));
+		if(!pObj)
+			return;
 
+		int X = (int)(m_Pos.x+m_aPoints[i].x);
+		int Y = (int)(m_Pos.y+m_aPoints[i].y);
+		pObj->m_X = X;
+		pObj->m_Y = Y;
+		pObj->m_FromX = X;
+		pObj->m_FromY = Y;
+		pObj->m_StartTick = m_StartTick;
+	}
 }
 
+void CLoltext::InitGlyphs()
+{
+	for(int c = 0; c < 256; c++)
+	{
+		CGlyph *pGlyph = &s_aGlyphs[c];
+		pGlyph->m_NumPoints = 0;
+		for(int y = 0; y < 5/*XXX*/; ++y)
+			for(int x = 0; x < 3/*XXX*/; ++x)
+				if (s_aaaChars[c][y][x])
+				{
+					pGlyph->m_aX[pGlyph->m_NumPoints] = x;
+					pGlyph->m_aY[pGlyph->m_NumPoints] = y;
+					pGlyph->m_NumPoints++;
+				}
+	}
+	s_GlyphsInited = true;
+}
 
 vec2 CLoltext::TextSize(const char *pText)
 {
@@ -71,6 +130,9 @@ vec2 CLoltext::TextSize(const char *pText)
 
 int CLoltext::Create(CGameWorld *pGameWorld, CEntity *pParent, vec2 Pos, vec2 Vel, int Lifespan, const char *pText, bool Center, bool Follow)
 {
+	if (!s_GlyphsInited)
+		InitGlyphs();
+
 	char c;
 	vec2 CurPos = Pos;
 	if (Center)
@@ -84,20 +146,17 @@ int CLoltext::Create(CGameWorld *pGameWorld, CEntity *pParent, vec2 Pos, vec2 Ve
 
 	int TextID = 0;
 	for(; TextID < MAX_LOLTEXTS; ++TextID)
-		if (s_aExpire[TextID] < pGameWorld->Server()->Tick())
-		{
-			s_aExpire[TextID] = pGameWorld->Server()->Tick() + Lifespan;
+		if (!s_apTexts[TextID])
 			break;
-		}
 
 	if (TextID == MAX_LOLTEXTS)
 		return -1;
 
-	int NumPlasmas = 0;
-
-	for(int i = 0; i < MAX_PLASMA_PER_LOLTEXT; i++)
-		s_aapPlasma[TextID][i] = 0;
+	CLoltext *pLoltext = new CLoltext(pGameWorld, pParent, CurPos, Vel, Lifespan);
+	pLoltext->m_TextID = TextID;
+	s_apTexts[TextID] = pLoltext;
 
+	vec2 Offset = vec2(0.0f, 0.0f);
 	while((c = *pText++))
 	{
 		if (c >= 'a' && c <= 'z')
@@ -105,12 +164,10 @@ int CLoltext::Create(CGameWorld *pGameWorld, CEntity *pParent, vec2 Pos, vec2 Ve
 		if (c != ' ' && !HasRepr(c))
 			continue;
 
-		for(int y = 0; y < 5/*XXX*/; ++y)
-			for(int x = 0; x < 3/*XXX*/; ++x)
-				if (s_aaaChars[(unsigned)c][y][x] && NumPlasmas < MAX_PLASMA_PER_LOLTEXT)
-					s_aapPlasma[TextID][NumPlasmas++] =
-						        new ClolPlasma(pGameWorld, pParent, CurPos + vec2(x*g_Config.m_SvLoltextHspace, y*g_Config.m_SvLoltextVspace), Vel, Lifespan);
-		CurPos.x += 4*g_Config.m_SvLoltextHspace;
+		const CGlyph *pGlyph = &s_aGlyphs[(unsigned char)c];
+		for(int i = 0; i < pGlyph->m_NumPoints && pLoltext->m_NumPoints < MAX_PLASMA_PER_LOLTEXT; i++)
+			pLoltext->AddPoint(Offset + vec2(pGlyph->m_aX[i]*g_Config.m_SvLoltextHspace, pGlyph->m_aY[i]*g_Config.m_SvLoltextVspace));
+		Offset.x += 4*g_Config.m_SvLoltextHspace;
 	}
 	return TextID;
 }
@@ -118,17 +175,7 @@ int CLoltext::Create(CGameWorld *pGameWorld, CEntity *pParent, vec2 Pos, vec2 Ve
 void CLoltext::Dump()
 {
 	for(int i = 0; i < MAX_LOLTEXTS; i++)
-		dbg_msg("lt", "s_aExpire[%d] = %d", i, s_aExpire[i]);
-
-	for(int i = 0; i < MAX_LOLTEXTS; i++)
-	{
-		int Count = 0;
-		for(int j = 0; j < MAX_PLASMA_PER_LOLTEXT; j++)
-			if (s_aapPlasma[i][j])
-				Count++;
-		dbg_msg("tl", "|s_aapPlasma[%d]| = %d", i, Count);
-	}
-
+		dbg_msg("lt", "|s_apTexts[%d]| = %d", i, s_apTexts[i] ? s_apTexts[i]->m_NumPoints : -1);
 }
 
 void CLoltext::Destroy(CGameWorld *pGameWorld, int TextID)
@@ -139,30 +186,20 @@ void CLoltext::Destroy(CGameWorld *pGameWorld, int TextID)
 			Destroy(pGameWorld, i);
 		return;
 	}
-	
-	if (TextID < 0 || TextID >= MAX_LOLTEXTS)
-		return;
 
-	if (s_aExpire[TextID] < pGameWorld->Server()->Tick())
-	{
-		s_aExpire[TextID] = 0; //explicitly unset incase map cycles because Tick counting starts over with 0 then.
+	if (TextID < 0 || TextID >= MAX_LOLTEXTS || !s_apTexts[TextID])
 		return;
-	}
-	
-	for(int i = 0; i < MAX_PLASMA_PER_LOLTEXT; i++)
-		if (s_aapPlasma[TextID][i])
-			s_aapPlasma[TextID][i]->Reset();
 
-	s_aExpire[TextID] = 0;
+	// the slot is free for new texts right away, the entity goes with the next world tick
+	s_apTexts[TextID]->Reset();
+	s_apTexts[TextID] = 0;
 }
 
 bool CLoltext::HasRepr(char c) // can be removed when we have a full character set
 {
-	for(int y = 0; y < 5; ++y)
-		for(int x = 0; x < 3; ++x)
-			if (s_aaaChars[(unsigned)c][y][x])
-				return true;
-	return false;
+	if (!s_GlyphsInited)
+		InitGlyphs();
+	return s_aGlyphs[(unsigned char)c].m_NumPoints > 0;
 }
 
 bool CLoltext::s_aaaChars[256][5][3] = {
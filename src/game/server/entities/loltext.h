@@ -9,39 +9,54 @@
 //usage: GameServer()->CreateLoltext(...)
 //it will dispose itself after lifespan ended
 
-class ClolPlasma : public CEntity
+// one entity per text, every lit glyph cell is snapped as a laser dot
+class CLoltext : public CEntity
 {
 public:
 	//position relative to pParent->m_Pos. if pParent is NULL, Pos is absolute. lifespan in ticks
-	ClolPlasma(CGameWorld *pGameWorld, CEntity *pParent, vec2 Pos, vec2 Vel, int Lifespan);
+	CLoltext(CGameWorld *pGameWorld, CEntity *pParent, vec2 Pos, vec2 Vel, int Lifespan);
+	virtual ~CLoltext();
 
 	virtual void Reset();
 	virtual void Tick();
 	virtual void Snap(int SnappingClient);
 
+	static vec2 TextSize(const char *pText);
+	static int Create(CGameWorld *pGameWorld, CEntity *pParent, vec2 Pos, vec2 Vel, int Lifespan, const char *pText, bool Center, bool Follow);
+	static void Destroy(CGameWorld *pGameWorld, int TextID);
+	static void Dump(); //debugging
 
 private:
+	struct CGlyph
+	{
+		int m_NumPoints;
+		unsigned char m_aX[5*3];
+		unsigned char m_aY[5*3];
+	};
+
+	static bool s_aaaChars[256][5][3];
+	static CGlyph s_aGlyphs[256];
+	static bool s_GlyphsInited;
+	static CLoltext *s_apTexts[MAX_LOLTEXTS];
+	static void InitGlyphs();
+	static bool HasRepr(char c);
+
+	void AddPoint(vec2 Offset);
+
 	vec2 m_LocalPos; // local coordinate system is origin'd wherever we actually start (i.e. this is (0,0) after creation)
 	vec2 m_Vel;
 	int m_Life; // remaining ticks
 	int m_StartTick; // tick created
 	vec2 m_StartOff; // initial offset from parent, for proper following
 	CEntity *m_pParent;
-};
-
-class CLoltext
-{
-private:
-	static bool s_aaaChars[256][5][3];
-	static ClolPlasma *s_aapPlasma[MAX_LOLTEXTS][MAX_PLASMA_PER_LOLTEXT];
-	static int s_aExpire[MAX_LOLTEXTS];
-	static bool HasRepr(char c);
-public:
-	static vec2 TextSize(const char *pText);
-	static int Create(CGameWorld *pGameWorld, CEntity *pParent, vec2 Pos, vec2 Vel, int Lifespan, const char *pText, bool Center, bool Follow);
-	static void Destroy(CGameWorld *pGameWorld, int TextID);
-	static void Dump(); //debugging
+	int m_TextID;
+
+	// dots relative to m_Pos
+	int m_NumPoints;
+	vec2 m_aPoints[MAX_PLASMA_PER_LOLTEXT];
+	int m_aIDs[MAX_PLASMA_PER_LOLTEXT];
+	vec2 m_BoxMin;
+	vec2 m_BoxMax;
 };
 
 #endif
-
@@ -31,7 +31,7 @@ void CProjectile::Reset()
 	GameServer()->m_World.DestroyEntity(this);
 }
 
-vec2 CProjectile::GetPos(float Time)
+void CProjectile::GetMotion(CMotion *pMotion)
 {
 	float Curvature = 0;
 	float Speed = 0;
@@ -54,19 +54,34 @@ vec2 CProjectile::GetPos(float Time)
 			break;
 	}
 
-	return CalcPos(m_Pos, m_Direction, Curvature, Speed, Time);
+	pMotion->m_Pos = m_Pos;
+	pMotion->m_Direction = m_Direction;
+	pMotion->m_Curvature = Curvature;
+	pMotion->m_Speed = Speed;
+	pMotion->m_StartTick = m_StartTick;
+}
+
+vec2 CProjectile::GetPos(float Time)
+{
+	CMotion Motion;
+	GetMotion(&Motion);
+	return CalcPos(Motion.m_Pos, Motion.m_Direction, Motion.m_Curvature, Motion.m_Speed, Time);
 }
 
 
 void CProjectile::Tick()
 {
+	// the world advances all projectiles at once, see CGameWorld::TickProjectiles
 	float Pt = (Server()->Tick()-m_StartTick-1)/(float)Server()->TickSpeed();
 	float Ct = (Server()->Tick()-m_StartTick)/(float)Server()->TickSpeed();
-	vec2 PrevPos = GetPos(Pt);
-	vec2 CurPos = GetPos(Ct);
+	Advance(GetPos(Pt), GetPos(Ct));
+}
+
+void CProjectile::Advance(vec2 PrevPos, vec2 CurPos)
+{
 	int Collide = GameServer()->Collision()->IntersectLine(PrevPos, CurPos, &CurPos, 0);
 	CCharacter *OwnerChar = GameServer()->GetPlayerChar(m_Owner);
-	CCharacter *TargetChr = GameServer()->m_World.IntersectCharacter(PrevPos, CurPos, 6.0f, CurPos, OwnerChar);
+	CCharacter *TargetChr = GameServer()->m_World.IntersectCharacterGrid(PrevPos, CurPos, 6.0f, CurPos, OwnerChar);
 
 	m_LifeSpan--;
 
@@ -106,7 +121,8 @@ void CProjectile::Tick()
 			GameServer()->m_World.DestroyEntity(this);
 		}
 	} else if (g_Config.m_SvProjectileTeleport) {
-		if (GameServer()->Collision()->GetCollisionAt(CurPos.x, CurPos.y)&CCollision::COLFLAG_TELEONE) {
+		int TileFlags = GameServer()->Collision()->GetCollisionAt(CurPos.x, CurPos.y);
+		if (TileFlags&CCollision::COLFLAG_TELEONE) {
 			if (!m_inTele) {
 				m_inTele = true;
 				int x = GameServer()->Collision()->getTeleX(0);
@@ -117,7 +133,7 @@ void CProjectile::Tick()
 				vec2 end = {(float)tx, (float)ty};
 				m_Pos = m_Pos - start * 32 + end * 32;
 			}
-		} else if (GameServer()->Collision()->GetCollisionAt(CurPos.x, CurPos.y)&CCollision::COLFLAG_TELETWO) {
+		} else if (TileFlags&CCollision::COLFLAG_TELETWO) {
 			if (!m_inTele) {
 				m_inTele = true;
 				int x = GameServer()->Collision()->getTeleX(1);
@@ -128,7 +144,7 @@ void CProjectile::Tick()
 				vec2 end = {(float)tx, (float)ty};
 				m_Pos = m_Pos - start * 32 + end * 32;
 			}
-		} else if (GameServer()->Collision()->GetCollisionAt(CurPos.x, CurPos.y)&CCollision::COLFLAG_TELETHREE) {
+		} else if (TileFlags&CCollision::COLFLAG_TELETHREE) {
 			if (!m_inTele) {
 				m_inTele = true;
 				int x = GameServer()->Collision()->getTeleX(2);
@@ -139,7 +155,7 @@ void CProjectile::Tick()
 				vec2 end = {(float)tx, (float)ty};
 				m_Pos = m_Pos - start * 32 + end * 32;
 			}
-		} else if (GameServer()->Collision()->GetCollisionAt(CurPos.x, CurPos.y)&CCollision::COLFLAG_TELEFOUR) {
+		} else if (TileFlags&CCollision::COLFLAG_TELEFOUR) {
 			if (!m_inTele) {
 				m_inTele = true;
 				int x = GameServer()->Collision()->getTeleX(3);
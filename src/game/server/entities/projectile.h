@@ -9,9 +9,22 @@ public:
 	CProjectile(CGameWorld *pGameWorld, int Type, int Owner, vec2 Pos, vec2 Dir, int Span,
 		int Damage, bool Explosive, float Force, int SoundImpact, int Weapon);
 
+	struct CMotion
+	{
+		vec2 m_Pos;
+		vec2 m_Direction;
+		float m_Curvature;
+		float m_Speed;
+		int m_StartTick;
+	};
+
 	vec2 GetPos(float Time);
+	void GetMotion(CMotion *pMotion);
 	void FillInfo(CNetObj_Projectile *pProj);
 
+	// moves the projectile from PrevPos to CurPos and handles what it hits
+	void Advance(vec2 PrevPos, vec2 CurPos);
+
 	virtual void Reset();
 	virtual void Tick();
 	virtual void TickPaused();
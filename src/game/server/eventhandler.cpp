@@ -10,6 +10,9 @@ CEventHandler::CEventHandler()
 {
 	m_pGameServer = 0;
 	Clear();
+	m_NextSerial = 0;
+	for(int i = 0; i < MAX_CLIENTS+1; i++)
+		m_aSnapSerial[i] = 0;
 }
 
 void CEventHandler::SetGameServer(CGameContext *pGameServer)
@@ -29,6 +32,8 @@ void *CEventHandler::Create(int Type, int Size, int Mask)
 	m_aTypes[m_NumEvents] = Type;
 	m_aSizes[m_NumEvents] = Size;
 	m_aClientMasks[m_NumEvents] = Mask;
+	m_aTicks[m_NumEvents] = GameServer()->Server()->Tick();
+	m_aSerials[m_NumEvents] = m_NextSerial++;
 	m_CurrentOffset += Size;
 	m_NumEvents++;
 	return p;
@@ -40,14 +45,55 @@ void CEventHandler::Clear()
 	m_CurrentOffset = 0;
 }
 
+void CEventHandler::Expire(int Tick)
+{
+	// events are created in tick order
+	int Num = 0;
+	while(Num < m_NumEvents && m_aTicks[Num] <= Tick)
+		Num++;
+	if(!Num)
+		return;
+	if(Num == m_NumEvents)
+	{
+		Clear();
+		return;
+	}
+
+	int Offset = m_aOffsets[Num];
+	mem_move(m_aData, &m_aData[Offset], m_CurrentOffset-Offset);
+	m_CurrentOffset -= Offset;
+	m_NumEvents -= Num;
+	for(int i = 0; i < m_NumEvents; i++)
+	{
+		m_aTypes[i] = m_aTypes[i+Num];
+		m_aOffsets[i] = m_aOffsets[i+Num]-Offset;
+		m_aSizes[i] = m_aSizes[i+Num];
+		m_aClientMasks[i] = m_aClientMasks[i+Num];
+		m_aTicks[i] = m_aTicks[i+Num];
+		m_aSerials[i] = m_aSerials[i+Num];
+	}
+}
+
 void CEventHandler::Snap(int SnappingClient)
 {
+	// only what happened since the last snapshot of the client
+	unsigned *pSnapSerial = &m_aSnapSerial[SnappingClient == -1 ? MAX_CLIENTS : SnappingClient];
+	unsigned SnapSerial = *pSnapSerial;
+	*pSnapSerial = m_NextSerial;
+
+	// the margin beyond what the entities are clipped at shrinks for the snapshot budget
+	float Radius = 1100.0f;
+	if(SnappingClient != -1)
+		Radius += 400.0f*GameServer()->Server()->SnapRange(SnappingClient);
 	for(int i = 0; i < m_NumEvents; i++)
 	{
+		if((int)(m_aSerials[i]-SnapSerial) < 0)
+			continue;
+
 		if(SnappingClient == -1 || CmaskIsSet(m_aClientMasks[i], SnappingClient))
 		{
 			CNetEvent_Common *ev = (CNetEvent_Common *)&m_aData[m_aOffsets[i]];
-			if(SnappingClient == -1 || distance(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, vec2(ev->m_X, ev->m_Y)) < 1500.0f)
+			if(SnappingClient == -1 || distance(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, vec2(ev->m_X, ev->m_Y)) < Radius)
 			{
 				void *d = GameServer()->Server()->SnapNewItem(m_aTypes[i], i, m_aSizes[i]);
 				if(d)
@@ -3,18 +3,28 @@
 #ifndef GAME_SERVER_EVENTHANDLER_H
 #define GAME_SERVER_EVENTHANDLER_H
 
-//
+#include <engine/shared/protocol.h>
+
+// events stay until every client got a snapshot since they happened,
+// clients on a bad connection are snapped less often than every tick
 class CEventHandler
 {
-	static const int MAX_EVENTS = 128;
-	static const int MAX_DATASIZE = 128*64;
+	static const int MAX_EVENTS = 512;
+	static const int MAX_DATASIZE = 512*64;
 
 	int m_aTypes[MAX_EVENTS]; // TODO: remove some of these arrays
 	int m_aOffsets[MAX_EVENTS];
 	int m_aSizes[MAX_EVENTS];
 	int m_aClientMasks[MAX_EVENTS];
+	int m_aTicks[MAX_EVENTS];
+	unsigned m_aSerials[MAX_EVENTS];
 	char m_aData[MAX_DATASIZE];
 
+	// serial of the first event that was not in the last snapshot, the
+	// demo is the last one
+	unsigned m_NextSerial;
+	unsigned m_aSnapSerial[MAX_CLIENTS+1];
+
 	class CGameContext *m_pGameServer;
 
 	int m_CurrentOffset;
@@ -26,6 +36,9 @@ public:
 	CEventHandler();
 	void *Create(int Type, int Size, int Mask = -1);
 	void Clear();
+
+	// removes the events up to the tick
+	void Expire(int Tick);
 	void Snap(int SnappingClient);
 };
 
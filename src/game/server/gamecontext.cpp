@@ -3,12 +3,14 @@
 #include <new>
 #include <base/math.h>
 #include <engine/shared/config.h>
+#include <engine/shared/profiler.h>
 #include <engine/map.h>
 #include <engine/console.h>
 #include "gamecontext.h"
 #include <game/version.h>
 #include <game/collision.h>
 #include <game/server/entities/loltext.h>
+#include <game/server/entities/projectile.h>
 // #ifdef USECHEATS
 #include <game/server/entities/pickup.h>
 // #endif
@@ -46,14 +48,23 @@ void CGameContext::Construct(int Resetting)
 	m_LockTeams = 0;
 
 	if(Resetting==NO_RESET)
+	{
 		m_pVoteOptionHeap = new CHeap();
+		m_pStatsLog = new CStatsLog();
+	}
 
 	m_SpecMuted = false;
 
 	m_apPlayers;
 	for(int i = 0; i < MAX_CLIENTS; i++) {
 		m_apPlayers[i] = NULL;
+		m_aVoterGroup[i] = -1;
+		m_aVoterActive[i] = false;
 	}
+	mem_zero(m_aVoteGroups, sizeof(m_aVoteGroups));
+	m_VoteTotal = 0;
+	m_VoteYes = 0;
+	m_VoteNo = 0;
 }
 
 CGameContext::CGameContext(int Resetting)
@@ -71,12 +82,16 @@ CGameContext::~CGameContext()
 	for(int i = 0; i < MAX_CLIENTS; i++)
 		delete m_apPlayers[i];
 	if(!m_Resetting)
+	{
 		delete m_pVoteOptionHeap;
+		delete m_pStatsLog;
+	}
 }
 
 void CGameContext::Clear()
 {
 	CHeap *pVoteOptionHeap = m_pVoteOptionHeap;
+	CStatsLog *pStatsLog = m_pStatsLog;
 	CVoteOptionServer *pVoteOptionFirst = m_pVoteOptionFirst;
 	CVoteOptionServer *pVoteOptionLast = m_pVoteOptionLast;
 	int NumVoteOptions = m_NumVoteOptions;
@@ -88,6 +103,7 @@ void CGameContext::Clear()
 	new (this) CGameContext(RESET);
 
 	m_pVoteOptionHeap = pVoteOptionHeap;
+	m_pStatsLog = pStatsLog;
 	m_pVoteOptionFirst = pVoteOptionFirst;
 	m_pVoteOptionLast = pVoteOptionLast;
 	m_NumVoteOptions = NumVoteOptions;
@@ -333,6 +349,17 @@ void CGameContext::StartVote(const char *pDesc, const char *pCommand, const char
 			m_apPlayers[i]->m_VotePos = 0;
 		}
 	}
+	m_VoteTotal = 0;
+	m_VoteYes = 0;
+	m_VoteNo = 0;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		m_aVoteGroups[i].m_Vote = 0;
+		m_aVoteGroups[i].m_VotePos = 0;
+		m_aVoteGroups[i].m_VoteOwner = -1;
+		if(m_aVoteGroups[i].m_NumActive)
+			m_VoteTotal++;
+	}
 
 	// start vote
 	m_VoteCloseTime = time_get() + time_freq()*25;
@@ -387,6 +414,125 @@ void CGameContext::AbortVoteKickOnDisconnect(int ClientID)
 		m_VoteCloseTime = -1;
 }
 
+static void TallyVoteGroup(const CGameContext::CVoteGroup *pGroup, int Sign, int *pTotal, int *pYes, int *pNo)
+{
+	if(!pGroup->m_NumActive)
+		return;
+	*pTotal += Sign;
+	if(pGroup->m_Vote > 0)
+		*pYes += Sign;
+	else if(pGroup->m_Vote < 0)
+		*pNo += Sign;
+}
+
+void CGameContext::VoterJoin(int ClientID)
+{
+	m_aVoterGroup[ClientID] = -1;
+	m_aVoterActive[ClientID] = false;
+
+	NETADDR Addr;
+	if(!m_apPlayers[ClientID] || m_apPlayers[ClientID]->m_isBot || !Server()->GetClientAddr(ClientID, &Addr))
+		return;
+
+	// join the group of players with the same address
+	int Group = -1;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(!m_aVoteGroups[i].m_NumMembers)
+		{
+			if(Group == -1)
+				Group = i;
+		}
+		else if(net_addr_comp(&m_aVoteGroups[i].m_Addr, &Addr) == 0)
+		{
+			Group = i;
+			break;
+		}
+	}
+
+	CVoteGroup *pGroup = &m_aVoteGroups[Group];
+	if(!pGroup->m_NumMembers)
+	{
+		mem_zero(pGroup, sizeof(*pGroup));
+		pGroup->m_Addr = Addr;
+		pGroup->m_VoteOwner = -1;
+	}
+	pGroup->m_NumMembers++;
+	m_aVoterGroup[ClientID] = Group;
+
+	VoterUpdate(ClientID);
+}
+
+void CGameContext::VoterLeave(int ClientID)
+{
+	int Group = m_aVoterGroup[ClientID];
+	if(Group < 0)
+		return;
+
+	CVoteGroup *pGroup = &m_aVoteGroups[Group];
+	TallyVoteGroup(pGroup, -1, &m_VoteTotal, &m_VoteYes, &m_VoteNo);
+
+	m_aVoterGroup[ClientID] = -1;
+	pGroup->m_NumMembers--;
+	if(m_aVoterActive[ClientID])
+	{
+		pGroup->m_NumActive--;
+		m_aVoterActive[ClientID] = false;
+	}
+
+	// the vote of the group is the one cast first, fall back to the next one
+	if(pGroup->m_VoteOwner == ClientID)
+	{
+		pGroup->m_Vote = 0;
+		pGroup->m_VotePos = 0;
+		pGroup->m_VoteOwner = -1;
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			if(m_aVoterGroup[i] != Group || !m_apPlayers[i]->m_Vote)
+				continue;
+			if(!pGroup->m_Vote || m_apPlayers[i]->m_VotePos < pGroup->m_VotePos)
+			{
+				pGroup->m_Vote = m_apPlayers[i]->m_Vote;
+				pGroup->m_VotePos = m_apPlayers[i]->m_VotePos;
+				pGroup->m_VoteOwner = i;
+			}
+		}
+	}
+
+	TallyVoteGroup(pGroup, 1, &m_VoteTotal, &m_VoteYes, &m_VoteNo);
+	m_VoteUpdate = true;
+}
+
+void CGameContext::VoterUpdate(int ClientID)
+{
+	int Group = m_aVoterGroup[ClientID];
+	if(Group < 0)
+		return;
+
+	CVoteGroup *pGroup = &m_aVoteGroups[Group];
+	CPlayer *pPlayer = m_apPlayers[ClientID];
+	TallyVoteGroup(pGroup, -1, &m_VoteTotal, &m_VoteYes, &m_VoteNo);
+
+	// don't count in votes by spectators
+	bool Active = pPlayer->GetTeam() != TEAM_SPECTATORS;
+	if(Active != m_aVoterActive[ClientID])
+	{
+		pGroup->m_NumActive += Active ? 1 : -1;
+		m_aVoterActive[ClientID] = Active;
+	}
+
+	// only use the vote of the one who voted first
+	if(pPlayer->m_Vote && (!pGroup->m_Vote || pPlayer->m_VotePos < pGroup->m_VotePos))
+	{
+		pGroup->m_Vote = pPlayer->m_Vote;
+		pGroup->m_VotePos = pPlayer->m_VotePos;
+		pGroup->m_VoteOwner = ClientID;
+	}
+
+	TallyVoteGroup(pGroup, 1, &m_VoteTotal, &m_VoteYes, &m_VoteNo);
+	m_VoteUpdate = true;
+}
+
 
 void CGameContext::CheckPureTuning()
 {
@@ -441,20 +587,34 @@ void CGameContext::OnTick()
 
 	// copy tuning
 	m_World.m_Core.m_Tuning = m_Tuning;
-	m_World.Tick();
+	{
+		CProfileScope Scope(m_WorldPhase);
+		m_World.Tick();
+	}
 
 	//if(world.paused) // make sure that the game object always updates
-	m_pController->Tick();
+	{
+		CProfileScope Scope(m_ControllerPhase);
+		m_pController->Tick();
+	}
 
-	for(int i = 0; i < MAX_CLIENTS; i++)
 	{
-		if(m_apPlayers[i])
+		CProfileScope Scope(m_PlayersPhase);
+		for(int i = 0; i < MAX_CLIENTS; i++)
 		{
-			m_apPlayers[i]->Tick();
-			m_apPlayers[i]->PostTick();
+			if(m_apPlayers[i])
+			{
+				m_apPlayers[i]->Tick();
+				m_apPlayers[i]->PostTick();
+			}
 		}
 	}
 
+	{
+		CProfileScope Scope(m_BotsPhase);
+		m_BotEngine.Tick();
+	}
+
 	if(g_Config.m_SvChatMessage[0] && Server()->Tick() % (Server()->TickSpeed()*g_Config.m_SvChatMessageInterval*60) == 0)
 	{
 		str_sanitize_cc(g_Config.m_SvChatMessage);
@@ -472,47 +632,12 @@ void CGameContext::OnTick()
 		}
 		else
 		{
-			int Total = 0, Yes = 0, No = 0;
+			// the tally is kept up to date by VoterJoin, VoterLeave and VoterUpdate
 			if(m_VoteUpdate)
 			{
-				// count votes
-				char aaBuf[MAX_CLIENTS][NETADDR_MAXSTRSIZE] = {{0}};
-				for(int i = 0; i < MAX_CLIENTS; i++)
-					if(m_apPlayers[i])
-						Server()->GetClientAddr(i, aaBuf[i], NETADDR_MAXSTRSIZE);
-				bool aVoteChecked[MAX_CLIENTS] = {0};
-				for(int i = 0; i < MAX_CLIENTS; i++)
-				{
-					if(!m_apPlayers[i] || m_apPlayers[i]->GetTeam() == TEAM_SPECTATORS || aVoteChecked[i] || m_apPlayers[i]->m_isBot)	// don't count in votes by spectators
-						continue;
-
-					int ActVote = m_apPlayers[i]->m_Vote;
-					int ActVotePos = m_apPlayers[i]->m_VotePos;
-
-					// check for more players with the same ip (only use the vote of the one who voted first)
-					for(int j = i+1; j < MAX_CLIENTS; ++j)
-					{
-						if(!m_apPlayers[j] || aVoteChecked[j] || str_comp(aaBuf[j], aaBuf[i]))
-							continue;
-
-						aVoteChecked[j] = true;
-						if(m_apPlayers[j]->m_Vote && (!ActVote || ActVotePos > m_apPlayers[j]->m_VotePos))
-						{
-							ActVote = m_apPlayers[j]->m_Vote;
-							ActVotePos = m_apPlayers[j]->m_VotePos;
-						}
-					}
-
-					Total++;
-					if(ActVote > 0)
-						Yes++;
-					else if(ActVote < 0)
-						No++;
-				}
-
-				if(Yes >= Total/2+1)
+				if(m_VoteYes >= m_VoteTotal/2+1)
 					m_VoteEnforce = VOTE_ENFORCE_YES;
-				else if(No >= (Total+1)/2)
+				else if(m_VoteNo >= (m_VoteTotal+1)/2)
 					m_VoteEnforce = VOTE_ENFORCE_NO;
 			}
 
@@ -535,7 +660,7 @@ void CGameContext::OnTick()
 			else if(m_VoteUpdate)
 			{
 				m_VoteUpdate = false;
-				SendVoteStatus(-1, Total, Yes, No);
+				SendVoteStatus(-1, m_VoteTotal, m_VoteYes, m_VoteNo);
 			}
 		}
 	}
@@ -620,7 +745,7 @@ void CGameContext::OnClientEnter(int ClientID)
 	str_format(aBuf, sizeof(aBuf), "team_join player='%d:%s' team=%d", ClientID, Server()->ClientName(ClientID), m_apPlayers[ClientID]->GetTeam());
 	Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "game", aBuf);
 
-	m_VoteUpdate = true;
+	VoterJoin(ClientID);
 	int Pl = 0;
 	for(int i = 0; i < MAX_CLIENTS; i++)
 		if(m_apPlayers[i] && m_apPlayers[i]->GetTeam() != TEAM_SPECTATORS)
@@ -637,6 +762,9 @@ void CGameContext::OnClientConnected(int ClientID)
 	const int StartTeam = g_Config.m_SvTournamentMode ? TEAM_SPECTATORS : m_pController->GetAutoTeam(ClientID);
 
 	m_apPlayers[ClientID] = new(ClientID) CPlayer(this, ClientID, StartTeam);
+	m_aVoterGroup[ClientID] = -1;
+	m_aVoterActive[ClientID] = false;
+	m_ChatCommands.ResetClient(ClientID);
 	//players[client_id].init(client_id);
 	//players[client_id].client_id = client_id;
 
@@ -663,6 +791,7 @@ void CGameContext::OnClientConnected(int ClientID)
 void CGameContext::OnClientDrop(int ClientID, const char *pReason)
 {
 	AbortVoteKickOnDisconnect(ClientID);
+	VoterLeave(ClientID);
 	m_apPlayers[ClientID]->OnDisconnect(pReason);
 	delete m_apPlayers[ClientID];
 	m_apPlayers[ClientID] = 0;
@@ -1008,6 +1137,7 @@ void CGameContext::OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID)
 				StartVote(aDesc, aCmd, pReason);
 				pPlayer->m_Vote = 1;
 				pPlayer->m_VotePos = m_VotePos = 1;
+				VoterUpdate(ClientID);
 				m_VoteCreator = ClientID;
 				pPlayer->m_LastVoteCall = Now;
 			}
@@ -1025,7 +1155,7 @@ void CGameContext::OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID)
 
 				pPlayer->m_Vote = pMsg->m_Vote;
 				pPlayer->m_VotePos = ++m_VotePos;
-				m_VoteUpdate = true;
+				VoterUpdate(ClientID);
 			}
 		}
 		else if (MsgID == NETMSGTYPE_CL_SETTEAM && !m_World.m_Paused)
@@ -1064,8 +1194,6 @@ void CGameContext::OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID)
 				if(m_pController->CanChangeTeam(pPlayer, pMsg->m_Team))
 				{
 					pPlayer->m_LastSetTeam = Server()->Tick();
-					if(pPlayer->GetTeam() == TEAM_SPECTATORS || pMsg->m_Team == TEAM_SPECTATORS)
-						m_VoteUpdate = true;
 					pPlayer->SetTeam(pMsg->m_Team);
 					(void)m_pController->CheckTeamBalance();
 					pPlayer->m_TeamChangeTick = Server()->Tick();
@@ -1952,12 +2080,16 @@ void CGameContext::ConSetName(IConsole::IResult *pResult, void *pUserData)
 {
 	CGameContext *pSelf = (CGameContext *)pUserData;
 	pSelf->Server()->SetClientName(pResult->GetInteger(0), pResult->GetString(1));
+	if(pSelf->IsValidCID(pResult->GetInteger(0)))
+		pSelf->m_apPlayers[pResult->GetInteger(0)]->ClientInfoChanged();
 }
 
 void CGameContext::ConSetClan(IConsole::IResult *pResult, void *pUserData)
 {
 	CGameContext *pSelf = (CGameContext *)pUserData;
 	pSelf->Server()->SetClientClan(pResult->GetInteger(0), pResult->GetString(1));
+	if(pSelf->IsValidCID(pResult->GetInteger(0)))
+		pSelf->m_apPlayers[pResult->GetInteger(0)]->ClientInfoChanged();
 }
 
 void CGameContext::ConKill(IConsole::IResult *pResult, void *pUserData)
@@ -2136,6 +2268,8 @@ void CGameContext::AddBot(int difficulty) {
 		type = 1;
 	OnClientConnected(id);
 	m_apPlayers[id]->m_isBot = type;
+	m_BotEngine.OnBotAdded(id);
+	m_apPlayers[id]->ClientInfoChanged();
 	OnClientEnter(id);
 	m_pServer->m_numberBots++;
 }
@@ -2159,6 +2293,24 @@ void CGameContext::ConRemoveBot(IConsole::IResult *pResult, void *pUserData)
 
 }
 
+void CGameContext::ConfigGrenadeAmmo(int Variable, void *pUserData)
+{
+	// Grenade should have everytime more than 3 bullets
+	if(g_Config.m_SvGrenadeAmmo < 4)
+		g_Config.m_SvGrenadeAmmo = -1;
+}
+
+void CGameContext::ConfigIFreezeMeltTime(int Variable, void *pUserData)
+{
+	static_cast<CGameContext *>(pUserData)->UpdateIFreezeMeltTicks();
+}
+
+void CGameContext::UpdateIFreezeMeltTicks()
+{
+	m_IFreezeMeltTicks = SERVER_TICK_SPEED * g_Config.m_SvIFreezeMeltTime * 0.001f;
+	m_IFreezeThawTicks = (int)(SERVER_TICK_SPEED * g_Config.m_SvIFreezeMeltTime * 0.0005f);
+}
+
 void CGameContext::OnConsoleInit()
 {
 	m_pServer = Kernel()->RequestInterface<IServer>();
@@ -2187,6 +2339,8 @@ void CGameContext::OnConsoleInit()
 	Console()->Register("vote", "r", CFGFLAG_SERVER, ConVote, this, "Force a vote to yes/no");
 
 	Console()->Chain("sv_motd", ConchainSpecialMotdupdate, this);
+	Console()->RegisterConfigCallback(CONFIG_SvGrenadeAmmo, ConfigGrenadeAmmo, this);
+	Console()->RegisterConfigCallback(CONFIG_SvIFreezeMeltTime, ConfigIFreezeMeltTime, this);
 
 	Console()->Register("freeze", "ii", CFGFLAG_SERVER, ConFreeze, this, "Freeze a player for x seconds");
 	Console()->Register("unfreeze", "i", CFGFLAG_SERVER, ConUnFreeze, this, "Unfreeze a player");
@@ -2218,6 +2372,7 @@ void CGameContext::OnInit(/*class IKernel *pKernel*/)
 	m_World.SetGameServer(this);
 	m_Events.SetGameServer(this);
 	m_Mute.Init(this);
+	RegisterChatCommands();
 
 	//if(!data) // only load once
 		//data = load_data_from_memory(internal_data);
@@ -2227,6 +2382,13 @@ void CGameContext::OnInit(/*class IKernel *pKernel*/)
 
 	m_Layers.Init(Kernel());
 	m_Collision.Init(&m_Layers);
+	m_BotEngine.Init(this);
+	UpdateIFreezeMeltTicks();
+
+	m_WorldPhase = g_Profiler.Register("tick.world");
+	m_ControllerPhase = g_Profiler.Register("tick.controller");
+	m_PlayersPhase = g_Profiler.Register("tick.players");
+	m_BotsPhase = g_Profiler.Register("tick.bots");
 
 	m_pServer->m_numberBots = 0; // reset bot count
 
@@ -2434,7 +2596,86 @@ void CGameContext::OnSnap(int ClientID)
 }
 void CGameContext::OnPreSnap() {}
 void CGameContext::OnPostSnap() {
-	m_Events.Clear();
+	// keep the events for the clients that get snapped less often
+	m_Events.Expire(Server()->Tick() - max(g_Config.m_SvSnapIntervalMax, 2));
+}
+
+// FNV-1a over the ints of a net object
+static unsigned HashInts(unsigned Hash, const void *pData, int Size)
+{
+	const int *pInts = (const int *)pData;
+	for(int i = 0; i < Size/(int)sizeof(int); i++)
+	{
+		unsigned Value = pInts[i];
+		for(int b = 0; b < 4; b++)
+		{
+			Hash ^= (Value>>(b*8))&0xff;
+			Hash *= 16777619u;
+		}
+	}
+	return Hash;
+}
+
+void CGameContext::WriteWorldHash(IOHANDLE File)
+{
+	// the first pass sums the world up, the second one writes a line per
+	// entity so a diff can tell where two worlds split
+	const unsigned Seed = 2166136261u;
+	unsigned WorldHash = Seed;
+	char aBuf[64];
+	for(int Pass = 0; Pass < 2; Pass++)
+	{
+		if(Pass == 1)
+		{
+			str_format(aBuf, sizeof(aBuf), "tick %d %08x\n", Server()->Tick(), WorldHash);
+			io_write(File, aBuf, str_length(aBuf));
+		}
+
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			CCharacter *pChr = GetPlayerChar(i);
+			if(!pChr)
+				continue;
+			CNetObj_CharacterCore Core;
+			pChr->GetCore()->Write(&Core);
+			unsigned Hash = HashInts(Seed, &Core, sizeof(Core));
+			if(Pass == 0)
+				WorldHash = HashInts(WorldHash, &Hash, sizeof(Hash));
+			else
+			{
+				str_format(aBuf, sizeof(aBuf), "character %d %08x\n", i, Hash);
+				io_write(File, aBuf, str_length(aBuf));
+			}
+		}
+
+		int Num = 0;
+		for(CProjectile *pProj = (CProjectile *)m_World.FindFirst(CGameWorld::ENTTYPE_PROJECTILE); pProj; pProj = (CProjectile *)pProj->TypeNext(), Num++)
+		{
+			CNetObj_Projectile Proj;
+			pProj->FillInfo(&Proj);
+			unsigned Hash = HashInts(Seed, &Proj, sizeof(Proj));
+			if(Pass == 0)
+				WorldHash = HashInts(WorldHash, &Hash, sizeof(Hash));
+			else
+			{
+				str_format(aBuf, sizeof(aBuf), "projectile %d %08x\n", Num, Hash);
+				io_write(File, aBuf, str_length(aBuf));
+			}
+		}
+
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			if(!m_apPlayers[i])
+				continue;
+			if(Pass == 0)
+				WorldHash = HashInts(WorldHash, &m_apPlayers[i]->m_Score, sizeof(int));
+			else
+			{
+				str_format(aBuf, sizeof(aBuf), "score %d %d\n", i, m_apPlayers[i]->m_Score);
+				io_write(File, aBuf, str_length(aBuf));
+			}
+		}
+	}
 }
 
 bool CGameContext::IsClientReady(int ClientID)  {
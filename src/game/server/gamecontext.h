@@ -16,6 +16,9 @@
 #include "gameworld.h"
 #include "player.h"
 #include "mute.h"
+#include "chatcommands.h"
+#include "botengine.h"
+#include "statslog.h"
 
 
 /*
@@ -28,6 +31,7 @@
 				Remove entities marked for deletion (GAMEWORLD::remove_entities)
 			Game Controller (GAMECONTROLLER::tick)
 			All players (CPlayer::tick)
+			Bot inputs (CBotEngine::tick)
 
 
 	Snap
@@ -72,6 +76,8 @@ class CGameContext : public IGameServer
 	static void ConClearVotes(IConsole::IResult *pResult, void *pUserData);
 	static void ConVote(IConsole::IResult *pResult, void *pUserData);
 	static void ConchainSpecialMotdupdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
+	static void ConfigGrenadeAmmo(int Variable, void *pUserData);
+	static void ConfigIFreezeMeltTime(int Variable, void *pUserData);
 
 	static void ConFreeze(IConsole::IResult *pResult, void *pUserData);
 	static void ConUnFreeze(IConsole::IResult *pResult, void *pUserData);
@@ -130,6 +136,11 @@ public:
 	void SendVoteStatus(int ClientID, int Total, int Yes, int No);
 	void AbortVoteKickOnDisconnect(int ClientID);
 
+	// vote tally, players sharing an address are counted as one voter
+	void VoterJoin(int ClientID);
+	void VoterLeave(int ClientID);
+	void VoterUpdate(int ClientID);
+
 	int CreateLolText(CEntity *pParent, bool Follow, vec2 Pos, vec2 Vel, int Lifespan, const char *pText);
 	int CreateLolText(CEntity *pParent, const char *pText);
 	void DestroyLolText(int TextID);
@@ -144,6 +155,22 @@ public:
 	int m_NumVoteOptions;
 	int m_VoteEnforce;
 
+	struct CVoteGroup
+	{
+		NETADDR m_Addr; // port zeroed
+		int m_NumMembers;
+		int m_NumActive; // members that are ingame and not spectating
+		int m_Vote;
+		int m_VotePos;
+		int m_VoteOwner;
+	};
+	CVoteGroup m_aVoteGroups[MAX_CLIENTS];
+	int m_aVoterGroup[MAX_CLIENTS];
+	bool m_aVoterActive[MAX_CLIENTS];
+	int m_VoteTotal;
+	int m_VoteYes;
+	int m_VoteNo;
+
 	int m_PlayerCount; // counts of players and clients
 	int m_ClientCount;
 	enum
@@ -177,6 +204,21 @@ public:
 	};
 
 	CMute m_Mute;
+	CBotEngine m_BotEngine;
+
+	// outlives map changes like the vote options
+	CStatsLog *m_pStatsLog;
+
+	// sv_ifreeze_melt_time in ticks, half of it is when the "thawed" message comes
+	float m_IFreezeMeltTicks;
+	int m_IFreezeThawTicks;
+	void UpdateIFreezeMeltTicks();
+
+	// profiler phases of the tick
+	int m_WorldPhase;
+	int m_ControllerPhase;
+	int m_PlayersPhase;
+	int m_BotsPhase;
 
 	// network
 	void SendChatTarget(int To, const char *pText);
@@ -212,6 +254,7 @@ public:
 	virtual void OnClientDirectInput(int ClientID, void *pInput);
 	virtual void OnClientPredictedInput(int ClientID, void *pInput);
 
+	virtual void WriteWorldHash(IOHANDLE File);
 	virtual bool IsClientReady(int ClientID);
 	virtual bool IsClientPlayer(int ClientID);
 
@@ -221,6 +264,31 @@ public:
 
 	bool m_SpecMuted;
 	bool ShowCommand(int ClientID, CPlayer* pPlayer, const char* pMessage, int *pTeam);
+
+	// chat commands
+	CChatCommands m_ChatCommands;
+	void RegisterChatCommands();
+	CPlayer *ChatStatsPlayer(CChatCommands::CResult *pResult, char *pTitle, int TitleSize);
+	void SendPrivateMessage(int ClientID, int ReceiverID, const char *pMsg);
+
+	static bool ChatInfo(CChatCommands::CResult *pResult, void *pUserData);
+	static bool ChatCredits(CChatCommands::CResult *pResult, void *pUserData);
+	static bool ChatHelp(CChatCommands::CResult *pResult, void *pUserData);
+	static bool ChatCmdlist(CChatCommands::CResult *pResult, void *pUserData);
+	static bool ChatStop(CChatCommands::CResult *pResult, void *pUserData);
+	static bool ChatGo(CChatCommands::CResult *pResult, void *pUserData);
+	static bool ChatRestart(CChatCommands::CResult *pResult, void *pUserData);
+	static bool ChatXonX(CChatCommands::CResult *pResult, void *pUserData);
+	static bool ChatReset(CChatCommands::CResult *pResult, void *pUserData);
+	static bool ChatStatsAll(CChatCommands::CResult *pResult, void *pUserData);
+	static bool ChatStats(CChatCommands::CResult *pResult, void *pUserData);
+	static bool ChatWhisper(CChatCommands::CResult *pResult, void *pUserData);
+	static bool ChatMe(CChatCommands::CResult *pResult, void *pUserData);
+	static bool ChatAnswer(CChatCommands::CResult *pResult, void *pUserData);
+	static bool ChatEmote(CChatCommands::CResult *pResult, void *pUserData);
+	static bool ChatSetTeam(CChatCommands::CResult *pResult, void *pUserData);
+	static bool ChatPause(CChatCommands::CResult *pResult, void *pUserData);
+
 	//Helpers
 	bool CanExec(int, const char*);
 	int ParsePlayerName(char* pMsg, int *ClientID);
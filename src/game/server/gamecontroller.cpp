@@ -411,6 +411,7 @@ void IGameController::CycleMap()
 		str_format(aBuf, sizeof(aBuf), "rotating map to %s", m_aMapWish);
 		GameServer()->Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "game", aBuf);
 		str_copy(g_Config.m_SvMap, m_aMapWish, sizeof(g_Config.m_SvMap));
+		GameServer()->Console()->ConfigChanged(CONFIG_SvMap);
 		m_aMapWish[0] = 0;
 		m_RoundCount = 0;
 		return;
@@ -477,6 +478,7 @@ void IGameController::CycleMap()
 	str_format(aBufMsg, sizeof(aBufMsg), "rotating map to %s", &aBuf[i]);
 	GameServer()->Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "game", aBuf);
 	str_copy(g_Config.m_SvMap, &aBuf[i], sizeof(g_Config.m_SvMap));
+	GameServer()->Console()->ConfigChanged(CONFIG_SvMap);
 }
 
 void IGameController::PostReset()
@@ -496,6 +498,8 @@ void IGameController::PostReset()
 
 void IGameController::OnPlayerInfoChange(class CPlayer *pP)
 {
+	pP->ClientInfoChanged();
+
 	const int aTeamColors[2] = {65387, 10223467};
 	if(IsTeamplay())
 	{
@@ -634,10 +638,6 @@ void IGameController::Tick()
 		}
 	}
 
-	// Grenade should have everytime more than 3 bullets
-	if(g_Config.m_SvGrenadeAmmo < 4)
-		g_Config.m_SvGrenadeAmmo = -1;
-
 	// game is Paused
 	if(GameServer()->m_World.m_Paused)
 		++m_RoundStartTick;
@@ -986,63 +986,149 @@ int IGameController::ClampTeam(int Team)
 
 void IGameController::SaveStats()
 {
-	if(g_Config.m_SvStatsFile[0] && g_Config.m_SvStatsOutputlevel)
+	if(!g_Config.m_SvStatsFile[0] || !g_Config.m_SvStatsOutputlevel)
+		return;
+
+	CStatsLog *pLog = GameServer()->m_pStatsLog;
+	if(pLog->OpenFailed())
 	{
-		char aBuf[1024];
-		FILE* pFile = fopen(g_Config.m_SvStatsFile, "a");
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "Failed to open %s to save stats", g_Config.m_SvStatsFile);
+		GameServer()->Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "stats", aBuf);
+	}
 
-		if(!pFile)
-		{
-			str_format(aBuf, sizeof(aBuf), "Failed to open %s to save stats", g_Config.m_SvStatsFile);
-			GameServer()->Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "stats", aBuf);
-			return;
-		}
+	// the writer did not keep up, the file misses records
+	int NumDropped = pLog->TakeNumDropped();
+	if(NumDropped)
+	{
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "dropped %d records of %s", NumDropped, g_Config.m_SvStatsFile);
+		GameServer()->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "stats", aBuf);
+	}
 
-		{
-			char TimeStr[2][128];
-			double PlayingTime = (double)(Server()->Tick() - m_RoundStartTick)/Server()->TickSpeed();
-			time_t Now_t = time(0);
-			time_t StartRound_t = Now_t - (int)PlayingTime;
-
-			strftime(TimeStr[0], sizeof(TimeStr[0]), "Roundstart at %d.%m.%Y on %X", localtime(&StartRound_t));
-			strftime(TimeStr[1], sizeof(TimeStr[1]), "and ended at %X", localtime(&Now_t));
-			str_format(aBuf, sizeof(aBuf), "--> %s %s (Length: %d min %.2lf sec). Gametype: %s\n\n", TimeStr[0], TimeStr[1], (int)PlayingTime/60, PlayingTime - ((int)PlayingTime/60)*60, GameServer()->GameType());
-			fputs(aBuf, pFile);
-		}
+	if(g_Config.m_SvStatsFormat == 1)
+		SaveStatsJson();
+	else
+		SaveStatsText();
+}
 
-		for(int i = 0; i < MAX_CLIENTS; i++)
-		{
-			if(!GameServer()->m_apPlayers[i] || GameServer()->m_apPlayers[i]->GetTeam() == TEAM_SPECTATORS)
-				continue;
-			CPlayer* pP = GameServer()->m_apPlayers[i];
-
-			char aaTemp[3][512] = {"", "", ""};
-			// Outputlevel 1
-			str_format(aaTemp[0], sizeof(aaTemp[0]), "ID: %2d\t| Name: %-15.15s| Team: %-10.10s| Score: %-6.1d| Kills: %-6.1d| Deaths: %-6.1d| Ratio: %-6.2lf",
-					pP->GetCID(), Server()->ClientName(i), GetTeamName(pP->GetTeam()), pP->m_Score, pP->m_Stats.m_Kills, pP->m_Stats.m_Deaths, (pP->m_Stats.m_Deaths > 0) ? ((float)pP->m_Stats.m_Kills / (float)pP->m_Stats.m_Deaths) : 0
-					);
-			//Outputlevel 2
-			if(g_Config.m_SvStatsOutputlevel > 1)
-				str_format(aaTemp[1], sizeof(aaTemp[1]), "| Hits: %-6.1d| Total Shots: %-6.1d| Captures: %-6.1d| Fastest Capture: %6.2lf",
-					pP->m_Stats.m_Hits, pP->m_Stats.m_TotalShots, (m_GameFlags&GAMEFLAG_FLAGS) ? pP->m_Stats.m_Captures : -1, ((m_GameFlags&GAMEFLAG_FLAGS) || pP->m_Stats.m_FastestCapture < 0.1) ? pP->m_Stats.m_FastestCapture : -1
-					);
-			//Outputlevel 3
-			if(g_Config.m_SvStatsOutputlevel > 2)
-				str_format(aaTemp[2], sizeof(aaTemp[2]), "| Lost Flags: %-6.1d",
-					pP->m_Stats.m_LostFlags
-					);
-
-			str_format(aBuf, sizeof(aBuf), "%s %s %s\n", aaTemp[0], aaTemp[1], aaTemp[2]);
-			fputs(aBuf, pFile);
-		}
+void IGameController::SaveStatsText()
+{
+	CStatsLog *pLog = GameServer()->m_pStatsLog;
+	char aBuf[1024];
 
-		if(IsTeamplay())
-		{
-			str_format(aBuf, sizeof(aBuf), "---------------------\nRed: %d | Blue: %d\n", m_aTeamscore[TEAM_RED], m_aTeamscore[TEAM_BLUE]);
-			fputs(aBuf, pFile);
-		}
+	{
+		char TimeStr[2][128];
+		double PlayingTime = (double)(Server()->Tick() - m_RoundStartTick)/Server()->TickSpeed();
+		time_t Now_t = time(0);
+		time_t StartRound_t = Now_t - (int)PlayingTime;
+
+		strftime(TimeStr[0], sizeof(TimeStr[0]), "Roundstart at %d.%m.%Y on %X", localtime(&StartRound_t));
+		strftime(TimeStr[1], sizeof(TimeStr[1]), "and ended at %X", localtime(&Now_t));
+		str_format(aBuf, sizeof(aBuf), "--> %s %s (Length: %d min %.2lf sec). Gametype: %s\n\n", TimeStr[0], TimeStr[1], (int)PlayingTime/60, PlayingTime - ((int)PlayingTime/60)*60, GameServer()->GameType());
+		pLog->Write(g_Config.m_SvStatsFile, aBuf, str_length(aBuf));
+	}
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(!GameServer()->m_apPlayers[i] || GameServer()->m_apPlayers[i]->GetTeam() == TEAM_SPECTATORS)
+			continue;
+		CPlayer* pP = GameServer()->m_apPlayers[i];
+
+		char aaTemp[3][512] = {"", "", ""};
+		// Outputlevel 1
+		str_format(aaTemp[0], sizeof(aaTemp[0]), "ID: %2d\t| Name: %-15.15s| Team: %-10.10s| Score: %-6.1d| Kills: %-6.1d| Deaths: %-6.1d| Ratio: %-6.2lf",
+				pP->GetCID(), Server()->ClientName(i), GetTeamName(pP->GetTeam()), pP->m_Score, pP->m_Stats.m_Kills, pP->m_Stats.m_Deaths, (pP->m_Stats.m_Deaths > 0) ? ((float)pP->m_Stats.m_Kills / (float)pP->m_Stats.m_Deaths) : 0
+				);
+		//Outputlevel 2
+		if(g_Config.m_SvStatsOutputlevel > 1)
+			str_format(aaTemp[1], sizeof(aaTemp[1]), "| Hits: %-6.1d| Total Shots: %-6.1d| Captures: %-6.1d| Fastest Capture: %6.2lf",
+				pP->m_Stats.m_Hits, pP->m_Stats.m_TotalShots, (m_GameFlags&GAMEFLAG_FLAGS) ? pP->m_Stats.m_Captures : -1, ((m_GameFlags&GAMEFLAG_FLAGS) || pP->m_Stats.m_FastestCapture < 0.1) ? pP->m_Stats.m_FastestCapture : -1
+				);
+		//Outputlevel 3
+		if(g_Config.m_SvStatsOutputlevel > 2)
+			str_format(aaTemp[2], sizeof(aaTemp[2]), "| Lost Flags: %-6.1d",
+				pP->m_Stats.m_LostFlags
+				);
+
+		str_format(aBuf, sizeof(aBuf), "%s %s %s\n", aaTemp[0], aaTemp[1], aaTemp[2]);
+		pLog->Write(g_Config.m_SvStatsFile, aBuf, str_length(aBuf));
+	}
 
-		fputs("________________________________________________________________________________________________________________________________________\n\n\n", pFile);
-		fclose(pFile);
+	if(IsTeamplay())
+	{
+		str_format(aBuf, sizeof(aBuf), "---------------------\nRed: %d | Blue: %d\n", m_aTeamscore[TEAM_RED], m_aTeamscore[TEAM_BLUE]);
+		pLog->Write(g_Config.m_SvStatsFile, aBuf, str_length(aBuf));
 	}
+
+	const char *pEnd = "________________________________________________________________________________________________________________________________________\n\n\n";
+	pLog->Write(g_Config.m_SvStatsFile, pEnd, str_length(pEnd));
+}
+
+void IGameController::SaveStatsJson()
+{
+	CStatsLog *pLog = GameServer()->m_pStatsLog;
+	int Now = time_timestamp();
+	int Length = (Server()->Tick() - m_RoundStartTick)/Server()->TickSpeed();
+	int Start = Now - Length;
+	const char *pLine;
+	int Size;
+
+	CStatsRecord Round("round", Now);
+	Round.AddInt("start", Start);
+	Round.AddInt("length", Length);
+	Round.AddStr("gametype", GameServer()->GameType());
+	Round.AddStr("map", g_Config.m_SvMap);
+	if(IsTeamplay())
+	{
+		Round.AddInt("red", m_aTeamscore[TEAM_RED]);
+		Round.AddInt("blue", m_aTeamscore[TEAM_BLUE]);
+	}
+	if((pLine = Round.Finish(&Size)))
+		pLog->Write(g_Config.m_SvStatsFile, pLine, Size);
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(!GameServer()->m_apPlayers[i] || GameServer()->m_apPlayers[i]->GetTeam() == TEAM_SPECTATORS)
+			continue;
+		CPlayer* pP = GameServer()->m_apPlayers[i];
+
+		CStatsRecord Player("player", Now);
+		Player.AddInt("round", Start);
+		Player.AddInt("id", i);
+		Player.AddStr("name", Server()->ClientName(i));
+		Player.AddStr("clan", Server()->ClientClan(i));
+		Player.AddInt("team", pP->GetTeam());
+		Player.AddInt("score", pP->m_Score);
+		Player.AddInt("kills", pP->m_Stats.m_Kills);
+		Player.AddInt("deaths", pP->m_Stats.m_Deaths);
+		Player.AddInt("hits", pP->m_Stats.m_Hits);
+		Player.AddInt("shots", pP->m_Stats.m_TotalShots);
+		Player.AddIntArray("weapon_shots", pP->m_Stats.m_Shots, NUM_WEAPONS);
+		Player.AddInt("captures", pP->m_Stats.m_Captures);
+		Player.AddInt("lost_flags", pP->m_Stats.m_LostFlags);
+		Player.AddFloat("fastest_capture", pP->m_Stats.m_FastestCapture);
+		if((pLine = Player.Finish(&Size)))
+			pLog->Write(g_Config.m_SvStatsFile, pLine, Size);
+	}
+}
+
+void IGameController::SaveKill(int Killer, int Victim, int Weapon, int ModeSpecial)
+{
+	if(!g_Config.m_SvStatsFile[0] || !g_Config.m_SvStatsOutputlevel || g_Config.m_SvStatsFormat != 1 || !g_Config.m_SvStatsKills)
+		return;
+
+	CStatsRecord Kill("kill", time_timestamp());
+	Kill.AddInt("tick", Server()->Tick());
+	Kill.AddInt("killer", Killer);
+	Kill.AddStr("killer_name", Server()->ClientName(Killer));
+	Kill.AddInt("victim", Victim);
+	Kill.AddStr("victim_name", Server()->ClientName(Victim));
+	Kill.AddInt("weapon", Weapon);
+	Kill.AddInt("special", ModeSpecial);
+
+	int Size;
+	const char *pLine = Kill.Finish(&Size);
+	if(pLine)
+		GameServer()->m_pStatsLog->Write(g_Config.m_SvStatsFile, pLine, Size);
 }
@@ -166,6 +166,16 @@ public:
 	int IsWarmup() { return m_Warmup; }
 	int m_FakeWarmup;
 	void SaveStats();
+
+	/*
+		Function: SaveKill
+			Adds a kill record to the stats file, see statslog.h.
+	*/
+	void SaveKill(int Killer, int Victim, int Weapon, int ModeSpecial);
+
+private:
+	void SaveStatsText();
+	void SaveStatsJson();
 };
 
 #endif
@@ -1,13 +1,25 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 
+#include <engine/shared/profiler.h>
+
 #include "gameworld.h"
 #include "entity.h"
 #include "gamecontext.h"
+#include "entities/projectile.h"
 
 //////////////////////////////////////////////////
 // game world
 //////////////////////////////////////////////////
+static const char *s_apTypePhases[CGameWorld::NUM_ENTTYPES] = {
+	"tick.world.projectile",
+	"tick.world.laser",
+	"tick.world.pickup",
+	"tick.world.flag",
+	"tick.world.character",
+	"tick.world.structure",
+};
+
 CGameWorld::CGameWorld()
 {
 	m_pGameServer = 0x0;
@@ -16,7 +28,12 @@ CGameWorld::CGameWorld()
 	m_Paused = false;
 	m_ResetRequested = false;
 	for(int i = 0; i < NUM_ENTTYPES; i++)
+	{
 		m_apFirstEntityTypes[i] = 0;
+		m_aTypePhases[i] = g_Profiler.Register(s_apTypePhases[i]);
+	}
+	m_CharacterGridValid = false;
+	m_InProjectilePass = false;
 }
 
 CGameWorld::~CGameWorld()
@@ -72,6 +89,9 @@ void CGameWorld::InsertEntity(CEntity *pEnt)
 	pEnt->m_pNextTypeEntity = m_apFirstEntityTypes[pEnt->m_ObjType];
 	pEnt->m_pPrevTypeEntity = 0x0;
 	m_apFirstEntityTypes[pEnt->m_ObjType] = pEnt;
+
+	if(pEnt->m_ObjType == ENTTYPE_CHARACTER)
+		m_CharacterGridValid = false;
 }
 
 void CGameWorld::DestroyEntity(CEntity *pEnt)
@@ -99,6 +119,9 @@ void CGameWorld::RemoveEntity(CEntity *pEnt)
 
 	pEnt->m_pNextTypeEntity = 0;
 	pEnt->m_pPrevTypeEntity = 0;
+
+	if(pEnt->m_ObjType == ENTTYPE_CHARACTER)
+		m_CharacterGridValid = false;
 }
 
 //
@@ -156,22 +179,32 @@ void CGameWorld::Tick()
 	{
 		if(GameServer()->m_pController->IsForceBalanced())
 			GameServer()->SendChat(-1, CGameContext::CHAT_ALL, "Teams have been balanced");
-		// update all objects
-		for(int i = 0; i < NUM_ENTTYPES; i++)
+		// update all objects, projectiles come first as they are the first type
+		{
+			CProfileScope Scope(m_aTypePhases[ENTTYPE_PROJECTILE]);
+			TickProjectiles();
+		}
+		for(int i = ENTTYPE_PROJECTILE+1; i < NUM_ENTTYPES; i++)
+		{
+			CProfileScope Scope(m_aTypePhases[i]);
 			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
 			{
 				m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
 				pEnt->Tick();
 				pEnt = m_pNextTraverseEntity;
 			}
+		}
 
 		for(int i = 0; i < NUM_ENTTYPES; i++)
+		{
+			CProfileScope Scope(m_aTypePhases[i]);
 			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
 			{
 				m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
 				pEnt->TickDefered();
 				pEnt = m_pNextTraverseEntity;
 			}
+		}
 	}
 	else
 	{
@@ -220,6 +253,133 @@ CCharacter *CGameWorld::IntersectCharacter(vec2 Pos0, vec2 Pos1, float Radius, v
 }
 
 
+void CGameWorld::BuildCharacterGrid()
+{
+	m_CharacterGridWidth = max(1, GameServer()->Collision()->GetWidth()*32/CHARGRID_CELL_SIZE+1);
+	m_CharacterGridHeight = max(1, GameServer()->Collision()->GetHeight()*32/CHARGRID_CELL_SIZE+1);
+	int NumCells = m_CharacterGridWidth*m_CharacterGridHeight;
+
+	// counting sort by cell, keeps the list order within a cell
+	m_lCharacterGridStart.set_size(NumCells+1);
+	for(int i = 0; i <= NumCells; i++)
+		m_lCharacterGridStart[i] = 0;
+
+	int aCell[MAX_CLIENTS*2];
+	CCharacter *apChars[MAX_CLIENTS*2];
+	int Num = 0;
+	m_CharacterGridReach = 0.0f;
+	for(CCharacter *p = (CCharacter *)FindFirst(ENTTYPE_CHARACTER); p && Num < MAX_CLIENTS*2; p = (CCharacter *)p->TypeNext())
+	{
+		int x = clamp((int)(p->m_Pos.x/CHARGRID_CELL_SIZE), 0, m_CharacterGridWidth-1);
+		int y = clamp((int)(p->m_Pos.y/CHARGRID_CELL_SIZE), 0, m_CharacterGridHeight-1);
+		aCell[Num] = y*m_CharacterGridWidth+x;
+		apChars[Num] = p;
+		m_lCharacterGridStart[aCell[Num]+1]++;
+		m_CharacterGridReach = max(m_CharacterGridReach, p->m_ProximityRadius);
+		Num++;
+	}
+	for(int i = 0; i < NumCells; i++)
+		m_lCharacterGridStart[i+1] += m_lCharacterGridStart[i];
+
+	m_lCharacterGrid.set_size(Num);
+	m_lCharacterGridOrder.set_size(Num);
+	int aFill[MAX_CLIENTS*2];
+	for(int i = 0; i < Num; i++)
+	{
+		aFill[i] = m_lCharacterGridStart[aCell[i]]++;
+		m_lCharacterGrid[aFill[i]] = apChars[i];
+		m_lCharacterGridOrder[aFill[i]] = i;
+	}
+	for(int i = NumCells; i > 0; i--)
+		m_lCharacterGridStart[i] = m_lCharacterGridStart[i-1];
+	m_lCharacterGridStart[0] = 0;
+
+	m_CharacterGridValid = true;
+}
+
+CCharacter *CGameWorld::IntersectCharacterGrid(vec2 Pos0, vec2 Pos1, float Radius, vec2& NewPos, CEntity *pNotThis)
+{
+	if(!m_CharacterGridValid || !m_InProjectilePass)
+		BuildCharacterGrid();
+
+	float ClosestLen = distance(Pos0, Pos1) * 100.0f;
+	CCharacter *pClosest = 0;
+	int ClosestOrder = -1;
+
+	// a hit is at most this far from the bounding box of the line
+	float Reach = m_CharacterGridReach+Radius+1.0f;
+	int x0 = clamp((int)((min(Pos0.x, Pos1.x)-Reach)/CHARGRID_CELL_SIZE), 0, m_CharacterGridWidth-1);
+	int x1 = clamp((int)((max(Pos0.x, Pos1.x)+Reach)/CHARGRID_CELL_SIZE), 0, m_CharacterGridWidth-1);
+	int y0 = clamp((int)((min(Pos0.y, Pos1.y)-Reach)/CHARGRID_CELL_SIZE), 0, m_CharacterGridHeight-1);
+	int y1 = clamp((int)((max(Pos0.y, Pos1.y)+Reach)/CHARGRID_CELL_SIZE), 0, m_CharacterGridHeight-1);
+
+	for(int y = y0; y <= y1; y++)
+	{
+		int Start = m_lCharacterGridStart[y*m_CharacterGridWidth+x0];
+		int End = m_lCharacterGridStart[y*m_CharacterGridWidth+x1+1];
+		for(int i = Start; i < End; i++)
+		{
+			CCharacter *p = m_lCharacterGrid[i];
+			if(p == pNotThis)
+				continue;
+
+			// same test as IntersectCharacter, ties go to the character earlier in the list
+			vec2 IntersectPos = closest_point_on_line(Pos0, Pos1, p->m_Pos);
+			float Len = distance(p->m_Pos, IntersectPos);
+			if(Len < p->m_ProximityRadius+Radius)
+			{
+				Len = distance(Pos0, IntersectPos);
+				if(Len < ClosestLen || (Len == ClosestLen && pClosest && m_lCharacterGridOrder[i] < ClosestOrder))
+				{
+					NewPos = IntersectPos;
+					ClosestLen = Len;
+					pClosest = p;
+					ClosestOrder = m_lCharacterGridOrder[i];
+				}
+			}
+		}
+	}
+
+	return pClosest;
+}
+
+void CGameWorld::TickProjectiles()
+{
+	m_lProjectiles.clear();
+	for(CEntity *pEnt = m_apFirstEntityTypes[ENTTYPE_PROJECTILE]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+		m_lProjectiles.add((CProjectile *)pEnt);
+
+	int Num = m_lProjectiles.size();
+	if(!Num)
+		return;
+
+	// the characters moved since the last pass
+	m_CharacterGridValid = false;
+	m_InProjectilePass = true;
+
+	// evaluate the paths of all projectiles in one go
+	m_lProjectilePrevPos.set_size(Num);
+	m_lProjectileCurPos.set_size(Num);
+	int Tick = Server()->Tick();
+	float TickSpeed = (float)Server()->TickSpeed();
+	for(int i = 0; i < Num; i++)
+	{
+		CProjectile::CMotion Motion;
+		m_lProjectiles[i]->GetMotion(&Motion);
+		float Pt = (Tick-Motion.m_StartTick-1)/TickSpeed;
+		float Ct = (Tick-Motion.m_StartTick)/TickSpeed;
+		m_lProjectilePrevPos[i] = CalcPos(Motion.m_Pos, Motion.m_Direction, Motion.m_Curvature, Motion.m_Speed, Pt);
+		m_lProjectileCurPos[i] = CalcPos(Motion.m_Pos, Motion.m_Direction, Motion.m_Curvature, Motion.m_Speed, Ct);
+	}
+
+	// collisions and their effects have to happen in list order
+	for(int i = 0; i < Num; i++)
+		m_lProjectiles[i]->Advance(m_lProjectilePrevPos[i], m_lProjectileCurPos[i]);
+
+	m_CharacterGridValid = false;
+	m_InProjectilePass = false;
+}
+
 CCharacter *CGameWorld::ClosestCharacter(vec2 Pos, float Radius, CEntity *pNotThis)
 {
 	// Find other players
@@ -3,10 +3,12 @@
 #ifndef GAME_SERVER_GAMEWORLD_H
 #define GAME_SERVER_GAMEWORLD_H
 
+#include <base/tl/array.h>
 #include <game/gamecore.h>
 
 class CEntity;
 class CCharacter;
+class CProjectile;
 
 /*
 	Class: Game World
@@ -30,9 +32,31 @@ public:
 private:
 	void Reset();
 	void RemoveEntities();
+	void TickProjectiles();
+	void BuildCharacterGrid();
 
 	CEntity *m_pNextTraverseEntity;
 	CEntity *m_apFirstEntityTypes[NUM_ENTTYPES];
+	int m_aTypePhases[NUM_ENTTYPES]; // profiler phase of each entity type
+
+	// characters sorted by grid cell for the projectile pass, rebuilt after characters got inserted or removed
+	enum
+	{
+		CHARGRID_CELL_SIZE=512,
+	};
+	bool m_CharacterGridValid;
+	bool m_InProjectilePass; // the characters don't move while it runs
+	int m_CharacterGridWidth;
+	int m_CharacterGridHeight;
+	float m_CharacterGridReach; // largest proximity radius of the characters
+	array<int> m_lCharacterGridStart; // first entry of each cell, one extra at the end
+	array<CCharacter *> m_lCharacterGrid;
+	array<int> m_lCharacterGridOrder; // position of the character in the entity list
+
+	// projectile pass state
+	array<CProjectile *> m_lProjectiles;
+	array<vec2> m_lProjectilePrevPos;
+	array<vec2> m_lProjectileCurPos;
 
 	class CGameContext *m_pGameServer;
 	class IServer *m_pServer;
@@ -85,6 +109,16 @@ public:
 	*/
 	class CCharacter *IntersectCharacter(vec2 Pos0, vec2 Pos1, float Radius, vec2 &NewPos, class CEntity *pNotThis = 0);
 
+	/*
+		Function: IntersectCharacterGrid
+			Same as IntersectCharacter, but only tests the characters
+			of the grid cells near the line. Gives the same result.
+			The grid is built once per projectile pass, outside of it
+			every call builds it again, as the characters may have
+			moved since the last one.
+	*/
+	class CCharacter *IntersectCharacterGrid(vec2 Pos0, vec2 Pos1, float Radius, vec2 &NewPos, class CEntity *pNotThis = 0);
+
 	/*
 		Function: closest_CCharacter
 			Finds the closest CCharacter to a specific point.
@@ -12,13 +12,18 @@
 CMute::CMute() :
 		m_Mutes(MAX_MUTES)
 {
-	mem_zero(this, sizeof(CMute));
+	m_pServer = 0;
+	m_pGameServer = 0;
+	m_pConsole = 0;
+	m_LastPurge = 0;
 }
 
 void CMute::Init(CGameContext *pGameServer)
 {
 	m_pGameServer = pGameServer;
 	m_pServer = pGameServer->Server();
+	m_pConsole = pGameServer->Console();
+	LoadSpamFilter();
 }
 
 void CMute::OnConsoleInit(IConsole *pConsole)
@@ -28,6 +33,7 @@ void CMute::OnConsoleInit(IConsole *pConsole)
 	Console()->Register("unmuteid", "i", CFGFLAG_SERVER, ConUnmuteID, this, "Unmute a player by its client id");
 	Console()->Register("unmuteip", "i", CFGFLAG_SERVER, ConUnmuteIP, this, "Remove a mute by its index");
 	Console()->Register("mutes", "", CFGFLAG_SERVER, ConMutes, this, "Show all mutes");
+	Console()->Register("spamfilter_reload", "", CFGFLAG_SERVER, ConSpamfilterReload, this, "Reload the anti-adbot patterns from sv_spamfilter_file");
 }
 
 int CMute::NumMutes()
@@ -197,39 +203,38 @@ void CMute::ConUnmuteIP(IConsole::IResult *pResult, void *pUserData)
 		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "Mutes", "mute not found");
 }
 
-bool CMute::CheckSpam(int ClientID, const char* msg)
+void CMute::ConSpamfilterReload(IConsole::IResult *pResult, void *pUserData)
+{
+	CMute *pSelf = (CMute *) pUserData;
+	pSelf->LoadSpamFilter();
+}
+
+void CMute::LoadSpamFilter()
 {
-	int count = 0; // amount of flagged strings (some strings may count more than others)
-
-	// fancy alphabet detection
-	int fancy_count = 0;
-	const char* alphabet_fancy[] = {
-		"𝕢", "𝕨", "𝕖", "𝕣", "𝕥", "𝕪", "𝕦", "𝕚", "𝕠", "𝕡", "𝕒", "𝕤", "𝕕", "𝕗", "𝕘", "𝕙", "𝕛", "𝕜", "𝕝", "𝕫", "𝕩", "	", "𝕧", "𝕓", "𝕟", "𝕞",
-		"ｑ", "ｗ", "ｅ", "ｒ", "ｔ", "ｙ", "ｕ", "ｉ", "ｏ", "ｐ", "ａ", "ｓ", "ｄ", "ｆ", "ｇ", "ｈ", "ｊ", "ｋ", "ｌ", "ｚ", "ｘ", "ｃ", "ｖ", "ｂ", "ｎ", "ｍ",
-		"🆀", "🆆", "🅴", "🆁", "🆃", "🆈", "🆄", "🅸", "🅾", "🅿", "🅰", "🆂", "🅳", "🅵", "🅶", "🅷", "🅹", "🅺", "🅻", "🆉", "🆇", "🅲", "🆅", "🅱", "🅽", "🅼",
-		"🅀", "🅆", "🄴", "🅁", "🅃", "🅈", "🅄", "🄸", "🄾", "🄿", "🄰", "🅂", "🄳", "🄵", "🄶", "🄷", "🄹", "🄺", "🄻", "🅉", "🅇", "🄲", "🅅", "🄱", "🄽", "🄼",
-		"ⓠ", "ⓦ", "ⓔ", "ⓡ", "ⓣ", "ⓨ", "ⓤ", "ⓘ", "ⓞ", "ⓟ", "ⓐ", "ⓢ", "ⓓ", "ⓕ", "ⓖ", "ⓗ", "ⓙ", "ⓚ", "ⓛ", "ⓩ", "ⓧ", "ⓒ", "ⓥ", "ⓑ", "ⓝ", "ⓜ",
-	};
-	for (int i = 0; i < 130; i++) {
-		if (str_find_nocase(msg, alphabet_fancy[i]))
-			fancy_count++;
+	char aBuf[256];
+	if(g_Config.m_SvSpamfilterFile[0] && m_SpamFilter.Load(g_Config.m_SvSpamfilterFile))
+		str_format(aBuf, sizeof(aBuf), "loaded %d patterns from '%s'", m_SpamFilter.NumPatterns(), g_Config.m_SvSpamfilterFile);
+	else if(g_Config.m_SvSpamfilterFile[0] && m_SpamFilter.NumPatterns())
+	{
+		// a failed reload keeps the patterns in use
+		str_format(aBuf, sizeof(aBuf), "failed to load '%s', keeping the current %d patterns", g_Config.m_SvSpamfilterFile, m_SpamFilter.NumPatterns());
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "spamfilter", aBuf);
+		return;
 	}
-	if (fancy_count > 3)
-		count += 2;
-
-	// general needles to disallow
-	const char* disallowedStrings[] = {"krx", "discord.gg", "http", "free", "bot client", "cheat client"};
-	for (int i = 0; i < 6; i++) {
-		if (str_find_nocase(msg, disallowedStrings[i]))
-			count++;
+	else
+	{
+		if(g_Config.m_SvSpamfilterFile[0])
+		{
+			str_format(aBuf, sizeof(aBuf), "failed to load '%s', using the built-in patterns", g_Config.m_SvSpamfilterFile);
+			Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "spamfilter", aBuf);
+		}
+		m_SpamFilter.LoadDefaults();
+		str_format(aBuf, sizeof(aBuf), "loaded %d built-in patterns", m_SpamFilter.NumPatterns());
 	}
-	
-	// anti whisper ad bot
-	if ((str_find_nocase(msg, "/whisper") || str_find_nocase(msg, "/w")) && str_find_nocase(msg, "bro, check out this client"))
-		count += 2;
-
-	if (count >= 2) {
-		return true;
-	} else
-		return false;
+	Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "spamfilter", aBuf);
+}
+
+bool CMute::CheckSpam(int ClientID, const char* msg)
+{
+	return m_SpamFilter.IsSpam(msg);
 }
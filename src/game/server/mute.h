@@ -11,6 +11,7 @@
 #include <base/list.h>
 #include <engine/shared/config.h>
 #include <engine/console.h>
+#include "spamfilter.h"
 
 class CMute
 {
@@ -25,6 +26,7 @@ class CMute
 	static void ConUnmuteID(IConsole::IResult *pResult, void *pUserData);
 	static void ConUnmuteIP(IConsole::IResult *pResult, void *pUserData);
 	static void ConMutes(IConsole::IResult *pResult, void *pUserData);
+	static void ConSpamfilterReload(IConsole::IResult *pResult, void *pUserData);
 
 public:
 	CMute();
@@ -69,6 +71,10 @@ public:
 
 
 	bool CheckSpam(int ClientID, const char* msg);
+	/**
+	 * (Re)load the spam patterns from sv_spamfilter_file or the built-in lists
+	 */
+	void LoadSpamFilter();
 
 private:
 	/**
@@ -88,6 +94,10 @@ private:
 	 */
 	void Unmute(CMuteEntry *pMute);
 	int m_LastPurge;
+	/**
+	 * Compiled patterns used by CheckSpam
+	 */
+	CSpamFilter m_SpamFilter;
 };
 
 #endif /* GAME_SERVER_MUTE_H */
@@ -38,11 +38,11 @@ CPlayer::CPlayer(CGameContext *pGameServer, int ClientID, int Team)
 
 	m_Lives = g_Config.m_SvLMSLives;
 	m_isBot = 0;
-	m_botDirection = 1;
-	m_ticksSinceFire = 0;
-	m_botAggro = -1;
 
 	m_WantsPause = false;
+
+	m_ClientInfoDirty = true;
+	m_ClientInfoFrozenTag = false;
 }
 
 CPlayer::~CPlayer()
@@ -118,121 +118,6 @@ void CPlayer::Tick()
 		}
 		else if(m_Spawning && m_RespawnTick <= Server()->Tick())
 			TryRespawn();
-
-		if (m_isBot >= 2) {
-			// >=2 means the AI will shoot and maybe move, instead of being a dummy
-			// if there are no clients connected, the bots will idle
-			if (GameServer()->m_ClientCount <= 0) {
-				CNetObj_PlayerInput input;
-				input.m_Direction = 0;
-				input.m_TargetX = 0; // look randomly
-				input.m_TargetY = 0;
-				input.m_Jump = false;
-				input.m_Fire = false;
-				input.m_Hook = false;
-				input.m_PlayerFlags = PLAYERFLAG_PLAYING;
-				input.m_WantedWeapon = WEAPON_GUN+1;
-				input.m_NextWeapon = WEAPON_GUN+1;
-				input.m_PrevWeapon = WEAPON_GUN+1;
-				OnPredictedInput(&input);
-				OnDirectInput(&input);
-			} else {
-				CNetObj_PlayerInput input;
-				input.m_Direction = 0;
-				input.m_TargetX = (rand() % 128) - 64; // look randomly
-				input.m_TargetY = (rand() % 128) - 64;
-				input.m_Jump = false;
-				input.m_Fire = true;
-				if (!GameServer()->m_pController->IsInstagib()) // make non-automatic weapons work, but still have ammo reload work in instagib
-					input.m_Fire = GameServer()->Server()->Tick() % (2) == 1;
-				input.m_Hook = false;
-				input.m_PlayerFlags = PLAYERFLAG_PLAYING;
-				input.m_WantedWeapon = WEAPON_GUN+1;
-				if (GameServer()->m_pController->IsInstagib())
-					input.m_WantedWeapon = WEAPON_RIFLE+1;
-				if (GameServer()->m_pController->IsGrenade())
-					input.m_WantedWeapon = WEAPON_GRENADE+1;
-				input.m_NextWeapon = WEAPON_GUN+1;
-				input.m_PrevWeapon = WEAPON_GUN+1;
-				if (m_isBot >= 3) { // move, and occasionally jump
-					if (rand() % (SERVER_TICK_SPEED*2) == 1)
-						m_botDirection = -m_botDirection;
-					input.m_Direction = m_botDirection;
-					if (rand() % (SERVER_TICK_SPEED*2) == 1)
-						input.m_Jump = true;
-				}
-				if (m_isBot >= 4 && m_pCharacter) {
-					if (GameServer()->Server()->Tick() % (SERVER_TICK_SPEED) == 1) {
-						// get a new aggro
-						float smallestDistance = 850.0;
-						if (m_isBot == 4)
-							smallestDistance = 750.0;
-						m_botAggro = -1;
-
-						for (int i = 0; i < MAX_CLIENTS; i++) {
-							if (i != m_ClientID && GameServer()->m_apPlayers[i] && GameServer()->m_apPlayers[i]->GetCharacter()) {
-								vec2 pos = GameServer()->m_apPlayers[i]->GetCharacter()->m_Pos;
-								float d = sqrt((pos.x - m_pCharacter->m_Pos.x)*(pos.x - m_pCharacter->m_Pos.x) + (1.35)*(pos.y - m_pCharacter->m_Pos.y)*(pos.y - m_pCharacter->m_Pos.y));
-								// vertical distance is multiplied by a factor, since screens are larger horizontally
-								if (d < smallestDistance && !(GameServer()->m_pController->IsTeamplay() && GameServer()->m_apPlayers[i]->GetTeam() == GetTeam())) {
-									smallestDistance = d;
-									m_botAggro = i;
-								}
-							}
-						}
-					}
-					if (m_botAggro == -1) {
-						m_ticksSinceFire = 0; // reset
-						input.m_Fire = false; // do not shoot by default
-					} else {
-						m_ticksSinceFire++;
-						if (GameServer()->m_pController->IsGrenade()) {
-							if (m_isBot >= 5 || m_ticksSinceFire > 50) {
-								m_ticksSinceFire = 0; // reset
-								input.m_Fire = true; // fire
-							} else
-								input.m_Fire = false; // do not shoot by default
-						}
-						else if (GameServer()->m_pController->IsInstagib()) {
-							if (m_isBot >= 6 || (m_isBot == 5 && m_ticksSinceFire > 5 + g_Config.m_SvLaserReloadTime / Server()->TickSpeed()) || m_ticksSinceFire > 20+g_Config.m_SvLaserReloadTime / Server()->TickSpeed()) {
-								m_ticksSinceFire = 0; // reset
-								input.m_Fire = true; // fire
-							} else
-								input.m_Fire = false; // do not shoot by default
-						}
-						else {
-							if (m_ticksSinceFire > 10) { // 10 = 0.2s
-								m_ticksSinceFire = 0; // reset
-								input.m_Fire = true; // fire
-							} else
-								input.m_Fire = false; // do not shoot by default
-							if (m_isBot >= 5)
-								input.m_Fire = GameServer()->Server()->Tick() % (2) == 1;
-						}
-
-						// aim
-						if (GameServer()->m_apPlayers[m_botAggro] && GameServer()->m_apPlayers[m_botAggro]->GetCharacter()) {
-							vec2 pos = GameServer()->m_apPlayers[m_botAggro]->GetCharacter()->m_Pos;
-							float d = sqrt((pos.x - m_pCharacter->m_Pos.x)*(pos.x - m_pCharacter->m_Pos.x) + (pos.y - m_pCharacter->m_Pos.y)*(pos.y - m_pCharacter->m_Pos.y));
-							input.m_TargetX = pos.x - m_pCharacter->m_Pos.x; // aim
-							input.m_TargetY = pos.y - m_pCharacter->m_Pos.y;
-							if (GameServer()->m_pController->IsGrenade()) // grenade curve correction, somewhat
-								input.m_TargetY = input.m_TargetY + (-abs(input.m_TargetX)*0.3);
-							if (m_isBot <= 5) // aim worse
-							{
-								input.m_TargetX = (float)input.m_TargetX + (d * 0.3 * ((float)(rand() % 64) / 64.0 - 0.5));
-								input.m_TargetY = (float)input.m_TargetY + (d * 0.3 *  ((float)(rand() % 64) / 64.0 - 0.5));
-							}
-						}
-					}
-				}
-				OnPredictedInput(&input);
-				OnDirectInput(&input);
-				if (m_pCharacter) {
-					m_pCharacter->SetAmmo(WEAPON_GUN, 10);
-				}
-			}
-		}
 	}
 	else
 	{
@@ -261,19 +146,11 @@ void CPlayer::PostTick()
 		m_ViewPos = GameServer()->m_apPlayers[m_SpectatorID]->m_ViewPos;
 }
 
-void CPlayer::Snap(int SnappingClient)
+void CPlayer::EncodeClientInfo(bool FrozenTag)
 {
-#ifdef CONF_DEBUG
-	if(!g_Config.m_DbgDummies || m_ClientID < MAX_CLIENTS-g_Config.m_DbgDummies)
-#endif
-	if(!Server()->ClientIngame(m_ClientID))
-		return;
-
-	CNetObj_ClientInfo *pClientInfo = static_cast<CNetObj_ClientInfo *>(Server()->SnapNewItem(NETOBJTYPE_CLIENTINFO, m_ClientID, sizeof(CNetObj_ClientInfo)));
-	if(!pClientInfo)
-		return;
+	CNetObj_ClientInfo *pClientInfo = &m_ClientInfo;
 
-	if(m_pCharacter && m_pCharacter->Frozen() && GameServer()->m_pController->IsIFreeze() && g_Config.m_SvIFreezeFrozenTag)
+	if(FrozenTag)
 	{
 		char aBuf[MAX_NAME_LENGTH];
 		str_format(aBuf, sizeof(aBuf), "[F] %s", Server()->ClientName(m_ClientID));
@@ -289,6 +166,40 @@ void CPlayer::Snap(int SnappingClient)
 	pClientInfo->m_ColorBody = m_TeeInfos.m_ColorBody;
 	pClientInfo->m_ColorFeet = m_TeeInfos.m_ColorFeet;
 
+	if (m_isBot) {
+		StrToInts(&pClientInfo->m_Name0, 4, "bot");
+		StrToInts(&pClientInfo->m_Clan0, 3, "bot");
+		switch (m_isBot)
+		{
+		case 4: StrToInts(&pClientInfo->m_Clan0, 3, "bot4"); break;
+		case 5: StrToInts(&pClientInfo->m_Clan0, 3, "bot5"); break;
+		case 6: StrToInts(&pClientInfo->m_Clan0, 3, "bot6"); break;
+		default: break;
+		}
+		StrToInts(&pClientInfo->m_Skin0, 6, g_Config.m_SvBotSkin);
+	}
+
+	m_ClientInfoDirty = false;
+	m_ClientInfoFrozenTag = FrozenTag;
+}
+
+void CPlayer::Snap(int SnappingClient)
+{
+#ifdef CONF_DEBUG
+	if(!g_Config.m_DbgDummies || m_ClientID < MAX_CLIENTS-g_Config.m_DbgDummies)
+#endif
+	if(!Server()->ClientIngame(m_ClientID))
+		return;
+
+	CNetObj_ClientInfo *pClientInfo = static_cast<CNetObj_ClientInfo *>(Server()->SnapNewItem(NETOBJTYPE_CLIENTINFO, m_ClientID, sizeof(CNetObj_ClientInfo)));
+	if(!pClientInfo)
+		return;
+
+	bool FrozenTag = m_pCharacter && m_pCharacter->Frozen() && GameServer()->m_pController->IsIFreeze() && g_Config.m_SvIFreezeFrozenTag;
+	if(m_ClientInfoDirty || FrozenTag != m_ClientInfoFrozenTag)
+		EncodeClientInfo(FrozenTag);
+	mem_copy(pClientInfo, &m_ClientInfo, sizeof(CNetObj_ClientInfo));
+
 	CNetObj_PlayerInfo *pPlayerInfo = static_cast<CNetObj_PlayerInfo *>(Server()->SnapNewItem(NETOBJTYPE_PLAYERINFO, m_ClientID, sizeof(CNetObj_PlayerInfo)));
 	if(!pPlayerInfo)
 		return;
@@ -316,19 +227,8 @@ void CPlayer::Snap(int SnappingClient)
 		pSpectatorInfo->m_Y = m_ViewPos.y;
 	}
 
-	if (m_isBot) {
-		StrToInts(&pClientInfo->m_Name0, 4, "bot");
-		StrToInts(&pClientInfo->m_Clan0, 3, "bot");
-		switch (m_isBot)
-		{
-		case 4: StrToInts(&pClientInfo->m_Clan0, 3, "bot4"); break;
-		case 5: StrToInts(&pClientInfo->m_Clan0, 3, "bot5"); break;
-		case 6: StrToInts(&pClientInfo->m_Clan0, 3, "bot6"); break;
-		default: break;
-		}
-		StrToInts(&pClientInfo->m_Skin0, 6, g_Config.m_SvBotSkin);
+	if (m_isBot)
 		pPlayerInfo->m_Latency = 0;
-	}
 
 	// WARNING, this is very hardcoded; for ddnet client support
 	CNetObj_DDNetPlayer *pDDNetPlayer = (CNetObj_DDNetPlayer *)Server()->SnapNewItem(32765, GetCID(), 8);
@@ -461,6 +361,8 @@ void CPlayer::SetTeam(int Team, bool DoChatMsg)
 	GameServer()->Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "game", aBuf);
 
 	GameServer()->m_pController->OnPlayerInfoChange(GameServer()->m_apPlayers[m_ClientID]);
+	GameServer()->VoterUpdate(m_ClientID);
+	Server()->ExpireServerInfo();
 
 	if(Team == TEAM_SPECTATORS)
 	{
@@ -27,6 +27,8 @@ public:
 	void Tick();
 	void PostTick();
 	void Snap(int SnappingClient);
+	// the client info has to be encoded again before the next snap
+	void ClientInfoChanged() { m_ClientInfoDirty = true; }
 
 	void OnDirectInput(CNetObj_PlayerInput *NewInput);
 	void OnPredictedInput(CNetObj_PlayerInput *NewInput);
@@ -125,12 +127,15 @@ public:
 	bool m_FreezeOnSpawn;
 
 	int m_Lives; // for LMS
-	int m_isBot; // for detecting if this is a bot and what kind
-	int m_botDirection; // last moved direction
-	int m_ticksSinceFire; // ticks since last fire
-	int m_botAggro; // whether it is aggroed and on whom
+	int m_isBot; // for detecting if this is a bot and what kind, driven by CBotEngine
 	bool m_WantsPause;
 private:
+	// encoded client info, shared by all snapping clients
+	CNetObj_ClientInfo m_ClientInfo;
+	bool m_ClientInfoDirty;
+	bool m_ClientInfoFrozenTag;
+	void EncodeClientInfo(bool FrozenTag);
+
 	CCharacter *m_pCharacter;
 	CGameContext *m_pGameServer;
 
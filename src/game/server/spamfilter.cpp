@@ -0,0 +1,265 @@
+/* File is created for the TW+ mod
+ */
+
+#include <base/system.h>
+#include "spamfilter.h"
+
+static const char *s_apPatternTypes[CSpamFilter::NUM_PATTERN_TYPES] = {"fancy", "needle", "whisper", "ad"};
+
+CSpamFilter::CSpamFilter()
+{
+	mem_zero(m_aClass, sizeof(m_aClass));
+	m_NumClasses = 1;
+	m_Generation = 0;
+}
+
+void CSpamFilter::LoadDefaults()
+{
+	static const char *s_apFancy[] = {
+		"𝕢", "𝕨", "𝕖", "𝕣", "𝕥", "𝕪", "𝕦", "𝕚", "𝕠", "𝕡", "𝕒", "𝕤", "𝕕", "𝕗", "𝕘", "𝕙", "𝕛", "𝕜", "𝕝", "𝕫", "𝕩", "𝕔", "𝕧", "𝕓", "𝕟", "𝕞",
+		"ｑ", "ｗ", "ｅ", "ｒ", "ｔ", "ｙ", "ｕ", "ｉ", "ｏ", "ｐ", "ａ", "ｓ", "ｄ", "ｆ", "ｇ", "ｈ", "ｊ", "ｋ", "ｌ", "ｚ", "ｘ", "ｃ", "ｖ", "ｂ", "ｎ", "ｍ",
+		"🆀", "🆆", "🅴", "🆁", "🆃", "🆈", "🆄", "🅸", "🅾", "🅿", "🅰", "🆂", "🅳", "🅵", "🅶", "🅷", "🅹", "🅺", "🅻", "🆉", "🆇", "🅲", "🆅", "🅱", "🅽", "🅼",
+		"🅀", "🅆", "🄴", "🅁", "🅃", "🅈", "🅄", "🄸", "🄾", "🄿", "🄰", "🅂", "🄳", "🄵", "🄶", "🄷", "🄹", "🄺", "🄻", "🅉", "🅇", "🄲", "🅅", "🄱", "🄽", "🄼",
+		"ⓠ", "ⓦ", "ⓔ", "ⓡ", "ⓣ", "ⓨ", "ⓤ", "ⓘ", "ⓞ", "ⓟ", "ⓐ", "ⓢ", "ⓓ", "ⓕ", "ⓖ", "ⓗ", "ⓙ", "ⓚ", "ⓛ", "ⓩ", "ⓧ", "ⓒ", "ⓥ", "ⓑ", "ⓝ", "ⓜ",
+	};
+	static const char *s_apNeedles[] = {"krx", "discord.gg", "http", "free", "bot client", "cheat client"};
+	static const char *s_apWhisper[] = {"/whisper", "/w"};
+	static const char *s_apAds[] = {"bro, check out this client"};
+
+	array<CSource> lSources;
+	CSource Source;
+	Source.m_Type = PATTERN_FANCY;
+	for(unsigned i = 0; i < sizeof(s_apFancy)/sizeof(s_apFancy[0]); i++)
+	{
+		Source.m_pText = s_apFancy[i];
+		lSources.add(Source);
+	}
+	Source.m_Type = PATTERN_NEEDLE;
+	for(unsigned i = 0; i < sizeof(s_apNeedles)/sizeof(s_apNeedles[0]); i++)
+	{
+		Source.m_pText = s_apNeedles[i];
+		lSources.add(Source);
+	}
+	Source.m_Type = PATTERN_WHISPER;
+	for(unsigned i = 0; i < sizeof(s_apWhisper)/sizeof(s_apWhisper[0]); i++)
+	{
+		Source.m_pText = s_apWhisper[i];
+		lSources.add(Source);
+	}
+	Source.m_Type = PATTERN_AD;
+	for(unsigned i = 0; i < sizeof(s_apAds)/sizeof(s_apAds[0]); i++)
+	{
+		Source.m_pText = s_apAds[i];
+		lSources.add(Source);
+	}
+
+	Compile(lSources.base_ptr(), lSources.size());
+}
+
+bool CSpamFilter::Load(const char *pFilename)
+{
+	IOHANDLE File = io_open(pFilename, IOFLAG_READ);
+	if(!File)
+		return false;
+
+	int Size = io_length(File);
+	if(Size < 0)
+	{
+		io_close(File);
+		return false;
+	}
+	char *pData = (char *)mem_alloc_tag(Size+1, 1, MEMTAG_GAME);
+	Size = io_read(File, pData, Size);
+	pData[Size] = 0;
+	io_close(File);
+
+	// parse the lines in place, the sources point into the file data
+	array<CSource> lSources;
+	bool Valid = true;
+	char *pLine = pData;
+	while(pLine && Valid)
+	{
+		char *pNext = 0;
+		for(char *p = pLine; *p; p++)
+		{
+			if(*p == '\n')
+			{
+				*p = 0;
+				pNext = p+1;
+				break;
+			}
+			if(*p == '\r')
+				*p = 0;
+		}
+
+		pLine = str_skip_whitespaces(pLine);
+		if(*pLine && *pLine != '#')
+		{
+			char *pText = str_skip_to_whitespace(pLine);
+			if(*pText)
+				*pText++ = 0;
+			pText = str_skip_whitespaces(pText);
+
+			CSource Source;
+			Source.m_Type = -1;
+			Source.m_pText = pText;
+			for(int i = 0; i < NUM_PATTERN_TYPES; i++)
+				if(str_comp(pLine, s_apPatternTypes[i]) == 0)
+					Source.m_Type = i;
+
+			if(Source.m_Type == -1 || !*pText)
+				Valid = false;
+			else
+				lSources.add(Source);
+		}
+		pLine = pNext;
+	}
+
+	if(Valid)
+		Compile(lSources.base_ptr(), lSources.size());
+	mem_free(pData);
+	return Valid;
+}
+
+void CSpamFilter::Compile(const CSource *pSources, int Num)
+{
+	// map every byte used in the patterns to its own class, ascii letters share the class with their lowercase form
+	mem_zero(m_aClass, sizeof(m_aClass));
+	m_NumClasses = 1;
+	for(int i = 0; i < Num; i++)
+	{
+		for(const unsigned char *p = (const unsigned char *)pSources[i].m_pText; *p; p++)
+		{
+			unsigned char c = (*p >= 'A' && *p <= 'Z') ? *p-'A'+'a' : *p;
+			if(!m_aClass[c])
+				m_aClass[c] = m_NumClasses++;
+		}
+	}
+	for(int c = 'A'; c <= 'Z'; c++)
+		m_aClass[c] = m_aClass[c-'A'+'a'];
+
+	m_lPatterns.clear();
+	m_lDelta.clear();
+	m_lPattern.clear();
+	m_lOutput.clear();
+
+	// build the trie
+	m_lDelta.set_size(m_NumClasses);
+	for(int c = 0; c < m_NumClasses; c++)
+		m_lDelta[c] = -1;
+	m_lPattern.add(-1);
+	m_lOutput.add(-1);
+
+	for(int i = 0; i < Num; i++)
+	{
+		int State = 0;
+		for(const unsigned char *p = (const unsigned char *)pSources[i].m_pText; *p; p++)
+		{
+			int Transition = State*m_NumClasses + m_aClass[*p];
+			if(m_lDelta[Transition] < 0)
+			{
+				int NewState = m_lPattern.size();
+				m_lDelta.set_size((NewState+1)*m_NumClasses);
+				for(int c = 0; c < m_NumClasses; c++)
+					m_lDelta[NewState*m_NumClasses+c] = -1;
+				m_lPattern.add(-1);
+				m_lOutput.add(-1);
+				m_lDelta[Transition] = NewState;
+			}
+			State = m_lDelta[Transition];
+		}
+		if(State == 0)
+			continue;
+
+		bool Duplicate = false;
+		for(int p = m_lPattern[State]; p >= 0; p = m_lPatterns[p].m_NextSame)
+			if(m_lPatterns[p].m_Type == pSources[i].m_Type)
+				Duplicate = true;
+		if(Duplicate)
+			continue;
+
+		CPattern Pattern;
+		Pattern.m_Type = pSources[i].m_Type;
+		Pattern.m_NextSame = m_lPattern[State];
+		m_lPattern[State] = m_lPatterns.add(Pattern);
+	}
+
+	// turn it into a dfa by following the failure links breadth first
+	int NumStates = m_lPattern.size();
+	array<int> lFail;
+	array<int> lQueue;
+	lFail.set_size(NumStates);
+	lQueue.hint_size(NumStates);
+	lFail[0] = 0;
+	for(int c = 0; c < m_NumClasses; c++)
+	{
+		int Next = m_lDelta[c];
+		if(Next < 0)
+			m_lDelta[c] = 0;
+		else
+		{
+			lFail[Next] = 0;
+			lQueue.add(Next);
+		}
+	}
+	for(int Head = 0; Head < lQueue.size(); Head++)
+	{
+		int State = lQueue[Head];
+		int Fail = lFail[State];
+		m_lOutput[State] = m_lPattern[Fail] >= 0 ? Fail : m_lOutput[Fail];
+		for(int c = 0; c < m_NumClasses; c++)
+		{
+			int Next = m_lDelta[State*m_NumClasses+c];
+			if(Next < 0)
+				m_lDelta[State*m_NumClasses+c] = m_lDelta[Fail*m_NumClasses+c];
+			else
+			{
+				lFail[Next] = m_lDelta[Fail*m_NumClasses+c];
+				lQueue.add(Next);
+			}
+		}
+	}
+
+	m_lSeen.set_size(m_lPatterns.size());
+	for(int i = 0; i < m_lSeen.size(); i++)
+		m_lSeen[i] = 0;
+	m_Generation = 0;
+}
+
+int CSpamFilter::Score(const char *pMsg)
+{
+	if(!m_lPatterns.size())
+		return 0;
+
+	if(++m_Generation == 0)
+	{
+		for(int i = 0; i < m_lSeen.size(); i++)
+			m_lSeen[i] = 0;
+		m_Generation = 1;
+	}
+
+	// count every pattern once, no matter how often it appears
+	int aCount[NUM_PATTERN_TYPES] = {0};
+	int State = 0;
+	for(const unsigned char *p = (const unsigned char *)pMsg; *p; p++)
+	{
+		State = m_lDelta[State*m_NumClasses + m_aClass[*p]];
+		for(int Match = m_lPattern[State] >= 0 ? State : m_lOutput[State]; Match >= 0; Match = m_lOutput[Match])
+		{
+			for(int i = m_lPattern[Match]; i >= 0; i = m_lPatterns[i].m_NextSame)
+			{
+				if(m_lSeen[i] == m_Generation)
+					continue;
+				m_lSeen[i] = m_Generation;
+				aCount[m_lPatterns[i].m_Type]++;
+			}
+		}
+	}
+
+	int Score = aCount[PATTERN_NEEDLE];
+	if(aCount[PATTERN_FANCY] > FANCY_THRESHOLD)
+		Score += 2;
+	if(aCount[PATTERN_WHISPER] && aCount[PATTERN_AD])
+		Score += 2;
+	return Score;
+}
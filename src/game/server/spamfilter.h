@@ -0,0 +1,81 @@
+/* File is created for the TW+ mod
+ */
+
+#ifndef GAME_SERVER_SPAMFILTER_H
+#define GAME_SERVER_SPAMFILTER_H
+
+#include <base/tl/array.h>
+
+/**
+ * Finds all spam patterns of a chat message in a single pass.
+ *
+ * The patterns are compiled into an Aho-Corasick automaton over the
+ * bytes of their UTF-8 encoding, ascii letters are matched case insensitive.
+ */
+class CSpamFilter
+{
+public:
+	enum
+	{
+		PATTERN_FANCY=0, // characters of fancy alphabets
+		PATTERN_NEEDLE, // strings that are not allowed
+		PATTERN_WHISPER, // whisper commands, only flagged together with an ad
+		PATTERN_AD, // text of whisper ads
+		NUM_PATTERN_TYPES,
+
+		FANCY_THRESHOLD=3, // number of different fancy characters a message may contain
+		SPAM_SCORE=2,
+	};
+
+	CSpamFilter();
+
+	/**
+	 * Replaces the patterns with the built-in lists
+	 */
+	void LoadDefaults();
+	/**
+	 * Replaces the patterns with the ones of the given file, lines are
+	 * in the form "<fancy|needle|whisper|ad> <pattern>", '#' starts a comment.
+	 * Keeps the current patterns and returns false on failure
+	 */
+	bool Load(const char *pFilename);
+
+	/**
+	 * Returns the spam score of the message, SPAM_SCORE or more is spam
+	 */
+	int Score(const char *pMsg);
+	bool IsSpam(const char *pMsg) { return Score(pMsg) >= SPAM_SCORE; }
+
+	int NumPatterns() const { return m_lPatterns.size(); }
+	int NumStates() const { return m_lPattern.size(); }
+
+private:
+	struct CPattern
+	{
+		int m_Type;
+		int m_NextSame; // next pattern with the same text or -1
+	};
+
+	struct CSource
+	{
+		int m_Type;
+		const char *m_pText;
+	};
+
+	void Compile(const CSource *pSources, int Num);
+
+	array<CPattern> m_lPatterns;
+
+	// automaton, state 0 is the root
+	unsigned char m_aClass[256];
+	int m_NumClasses;
+	array<int> m_lDelta; // m_NumClasses transitions per state
+	array<int> m_lPattern; // first pattern ending in a state or -1
+	array<int> m_lOutput; // next state on the failure chain that ends a pattern or -1
+
+	// marks patterns already counted for the current message
+	array<unsigned> m_lSeen;
+	unsigned m_Generation;
+};
+
+#endif
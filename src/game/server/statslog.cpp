@@ -0,0 +1,218 @@
+/* File is created for the TW+ mod
+ */
+
+#include <stdio.h>
+
+#include "statslog.h"
+
+CStatsRecord::CStatsRecord(const char *pType, int Time)
+{
+	m_Size = 0;
+	m_Overflow = false;
+	Append("{");
+	AddStr("type", pType);
+	AddInt("time", Time);
+}
+
+void CStatsRecord::Append(const char *pStr)
+{
+	int Length = str_length(pStr);
+	// keep room for the closing bracket and the line break
+	if(m_Overflow || m_Size + Length > MAX_SIZE-3)
+	{
+		m_Overflow = true;
+		return;
+	}
+	mem_copy(&m_aBuf[m_Size], pStr, Length);
+	m_Size += Length;
+}
+
+void CStatsRecord::AppendKey(const char *pKey)
+{
+	if(m_Size > 1)
+		Append(",");
+	Append("\"");
+	Append(pKey);
+	Append("\":");
+}
+
+void CStatsRecord::AddInt(const char *pKey, int Value)
+{
+	char aBuf[16];
+	str_format(aBuf, sizeof(aBuf), "%d", Value);
+	AppendKey(pKey);
+	Append(aBuf);
+}
+
+void CStatsRecord::AddFloat(const char *pKey, double Value)
+{
+	char aBuf[32];
+	str_format(aBuf, sizeof(aBuf), "%.2f", Value);
+	AppendKey(pKey);
+	Append(aBuf);
+}
+
+void CStatsRecord::AddStr(const char *pKey, const char *pValue)
+{
+	AppendKey(pKey);
+	Append("\"");
+
+	// escape quotes, backslashes and control characters, everything else is utf8 already
+	char aBuf[8];
+	for(const unsigned char *p = (const unsigned char *)pValue; *p; p++)
+	{
+		if(*p == '"' || *p == '\\')
+			str_format(aBuf, sizeof(aBuf), "\\%c", *p);
+		else if(*p < 0x20)
+			str_format(aBuf, sizeof(aBuf), "\\u%04x", *p);
+		else
+		{
+			aBuf[0] = *p;
+			aBuf[1] = 0;
+		}
+		Append(aBuf);
+	}
+
+	Append("\"");
+}
+
+void CStatsRecord::AddIntArray(const char *pKey, const int *pValues, int Num)
+{
+	char aBuf[16];
+	AppendKey(pKey);
+	Append("[");
+	for(int i = 0; i < Num; i++)
+	{
+		str_format(aBuf, sizeof(aBuf), i ? ",%d" : "%d", pValues[i]);
+		Append(aBuf);
+	}
+	Append("]");
+}
+
+const char *CStatsRecord::Finish(int *pSize)
+{
+	if(m_Overflow)
+		return 0;
+	m_aBuf[m_Size++] = '}';
+	m_aBuf[m_Size++] = '\n';
+	m_aBuf[m_Size] = 0;
+	*pSize = m_Size;
+	return m_aBuf;
+}
+
+CStatsLog::CStatsLog()
+{
+	m_pThread = 0;
+	m_Lock = lock_create();
+	for(int i = 0; i < 2; i++)
+	{
+		m_apBuffers[i] = (char *)mem_alloc_tag(BUFFER_SIZE, 1, MEMTAG_GAME);
+		m_aBufferSize[i] = 0;
+		m_aaFilename[i][0] = 0;
+	}
+	m_Current = 0;
+	m_Pending = -1;
+	m_Stop = false;
+	m_OpenFailed = false;
+	m_NumDropped = 0;
+}
+
+CStatsLog::~CStatsLog()
+{
+	// the thread writes everything that is left before it stops
+	if(m_pThread)
+	{
+		m_Stop = true;
+		thread_wait(m_pThread);
+	}
+
+	lock_destroy(m_Lock);
+	for(int i = 0; i < 2; i++)
+		mem_free(m_apBuffers[i]);
+}
+
+void CStatsLog::WriterThread(void *pUser)
+{
+	CStatsLog *pThis = (CStatsLog *)pUser;
+	while(1)
+	{
+		// take whatever was written since the last time
+		lock_wait(pThis->m_Lock);
+		if(pThis->m_Pending == -1 && pThis->m_aBufferSize[pThis->m_Current])
+		{
+			pThis->m_Pending = pThis->m_Current;
+			pThis->m_Current ^= 1;
+			pThis->m_aBufferSize[pThis->m_Current] = 0;
+		}
+		int Pending = pThis->m_Pending;
+		lock_release(pThis->m_Lock);
+
+		if(Pending != -1)
+		{
+			FILE *pFile = fopen(pThis->m_aaFilename[Pending], "a");
+			if(pFile)
+			{
+				fwrite(pThis->m_apBuffers[Pending], 1, pThis->m_aBufferSize[Pending], pFile);
+				fclose(pFile);
+			}
+			else
+				pThis->m_OpenFailed = true;
+
+			lock_wait(pThis->m_Lock);
+			pThis->m_Pending = -1;
+			lock_release(pThis->m_Lock);
+		}
+		else if(pThis->m_Stop)
+			break;
+		else
+			thread_sleep(100);
+	}
+}
+
+void CStatsLog::Write(const char *pFilename, const char *pData, int Size)
+{
+	if(!pFilename[0] || Size <= 0 || Size > BUFFER_SIZE)
+		return;
+
+	if(!m_pThread)
+		m_pThread = teethread_create(WriterThread, this);
+
+	lock_wait(m_Lock);
+	int Used = m_aBufferSize[m_Current];
+	if(Used && (Used + Size > BUFFER_SIZE || str_comp(m_aaFilename[m_Current], pFilename) != 0))
+	{
+		// the writer is still busy with the other buffer
+		if(m_Pending != -1)
+		{
+			m_NumDropped++;
+			lock_release(m_Lock);
+			return;
+		}
+		m_Pending = m_Current;
+		m_Current ^= 1;
+		m_aBufferSize[m_Current] = 0;
+	}
+
+	if(!m_aBufferSize[m_Current])
+		str_copy(m_aaFilename[m_Current], pFilename, sizeof(m_aaFilename[m_Current]));
+	mem_copy(m_apBuffers[m_Current] + m_aBufferSize[m_Current], pData, Size);
+	m_aBufferSize[m_Current] += Size;
+	lock_release(m_Lock);
+}
+
+int CStatsLog::TakeNumDropped()
+{
+	lock_wait(m_Lock);
+	int NumDropped = m_NumDropped;
+	m_NumDropped = 0;
+	lock_release(m_Lock);
+	return NumDropped;
+}
+
+bool CStatsLog::OpenFailed()
+{
+	if(!m_OpenFailed)
+		return false;
+	m_OpenFailed = false;
+	return true;
+}
@@ -0,0 +1,107 @@
+/* File is created for the TW+ mod
+ */
+
+#ifndef GAME_SERVER_STATSLOG_H
+#define GAME_SERVER_STATSLOG_H
+
+#include <base/system.h>
+
+/*
+	Stats file with sv_stats_format 1, one JSON object per line. Every
+	record has "type" and "time" (unix time the record was made).
+
+	type "round", written at the end of a round:
+		"start"     unix time the round started
+		"length"    seconds played
+		"gametype", "map"
+		"red", "blue"  team scores, only in team games
+
+	type "player", one per player in the game at the end of a round:
+		"round"     "start" of the round record it belongs to
+		"id", "name", "clan", "team" (0 red or game, 1 blue)
+		"score", "kills", "deaths", "hits", "shots"
+		"weapon_shots"  shots per weapon, hammer to ninja
+		"captures", "lost_flags"
+		"fastest_capture"  seconds, 0 if there was none
+
+	type "kill", with sv_stats_kills 1:
+		"tick", "killer", "killer_name", "victim", "victim_name"
+		"weapon"    weapon id, negative for the world, suicide and the game
+		"special"   mode special flags, 1 if the victim carried the flag
+
+	sv_stats_outputlevel only enables the JSON records, they always carry
+	all fields.
+*/
+class CStatsRecord
+{
+	enum
+	{
+		MAX_SIZE=2048,
+	};
+
+	char m_aBuf[MAX_SIZE];
+	int m_Size;
+	bool m_Overflow;
+
+	void Append(const char *pStr);
+	void AppendKey(const char *pKey);
+
+public:
+	CStatsRecord(const char *pType, int Time);
+
+	void AddInt(const char *pKey, int Value);
+	void AddFloat(const char *pKey, double Value);
+	void AddStr(const char *pKey, const char *pValue);
+	void AddIntArray(const char *pKey, const int *pValues, int Num);
+
+	/**
+	 * Closes the record and terminates the line, returns 0 if it did not fit
+	 */
+	const char *Finish(int *pSize);
+};
+
+/*
+	Appends to the stats file on a background thread, so neither opening
+	nor writing the file holds up the game. The game thread fills one
+	buffer while the thread writes the other one. Records get dropped
+	while both are full.
+*/
+class CStatsLog
+{
+	enum
+	{
+		BUFFER_SIZE=64*1024,
+	};
+
+	static void WriterThread(void *pUser);
+
+	void *m_pThread;
+	LOCK m_Lock;
+
+	char *m_apBuffers[2];
+	int m_aBufferSize[2];
+	char m_aaFilename[2][256];
+	int m_Current; // buffer the records go to
+	volatile int m_Pending; // buffer the thread has to write or -1
+	volatile bool m_Stop;
+	volatile bool m_OpenFailed;
+	int m_NumDropped;
+
+public:
+	CStatsLog();
+	~CStatsLog();
+
+	void Write(const char *pFilename, const char *pData, int Size);
+
+	/**
+	 * Returns the number of records dropped since the last call
+	 */
+	int TakeNumDropped();
+
+	/**
+	 * Returns true once after the thread failed to open the file
+	 */
+	bool OpenFailed();
+};
+
+#endif
@@ -125,6 +125,8 @@ MACRO_CONFIG_INT(SvLaserReloadTime, sv_laser_reload_time, 800, 0, 2400, CFGFLAG_
 //
 MACRO_CONFIG_STR(SvStatsFile, sv_stats_file, 256, "stats.txt", CFGFLAG_SERVER, "Name of the file where the statistics are stored in")
 MACRO_CONFIG_INT(SvStatsOutputlevel, sv_stats_outputlevel, 0, 0, 3, CFGFLAG_SERVER, "How much informations in the statistics-file should be saved (0 to disable saving)")
+MACRO_CONFIG_INT(SvStatsFormat, sv_stats_format, 0, 0, 1, CFGFLAG_SERVER, "Format of the statistics-file (0 = text table, 1 = one JSON record per line)")
+MACRO_CONFIG_INT(SvStatsKills, sv_stats_kills, 0, 0, 1, CFGFLAG_SERVER, "Also save every kill in the statistics-file (JSON format only)")
 //
 MACRO_CONFIG_STR(SvChatMessage, sv_chat_message, 256, "", CFGFLAG_SERVER, "A message which will be periodically shown in chat")
 MACRO_CONFIG_INT(SvChatMessageInterval, sv_chat_message_interval, 15, 7, 1000000, CFGFLAG_SERVER, "The interval in minutes where the message is sent to chat")
@@ -191,6 +193,7 @@ MACRO_CONFIG_INT(SvHookkill, sv_indirect_kill, 1, 0, 1, CFGFLAG_SERVER, "(WIP) W
 MACRO_CONFIG_INT(SvIndirectKillTicks, sv_indirect_kill_ticks, 100, 0, 1000, CFGFLAG_SERVER, "Ticks after being hooked that will still count as a kill")
 
 MACRO_CONFIG_INT(SvChatMe, sv_slash_me, 1, 0, 1, CFGFLAG_SERVER, "Whether or not to enable /me usage")
+MACRO_CONFIG_INT(SvChatCommandCooldown, sv_chat_command_cooldown, 3, 0, 60, CFGFLAG_SERVER, "Seconds players have to wait between uses of expensive chat commands like /stats")
 
 //MACRO_CONFIG_INT(SvTuneReset, sv_tune_reset, 5, 0, 10, CFGFLAG_SERVER, "(WIP) Whether tuning is reset after each map change or not")
 
@@ -222,8 +225,11 @@ MACRO_CONFIG_INT(SvKillingspreeParticles, sv_killingspree_particles, 1, 0, 1, CF
 
 MACRO_CONFIG_INT(SvBotsPreferredAmount, sv_bots_preferred_amount, 0, 0, MAX_CLIENTS-1, CFGFLAG_SERVER, "Preferred amount of bots (takes effect on reload)")
 MACRO_CONFIG_INT(SvBotsPreferredLevel, sv_bots_preferred_level, 4, 1, 6, CFGFLAG_SERVER, "Preferred level of bots (max:6) (takes effect on reload)")
+MACRO_CONFIG_INT(SvBotThinkBudget, sv_bot_think_budget, 8, 1, MAX_CLIENTS, CFGFLAG_SERVER, "Number of bots that plan their path per tick")
+MACRO_CONFIG_INT(SvBotPathBudget, sv_bot_path_budget, 512, 16, 65536, CFGFLAG_SERVER, "Number of navigation nodes a bot may visit per path search")
 
 MACRO_CONFIG_INT(SvAntiAdbot, sv_antiadbot, 1, 0, 3, CFGFLAG_SERVER, "whether antiadbot should be on")
+MACRO_CONFIG_STR(SvSpamfilterFile, sv_spamfilter_file, 128, "", CFGFLAG_SERVER, "File with the antiadbot patterns (empty for the built-in ones)")
 
 MACRO_CONFIG_INT(SvLaserDeath, sv_laser_death, 0, 0, 1, CFGFLAG_SERVER, "spawn sv_laser_death_amount lasers on death")
 MACRO_CONFIG_INT(SvLaserDeathAmount, sv_laser_death_amount, 16, 0, 64, CFGFLAG_SERVER, "amount of lasers to spawn on death (if sv_laser_death is 1)")
@@ -239,7 +245,8 @@ MACRO_CONFIG_INT(SvDDShowHud, sv_dd_show_hud, 1, 0, 1, CFGFLAG_SERVER, "Whether
 MACRO_CONFIG_INT(SvDDExposeAuthed, sv_dd_expose_authed, 1, 0, 1, CFGFLAG_SERVER, "Whether or not to color client's names if they are authenticated in rcon")
 
 // fast download
-MACRO_CONFIG_INT(SvMapWindow, sv_map_window, 15, 0, 100, CFGFLAG_SERVER, "Map downloading send-ahead window")
+MACRO_CONFIG_INT(SvMapWindow, sv_map_window, 15, 0, 100, CFGFLAG_SERVER, "Map downloading send-ahead window to start with, it adapts to the connection")
+MACRO_CONFIG_INT(SvMapDownloadSpeed, sv_map_download_speed, 0, 0, 100000, CFGFLAG_SERVER, "Bandwidth in KB/s all fast map downloads share (0 for no limit)")
 MACRO_CONFIG_INT(SvFastDownload, sv_fast_download, 1, 0, 1, CFGFLAG_SERVER, "Enables fast download of maps")
 
 #endif
@@ -0,0 +1,593 @@
+/* File is created for the TW+ mod
+ */
+
+#include <base/math.h>
+#include <base/system.h>
+#include <base/vmath.h>
+
+#include <engine/message.h>
+#include <engine/shared/network.h>
+#include <engine/shared/packer.h>
+#include <engine/shared/protocol.h>
+
+#include <game/generated/protocol.h>
+#include <game/version.h>
+
+/*
+	Connects a number of simulated clients to a server and plays them
+	like real players: they download the map, enter the game, send
+	inputs every tick, chat from time to time and ack the snapshots.
+
+	Every second a line with the observed server tick time, the
+	snapshot sizes and the traffic per client is printed. Traffic
+	counts the message payload without the packet headers.
+
+	All clients come from the same address, the server needs
+	sv_max_clients_per_ip set to at least the number of clients.
+*/
+
+enum
+{
+	MAX_SIM_CLIENTS=NET_MAX_CLIENTS,
+	MAX_SNAP_PARTS=64,
+	DDNET_VERSION=VERSION_DDNET_REDIRECT,
+};
+
+struct CStats
+{
+	int64 m_BytesIn;
+	int64 m_BytesOut;
+	int m_Snaps;
+	int m_EmptySnaps;
+	int64 m_SnapBytes;
+	int m_MaxSnapBytes;
+	int64 m_TickTime; // sum of the time between snapshots divided by their tick distance
+	int64 m_MaxTickTime;
+	int m_TickSamples;
+	int64 m_Ping;
+	int64 m_MaxPing;
+	int m_Pings;
+	int m_Chats;
+
+	void Add(const CStats &Other)
+	{
+		m_BytesIn += Other.m_BytesIn;
+		m_BytesOut += Other.m_BytesOut;
+		m_Snaps += Other.m_Snaps;
+		m_EmptySnaps += Other.m_EmptySnaps;
+		m_SnapBytes += Other.m_SnapBytes;
+		m_MaxSnapBytes = max(m_MaxSnapBytes, Other.m_MaxSnapBytes);
+		m_TickTime += Other.m_TickTime;
+		m_MaxTickTime = max(m_MaxTickTime, Other.m_MaxTickTime);
+		m_TickSamples += Other.m_TickSamples;
+		m_Ping += Other.m_Ping;
+		m_MaxPing = max(m_MaxPing, Other.m_MaxPing);
+		m_Pings += Other.m_Pings;
+		m_Chats += Other.m_Chats;
+	}
+};
+
+class CSimClient
+{
+public:
+	enum
+	{
+		STATE_OFFLINE=0,
+		STATE_CONNECTING,
+		STATE_LOADING,
+		STATE_READY,
+		STATE_INGAME,
+		STATE_ERROR,
+	};
+
+	int m_Index;
+	int m_State;
+	CNetClient m_Net;
+
+	CStats m_Stats; // current report interval
+	CStats m_Total;
+
+	bool Init(int Index, NETADDR *pServerAddr, const char *pPassword, int ChatInterval);
+	void Update(int64 Now);
+	void Close(const char *pReason);
+
+private:
+	char m_aPassword[32];
+	int m_ChatInterval;
+
+	// map download
+	int m_MapCrc;
+	int m_MapChunk;
+	int64 m_MapBytes;
+	int64 m_LastMapData;
+
+	// snapshots
+	int m_AckTick; // last complete snapshot, sent with every input
+	int m_PartsTick;
+	int m_NumParts;
+	int m_PartsSize;
+	unsigned char m_aPartSeen[MAX_SNAP_PARTS];
+	int m_LastSnapTick;
+	int64 m_LastSnapTime;
+
+	int64 m_NextInput;
+	int64 m_NextChat;
+	int64 m_NextPing;
+	int64 m_PingSent;
+	int m_InputCount;
+	int m_ChatCount;
+	bool m_InfoSent;
+
+	void SendMsg(CMsgPacker *pMsg, int Flags, bool System);
+	void OnSystemMessage(int Msg, CUnpacker *pUnpacker, int64 Now);
+	void OnGameMessage(int Msg, CUnpacker *pUnpacker);
+	void OnSnapshot(int Tick, int Size, int64 Now);
+	void SendInput();
+	void SendChat();
+};
+
+bool CSimClient::Init(int Index, NETADDR *pServerAddr, const char *pPassword, int ChatInterval)
+{
+	NETADDR BindAddr;
+	mem_zero(&BindAddr, sizeof(BindAddr));
+	BindAddr.type = pServerAddr->type;
+	if(!m_Net.Open(BindAddr, 0))
+		return false;
+
+	m_Index = Index;
+	m_State = STATE_CONNECTING;
+	mem_zero(&m_Stats, sizeof(m_Stats));
+	mem_zero(&m_Total, sizeof(m_Total));
+	str_copy(m_aPassword, pPassword, sizeof(m_aPassword));
+	m_ChatInterval = ChatInterval;
+	m_MapCrc = 0;
+	m_MapChunk = 0;
+	m_MapBytes = 0;
+	m_LastMapData = 0;
+	m_AckTick = -1;
+	m_PartsTick = -1;
+	m_NumParts = 0;
+	m_PartsSize = 0;
+	m_LastSnapTick = -1;
+	m_LastSnapTime = 0;
+	m_NextInput = 0;
+	m_NextChat = 0;
+	m_NextPing = 0;
+	m_PingSent = 0;
+	m_InputCount = 0;
+	m_ChatCount = 0;
+	m_InfoSent = false;
+
+	m_Net.Connect(pServerAddr);
+	return true;
+}
+
+void CSimClient::Close(const char *pReason)
+{
+	if(m_State != STATE_OFFLINE && m_State != STATE_ERROR)
+		m_Net.Disconnect(pReason);
+	m_Net.Close();
+	m_State = STATE_OFFLINE;
+}
+
+void CSimClient::SendMsg(CMsgPacker *pMsg, int Flags, bool System)
+{
+	CNetChunk Packet;
+	mem_zero(&Packet, sizeof(Packet));
+	Packet.m_ClientID = 0;
+	Packet.m_pData = pMsg->Data();
+	Packet.m_DataSize = pMsg->Size();
+
+	// HACK: modify the message id in the packet and store the system flag
+	*((unsigned char *)Packet.m_pData) <<= 1;
+	if(System)
+		*((unsigned char *)Packet.m_pData) |= 1;
+
+	if(Flags&MSGFLAG_VITAL)
+		Packet.m_Flags |= NETSENDFLAG_VITAL;
+	if(Flags&MSGFLAG_FLUSH)
+		Packet.m_Flags |= NETSENDFLAG_FLUSH;
+
+	m_Stats.m_BytesOut += Packet.m_DataSize;
+	m_Net.Send(&Packet);
+}
+
+void CSimClient::SendInput()
+{
+	// walk back and forth, turn the aim around and fire, jump and hook now and then
+	int Step = m_InputCount++;
+	CNetObj_PlayerInput Input;
+	mem_zero(&Input, sizeof(Input));
+	Input.m_Direction = ((Step+m_Index*17)/75)%3 - 1;
+	float Angle = (Step+m_Index*31)*0.05f;
+	Input.m_TargetX = (int)(cosf(Angle)*200.0f);
+	Input.m_TargetY = (int)(sinf(Angle)*200.0f);
+	Input.m_Jump = (Step%60) < 3;
+	Input.m_Fire = Step/5; // odd while the trigger is held
+	Input.m_Hook = (Step%120) < 30;
+	Input.m_PlayerFlags = PLAYERFLAG_PLAYING;
+	Input.m_WantedWeapon = 0;
+
+	CMsgPacker Msg(NETMSG_INPUT);
+	Msg.AddInt(m_AckTick);
+	Msg.AddInt(m_AckTick+2);
+	Msg.AddInt(sizeof(Input));
+	int *pData = (int *)&Input;
+	for(unsigned i = 0; i < sizeof(Input)/sizeof(int); i++)
+		Msg.AddInt(pData[i]);
+	SendMsg(&Msg, MSGFLAG_FLUSH, true);
+}
+
+void CSimClient::SendChat()
+{
+	static const char *s_apLines[] = {"gg", "nice shot", "lol", "where are you", "one more round?", "brb", "wp"};
+	char aBuf[64];
+	str_format(aBuf, sizeof(aBuf), "%s (%d)", s_apLines[(m_Index+m_ChatCount)%(sizeof(s_apLines)/sizeof(s_apLines[0]))], m_ChatCount);
+	m_ChatCount++;
+
+	CNetMsg_Cl_Say Say;
+	Say.m_Team = 0;
+	Say.m_pMessage = aBuf;
+	CMsgPacker Msg(Say.MsgID());
+	Say.Pack(&Msg);
+	SendMsg(&Msg, MSGFLAG_VITAL, false);
+	m_Stats.m_Chats++;
+}
+
+void CSimClient::OnSnapshot(int Tick, int Size, int64 Now)
+{
+	m_Stats.m_Snaps++;
+	m_Stats.m_SnapBytes += Size;
+	m_Stats.m_MaxSnapBytes = max(m_Stats.m_MaxSnapBytes, Size);
+
+	if(m_LastSnapTick >= 0 && Tick > m_LastSnapTick)
+	{
+		int64 TickTime = (Now-m_LastSnapTime)/(Tick-m_LastSnapTick);
+		m_Stats.m_TickTime += TickTime;
+		m_Stats.m_MaxTickTime = max(m_Stats.m_MaxTickTime, TickTime);
+		m_Stats.m_TickSamples++;
+	}
+	if(Tick > m_LastSnapTick)
+	{
+		m_LastSnapTick = Tick;
+		m_LastSnapTime = Now;
+	}
+	if(Tick > m_AckTick)
+		m_AckTick = Tick;
+}
+
+void CSimClient::OnSystemMessage(int Msg, CUnpacker *pUnpacker, int64 Now)
+{
+	if(Msg == NETMSG_MAP_CHANGE)
+	{
+		pUnpacker->GetString(CUnpacker::SANITIZE_CC);
+		m_MapCrc = pUnpacker->GetInt();
+		if(pUnpacker->Error())
+			return;
+
+		m_State = STATE_LOADING;
+		m_MapChunk = 0;
+		m_MapBytes = 0;
+		m_LastMapData = Now;
+		m_AckTick = -1;
+		m_LastSnapTick = -1;
+
+		CMsgPacker Request(NETMSG_REQUEST_MAP_DATA);
+		Request.AddInt(m_MapChunk);
+		SendMsg(&Request, MSGFLAG_VITAL|MSGFLAG_FLUSH, true);
+	}
+	else if(Msg == NETMSG_MAP_DATA)
+	{
+		int Last = pUnpacker->GetInt();
+		int Crc = pUnpacker->GetInt();
+		int Chunk = pUnpacker->GetInt();
+		int Size = pUnpacker->GetInt();
+		pUnpacker->GetRaw(Size);
+		if(pUnpacker->Error() || m_State != STATE_LOADING || Crc != m_MapCrc || Chunk != m_MapChunk)
+			return;
+
+		m_MapBytes += Size;
+		m_MapChunk++;
+		m_LastMapData = Now;
+		if(Last)
+		{
+			dbg_msg("loadgen", "client %d downloaded the map (%d bytes)", m_Index, (int)m_MapBytes);
+			m_State = STATE_READY;
+			CMsgPacker Ready(NETMSG_READY);
+			SendMsg(&Ready, MSGFLAG_VITAL|MSGFLAG_FLUSH, true);
+		}
+		else
+		{
+			CMsgPacker Request(NETMSG_REQUEST_MAP_DATA);
+			Request.AddInt(m_MapChunk);
+			SendMsg(&Request, MSGFLAG_VITAL|MSGFLAG_FLUSH, true);
+		}
+	}
+	else if(Msg == NETMSG_CON_READY)
+	{
+		char aName[MAX_NAME_LENGTH];
+		str_format(aName, sizeof(aName), "loadgen %d", m_Index);
+
+		CNetMsg_Cl_StartInfo Info;
+		Info.m_pName = aName;
+		Info.m_pClan = "loadgen";
+		Info.m_Country = -1;
+		Info.m_pSkin = "default";
+		Info.m_UseCustomColor = 0;
+		Info.m_ColorBody = 0;
+		Info.m_ColorFeet = 0;
+		CMsgPacker Packer(Info.MsgID());
+		Info.Pack(&Packer);
+		SendMsg(&Packer, MSGFLAG_VITAL|MSGFLAG_FLUSH, false);
+	}
+	else if(Msg == NETMSG_SNAPSINGLE || Msg == NETMSG_SNAP || Msg == NETMSG_SNAPEMPTY)
+	{
+		int Tick = pUnpacker->GetInt();
+		pUnpacker->GetInt(); // delta tick
+		if(Msg == NETMSG_SNAPEMPTY)
+		{
+			if(!pUnpacker->Error())
+			{
+				m_Stats.m_EmptySnaps++;
+				OnSnapshot(Tick, 0, Now);
+			}
+			return;
+		}
+
+		int NumParts = 1;
+		int Part = 0;
+		if(Msg == NETMSG_SNAP)
+		{
+			NumParts = pUnpacker->GetInt();
+			Part = pUnpacker->GetInt();
+		}
+		pUnpacker->GetInt(); // crc
+		int Size = pUnpacker->GetInt();
+		pUnpacker->GetRaw(Size);
+		if(pUnpacker->Error() || NumParts < 1 || NumParts > MAX_SNAP_PARTS || Part < 0 || Part >= NumParts)
+			return;
+
+		// only snapshots with all parts count as received
+		if(Tick != m_PartsTick)
+		{
+			m_PartsTick = Tick;
+			m_NumParts = 0;
+			m_PartsSize = 0;
+			mem_zero(m_aPartSeen, sizeof(m_aPartSeen));
+		}
+		if(m_aPartSeen[Part])
+			return;
+		m_aPartSeen[Part] = 1;
+		m_PartsSize += Size;
+		if(++m_NumParts == NumParts)
+			OnSnapshot(Tick, m_PartsSize, Now);
+	}
+	else if(Msg == NETMSG_PING_REPLY)
+	{
+		if(m_PingSent)
+		{
+			int64 Ping = Now-m_PingSent;
+			m_Stats.m_Ping += Ping;
+			m_Stats.m_MaxPing = max(m_Stats.m_MaxPing, Ping);
+			m_Stats.m_Pings++;
+			m_PingSent = 0;
+		}
+	}
+}
+
+void CSimClient::OnGameMessage(int Msg, CUnpacker *pUnpacker)
+{
+	if(Msg == NETMSGTYPE_SV_READYTOENTER && m_State == STATE_READY)
+	{
+		m_State = STATE_INGAME;
+		CMsgPacker Enter(NETMSG_ENTERGAME);
+		SendMsg(&Enter, MSGFLAG_VITAL, true);
+
+		// servers with more than 16 slots only snap to ddnet clients
+		CNetMsg_Cl_IsDDNetLegacy Legacy;
+		CMsgPacker Version(Legacy.MsgID());
+		Legacy.Pack(&Version);
+		Version.AddInt(DDNET_VERSION);
+		SendMsg(&Version, MSGFLAG_VITAL|MSGFLAG_FLUSH, false);
+	}
+}
+
+void CSimClient::Update(int64 Now)
+{
+	if(m_State == STATE_OFFLINE || m_State == STATE_ERROR)
+		return;
+
+	m_Net.Update();
+	if(m_Net.State() == NETSTATE_OFFLINE)
+	{
+		dbg_msg("loadgen", "client %d lost the connection: %s", m_Index, m_Net.ErrorString());
+		m_State = STATE_ERROR;
+		return;
+	}
+
+	CNetChunk Packet;
+	while(m_Net.Recv(&Packet))
+	{
+		if(Packet.m_ClientID == -1)
+			continue;
+
+		m_Stats.m_BytesIn += Packet.m_DataSize;
+		CUnpacker Unpacker;
+		Unpacker.Reset(Packet.m_pData, Packet.m_DataSize);
+		int Msg = Unpacker.GetInt();
+		int Sys = Msg&1;
+		Msg >>= 1;
+		if(Unpacker.Error())
+			continue;
+
+		if(Sys)
+			OnSystemMessage(Msg, &Unpacker, Now);
+		else
+			OnGameMessage(Msg, &Unpacker);
+	}
+
+	if(m_State == STATE_CONNECTING && m_Net.State() == NETSTATE_ONLINE && !m_InfoSent)
+	{
+		CMsgPacker Info(NETMSG_INFO);
+		Info.AddString(GAME_NETVERSION, 128);
+		Info.AddString(m_aPassword, 128);
+		SendMsg(&Info, MSGFLAG_VITAL|MSGFLAG_FLUSH, true);
+		m_InfoSent = true;
+	}
+
+	// ask again for map data that got lost on the way
+	if(m_State == STATE_LOADING && Now > m_LastMapData + time_freq())
+	{
+		m_LastMapData = Now;
+		CMsgPacker Request(NETMSG_REQUEST_MAP_DATA);
+		Request.AddInt(m_MapChunk);
+		SendMsg(&Request, MSGFLAG_VITAL|MSGFLAG_FLUSH, true);
+	}
+
+	if(m_State != STATE_INGAME)
+		return;
+
+	if(Now >= m_NextInput)
+	{
+		SendInput();
+		m_NextInput = max(m_NextInput + time_freq()/SERVER_TICK_SPEED, Now - time_freq());
+	}
+
+	if(m_ChatInterval > 0 && Now >= m_NextChat)
+	{
+		if(m_NextChat)
+			SendChat();
+		// spread the clients over the interval
+		m_NextChat = Now + time_freq()*m_ChatInterval + (m_NextChat ? 0 : time_freq()*m_ChatInterval*m_Index/MAX_SIM_CLIENTS);
+	}
+
+	if(Now >= m_NextPing && !m_PingSent)
+	{
+		CMsgPacker Ping(NETMSG_PING);
+		SendMsg(&Ping, MSGFLAG_FLUSH, true);
+		m_PingSent = Now;
+		m_NextPing = Now + time_freq();
+	}
+}
+
+static void PrintStats(const char *pPrefix, const CStats *pStats, int NumClients, int NumIngame, double Seconds)
+{
+	double Freq = (double)time_freq();
+	double PerClient = NumIngame ? Seconds*NumIngame : Seconds;
+	dbg_msg("loadgen", "%s ingame=%d/%d tick=%.2fms max_tick=%.2fms ping=%.2fms max_ping=%.2fms snaps=%d empty=%d avg_snap=%dB max_snap=%dB in=%.0fB/s out=%.0fB/s per client chat=%d",
+		pPrefix, NumIngame, NumClients,
+		pStats->m_TickSamples ? pStats->m_TickTime*1000.0/Freq/pStats->m_TickSamples : 0.0,
+		pStats->m_MaxTickTime*1000.0/Freq,
+		pStats->m_Pings ? pStats->m_Ping*1000.0/Freq/pStats->m_Pings : 0.0,
+		pStats->m_MaxPing*1000.0/Freq,
+		pStats->m_Snaps, pStats->m_EmptySnaps,
+		pStats->m_Snaps-pStats->m_EmptySnaps > 0 ? (int)(pStats->m_SnapBytes/(pStats->m_Snaps-pStats->m_EmptySnaps)) : 0,
+		pStats->m_MaxSnapBytes,
+		pStats->m_BytesIn/PerClient, pStats->m_BytesOut/PerClient,
+		pStats->m_Chats);
+}
+
+static CSimClient s_aClients[MAX_SIM_CLIENTS];
+
+static void Usage(const char *pName)
+{
+	dbg_msg("loadgen", "usage: %s [-n clients] [-t seconds] [-c chat interval] [-p password] [address]", pName);
+	dbg_msg("loadgen", "defaults: 16 clients, 60 seconds, chat every 20 seconds, 127.0.0.1:8303");
+}
+
+int main(int argc, const char **argv)
+{
+	dbg_logger_stdout();
+	net_init();
+	CNetBase::Init();
+
+	int NumClients = 16;
+	int Duration = 60;
+	int ChatInterval = 20;
+	const char *pPassword = "";
+	const char *pAddress = "127.0.0.1:8303";
+	for(int i = 1; i < argc; i++)
+	{
+		if(i+1 < argc && str_comp(argv[i], "-n") == 0)
+			NumClients = clamp(str_toint(argv[++i]), 1, (int)MAX_SIM_CLIENTS);
+		else if(i+1 < argc && str_comp(argv[i], "-t") == 0)
+			Duration = max(str_toint(argv[++i]), 1);
+		else if(i+1 < argc && str_comp(argv[i], "-c") == 0)
+			ChatInterval = max(str_toint(argv[++i]), 0);
+		else if(i+1 < argc && str_comp(argv[i], "-p") == 0)
+			pPassword = argv[++i];
+		else if(argv[i][0] != '-')
+			pAddress = argv[i];
+		else
+		{
+			Usage(argv[0]);
+			return -1;
+		}
+	}
+
+	NETADDR ServerAddr;
+	if(net_host_lookup(pAddress, &ServerAddr, NETTYPE_ALL) != 0)
+	{
+		dbg_msg("loadgen", "couldn't resolve '%s'", pAddress);
+		return -1;
+	}
+	if(!ServerAddr.port)
+		ServerAddr.port = 8303;
+
+	for(int i = 0; i < NumClients; i++)
+	{
+		if(!s_aClients[i].Init(i, &ServerAddr, pPassword, ChatInterval))
+		{
+			dbg_msg("loadgen", "couldn't open a socket for client %d", i);
+			return -1;
+		}
+	}
+	dbg_msg("loadgen", "connecting %d clients to %s for %d seconds", NumClients, pAddress, Duration);
+
+	int64 Start = time_get();
+	int64 LastReport = Start;
+	CStats Total;
+	mem_zero(&Total, sizeof(Total));
+	while(1)
+	{
+		int64 Now = time_get();
+		for(int i = 0; i < NumClients; i++)
+			s_aClients[i].Update(Now);
+
+		if(Now-LastReport >= time_freq() || Now-Start >= Duration*time_freq())
+		{
+			CStats Interval;
+			mem_zero(&Interval, sizeof(Interval));
+			int NumIngame = 0;
+			for(int i = 0; i < NumClients; i++)
+			{
+				if(s_aClients[i].m_State == CSimClient::STATE_INGAME)
+					NumIngame++;
+				Interval.Add(s_aClients[i].m_Stats);
+				s_aClients[i].m_Total.Add(s_aClients[i].m_Stats);
+				mem_zero(&s_aClients[i].m_Stats, sizeof(s_aClients[i].m_Stats));
+			}
+			PrintStats("interval", &Interval, NumClients, NumIngame, (Now-LastReport)/(double)time_freq());
+			Total.Add(Interval);
+			LastReport = Now;
+
+			if(Now-Start >= Duration*time_freq())
+			{
+				PrintStats("total", &Total, NumClients, NumIngame, (Now-Start)/(double)time_freq());
+				for(int i = 0; i < NumClients; i++)
+				{
+					char aBuf[32];
+					str_format(aBuf, sizeof(aBuf), "client %d", i);
+					PrintStats(aBuf, &s_aClients[i].m_Total, 1, s_aClients[i].m_State == CSimClient::STATE_INGAME, (Now-Start)/(double)time_freq());
+				}
+				break;
+			}
+		}
+
+		thread_sleep(1);
+	}
+
+	for(int i = 0; i < NumClients; i++)
+		s_aClients[i].Close("load test done");
+	return 0;
+}
@@ -0,0 +1,100 @@
+/* File is created for the TW+ mod
+ */
+
+#include <base/system.h>
+
+#include <engine/shared/linereader.h>
+
+/*
+	Compares the world hashes two builds wrote while replaying the same
+	tick record (dbg_tickreplay with dbg_tickhash) and reports the first
+	tick and entity where they went apart.
+
+	Returns 0 when both streams match, 1 when they differ.
+*/
+
+static bool IsTickLine(const char *pLine)
+{
+	return str_comp_num(pLine, "tick ", 5) == 0;
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+	if(argc != 3) // ignore_convention
+	{
+		dbg_msg("tickdiff", "usage: %s <hashes a> <hashes b>", argv[0]); // ignore_convention
+		return -1;
+	}
+
+	IOHANDLE aFiles[2];
+	CLineReader aReaders[2];
+	for(int i = 0; i < 2; i++)
+	{
+		aFiles[i] = io_open(argv[i+1], IOFLAG_READ); // ignore_convention
+		if(!aFiles[i])
+		{
+			dbg_msg("tickdiff", "failed to open '%s'", argv[i+1]); // ignore_convention
+			return -1;
+		}
+		aReaders[i].Init(aFiles[i]);
+	}
+
+	int Result = 0;
+	int NumTicks = 0;
+	int Tick = -1;
+	bool TickDiffers = false;
+	while(1)
+	{
+		const char *pA = aReaders[0].Get();
+		const char *pB = aReaders[1].Get();
+		if(!pA && !pB)
+		{
+			if(TickDiffers)
+			{
+				dbg_msg("tickdiff", "the worlds differ at tick %d", Tick);
+				Result = 1;
+			}
+			else
+				dbg_msg("tickdiff", "identical for %d ticks", NumTicks);
+			break;
+		}
+		if(!pA || !pB)
+		{
+			dbg_msg("tickdiff", "'%s' ends after tick %d", argv[pA ? 2 : 1], Tick); // ignore_convention
+			Result = 1;
+			break;
+		}
+
+		if(IsTickLine(pA))
+		{
+			// a differing tick hash with equal entities can only mean a changed entity count
+			if(TickDiffers)
+			{
+				dbg_msg("tickdiff", "the worlds differ at tick %d", Tick);
+				Result = 1;
+				break;
+			}
+			Tick = str_toint(pA+5);
+			NumTicks++;
+		}
+
+		if(str_comp(pA, pB) == 0)
+			continue;
+
+		// the tick line only tells that something differs, the entity lines below it tell what
+		if(IsTickLine(pA) && IsTickLine(pB))
+		{
+			TickDiffers = true;
+			continue;
+		}
+
+		dbg_msg("tickdiff", "first divergence at tick %d: '%s' against '%s'", Tick, pA, pB);
+		Result = 1;
+		break;
+	}
+
+	io_close(aFiles[0]);
+	io_close(aFiles[1]);
+	return Result;
+}